@@ -0,0 +1,179 @@
+/**
+ * @file gldebug.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Captures KHR_debug driver messages (errors, performance warnings such as buffer stalls, recompiles and implicit syncs) into a structured log with per-frame counts
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "gldebug.h"
+
+#include "log.h"
+
+/**
+ * @brief Forwards driver messages to the GLDebugLog passed as userParam
+ */
+static void GLAPIENTRY debugCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* userParam) {
+    GLDebugLog* log = (GLDebugLog*)userParam;
+    log->record(source, type, id, severity, message);
+}
+
+/**
+ * @brief Construct a new GLDebugLog object
+ *
+ * @param path File the structured records are written to
+ */
+GLDebugLog::GLDebugLog(const char* path) : frame(0), installed(false) {
+    file.open(path, std::ios::out | std::ios::trunc);
+}
+
+/**
+ * @brief Destroy the GLDebugLog object. Detaches the callback first so no message arrives mid-destruction
+ */
+GLDebugLog::~GLDebugLog() {
+    if (GLEW_KHR_debug || GLEW_VERSION_4_3)
+        glDebugMessageCallback(NULL, NULL);
+    file.close();
+}
+
+/**
+ * @brief Enables debug output and installs the callback. Requires a context created with SDL_GL_CONTEXT_DEBUG_FLAG to receive everything
+ *
+ * @return bool representing the success of the operation
+ */
+bool GLDebugLog::install() {
+    if (!(GLEW_KHR_debug || GLEW_VERSION_4_3))
+        return false;
+
+    glEnable(GL_DEBUG_OUTPUT);
+    // messages arrive on the thread and inside the call that caused them, so they can be attributed to a frame
+    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    glDebugMessageCallback(debugCallback, this);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+    installed = true;
+    return true;
+}
+
+/**
+ * @brief Starts attributing messages to a new frame
+ *
+ * @param frame Frame number
+ */
+void GLDebugLog::beginFrame(int frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->frame = frame;
+    frameCounts.clear();
+}
+
+/**
+ * @brief Drains glGetError. Without debug output the errors are logged from here; with it the callback has already logged them,
+ * so they are only cleared
+ */
+void GLDebugLog::pollErrors() {
+    GLenum error;
+    while ((error = glGetError()) != GL_NO_ERROR) {
+        if (installed)
+            continue;
+        char message[64];
+        snprintf(message, sizeof(message), "glGetError 0x%04X", error);
+        record(GL_DEBUG_SOURCE_API, GL_DEBUG_TYPE_ERROR, error, GL_DEBUG_SEVERITY_HIGH, message);
+    }
+}
+
+/**
+ * @brief Publishes the current frame's message counts
+ *
+ * @param profiler Profiler receiving the counters of the current frame
+ */
+void GLDebugLog::report(Profiler* profiler) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& it : frameCounts)
+        profiler->setCounter(string("gldebug.") + it.first, it.second);
+}
+
+/**
+ * @brief Counts a message and writes it as a structured record. Repeated messages stop being written after GL_DEBUG_REPEAT_LIMIT occurrences
+ *
+ * @param source GL_DEBUG_SOURCE_*
+ * @param type GL_DEBUG_TYPE_*
+ * @param id Implementation-defined message id
+ * @param severity GL_DEBUG_SEVERITY_*
+ * @param message Message text
+ */
+void GLDebugLog::record(GLenum source, GLenum type, GLuint id, GLenum severity, const char* message) {
+    std::lock_guard<std::mutex> lock(mutex);
+    frameCounts[typeName(type)] ++;
+
+    unsigned long long key = ((unsigned long long)source << 48) ^ ((unsigned long long)type << 32) ^ id;
+    int seen = ++ repeats[key];
+    if (seen > GL_DEBUG_REPEAT_LIMIT)
+        return;
+
+    file << "frame=" << frame
+         << " source=" << sourceName(source)
+         << " type=" << typeName(type)
+         << " severity=" << severityName(severity)
+         << " id=" << id
+         << " msg=\"" << message << "\"";
+    if (seen == GL_DEBUG_REPEAT_LIMIT)
+        file << " suppressed=true";
+    file << "\n";
+
+    if (type == GL_DEBUG_TYPE_ERROR)
+        LOG_ERROR("gl", "GL error (id %u): %s", id, message);
+}
+
+/**
+ * @brief Short name of a debug message source
+ *
+ * @param source GL_DEBUG_SOURCE_*
+ * @return const char*
+ */
+const char* GLDebugLog::sourceName(GLenum source) {
+    switch (source) {
+        case GL_DEBUG_SOURCE_API:               return "api";
+        case GL_DEBUG_SOURCE_WINDOW_SYSTEM:     return "window_system";
+        case GL_DEBUG_SOURCE_SHADER_COMPILER:   return "shader_compiler";
+        case GL_DEBUG_SOURCE_THIRD_PARTY:       return "third_party";
+        case GL_DEBUG_SOURCE_APPLICATION:       return "application";
+        default:                                return "other";
+    }
+}
+
+/**
+ * @brief Short name of a debug message type
+ *
+ * @param type GL_DEBUG_TYPE_*
+ * @return const char*
+ */
+const char* GLDebugLog::typeName(GLenum type) {
+    switch (type) {
+        case GL_DEBUG_TYPE_ERROR:               return "error";
+        case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+        case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined";
+        case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+        case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+        case GL_DEBUG_TYPE_MARKER:              return "marker";
+        case GL_DEBUG_TYPE_PUSH_GROUP:          return "push_group";
+        case GL_DEBUG_TYPE_POP_GROUP:           return "pop_group";
+        default:                                return "other";
+    }
+}
+
+/**
+ * @brief Short name of a debug message severity
+ *
+ * @param severity GL_DEBUG_SEVERITY_*
+ * @return const char*
+ */
+const char* GLDebugLog::severityName(GLenum severity) {
+    switch (severity) {
+        case GL_DEBUG_SEVERITY_HIGH:            return "high";
+        case GL_DEBUG_SEVERITY_MEDIUM:          return "medium";
+        case GL_DEBUG_SEVERITY_LOW:             return "low";
+        case GL_DEBUG_SEVERITY_NOTIFICATION:    return "notification";
+        default:                                return "unknown";
+    }
+}
@@ -0,0 +1,62 @@
+/**
+ * @file gldebug.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Captures KHR_debug driver messages (errors, performance warnings such as buffer stalls, recompiles and implicit syncs) into a structured log with per-frame counts
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef GLDEBUG_H
+#define GLDEBUG_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+using std::string;
+
+#include "profiler.h"
+
+#define GL_DEBUG_LOG_PATH "gl_debug.log"
+
+// identical messages (same source/type/id) are written out this many times, then only counted
+#define GL_DEBUG_REPEAT_LIMIT 16
+
+/**
+ * @brief Receives driver debug messages through glDebugMessageCallback and writes them as key=value records
+ *
+ * Each record is one line: frame, source, type, severity, id, and the quoted message. Per-frame counts by message type are published as "gldebug.<type>" counters
+ */
+class GLDebugLog {
+    public:
+        GLDebugLog(const char* path = GL_DEBUG_LOG_PATH);
+        ~GLDebugLog();
+
+        bool install();
+
+        void beginFrame(int frame);
+        void pollErrors();
+        void report(Profiler* profiler);
+
+        void record(GLenum source, GLenum type, GLuint id, GLenum severity, const char* message);
+
+        static const char* sourceName(GLenum source);
+        static const char* typeName(GLenum type);
+        static const char* severityName(GLenum severity);
+
+    private:
+        std::mutex mutex;   // drivers may call back from their own threads
+        std::ofstream file;
+        int frame;
+        bool installed;     // the callback reports errors, so glGetError is only drained
+
+        std::map<string, int> frameCounts;  // messages of the current frame, by type
+        std::map<unsigned long long, int> repeats;
+};
+
+#endif
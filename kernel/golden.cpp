@@ -0,0 +1,325 @@
+/**
+ * @file golden.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Golden-image checks of the renderer: chosen frames of a fixed-step headless run are read back and compared with stored images by SSIM, writing the frame and a diff image when they disagree. Meant to run on Mesa's llvmpipe, so results do not depend on the GPU
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "golden.h"
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+/**
+ * @brief Construct a new empty GoldenImage object
+ */
+GoldenImage::GoldenImage() : frame(0), width(0), height(0) {}
+
+/**
+ * @brief Asks Mesa for its llvmpipe software rasterizer. Must be called before the GL library is loaded (before SDL_Init); drivers other than Mesa ignore it
+ */
+void requestSoftwareGL() {
+    SDL_setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+    SDL_setenv("GALLIUM_DRIVER", "llvmpipe", 1);
+}
+
+/**
+ * @brief Returns whether a GL renderer string names a software rasterizer
+ *
+ * @param device GL_RENDERER (and version) of the context
+ * @return bool
+ */
+bool isSoftwareGL(const string& device) {
+    return device.find("llvmpipe") != string::npos || device.find("softpipe") != string::npos;
+}
+
+/**
+ * @brief Reads the back buffer of the current context. Call after rendering a frame and before swapping it
+ *
+ * @param width Width of the framebuffer
+ * @param height Height of the framebuffer
+ * @param frame Frame number to tag the image with
+ * @param image Receives the pixels
+ * @return bool false when GL reported an error
+ */
+bool captureFramebuffer(int width, int height, int frame, GoldenImage& image) {
+    image.frame = frame;
+    image.width = width;
+    image.height = height;
+    image.rgb.assign((size_t)width * height * 3, 0);
+
+    vector<unsigned char> flipped(image.rgb.size());
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glReadBuffer(GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &flipped[0]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+    // GL rows go bottom to top
+    size_t row = (size_t)width * 3;
+    for (int y = 0; y < height; y ++)
+        memcpy(&image.rgb[y * row], &flipped[(height - 1 - y) * row], row);
+    return glGetError() == GL_NO_ERROR;
+}
+
+/**
+ * @brief Loads an image file (any format SDL_image reads) as RGB
+ *
+ * @param path Path of the file
+ * @param image Receives the pixels
+ * @param error Receives the problem on failure
+ * @return bool representing the success of the operation
+ */
+bool loadImage(const string& path, GoldenImage& image, string& error) {
+    SDL_Surface* loaded = IMG_Load(path.c_str());
+    if (loaded == NULL) {
+        error = IMG_GetError();
+        return false;
+    }
+    SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGB24, 0);
+    SDL_FreeSurface(loaded);
+    if (surface == NULL) {
+        error = SDL_GetError();
+        return false;
+    }
+
+    image.frame = 0;
+    image.width = surface->w;
+    image.height = surface->h;
+    image.rgb.resize((size_t)surface->w * surface->h * 3);
+    SDL_LockSurface(surface);
+    for (int y = 0; y < surface->h; y ++)
+        memcpy(&image.rgb[(size_t)y * surface->w * 3], (unsigned char*)surface->pixels + y * surface->pitch, surface->w * 3);
+    SDL_UnlockSurface(surface);
+    SDL_FreeSurface(surface);
+    return true;
+}
+
+/**
+ * @brief Writes an image as PNG, creating its directory if needed
+ *
+ * @param path Path of the file
+ * @param image Image to write
+ * @return bool representing the success of the operation
+ */
+bool saveImage(const string& path, const GoldenImage& image) {
+    if (image.rgb.empty())
+        return false;
+    size_t slash = path.find_last_of('/');
+    if (slash != string::npos) {
+#ifdef _WIN32
+        _mkdir(path.substr(0, slash).c_str());
+#else
+        mkdir(path.substr(0, slash).c_str(), 0755);
+#endif
+    }
+
+    SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormatFrom((void*)&image.rgb[0], image.width, image.height, 24, image.width * 3, SDL_PIXELFORMAT_RGB24);
+    if (surface == NULL)
+        return false;
+    bool saved = IMG_SavePNG(surface, path.c_str()) == 0;
+    SDL_FreeSurface(surface);
+    return saved;
+}
+
+/**
+ * @brief Mean structural similarity (Wang et al. 2004) of the luma of two images of the same size, over GOLDEN_WINDOW-pixel windows every GOLDEN_STEP pixels
+ *
+ * @param a First image
+ * @param b Second image
+ * @return double in [-1, 1], 1 when the images are identical; 0 when their sizes differ
+ */
+double computeSSIM(const GoldenImage& a, const GoldenImage& b) {
+    if (a.width != b.width || a.height != b.height || a.width < GOLDEN_WINDOW || a.height < GOLDEN_WINDOW)
+        return 0;
+
+    const double C1 = (0.01 * 255) * (0.01 * 255), C2 = (0.03 * 255) * (0.03 * 255);
+    vector<double> la(a.width * a.height), lb(la.size());
+    for (size_t i = 0; i < la.size(); i ++) {
+        la[i] = 0.299 * a.rgb[i * 3] + 0.587 * a.rgb[i * 3 + 1] + 0.114 * a.rgb[i * 3 + 2];
+        lb[i] = 0.299 * b.rgb[i * 3] + 0.587 * b.rgb[i * 3 + 1] + 0.114 * b.rgb[i * 3 + 2];
+    }
+
+    double sum = 0;
+    int windows = 0;
+    const int n = GOLDEN_WINDOW * GOLDEN_WINDOW;
+    for (int y = 0; y + GOLDEN_WINDOW <= a.height; y += GOLDEN_STEP) {
+        for (int x = 0; x + GOLDEN_WINDOW <= a.width; x += GOLDEN_STEP) {
+            double sa = 0, sb = 0, saa = 0, sbb = 0, sab = 0;
+            for (int wy = 0; wy < GOLDEN_WINDOW; wy ++) {
+                for (int wx = 0; wx < GOLDEN_WINDOW; wx ++) {
+                    double va = la[(y + wy) * a.width + x + wx], vb = lb[(y + wy) * a.width + x + wx];
+                    sa += va; sb += vb;
+                    saa += va * va; sbb += vb * vb; sab += va * vb;
+                }
+            }
+            double ma = sa / n, mb = sb / n;
+            double varA = saa / n - ma * ma, varB = sbb / n - mb * mb, cov = sab / n - ma * mb;
+            sum += ((2 * ma * mb + C1) * (2 * cov + C2)) / ((ma * ma + mb * mb + C1) * (varA + varB + C2));
+            windows ++;
+        }
+    }
+    return sum / windows;
+}
+
+/**
+ * @brief Builds an image showing where two images differ: the golden image darkened to gray, with channel differences (scaled by GOLDEN_DIFF_GAIN) in red
+ *
+ * @param golden Expected image
+ * @param actual Rendered image, the same size
+ * @param diff Receives the diff image
+ */
+void diffImage(const GoldenImage& golden, const GoldenImage& actual, GoldenImage& diff) {
+    diff.frame = actual.frame;
+    diff.width = golden.width;
+    diff.height = golden.height;
+    diff.rgb.resize(golden.rgb.size());
+    for (size_t i = 0; i + 2 < golden.rgb.size() && i + 2 < actual.rgb.size(); i += 3) {
+        int d = 0;
+        for (int c = 0; c < 3; c ++)
+            d = std::max(d, abs((int)golden.rgb[i + c] - (int)actual.rgb[i + c]));
+        unsigned char gray = (unsigned char)((golden.rgb[i] + golden.rgb[i + 1] + golden.rgb[i + 2]) / 12);
+        diff.rgb[i] = (unsigned char)std::min(255, gray + d * GOLDEN_DIFF_GAIN);
+        diff.rgb[i + 1] = gray;
+        diff.rgb[i + 2] = gray;
+    }
+}
+
+/**
+ * @brief Returns where the golden image of a frame of a scenario is kept
+ *
+ * @param directory Golden directory
+ * @param scenario Scenario
+ * @param frame Frame number
+ * @param suffix "" for the golden image, or e.g. ".actual" and ".diff" for the images written next to it on failure
+ * @return string
+ */
+string goldenPath(const string& directory, const Scenario& scenario, int frame, const string& suffix) {
+    string slug;
+    for (char c : scenario.name)
+        slug += isalnum((unsigned char)c) ? (char)tolower((unsigned char)c) : '_';
+    return directory + "/" + slug + "-" + std::to_string(frame) + suffix + ".png";
+}
+
+/**
+ * @brief Compares captured frames with their golden images, writing the frame and a diff image next to each one that fails; or records them as the golden images
+ *
+ * @param directory Golden directory
+ * @param scenario Scenario the frames were captured from
+ * @param captures Captured frames
+ * @param minSSIM SSIM below which a frame fails
+ * @param update Whether to record the captures as golden images instead of comparing
+ * @param recordMissing Whether to record the captures that have no golden image yet, and compare the others
+ * @return vector<GoldenResult> one per capture
+ */
+vector<GoldenResult> compareGoldens(const string& directory, const Scenario& scenario, const vector<GoldenImage>& captures, double minSSIM, bool update, bool recordMissing) {
+    vector<GoldenResult> results;
+    for (const GoldenImage& actual : captures) {
+        GoldenResult result;
+        result.frame = actual.frame;
+        result.path = goldenPath(directory, scenario, actual.frame, "");
+        result.ssim = 0;
+        result.maxDiff = 0;
+        result.passed = false;
+        result.missing = false;
+
+        GoldenImage golden;
+        string error;
+        if (update) {
+            result.passed = saveImage(result.path, actual);
+            result.ssim = 1;
+            result.status = result.passed ? "recorded" : "unable to write " + result.path;
+        } else if (!loadImage(result.path, golden, error)) {
+            // a missing image is not a mismatch: the first run on a clean checkout records the images, or reports them missing
+            if (recordMissing) {
+                result.passed = saveImage(result.path, actual);
+                result.ssim = 1;
+                result.status = result.passed ? "recorded (had no golden image)" : "unable to write " + result.path;
+            } else {
+                result.missing = true;
+                result.status = "no golden image (" + error + "); record it with --golden-record-missing or --golden-update";
+            }
+        } else if (golden.width != actual.width || golden.height != actual.height) {
+            result.status = "golden image is " + std::to_string(golden.width) + "x" + std::to_string(golden.height) + ", frame is "
+                + std::to_string(actual.width) + "x" + std::to_string(actual.height);
+        } else {
+            result.ssim = computeSSIM(golden, actual);
+            for (size_t i = 0; i < golden.rgb.size(); i ++)
+                result.maxDiff = std::max(result.maxDiff, abs((int)golden.rgb[i] - (int)actual.rgb[i]));
+            result.passed = result.ssim >= minSSIM;
+            result.status = result.passed ? "ok" : "differs";
+        }
+
+        // what was rendered, and where, so a failure can be looked at without rerunning
+        if (!result.passed && !result.missing && !update) {
+            saveImage(goldenPath(directory, scenario, actual.frame, ".actual"), actual);
+            if (golden.width == actual.width && golden.height == actual.height) {
+                GoldenImage diff;
+                diffImage(golden, actual, diff);
+                saveImage(goldenPath(directory, scenario, actual.frame, ".diff"), diff);
+            }
+        }
+        results.push_back(result);
+    }
+    return results;
+}
+
+/**
+ * @brief Returns whether every frame matched its golden image
+ *
+ * @param results Results of a run
+ * @return bool
+ */
+bool goldensPassed(const vector<GoldenResult>& results) {
+    for (const GoldenResult& result : results) {
+        if (!result.passed && !result.missing)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Returns whether any frame had no golden image to compare with
+ *
+ * @param results Results of a run
+ * @return bool
+ */
+bool goldensMissing(const vector<GoldenResult>& results) {
+    for (const GoldenResult& result : results) {
+        if (result.missing)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Prints a line per compared frame
+ *
+ * @param name Name of the scenario
+ * @param device GL renderer the frames were rendered with
+ * @param results Results of the run
+ */
+void printGoldenReport(const string& name, const string& device, const vector<GoldenResult>& results) {
+    printf("%s: rendered with %s\n", name.c_str(), device.c_str());
+    printf("  %6s %8s %9s  %s\n", "frame", "ssim", "max diff", "golden");
+    for (const GoldenResult& result : results)
+        printf("  %6d %8.5f %9d  %s: %s\n", result.frame, result.ssim, result.maxDiff, result.path.c_str(), result.status.c_str());
+}
@@ -0,0 +1,74 @@
+/**
+ * @file golden.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Golden-image checks of the renderer: chosen frames of a fixed-step headless run are read back and compared with stored images by SSIM, writing the frame and a diff image when they disagree. Meant to run on Mesa's llvmpipe, so results do not depend on the GPU
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef GOLDEN_H
+#define GOLDEN_H
+
+#include "scenario.h"
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#define GOLDEN_DIR "golden"
+// frames captured unless --golden-frames says otherwise
+#define GOLDEN_FRAMES "1,30,60"
+// simulation step of golden runs whose scenario uses wall-clock time, which no image could match
+#define GOLDEN_TIME_STEP (1.0f / 60)
+// mean SSIM below which a frame fails; llvmpipe is deterministic, so this only absorbs rasterization and driver-version noise
+#define GOLDEN_MIN_SSIM 0.99
+// side and step of the SSIM windows, in pixels
+#define GOLDEN_WINDOW 8
+#define GOLDEN_STEP 4
+// factor the diff image scales channel differences by
+#define GOLDEN_DIFF_GAIN 8
+
+/**
+ * @brief An 8-bit RGB image, rows top to bottom
+ */
+struct GoldenImage {
+    int frame;                  // frame it was captured on, 0 when loaded from disk
+    int width, height;
+    vector<unsigned char> rgb;
+
+    GoldenImage();
+};
+
+/**
+ * @brief How one captured frame compared with its golden image
+ */
+struct GoldenResult {
+    int frame;
+    string path;        // golden image
+    double ssim;        // mean SSIM of the luma, 1 when identical
+    int maxDiff;        // largest channel difference, 0-255
+    bool passed;
+    bool missing;       // no golden image to compare with (not a failure, see goldensMissing)
+    string status;      // "ok", "recorded", or what went wrong
+};
+
+void requestSoftwareGL();
+bool isSoftwareGL(const string& device);
+
+bool captureFramebuffer(int width, int height, int frame, GoldenImage& image);
+bool loadImage(const string& path, GoldenImage& image, string& error);
+bool saveImage(const string& path, const GoldenImage& image);
+
+double computeSSIM(const GoldenImage& a, const GoldenImage& b);
+void diffImage(const GoldenImage& golden, const GoldenImage& actual, GoldenImage& diff);
+
+string goldenPath(const string& directory, const Scenario& scenario, int frame, const string& suffix);
+vector<GoldenResult> compareGoldens(const string& directory, const Scenario& scenario, const vector<GoldenImage>& captures, double minSSIM, bool update, bool recordMissing);
+bool goldensPassed(const vector<GoldenResult>& results);
+bool goldensMissing(const vector<GoldenResult>& results);
+void printGoldenReport(const string& name, const string& device, const vector<GoldenResult>& results);
+
+#endif
@@ -14,26 +14,115 @@
 #include "../objects/water.h"
 #include "../objects/camera.h"
 
+// fonts tried for the overlay, in order: a bundled one, then common system fonts
+static const char* OVERLAY_FONTS[] = {
+    "resources/fonts/overlay.ttf",
+    "C:/Windows/Fonts/consola.ttf",
+    "C:/Windows/Fonts/cour.ttf",
+    "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+    "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+    "/System/Library/Fonts/Menlo.ttc"
+};
+
 /**
  * @brief Construct a new Kernel::Kernel object
  */
 Kernel::Kernel() {
-    std::cout << "Reached line " << __LINE__ << " in " << __FILE__ << std::endl;
     rx = 0;
     ry = 0;
     isRunning = false;
+
+    window = NULL;
+    renderer = NULL;
+    glContext = NULL;
+
+    wDown = aDown = sDown = dDown = spDown = shDown = ctDown = false;
+    relX = relY = 0;
+
+    sceneRenderer = NULL;
+    camera = NULL;
+    water = NULL;
+    water_shader = NULL;
+    particles = NULL;
+    foam = NULL;
+    caustics = NULL;
+    pool = NULL;
+    validationTolerance = 0;
+    validator = NULL;
+    particleValidator = NULL;
+    backpack_shader = NULL;
+    backpack_model = NULL;
+    profiler = NULL;
+    recorder = NULL;
+    overlay = NULL;
+    historyCursor = 0;
+    for (int i = 0; i < OVERLAY_GRAPH_FRAMES; i ++)
+        frameHistory[i] = 0;
+    metricsPort = 0;
+    metrics = NULL;
+    debugContext = false;
+    gl_debug = NULL;
+    reflection = NULL;
+    sky = NULL;
+    skybox = NULL;
+    backpack_instances = NULL;
+    cull_shader = NULL;
+    cluster_shader = NULL;
+    backpack_materials = NULL;
+    animator = NULL;
+    skinner = NULL;
+    skin_shader = NULL;
+    animationTime = 0;
+    hiz = NULL;
+    setScenario(Scenario());
 }
 
 /**
  * @brief Destroy the Kernel::Kernel object
  */
 Kernel::~Kernel() {
+    delete metrics;
+
+    // GL objects are released by their owners' handles, so everything holding one goes before the context
+    delete backpack_instances;
+    delete cull_shader;
+    delete cluster_shader;
+    delete backpack_materials;
+    delete skinner;
+    delete skin_shader;
+    delete animator;
+    delete hiz;
+    delete backpack_model;
+    delete backpack_shader;
+    delete validator;
+    delete particleValidator;
+    delete particles;
+    delete foam;
+    delete caustics;
+    delete sceneRenderer;
+    delete water;
+    delete water_shader;
+    delete pool;
+    delete reflection;
+    delete sky;
+    delete skybox;
+    delete camera;
+    delete overlay;
+    delete profiler;
+    delete recorder;
+    GLResourceRegistry::get().checkLeaks();
+    // detaches the debug callback, so must go before the context
+    delete gl_debug;
+
     SDL_DestroyRenderer(renderer);
     SDL_GL_DeleteContext(glContext);
     SDL_DestroyWindow(window);
 
     renderer = NULL;
     window = NULL;
+
+    if (TTF_WasInit())
+        TTF_Quit();
 }
 
 /**
@@ -43,15 +132,33 @@ Kernel::~Kernel() {
  */
 bool Kernel::initSDL() {
     if (SDL_Init(SDL_INIT_NOPARACHUTE) && SDL_Init(SDL_INIT_EVERYTHING) != 0) {
-        SDL_Log("Unable to initialize SDL: %s\n", SDL_GetError());
+        LOG_ERROR("sdl", "Unable to initialize SDL: %s", SDL_GetError());
         return false;
     }
+
+    // renderers other than GL open no window, so only events and timers are needed
+    if (scenario.renderer != RENDERER_GL) {
+        if (SDL_InitSubSystem(SDL_INIT_EVENTS | SDL_INIT_TIMER) != 0) {
+            LOG_ERROR("sdl", "Unable to initialize SDL: %s", SDL_GetError());
+            return false;
+        }
+        LOG_INFO("sdl", "SDL initialized without video (%s renderer)", Renderer::backendName(scenario.renderer));
+        return true;
+    }
     
     //Specify OpenGL Version (4.3)
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
     SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    SDL_Log("SDL Initialized");
+
+    // explicit depth/stencil format, so the depth buffer can be blitted into the Hi-Z depth copy
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
+
+    // debug contexts report performance warnings (stalls, recompiles, implicit syncs) that release contexts usually drop
+    if (debugContext)
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+    LOG_INFO("sdl", "SDL initialized");
     return true;
 }
 
@@ -74,23 +181,131 @@ bool Kernel::initGL() {
     glewExperimental = GL_TRUE;
     GLenum error = glewInit();
     if(error != GLEW_OK) {
-        SDL_Log("Could not initialize GLEW: %s\n", glewGetErrorString(error));
+        LOG_ERROR("gl", "Could not initialize GLEW: %s", (const char*)glewGetErrorString(error));
         return false;
     } else {
-        SDL_Log("GLEW initialized successfully");
+        LOG_INFO("gl", "GLEW initialized successfully");
         glViewport(0, 0, (GLsizei)SDL_GetWindowSurface(window)->w, (GLsizei)SDL_GetWindowSurface(window)->h);
     }
 
-    //Use VSync (limit to refresh rate of monitor)
-    if(SDL_GL_SetSwapInterval(1) < 0) {
-        SDL_Log("Warning: Unable to set VSync! SDL Error: %s\n", SDL_GetError());
+    // capture driver messages before any objects are created
+    if (debugContext) {
+        gl_debug = new GLDebugLog();
+        if (gl_debug->install())
+            LOG_INFO("gl", "GL debug output written to %s", GL_DEBUG_LOG_PATH);
+        else
+            LOG_WARN("gl", "KHR_debug unavailable, GL debug output disabled");
+    }
+
+    // present mode: VSync (limit to refresh rate of monitor), immediate, or adaptive (falls back to VSync)
+    int interval = scenario.present == PRESENT_IMMEDIATE ? 0 : scenario.present == PRESENT_ADAPTIVE ? -1 : 1;
+    if (SDL_GL_SetSwapInterval(interval) < 0 && (interval != -1 || SDL_GL_SetSwapInterval(1) < 0)) {
+        LOG_WARN("sdl", "Unable to set swap interval %d: %s", interval, SDL_GetError());
         // does not return false, VSync is not essential to program
     } else {
-        SDL_Log("VSync initialized");
+        LOG_INFO("sdl", "Swap interval %d (%s)", SDL_GL_GetSwapInterval(), Scenario::presentName(scenario.present));
     }
     return true;
 }
 
+/**
+ * @brief Initializes SDL_ttf font rendering
+ * 
+ * @return bool representing the success of the operation
+ */
+bool Kernel::initTTF() {
+    if (TTF_Init() != 0) {
+        LOG_ERROR("sdl", "SDL_ttf could not initialize: %s", TTF_GetError());
+        return false;
+    }
+
+    LOG_INFO("sdl", "SDL_ttf initialized");
+    return true;
+}
+
+/**
+ * @brief Requests a debug GL context and captures its messages into GL_DEBUG_LOG_PATH. Must be called before start
+ * 
+ * @param enabled Whether to create a debug context
+ */
+void Kernel::setDebugContext(bool enabled) {
+    debugContext = enabled;
+}
+
+/**
+ * @brief Serves metrics at http://127.0.0.1:port/metrics while running. Must be called before start
+ * 
+ * @param port Local TCP port, 0 to disable the server
+ */
+void Kernel::setMetricsPort(int port) {
+    metricsPort = port;
+}
+
+/**
+ * @brief Sets up the run (window, scene, water, present mode, frame count). Must be called before start
+ * 
+ * @param s Scenario to run
+ */
+void Kernel::setScenario(const Scenario& s) {
+    scenario = s;
+    scenario.updateEvery = std::max(1, scenario.updateEvery);
+
+    proceduralSky = scenario.sky == "procedural";
+    planarReflections = scenario.reflections;
+    showOverlay = scenario.overlay;
+    showModel = scenario.models;
+    modelGrid = scenario.modelGrid;
+    modelSpacing = scenario.modelSpacing;
+}
+
+/**
+ * @brief Checks every water update of the run against the other evaluators and thread counts (see WaterValidator). Must be called before start
+ * 
+ * @param tolerance Largest absolute error still counted as agreement, 0 not to validate
+ */
+void Kernel::setValidation(float tolerance) {
+    validationTolerance = tolerance;
+}
+
+/**
+ * @brief Returns how the evaluators, and GPU particles, compared over the run, empty when it was not validated
+ * 
+ * @return vector<ValidationResult>
+ */
+vector<ValidationResult> Kernel::getValidation() const {
+    vector<ValidationResult> results = validator != NULL ? validator->getResults() : vector<ValidationResult>();
+    if (particleValidator != NULL)
+        results.push_back(particleValidator->getResult());
+    return results;
+}
+
+/**
+ * @brief Reads back the given frames before they are presented (see getCaptures). Must be called before start
+ * 
+ * @param frames Frame numbers, counted from 1
+ */
+void Kernel::setCaptureFrames(const vector<int>& frames) {
+    captureFrames = frames;
+}
+
+/**
+ * @brief Returns the frames captured during the run, in the order they were rendered
+ * 
+ * @return const vector<GoldenImage>&
+ */
+const vector<GoldenImage>& Kernel::getCaptures() const {
+    return captures;
+}
+
+/**
+ * @brief Returns the frame statistics of the run, filled in once start returns
+ * 
+ * @return const RunStats&
+ */
+const RunStats& Kernel::getStats() const {
+    return stats;
+}
+
 /**
  * @brief Initializes SDL_Image image loading
  * 
@@ -99,11 +314,11 @@ bool Kernel::initGL() {
 bool Kernel::initIMG() {
     int imgFlags = IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF;
     if(!(IMG_Init(imgFlags) & imgFlags)) {
-        SDL_Log("SDL_image could not initialize! SDL_image Error: %s\n", IMG_GetError());
+        LOG_ERROR("sdl", "SDL_image could not initialize: %s", IMG_GetError());
         return false;
     }
 
-    SDL_Log("SDL_image initialized");
+    LOG_INFO("sdl", "SDL_image initialized");
     return true;
 }
 
@@ -112,73 +327,178 @@ bool Kernel::initIMG() {
  * 
  * @param resx 
  * @param resy 
+ * @return bool whether the application started (false if initialization failed)
  */
-void Kernel::start(string title, int resx, int resy) {
+bool Kernel::start(string title, int resx, int resy) {
+    auto startT = std::chrono::steady_clock::now();
     rx = resx; ry = resy;
 
     // Initialize SDL
     if (!initSDL())
-        return;
+        return false;
 
-    // Create and verify window
-    window = SDL_CreateWindow(
-        title.c_str(),
-        SDL_WINDOWPOS_CENTERED,
-        SDL_WINDOWPOS_CENTERED,
-        rx,
-        ry,
-        SDL_WINDOW_OPENGL
-    );
-
-    if(window == NULL) {
-        SDL_Log("Could not create window: %s\n", SDL_GetError());
-        return;
-    }
-    else
-        SDL_Log("Window successfully generated");
+    bool gl = scenario.renderer == RENDERER_GL;
+    if (gl) {
+        // Create and verify window
+        window = SDL_CreateWindow(
+            title.c_str(),
+            SDL_WINDOWPOS_CENTERED,
+            SDL_WINDOWPOS_CENTERED,
+            rx,
+            ry,
+            SDL_WINDOW_OPENGL | (scenario.headless ? SDL_WINDOW_HIDDEN : 0)
+        );
+
+        if(window == NULL) {
+            LOG_ERROR("sdl", "Could not create window: %s", SDL_GetError());
+            return false;
+        }
+        else
+            LOG_INFO("sdl", "Window successfully generated");
     
-    // Create and verify renderer
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+        // Create and verify renderer
+        renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     
-    if(renderer == NULL) {
-        SDL_Log("Could not create renderer: %s\n", SDL_GetError());
-        return;
-    } else
-        SDL_Log("Renderer successfully generated");
+        if(renderer == NULL) {
+            LOG_ERROR("sdl", "Could not create renderer: %s", SDL_GetError());
+            return false;
+        } else
+            LOG_INFO("sdl", "Renderer successfully generated");
     
-    // Initialize GL Context
-    glContext = SDL_GL_CreateContext(window);
-    if (!initGL())
-        return;
+        // Initialize GL Context
+        glContext = SDL_GL_CreateContext(window);
+        if (!initGL())
+            return false;
+        stats.device = string((const char*)glGetString(GL_RENDERER)) + " / " + (const char*)glGetString(GL_VERSION);
+    } else {
+        stats.device = string(Renderer::backendName(scenario.renderer)) + " renderer";
+    }
 
     // Initialize SDL_image
     if (!initIMG())
-        return;
+        return false;
     
     // Setup objects
-    camera = new Camera(glm::vec3(0, 0, 3));
-
-    string skyboxTitle = "yokohama/";
-    string fileExtension = ".jpg";
-    vector<std::string> faces {
-        string("resources/skyboxes/") + skyboxTitle + string("negx") + fileExtension,
-        string("resources/skyboxes/") + skyboxTitle + string("posx") + fileExtension,
-        string("resources/skyboxes/") + skyboxTitle + string("negy") + fileExtension,
-        string("resources/skyboxes/") + skyboxTitle + string("posy") + fileExtension,
-        string("resources/skyboxes/") + skyboxTitle + string("negz") + fileExtension,
-        string("resources/skyboxes/") + skyboxTitle + string("posz") + fileExtension
-    };
-    skybox = new Skybox("shaders/skybox.vs", "shaders/skybox.fs", faces);
+    camera = new Camera(scenario.cameraPosition, glm::vec3(0, 1, 0), scenario.cameraYaw, scenario.cameraPitch);
 
-    backpack_shader = new Shader("shaders/backpack.vs", "shaders/backpack.fs");
-    backpack_model  = new Model("resources/backpack/backpack.obj");
+    if (proceduralSky && gl) {
+        // no sky assets: LUTs are computed on the GPU
+        sky = new Sky("shaders/sky.vs", "shaders/sky.fs", "shaders/sky.cs");
+        sky->setSun(scenario.sunElevation, scenario.sunAzimuth);
+    } else {
+        // without GL the procedural sky is approximated by the renderer's gradient, a skybox without faces
+        vector<std::string> faces;
+        if (!proceduralSky) {
+            string skyboxTitle = scenario.sky + "/";
+            string fileExtension = ".jpg";
+            faces = {
+                string("resources/skyboxes/") + skyboxTitle + string("negx") + fileExtension,
+                string("resources/skyboxes/") + skyboxTitle + string("posx") + fileExtension,
+                string("resources/skyboxes/") + skyboxTitle + string("negy") + fileExtension,
+                string("resources/skyboxes/") + skyboxTitle + string("posy") + fileExtension,
+                string("resources/skyboxes/") + skyboxTitle + string("negz") + fileExtension,
+                string("resources/skyboxes/") + skyboxTitle + string("posz") + fileExtension
+            };
+        }
+        skybox = new Skybox("shaders/skybox.vs", "shaders/skybox.fs", faces);
+    }
+
+    // nothing is read until the models are first shown (see resolveModels); a synchronous import runs on the pool
+    pool = new ThreadPool(scenario.threads);
+    backpack_model = new ModelHandle(scenario.modelPath, scenario.modelsAsync, pool);
+    for (int i = 0; i < modelGrid; i ++) {
+        for (int j = 0; j < modelGrid; j ++) {
+            glm::vec3 offset = glm::vec3(i - (modelGrid - 1) * 0.5f, 0, j - (modelGrid - 1) * 0.5f) * modelSpacing;
+            modelTransforms.push_back(glm::translate(glm::mat4(1.0f), offset));
+        }
+    }
+    modelLods.assign(modelTransforms.size(), 0);
+    if (gl)
+        hiz = new HiZ(rx, ry, "shaders/hiz.cs");
+
+    // the same seed gives the same waves
+    srand(scenario.seed);
+    water = new Water(scenario.waterX, scenario.waterZ, scenario.waterWidth, scenario.waterLength, scenario.gridX, scenario.gridZ,
+        scenario.amplitude, scenario.waves, scenario.directional, scenario.rounded, scenario.waterEngine != WATER_ENGINE_STATIC);
+    if (gl)
+        water_shader = new Shader("shaders/water.vs", "shaders/water.fs");
+    water->setThreadPool(pool);
+    sceneRenderer = createRenderer(scenario.renderer, pool);
+    if (scenario.waterEngine != WATER_ENGINE_STATIC && scenario.waterEngine != WATER_ENGINE_CPU) {
+        WaterEvaluator evaluator = scenario.waterEngine == WATER_ENGINE_SSE2 ? WATER_EVAL_SSE2
+            : scenario.waterEngine == WATER_ENGINE_AVX2 ? WATER_EVAL_AVX2 : WATER_EVAL_GPU;
+        if (!water->setEvaluator(evaluator))
+            LOG_WARN("scenario", "The %s evaluator is not supported here; the water is evaluated by the scalar one", Water::evaluatorName(evaluator));
+    }
+    if (validationTolerance > 0)
+        validator = new WaterValidator(water, validationTolerance);
+    if (scenario.particles) {
+        bool gpuParticles = gl && !scenario.particleReference;
+        if (!gpuParticles && water->getEvaluator() == WATER_EVAL_GPU)
+            LOG_WARN("scenario", "The CPU particle reference reads the water's CPU vertices, which the GPU evaluator does not write");
+        particles = new SprayParticles(water, scenario.particleMax, scenario.particleThreshold, scenario.particleRate, gpuParticles);
+        if (validationTolerance > 0 && gpuParticles)
+            particleValidator = new ParticleValidator(water, particles, scenario.particleMax, scenario.particleThreshold, scenario.particleRate);
+    }
+    if (scenario.foam && gl)
+        foam = new FoamMap(water, scenario.foamResolution, scenario.foamThreshold, scenario.foamGain, scenario.foamDecay, scenario.foamDrift);
+    if (scenario.caustics && gl)
+        caustics = new CausticsMap(water, scenario.causticsResolution, scenario.causticsTile, scenario.causticsDepth, scenario.causticsRate);
+    LOG_INFO("scenario", "Scenario %s: %dx%d water grid, %d waves, %s engine on %d threads, %s renderer", scenario.name, scenario.gridX, scenario.gridZ,
+        scenario.waves, Scenario::engineName(scenario.waterEngine), pool->getThreads(), Renderer::backendName(scenario.renderer));
+
+    // metrics are cheap to record, so only serving them is optional
+    Metrics& m = Metrics::get();
+    vector<double> frameBounds { 0.002, 0.004, 0.008, 0.0167, 0.025, 0.0333, 0.05, 0.1, 0.25, 1.0 };
+    vector<double> updateBounds { 0.0005, 0.001, 0.002, 0.004, 0.008, 0.016, 0.032, 0.064 };
+    frameSeconds = m.histogram("ews_frame_seconds", "CPU time of a whole frame", frameBounds);
+    waterUpdateSeconds = m.histogram("ews_water_update_seconds", "Time spent in Water::updateMesh", updateBounds);
+    verticesEvaluated = m.counter("ews_water_vertices_evaluated_total", "Water vertices evaluated by Water::updateMesh (rate() gives vertices per second)");
+    for (int i = 0; i < GLMEM_CATEGORY_COUNT; i ++) {
+        string label = string("category=\"") + GLResourceRegistry::categoryName((GLMemoryCategory)i) + "\"";
+        vramBytes[i] = m.gauge("ews_vram_bytes", "Video memory held by live GL objects (estimated from requested formats)", label);
+    }
+    if (metricsPort > 0) {
+        metrics = new MetricsServer(metricsPort);
+        if (!metrics->start()) {
+            delete metrics;
+            metrics = NULL;
+        }
+    }
 
-    water = new Water(0, 0, 100, 100, 100, 100, 0.01f, 20, true, true, false);
-    water_shader = new Shader("shaders/water.vs", "shaders/water.fs");
+    // the overlay is optional: without SDL_ttf or a font, timings go to the window title
+    if (gl && initTTF()) {
+        for (unsigned int i = 0; i < sizeof(OVERLAY_FONTS) / sizeof(OVERLAY_FONTS[0]) && overlay == NULL; i ++) {
+            TTF_Font* font = TTF_OpenFont(OVERLAY_FONTS[i], OVERLAY_FONT_SIZE);
+            if (font == NULL)
+                continue;
+            overlay = new Overlay("shaders/overlay.vs", "shaders/overlay.fs", font);
+            TTF_CloseFont(font);
+            LOG_INFO("overlay", "Overlay font: %s", OVERLAY_FONTS[i]);
+        }
+        if (overlay == NULL)
+            LOG_WARN("overlay", "No overlay font found, showing timings in the window title");
+    }
+
+    profiler = new Profiler();
+    profiler->setGpuZones(gl);
+    recorder = new FlightRecorder();
+    profiler->setRecorder(recorder);
+    if (gl) {
+        reflection = new Reflection(rx, ry, scenario.reflectionScale);
+        reflection->budgetMs = scenario.reflectionBudget;
+        reflection->maxReuse = scenario.reflectionMaxReuse;
+    } else
+        planarReflections = false;
+    GLResourceRegistry::get().logSummary();
 
     // Start loop
+    std::chrono::duration<double, std::milli> startup = std::chrono::steady_clock::now() - startT;
+    double startupMs = startup.count();
+    AssetLog::get().logReport(true);
     isRunning = true;
-    glEnable(GL_DEPTH_TEST);
+    if (gl)
+        glEnable(GL_DEPTH_TEST);
 
     // Start time of loop
     //auto initT = std::chrono::steady_clock::now();
@@ -186,9 +506,16 @@ void Kernel::start(string title, int resx, int resy) {
     int frame = 0;
     int curFPS = 0;
     float sumFPS = 0.001;
+    float updateElapsed = 0;    // seconds since the last update, which runs every scenario.updateEvery frames
+
+    // statistics cover the frames after the warmup
+    vector<float> measuredMs;
+    std::map<string, double> zoneSums;
+    auto measureStart = lastT;
 
     // Relative mouse mode (hide mouse)
-    SDL_SetRelativeMouseMode(SDL_TRUE);
+    if (!scenario.headless && gl)
+        SDL_SetRelativeMouseMode(SDL_TRUE);
 
     // Uncomment for wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -196,6 +523,10 @@ void Kernel::start(string title, int resx, int resy) {
     while (isRunning) {
         // iterate frame count
         frame ++;
+        AssetLog::get().setFrame(frame);
+        profiler->beginFrame();
+        if (gl_debug)
+            gl_debug->beginFrame(frame);
 
         // determine time between frames
         auto curT = std::chrono::steady_clock::now();
@@ -203,18 +534,32 @@ void Kernel::start(string title, int resx, int resy) {
         lastT = std::chrono::steady_clock::now();
         float dt = diff.count();
         sumFPS += dt;
+        if (frame == scenario.warmup + 1)
+            measureStart = curT;
+        // a fixed step makes the simulation independent of the frame rate
+        if (scenario.timeStep > 0)
+            dt = scenario.timeStep;
 
-        // update window title
-        // only update FPS every 30 frames
+        // only update FPS every 30 frames; the title only carries it when there is no overlay
         if (frame % 30 == 1) {
             curFPS = (int)(30/sumFPS);
             sumFPS = 0;
+
+            if (overlay == NULL && window != NULL) {
+                string atitle = title + string(" - FPS: ") + std::to_string(curFPS) + string(" - Frame: ") + std::to_string(frame);
+                if (planarReflections) {
+                    char reflTitle[64];
+                    snprintf(reflTitle, sizeof(reflTitle), " - Reflection: %.2f ms / %d", profiler->getCounter("reflection.gpu_ms"), (int)profiler->getCounter("reflection.interval"));
+                    atitle += reflTitle;
+                }
+                SDL_SetWindowTitle(window, atitle.c_str());
+            }
         }
-        string atitle = title + string(" - FPS: ") + std::to_string(curFPS) + string(" - Frame: ") + std::to_string(frame);
-        SDL_SetWindowTitle(window, atitle.c_str());
 
         // handle events
+        profiler->beginZone("events");
         handleEvents();
+        profiler->endZone("events");
 
         // update camera
         int end = NONE;
@@ -233,62 +578,419 @@ void Kernel::start(string title, int resx, int resy) {
         camera->updateKeyboard(end, dt);
         camera->updateMouse(relX, -relY);
 
-        // update renderer
-        if (frame % 2 == 1) {
-            update(dt);
+        // update renderer, by all the time the frames since the last update took
+        updateElapsed += dt;
+        if ((frame - 1) % scenario.updateEvery == 0) {
+            profiler->beginZone("update");
+            update(updateElapsed);
+            profiler->endZone("update");
+            updateElapsed = 0;
         }
+
+        // skinned models are posed every frame (see render), so their clips advance every frame too
+        animationTime += dt;
+        profiler->beginZone("render");
         render();
+        if (std::find(captureFrames.begin(), captureFrames.end(), frame) != captureFrames.end()) {
+            captures.push_back(GoldenImage());
+            GoldenImage& image = captures.back();
+            if (sceneRenderer->readPixels(image.width, image.height, image.rgb))
+                image.frame = frame;
+            else if (!captureFramebuffer(rx, ry, frame, image))
+                LOG_WARN("golden", "Reading back frame %d raised a GL error", frame);
+        }
+        if (gl)
+            SDL_GL_SwapWindow(window);
+        profiler->endZone("render");
+        sceneRenderer->report(profiler);
+        if (gl_debug) {
+            gl_debug->pollErrors();
+            gl_debug->report(profiler);
+        }
+        GLResourceRegistry::get().report(profiler);
+        profiler->endFrame();
+
+        frameSeconds->observe(profiler->getFrameMs() / 1000.0);
+        if (frame > scenario.warmup) {
+            measuredMs.push_back(profiler->getFrameMs());
+            for (auto& it : profiler->getCounters()) {
+                const string& name = it.first;
+                bool zone = (name.compare(0, 4, "cpu.") == 0 || name.compare(0, 4, "gpu.") == 0) && name.find('.', 4) == string::npos;
+                if (zone)
+                    zoneSums[name] += it.second;
+            }
+        }
+        frameHistory[historyCursor] = profiler->getFrameMs();
+        historyCursor = (historyCursor + 1) % OVERLAY_GRAPH_FRAMES;
+        for (int i = 0; i < GLMEM_CATEGORY_COUNT; i ++)
+            vramBytes[i]->set((double)GLResourceRegistry::get().getBytes((GLMemoryCategory)i));
+
+        // keep the state of a hitching frame next to its trace
+        if (recorder->endFrame(frame, profiler)) {
+            std::map<string, double> params;
+            params["camera.x"] = camera->position.x;
+            params["camera.y"] = camera->position.y;
+            params["camera.z"] = camera->position.z;
+            params["camera.yaw"] = camera->yaw;
+            params["camera.pitch"] = camera->pitch;
+            params["camera.zoom"] = camera->zoom;
+            params["frame.dt"] = dt;
+            water->describe(params);
+            recorder->dump(params);
+        }
+
+        if (scenario.frames > 0 && frame >= scenario.frames)
+            isRunning = false;
     }
+
+    std::chrono::duration<double> measured = std::chrono::steady_clock::now() - measureStart;
+    stats.compute(measuredMs, zoneSums, measuredMs.empty() ? 0 : measured.count());
+    stats.startupMs = startupMs;
+    AssetLog::get().logReport(false);
+    LOG_INFO("scenario", "Scenario %s: %d frames, mean %.3f ms, p95 %.3f ms, p99 %.3f ms", scenario.name, stats.frames, stats.meanMs, stats.p95Ms, stats.p99Ms);
+    return true;
 }
 
 /**
  * @brief Renders objects as defined by update cycle
  */
 void Kernel::render() {
-    // clear screen
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // sets backpack shaders as active
-    backpack_shader->use();
-
     // compute matrices
     glm::mat4 projection = glm::perspective(glm::radians(camera->zoom), (float)rx / (float)ry, 0.1f, 100.0f);
     glm::mat4 view = camera->getViewMatrix();
+    sceneRenderer->beginFrame(rx, ry);
+
+    // skinned models are posed once, for every pass below
+    animateModels();
+
+    // levels of detail are picked by the main pass; the mirrored pass reuses them, seen from the mirrored camera
+    LodView lod(camera->position, glm::radians(camera->zoom), ry, scenario.modelLodError, true);
+    LodView mirroredLod = lod;
+    mirroredLod.update = false;
+
+    // rebuild sky LUTs if the sun moved; a fresh sky also invalidates the reflection
+    if (sky != NULL && sky->update()) {
+        profiler->addCounter("sky.lut_updates", 1);
+        reflection->invalidate();
+    }
+
+    // render the scene mirrored about the water, unless the last reflection can be reused
+    if (planarReflections) {
+        if (reflection->needsUpdate(camera)) {
+            reflection->begin(camera, projection);
+            mirroredLod.position = glm::vec3(glm::inverse(reflection->view)[3]);
+            drawModels(reflection->view, reflection->projection, reflection->frustum, NULL, mirroredLod, false);
+            drawSky(reflection->view, reflection->projection);
+            reflection->end(rx, ry);
+        }
+        reflection->report(profiler);
+    }
+
+    // clear screen (other renderers clear in beginFrame)
+    if (glContext != NULL)
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    sceneRenderer->setCamera(view, projection, camera->position);
+
+    // render models, occlusion culled against last frame's depth
+    profiler->beginGpuZone("models");
+    drawModels(view, projection, Frustum(projection * view), hiz, lod, true);
+    profiler->endGpuZone("models");
+
+    // render water
+    WaterEnvironment env;
+    env.cubeTexture = skybox != NULL ? skybox->cubeTexture : 0;
+    env.skyView = sky != NULL ? sky->skyViewLUT : 0;
+    env.reflection = planarReflections ? reflection->texture : 0;
+    env.sunDirection = sunDirection();
+    env.exposure = sky != NULL ? sky->exposure : 1.0f;
+    if (foam != NULL) {
+        env.foam = foam->getTexture();
+        env.foamOrigin = foam->getOrigin();
+        env.foamSize = foam->getSize();
+    }
+    profiler->beginGpuZone("water");
+    water->draw(sceneRenderer, water_shader, env);
+    profiler->endGpuZone("water");
+
+    // spray and foam over the water, blended without writing depth
+    if (particles != NULL) {
+        profiler->beginGpuZone("particles");
+        particles->draw(view, projection, lod.pixelsPerUnit);
+        profiler->endGpuZone("particles");
+        particles->report(profiler);
+    }
+
+    // keep this frame's depth for next frame's occlusion culling
+    if (showModel && hiz != NULL)
+        hiz->capture(projection * view);
+
+    // draw sky last
+    profiler->beginGpuZone("sky");
+    drawSky(view, projection);
+    profiler->endGpuZone("sky");
 
-    // loads shaders
+    // HUD on top of everything
+    if (overlay != NULL && showOverlay) {
+        profiler->beginGpuZone("overlay");
+        drawOverlay();
+        profiler->endGpuZone("overlay");
+    }
+
+    sceneRenderer->endFrame();
+}
+
+/**
+ * @brief Draws every model of the scene that survives GPU culling. Shared by the main and reflection passes
+ * 
+ * @param view View matrix of the pass
+ * @param projection Projection matrix of the pass
+ * @param frustum Frustum of the pass, used to cull instances
+ * @param occluder Depth pyramid matching the pass, or NULL to skip occlusion culling
+ * @param lod Camera the copies' levels of detail are picked for
+ * @param mainView Whether this is the main pass, the only one whose culling counters are reported
+ */
+void Kernel::drawModels(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum, HiZ* occluder, const LodView& lod, bool mainView) {
+    if (!showModel)
+        return;
+    Model* model = resolveModels();
+    if (model == NULL)
+        return;
+
+    // without GL nothing is culled on the GPU: copies are frustum culled here and drawn one by one
+    if (backpack_instances == NULL) {
+        glm::vec3 center = (model->boundsMin + model->boundsMax) * 0.5f;
+        float radius = glm::length(model->boundsMax - model->boundsMin) * 0.5f;
+        sceneRenderer->setCamera(view, projection, camera->position);
+        for (unsigned int i = 0; i < modelTransforms.size(); i ++) {
+            const glm::mat4& transform = modelTransforms[i];
+            if (!frustum.intersectsSphere(glm::vec3(transform * glm::vec4(center, 1.0f)), radius))
+                continue;
+            if (lod.update)
+                modelLods[i] = selectLod(model->lodErrors, lodDistance(transform, model->boundsMin, model->boundsMax, lod.position), lod, modelLods[i]);
+            model->draw(sceneRenderer, backpack_shader, transform, modelLods[i]);
+        }
+        return;
+    }
+
+    backpack_instances->cull(frustum, occluder, lod, mainView);
+    if (mainView)
+        backpack_instances->report(profiler);
+
+    // sets backpack shaders as active
+    backpack_shader->use();
     backpack_shader->setMat4("projection", projection);
     backpack_shader->setMat4("view", view);
     backpack_shader->setVec3("cameraPos", camera->position);
+    if (caustics != NULL)
+        caustics->bind(backpack_shader, scenario.causticsStrength);
+    backpack_instances->draw(backpack_shader);
+}
 
-    // render model
-    glm::mat4 model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f)); // translate it down so it's at the center of the scene
-    model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));	// it's a bit too big for our scene, so scale it down
-    backpack_shader->setMat4("model", model);
-    //backpack_model->draw(backpack_shader);
+/**
+ * @brief Resolves the backpack model, creating its shaders and GPU instances along with it the first time it is ready
+ * 
+ * @return Model* to draw, or NULL while it is still loading in the background (nothing is drawn in its place) or if it failed to load
+ */
+Model* Kernel::resolveModels() {
+    Model* model = backpack_model->get();
+    if (model == NULL || glContext == NULL || backpack_instances != NULL)
+        return model;
 
-    // render water
-    water_shader->use();
-    water_shader->setMat4("projection", projection);
-    water_shader->setMat4("view", view);
-    water_shader->setMat4("model", model);
-    water_shader->setVec3("cameraPos", camera->position);
-    water->draw(water_shader, skybox->cubeTexture);
+    backpack_shader = new Shader("shaders/backpack.vs", "shaders/backpack.fs");
+    MaterialTable::assignUnits(backpack_shader);
+    cull_shader = new ComputeShader("shaders/cull.cs");
+    if (model->skeleton.animated()) {
+        animator = new Animator(&model->skeleton);
+        skin_shader = new ComputeShader("shaders/skin.cs");
+        skinner = new Skinner(model, skin_shader);
+    }
+
+    // meshlet bounds and cones only hold in the bind pose
+    if (scenario.modelClusters && skinner == NULL)
+        cluster_shader = new ComputeShader("shaders/cluster.cs");
+
+    // batches read merged copies of the meshes' own vertices, which skinning does not deform
+    if (scenario.modelMaterials != MATERIALS_BOUND && skinner == NULL) {
+        backpack_materials = new MaterialTable(model, scenario.modelMaterials == MATERIALS_BINDLESS);
+        if (!backpack_materials->valid()) {
+            delete backpack_materials;
+            backpack_materials = NULL;
+        }
+    }
+    backpack_instances = new ModelInstances(model, cull_shader, cluster_shader, backpack_materials);
+    backpack_instances->setTransforms(modelTransforms);
+    LOG_INFO("assets", "Models resolved: %s", backpack_model->getPath());
+    return model;
+}
+
+/**
+ * @brief Samples the pose of the skinned model on the pool and deforms its meshes on the GPU, once per frame before anything draws it
+ */
+void Kernel::animateModels() {
+    if (!showModel || animator == NULL)
+        return;
+    profiler->beginZone("animation");
+    animator->sample(scenario.modelClip, animationTime, pool);
+    profiler->endZone("animation");
+
+    profiler->beginGpuZone("skinning");
+    skinner->skin(animator->getPalette());
+    profiler->endGpuZone("skinning");
+    profiler->setCounter("animation.bones", animator->getPalette().size());
+    profiler->setCounter("animation.skinned_vertices", skinner->getSkinnedVertices());
+}
+
+/**
+ * @brief Draws whichever sky is in use on the far plane
+ * 
+ * @param view View matrix of the pass (translation is ignored)
+ * @param projection Projection matrix of the pass
+ */
+void Kernel::drawSky(const glm::mat4& view, const glm::mat4& projection) {
+    if (sky != NULL) {
+        sky->draw(view, projection);
+        return;
+    }
+    sceneRenderer->setCamera(view, projection, camera->position);
+    skybox->draw(sceneRenderer, sunDirection());
+}
+
+/**
+ * @brief Returns the direction toward the sun, from the procedural sky when there is one and from the scenario otherwise
+ * 
+ * @return glm::vec3
+ */
+glm::vec3 Kernel::sunDirection() {
+    if (sky != NULL)
+        return sky->sunDirection();
+    float e = glm::radians(scenario.sunElevation), a = glm::radians(scenario.sunAzimuth);
+    return glm::vec3(cos(e) * cos(a), sin(e), cos(e) * sin(a));
+}
+
+/**
+ * @brief Draws the performance HUD: frame rate, a frame-time graph, and every counter of the last completed frame
+ */
+void Kernel::drawOverlay() {
+    const std::map<string, double>& counters = profiler->getCounters();
+    const float margin = 8.0f, width = 340.0f, graphH = 40.0f, budgetMs = 1000.0f / 60.0f;
+    float lh = (float)overlay->lineHeight();
+
+    // frame times in chronological order, and their average
+    float history[OVERLAY_GRAPH_FRAMES];
+    float sumMs = 0;
+    for (int i = 0; i < OVERLAY_GRAPH_FRAMES; i ++) {
+        history[i] = frameHistory[(historyCursor + i) % OVERLAY_GRAPH_FRAMES];
+        sumMs += history[i];
+    }
+    float avgMs = sumMs / OVERLAY_GRAPH_FRAMES;
 
-    // draw skybox last
-    skybox->draw(camera, rx, ry);
+    // as many counters as fit in the window
+    int lines = std::min((int)counters.size(), std::max(0, (int)((ry - 3 * margin - graphH - 2 * lh) / lh)));
+    float panelH = 3 * margin + lh + graphH + (lines + 1) * lh;
 
-    glFlush();
+    overlay->begin(rx, ry);
+    overlay->rect(0, 0, width + 2 * margin, panelH, glm::vec4(0, 0, 0, 0.6f));
 
-    SDL_GL_SwapWindow(window);
+    char line[128];
+    snprintf(line, sizeof(line), "%.1f fps  %.2f ms avg  %.2f ms last", avgMs > 0 ? 1000.0f / avgMs : 0.0f, avgMs, profiler->getFrameMs());
+    float y = margin;
+    overlay->text(margin, y, line);
+    y += lh + margin;
+
+    // frame-time graph, scaled to two 60 Hz frames, with the 60 Hz budget marked
+    overlay->rect(margin, y, width, graphH, glm::vec4(1, 1, 1, 0.1f));
+    overlay->graph(margin, y, width, graphH, history, OVERLAY_GRAPH_FRAMES, 2 * budgetMs, glm::vec4(0.3f, 0.9f, 0.4f, 0.9f));
+    overlay->rect(margin, y + graphH / 2, width, 1, glm::vec4(1, 0.3f, 0.3f, 0.8f));
+    y += graphH + margin;
+
+    int shown = 0;
+    for (auto& it : counters) {
+        if (shown ++ >= lines)
+            break;
+
+        // timings in ms get two decimals, counts none
+        bool timing = it.first.compare(0, 4, "cpu.") == 0 || (it.first.compare(0, 4, "gpu.") == 0 && it.first.find('.', 4) == string::npos);
+        snprintf(line, sizeof(line), timing ? "%.2f" : "%.0f", it.second);
+        overlay->text(margin, y, it.first, glm::vec4(0.8f, 0.8f, 0.8f, 1.0f));
+        overlay->text(margin + width - overlay->textWidth(line), y, line);
+        y += lh;
+    }
+    if ((int)counters.size() > lines) {
+        snprintf(line, sizeof(line), "... %d more", (int)counters.size() - lines);
+        overlay->text(margin, y, line, glm::vec4(0.6f, 0.6f, 0.6f, 1.0f));
+    }
+
+    overlay->end();
 }
 
 /**
  * @brief Updates all objects in world (positions, meshes, etc.)
+ *
+ * @param dt Seconds since the last update, spanning every frame in between
  */
 void Kernel::update(float dt) {
     water->updateTime(dt);
-    water->updateMesh();
+
+    // validation re-evaluates the water several times over, so it is timed apart and ahead of the update it checks
+    if (validator != NULL) {
+        profiler->beginZone("validate");
+        validator->check();
+        profiler->endZone("validate");
+        if (scenario.waterEngine == WATER_ENGINE_STATIC)
+            water->updateMesh();
+    }
+    if (scenario.waterEngine == WATER_ENGINE_STATIC) {
+        updateWaterEffects(dt);
+        return;
+    }
+
+    // evaluation and upload are timed apart, so a regression can be pinned on either
+    auto start = std::chrono::steady_clock::now();
+    profiler->beginZone("water_eval");
+    water->evaluate();
+    profiler->endZone("water_eval");
+    profiler->beginZone("water_upload");
+    water->upload();
+    profiler->endZone("water_upload");
+    std::chrono::duration<double> diff = std::chrono::steady_clock::now() - start;
+    waterUpdateSeconds->observe(diff.count());
+    verticesEvaluated->add(water->vertices.size() / 6);
+    updateWaterEffects(dt);
+}
+
+/**
+ * @brief Steps the spray particles, the foam coverage and the caustics from the water as just updated
+ *
+ * @param dt Seconds since the last update
+ */
+void Kernel::updateWaterEffects(float dt) {
+    if (particles != NULL) {
+        if (particles->onGpu()) {
+            profiler->beginGpuZone("particles_step");
+            particles->update(dt);
+            profiler->endGpuZone("particles_step");
+            if (particleValidator != NULL) {
+                profiler->beginZone("validate_particles");
+                particleValidator->check(dt);
+                profiler->endZone("validate_particles");
+            }
+        } else {
+            profiler->beginZone("particles_step");
+            particles->update(dt);
+            profiler->endZone("particles_step");
+        }
+    }
+    if (foam != NULL) {
+        profiler->beginGpuZone("foam");
+        foam->update(dt);
+        profiler->endGpuZone("foam");
+    }
+    if (caustics != NULL) {
+        profiler->beginGpuZone("caustics");
+        if (caustics->update(dt, sunDirection()))
+            profiler->addCounter("caustics.updates", 1);
+        profiler->endGpuZone("caustics");
+    }
 }
 
 /**
@@ -322,6 +1024,33 @@ void Kernel::handleEvents() {
                     case SDLK_LSHIFT: // left shift
                         shDown = true;
                         break;
+                    case SDLK_r: // toggle planar reflections (GL only)
+                        planarReflections = !planarReflections && reflection != NULL;
+                        break;
+                    case SDLK_F1: // toggle performance overlay
+                        showOverlay = !showOverlay;
+                        break;
+                    case SDLK_m: // toggle model
+                        showModel = !showModel;
+                        if (hiz != NULL)
+                            hiz->valid = false; // pyramid is stale while models are hidden
+                        break;
+                    case SDLK_UP: // time of day: raise sun
+                        if (sky != NULL)
+                            sky->setSun(sky->sunElevation + 2.0f, sky->sunAzimuth);
+                        break;
+                    case SDLK_DOWN: // time of day: lower sun
+                        if (sky != NULL)
+                            sky->setSun(sky->sunElevation - 2.0f, sky->sunAzimuth);
+                        break;
+                    case SDLK_LEFT: // rotate sun
+                        if (sky != NULL)
+                            sky->setSun(sky->sunElevation, sky->sunAzimuth - 5.0f);
+                        break;
+                    case SDLK_RIGHT: // rotate sun
+                        if (sky != NULL)
+                            sky->setSun(sky->sunElevation, sky->sunAzimuth + 5.0f);
+                        break;
                 }
                 break;
             
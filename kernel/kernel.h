@@ -27,12 +27,34 @@ using std::string;
 #include "../objects/helper.h"
 #include "../objects/camera.h"
 #include "../objects/skybox.h"
+#include "../objects/sky.h"
 #include "../objects/water.h"
+#include "../objects/reflection.h"
+#include "../objects/culling.h"
+#include "../objects/material.h"
+#include "../objects/overlay.h"
+#include "../objects/skinning.h"
+#include "../objects/particles.h"
+#include "../objects/foam.h"
+#include "../objects/caustics.h"
+#include "../objects/renderer.h"
+#include "profiler.h"
+#include "gldebug.h"
+#include "recorder.h"
+#include "metrics.h"
+#include "log.h"
+#include "scenario.h"
+#include "validation.h"
+#include "golden.h"
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// point size of the overlay font, and how many frames its frame-time graph spans
+#define OVERLAY_FONT_SIZE 14
+#define OVERLAY_GRAPH_FRAMES 120
+
 class Kernel {
     public:
         Kernel();
@@ -41,17 +63,42 @@ class Kernel {
         bool initSDL();
         bool initGL();
         bool initIMG();
+        bool initTTF();
+
+        void setDebugContext(bool enabled);
+        void setMetricsPort(int port);
+        void setScenario(const Scenario& s);
+        void setValidation(float tolerance);
+        void setCaptureFrames(const vector<int>& frames);
 
-        void start(string title, int resx, int resy);
+        bool start(string title, int resx, int resy);
+        const RunStats& getStats() const;
+        vector<ValidationResult> getValidation() const;
+        const vector<GoldenImage>& getCaptures() const;
 
         void render();
+        void drawModels(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum, HiZ* occluder, const LodView& lod, bool mainView);
+        Model* resolveModels();
+        void animateModels();
+        void drawSky(const glm::mat4& view, const glm::mat4& projection);
+        void drawOverlay();
+        glm::vec3 sunDirection();
         void update(float dt);
+        void updateWaterEffects(float dt);
         void handleEvents();
 
     private:
         bool isRunning;
         int rx, ry;
 
+        // Settings of the run, and its frame statistics once it has ended
+        Scenario scenario;
+        RunStats stats;
+
+        // Frames read back before they are presented, for golden-image comparison
+        vector<int> captureFrames;
+        vector<GoldenImage> captures;
+
         SDL_Window* window;
         SDL_Renderer* renderer;
         SDL_GLContext glContext;
@@ -62,19 +109,87 @@ class Kernel {
 
         // ---- Objects in kernel ----
 
+        // Per-frame timings and counters
+        Profiler* profiler;
+
+        // Performance HUD (NULL when no font could be loaded; the window title is used instead)
+        Overlay* overlay;
+        bool     showOverlay;
+        float    frameHistory[OVERLAY_GRAPH_FRAMES];   // CPU frame times (ms), ring indexed by historyCursor
+        int      historyCursor;
+
+        // Last seconds of zones and counters, dumped when a frame hitches
+        FlightRecorder* recorder;
+
+        // Prometheus metrics; recorded always, served over HTTP only when metricsPort is set
+        int              metricsPort;
+        MetricsServer*   metrics;
+        MetricHistogram* frameSeconds;
+        MetricHistogram* waterUpdateSeconds;
+        MetricCounter*   verticesEvaluated;
+        MetricGauge*     vramBytes[GLMEM_CATEGORY_COUNT];
+
+        // Driver debug messages, captured when a debug context was requested (see setDebugContext)
+        bool        debugContext;
+        GLDebugLog* gl_debug;
+
+        // Where the water, sky and models are drawn: GL, or a backend needing no GL context (see Scenario::renderer)
+        Renderer* sceneRenderer;
+
         // Camera
         Camera*  camera;
 
-        // Skybox
+        // Sky, either procedural (sky) or a static cubemap (skybox); only the one in use is created. Without GL a procedural sky is a skybox without faces
+        bool     proceduralSky;
+        Sky*     sky;
         Skybox*  skybox;
 
-        // Water
+        // Water, evaluated on the thread pool
         Water*   water;
         Shader*  water_shader;
+        ThreadPool* pool;
+
+        // Spray and foam thrown off the water's crests (NULL unless particles is set); simulated on the CPU, and not drawn, without GL
+        SprayParticles* particles;
+
+        // Foam coverage of the water, sampled by water.fs (NULL unless foam is set, and without GL)
+        FoamMap* foam;
+
+        // Caustics lighting submerged models (NULL unless caustics is set, and without GL)
+        CausticsMap* caustics;
+
+        // Re-evaluates every water update with each evaluator and thread count (NULL unless a tolerance was set, see setValidation)
+        float           validationTolerance;
+        WaterValidator* validator;
+        ParticleValidator* particleValidator;   // compares GPU particles with their CPU reference (NULL unless validating them)
+
+        // Planar reflection of the scene about the water (NULL reflects the skybox cubemap only)
+        Reflection* reflection;
+        bool planarReflections;
 
-        // Test backpack model
+        // Test backpack model (models.path), read the first time models are shown; its shaders are created then too
         Shader*  backpack_shader;
-        Model*   backpack_model;
+        ModelHandle* backpack_model;
+        bool     showModel;
+
+        // Pose of a skinned model, sampled on the pool and skinned on the GPU once per frame (NULL for models without clips, and without GL)
+        Animator* animator;
+        Skinner*  skinner;
+        ComputeShader* skin_shader;
+        double   animationTime;
+
+        // Backpack copies laid out on a modelGrid x modelGrid grid over the water, culled on the GPU (NULL until the model is resolved, and without GL, where each transform is drawn through sceneRenderer)
+        vector<glm::mat4> modelTransforms;
+        vector<int> modelLods;      // level of detail each copy was last drawn at, without GL (the cull pass keeps its own)
+        ModelInstances* backpack_instances;
+        ComputeShader*  cull_shader;
+        ComputeShader*  cluster_shader;     // NULL unless models.clusters is set
+        MaterialTable*  backpack_materials; // NULL when textures are bound per mesh (models.materials, skinned models)
+        int      modelGrid;
+        float    modelSpacing;
+
+        // Depth pyramid of the previous frame, used to occlusion cull instances (NULL without GL)
+        HiZ*     hiz;
 
 };
 
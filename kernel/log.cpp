@@ -0,0 +1,474 @@
+/**
+ * @file log.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Asynchronous structured logging. Call sites copy their raw arguments into a lock-free queue; a background thread formats them and writes them to the sinks
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "log.h"
+
+#include <stdio.h>
+#include <ctype.h>
+
+/**
+ * @brief Writes a formatted line to stderr
+ *
+ * @param record Record being written
+ * @param text Formatted line
+ */
+void StderrLogSink::write(const LogRecord& record, const string& text) {
+    fputs(text.c_str(), stderr);
+}
+
+/**
+ * @brief Flushes stderr
+ */
+void StderrLogSink::flush() {
+    fflush(stderr);
+}
+
+/**
+ * @brief Construct a new FileLogSink object, truncating the file
+ *
+ * @param path Path of the log file
+ */
+FileLogSink::FileLogSink(const char* path) : file(path, std::ios::out | std::ios::trunc) {
+
+}
+
+/**
+ * @brief Writes a formatted line to the file
+ *
+ * @param record Record being written
+ * @param text Formatted line
+ */
+void FileLogSink::write(const LogRecord& record, const string& text) {
+    file << text;
+}
+
+/**
+ * @brief Flushes the file
+ */
+void FileLogSink::flush() {
+    file.flush();
+}
+
+/**
+ * @brief Construct a new BinaryLogSink object, truncating the file and writing the magic
+ *
+ * @param path Path of the log file
+ */
+BinaryLogSink::BinaryLogSink(const char* path) : file(path, std::ios::out | std::ios::trunc | std::ios::binary) {
+    file.write("EWSLOG1\n", 8);
+}
+
+/**
+ * @brief Writes a record without formatting it
+ *
+ * @param record Record being written
+ * @param text Unused
+ */
+void BinaryLogSink::write(const LogRecord& record, const string& text) {
+    unsigned short categoryLength = (unsigned short)strlen(record.category);
+    unsigned short formatLength = (unsigned short)strlen(record.format);
+
+    file.write((const char*)&record.timeNs, sizeof(record.timeNs));
+    file.write((const char*)&record.thread, sizeof(record.thread));
+    file.write((const char*)&record.level, sizeof(record.level));
+    file.write((const char*)&record.argCount, sizeof(record.argCount));
+    file.write((const char*)&record.used, sizeof(record.used));
+    file.write((const char*)&categoryLength, sizeof(categoryLength));
+    file.write((const char*)&formatLength, sizeof(formatLength));
+    file.write(record.category, categoryLength);
+    file.write(record.format, formatLength);
+    file.write((const char*)record.types, record.argCount);
+    file.write(record.data, record.used);
+}
+
+/**
+ * @brief Flushes the file
+ */
+void BinaryLogSink::flush() {
+    file.flush();
+}
+
+/**
+ * @brief Returns the logger of the process
+ *
+ * @return Logger&
+ */
+Logger& Logger::get() {
+    static Logger logger;
+    return logger;
+}
+
+/**
+ * @brief Construct a new Logger object. Records are queued from the start but only written once start() is called
+ */
+Logger::Logger() : origin(std::chrono::steady_clock::now()), level(LOG_LEVEL_INFO), cells(new Cell[LOG_QUEUE_SIZE]), enqueuePos(0), dequeuePos(0), dropped(0), textSinks(false), running(false) {
+    for (size_t i = 0; i < LOG_QUEUE_SIZE; i ++)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Destroy the Logger object, writing whatever is still queued
+ */
+Logger::~Logger() {
+    stop();
+    delete[] cells;
+}
+
+/**
+ * @brief Adds a sink. The logger takes ownership; call before start()
+ *
+ * @param sink Sink to add
+ */
+void Logger::addSink(LogSink* sink) {
+    sinks.push_back(sink);
+    textSinks = textSinks || sink->wantsText();
+}
+
+/**
+ * @brief Starts the writer thread
+ */
+void Logger::start() {
+    if (running)
+        return;
+    running = true;
+    thread = std::thread(&Logger::run, this);
+}
+
+/**
+ * @brief Stops the writer thread once the queue is drained, logs a warning if any records were dropped, then flushes and deletes the sinks. Records logged afterwards stay queued
+ */
+void Logger::stop() {
+    if (!running)
+        return;
+
+    running = false;
+    thread.join();
+
+    // the queue is empty now, so the summary fits; drain it (and anything logged since) here
+    unsigned long long lost = dropped.load();
+    if (lost > 0)
+        log(LOG_LEVEL_WARN, "log", "%llu records dropped (queue full)", lost);
+    LogRecord record;
+    while (consume(record))
+        write(record);
+
+    for (LogSink* sink : sinks) {
+        sink->flush();
+        delete sink;
+    }
+    sinks.clear();
+    textSinks = false;
+}
+
+/**
+ * @brief Sets the least severe level that is recorded
+ *
+ * @param level Level
+ */
+void Logger::setLevel(LogLevel level) {
+    this->level.store(level, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns how many records were dropped because the queue was full
+ *
+ * @return unsigned long long
+ */
+unsigned long long Logger::getDropped() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Claims a free cell of the queue (bounded MPSC queue after Vyukov: each cell's sequence says whose turn it is)
+ *
+ * @return Cell* whose record to fill and publish, or NULL if the queue is full
+ */
+Logger::Cell* Logger::acquire() {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = cells[pos & (LOG_QUEUE_SIZE - 1)];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        long long difference = (long long)sequence - (long long)pos;
+        if (difference == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                return &cell;
+        } else if (difference < 0) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * @brief Hands a filled record to the writer thread
+ *
+ * @param cell Cell returned by acquire()
+ */
+void Logger::publish(Cell* cell) {
+    // the sequence still holds the position the cell was claimed at
+    size_t sequence = cell->sequence.load(std::memory_order_relaxed);
+    cell->sequence.store(sequence + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Takes the oldest published record off the queue. Writer thread only
+ *
+ * @param record Receives the record
+ * @return bool whether there was one
+ */
+bool Logger::consume(LogRecord& record) {
+    Cell& cell = cells[dequeuePos & (LOG_QUEUE_SIZE - 1)];
+    if (cell.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+        return false;
+
+    record = cell.record;
+    cell.sequence.store(dequeuePos + LOG_QUEUE_SIZE, std::memory_order_release);
+    dequeuePos ++;
+    return true;
+}
+
+/**
+ * @brief Writer thread: drains the queue, flushing whenever it runs dry, until stopped and empty
+ */
+void Logger::run() {
+    LogRecord record;
+    for (;;) {
+        bool any = false;
+        while (consume(record)) {
+            write(record);
+            any = true;
+        }
+
+        if (any) {
+            for (LogSink* sink : sinks)
+                sink->flush();
+        } else if (!running) {
+            break;
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(LOG_POLL_US));
+        }
+    }
+}
+
+/**
+ * @brief Formats a record (if any sink wants text) and passes it to every sink
+ *
+ * @param record Record to write
+ */
+void Logger::write(const LogRecord& record) {
+    string text = textSinks ? format(record) : string();
+    for (LogSink* sink : sinks)
+        sink->write(record, text);
+}
+
+/**
+ * @brief Returns a small number identifying the calling thread, assigned on its first log call
+ *
+ * @return unsigned int
+ */
+unsigned int Logger::threadIndex() {
+    static std::atomic<unsigned int> next(0);
+    thread_local unsigned int index = next.fetch_add(1);
+    return index;
+}
+
+/**
+ * @brief Appends one argument. Arguments that do not fit are dropped (formatted as missing)
+ *
+ * @param record Record being filled
+ * @param type Type tag
+ * @param value Bytes of the value
+ * @param size Size of the value
+ */
+void Logger::putRaw(LogRecord& record, LogArgType type, const void* value, size_t size) {
+    if (record.argCount >= LOG_MAX_ARGS || record.used + size > LOG_ARG_BYTES)
+        return;
+    memcpy(record.data + record.used, value, size);
+    record.used += (unsigned short)size;
+    record.types[record.argCount ++] = (unsigned char)type;
+}
+
+/**
+ * @brief Appends a copy of a string, truncated to the space left in the record
+ *
+ * @param record Record being filled
+ * @param s Characters
+ * @param length Number of characters
+ */
+void Logger::putString(LogRecord& record, const char* s, size_t length) {
+    if (record.argCount >= LOG_MAX_ARGS || record.used >= LOG_ARG_BYTES)
+        return;
+    size_t space = LOG_ARG_BYTES - record.used - 1;
+    if (length > space)
+        length = space;
+    memcpy(record.data + record.used, s, length);
+    record.data[record.used + length] = '\0';
+    record.used += (unsigned short)(length + 1);
+    record.types[record.argCount ++] = LOG_ARG_STRING;
+}
+
+/**
+ * @brief Formats a record as one line: time, thread, level, category and the message
+ *
+ * The format is printf-style. Each conversion takes the next argument and is rebuilt for the argument's recorded type, so flags, width and precision apply but length modifiers in the format are ignored
+ *
+ * @param record Record to format
+ * @return string ending in a newline
+ */
+string Logger::format(const LogRecord& record) {
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "[%12.6f] [t%u] %-5s %s: ", record.timeNs * 1e-9, record.thread, levelName((LogLevel)record.level), record.category ? record.category : "");
+    string out = buffer;
+    if (record.format == NULL)
+        return out + "\n";
+
+    unsigned int arg = 0;
+    size_t offset = 0;
+    const char* p = record.format;
+    while (*p) {
+        if (*p != '%') {
+            out += *p ++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out += '%';
+            p += 2;
+            continue;
+        }
+
+        // flags, width and precision are kept as written
+        const char* start = p ++;
+        while (*p && strchr("-+ #0", *p))
+            p ++;
+        while (isdigit((unsigned char)*p))
+            p ++;
+        if (*p == '.') {
+            p ++;
+            while (isdigit((unsigned char)*p))
+                p ++;
+        }
+        string spec(start, p);
+        while (*p && strchr("hlLqjzt", *p))
+            p ++;
+        char conversion = *p;
+        if (conversion)
+            p ++;
+
+        if (arg >= record.argCount) {
+            out += "<missing>";
+            continue;
+        }
+
+        const char* value = record.data + offset;
+        bool integral = conversion && strchr("dicuxXo", conversion);
+        bool floating = conversion && strchr("fFeEgGaA", conversion);
+        switch (record.types[arg ++]) {
+            case LOG_ARG_INT: {
+                long long v;
+                memcpy(&v, value, sizeof(v));
+                offset += sizeof(v);
+                if (floating)
+                    snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), (double)v);
+                else if (conversion == 'c')
+                    snprintf(buffer, sizeof(buffer), (spec + 'c').c_str(), (int)v);
+                else if (integral && conversion != 'd' && conversion != 'i')
+                    snprintf(buffer, sizeof(buffer), (spec + "ll" + conversion).c_str(), (unsigned long long)v);
+                else
+                    snprintf(buffer, sizeof(buffer), (spec + "lld").c_str(), v);
+                break;
+            }
+            case LOG_ARG_UINT: {
+                unsigned long long v;
+                memcpy(&v, value, sizeof(v));
+                offset += sizeof(v);
+                if (floating)
+                    snprintf(buffer, sizeof(buffer), (spec + conversion).c_str(), (double)v);
+                else if (conversion == 'c')
+                    snprintf(buffer, sizeof(buffer), (spec + 'c').c_str(), (int)v);
+                else if (integral)
+                    snprintf(buffer, sizeof(buffer), (spec + "ll" + (conversion == 'i' ? 'd' : conversion)).c_str(), v);
+                else
+                    snprintf(buffer, sizeof(buffer), (spec + "llu").c_str(), v);
+                break;
+            }
+            case LOG_ARG_DOUBLE: {
+                double v;
+                memcpy(&v, value, sizeof(v));
+                offset += sizeof(v);
+                if (integral)
+                    snprintf(buffer, sizeof(buffer), (spec + "lld").c_str(), (long long)v);
+                else
+                    snprintf(buffer, sizeof(buffer), (spec + (floating ? conversion : 'g')).c_str(), v);
+                break;
+            }
+            case LOG_ARG_STRING: {
+                size_t length = strlen(value);
+                offset += length + 1;
+                // strings can be longer than the scratch buffer
+                if (conversion == 's' && spec.size() > 1) {
+                    snprintf(buffer, sizeof(buffer), (spec + 's').c_str(), value);
+                    out += buffer;
+                } else {
+                    out += value;
+                }
+                continue;
+            }
+            case LOG_ARG_POINTER: {
+                const void* v;
+                memcpy(&v, value, sizeof(v));
+                offset += sizeof(v);
+                snprintf(buffer, sizeof(buffer), "%p", v);
+                break;
+            }
+        }
+        out += buffer;
+    }
+    return out + "\n";
+}
+
+/**
+ * @brief Returns the display name of a level
+ *
+ * @param level Level
+ * @return const char*
+ */
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LOG_LEVEL_TRACE: return "TRACE";
+        case LOG_LEVEL_DEBUG: return "DEBUG";
+        case LOG_LEVEL_INFO:  return "INFO";
+        case LOG_LEVEL_WARN:  return "WARN";
+        case LOG_LEVEL_ERROR: return "ERROR";
+        default:              return "OFF";
+    }
+}
+
+/**
+ * @brief Parses a level name (trace, debug, info, warn, error or off)
+ *
+ * @param name Name, lower case
+ * @param level Receives the level
+ * @return bool whether the name was recognized
+ */
+bool Logger::parseLevel(const char* name, LogLevel& level) {
+    for (int i = LOG_LEVEL_TRACE; i <= LOG_LEVEL_OFF; i ++) {
+        const char* candidate = levelName((LogLevel)i);
+        size_t j = 0;
+        while (candidate[j] && name[j] && tolower((unsigned char)candidate[j]) == name[j])
+            j ++;
+        if (candidate[j] == '\0' && name[j] == '\0') {
+            level = (LogLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,219 @@
+/**
+ * @file log.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Asynchronous structured logging. Call sites copy their raw arguments into a lock-free queue; a background thread formats them and writes them to the sinks
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef LOG_H
+#define LOG_H
+
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+
+// queued records; must be a power of two. Records logged while the queue is full are dropped and counted, never waited on
+#define LOG_QUEUE_SIZE 4096
+#define LOG_MAX_ARGS 8
+// argument bytes per record; longer strings are truncated
+#define LOG_ARG_BYTES 448
+// how long the writer thread sleeps when the queue is empty
+#define LOG_POLL_US 1000
+#define LOG_DEFAULT_PATH "ews.log"
+
+enum LogLevel {
+    LOG_LEVEL_TRACE,
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+};
+
+enum LogArgType {
+    LOG_ARG_INT,        // long long
+    LOG_ARG_UINT,       // unsigned long long
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING,     // copied, null-terminated
+    LOG_ARG_POINTER
+};
+
+/**
+ * @brief One log call: where it came from, its printf-style format, and its arguments still in binary form
+ */
+struct LogRecord {
+    long long timeNs;       // since the logger was created
+    const char* category;   // must be a string literal
+    const char* format;     // must be a string literal
+    unsigned int thread;
+    unsigned char level;
+    unsigned char argCount;
+    unsigned char types[LOG_MAX_ARGS];
+    unsigned short used;    // bytes of data in use
+    char data[LOG_ARG_BYTES];
+};
+
+/**
+ * @brief Destination of log records. Sinks run on the logger's thread only
+ */
+class LogSink {
+    public:
+        virtual ~LogSink() {}
+
+        // whether write() needs the formatted text (records are only formatted if some sink does)
+        virtual bool wantsText() const {
+            return true;
+        }
+        virtual void write(const LogRecord& record, const string& text) = 0;
+        virtual void flush() {}
+};
+
+/**
+ * @brief Writes formatted lines to stderr
+ */
+class StderrLogSink : public LogSink {
+    public:
+        void write(const LogRecord& record, const string& text);
+        void flush();
+};
+
+/**
+ * @brief Writes formatted lines to a file
+ */
+class FileLogSink : public LogSink {
+    public:
+        FileLogSink(const char* path);
+
+        void write(const LogRecord& record, const string& text);
+        void flush();
+
+    private:
+        std::ofstream file;
+};
+
+/**
+ * @brief Writes unformatted records to a file, for tools that decode them later
+ *
+ * Layout: the magic "EWSLOG1\n", then per record: i64 timeNs, u32 thread, u8 level, u8 argCount, u16 used, u16 categoryLength, u16 formatLength, category bytes, format bytes, argCount type bytes, used data bytes (host byte order)
+ */
+class BinaryLogSink : public LogSink {
+    public:
+        BinaryLogSink(const char* path);
+
+        bool wantsText() const {
+            return false;
+        }
+        void write(const LogRecord& record, const string& text);
+        void flush();
+
+    private:
+        std::ofstream file;
+};
+
+/**
+ * @brief Process-wide logger. log() is safe from any thread, never blocks and never allocates; formatting and I/O happen on the logger's thread
+ */
+class Logger {
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            LogRecord record;
+        };
+
+    public:
+        static Logger& get();
+
+        void addSink(LogSink* sink);
+        void start();
+        void stop();
+
+        void setLevel(LogLevel level);
+        LogLevel getLevel() const {
+            return (LogLevel)level.load(std::memory_order_relaxed);
+        }
+        unsigned long long getDropped() const;
+
+        template <typename... Args>
+        void log(LogLevel level, const char* category, const char* format, const Args&... args) {
+            Cell* cell = acquire();
+            if (cell == NULL)
+                return;
+            LogRecord* record = &cell->record;
+            record->timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+            record->category = category;
+            record->format = format;
+            record->thread = threadIndex();
+            record->level = (unsigned char)level;
+            record->argCount = 0;
+            record->used = 0;
+            encode(*record, args...);
+            publish(cell);
+        }
+
+        static string format(const LogRecord& record);
+        static const char* levelName(LogLevel level);
+        static bool parseLevel(const char* name, LogLevel& level);
+
+    private:
+        Logger();
+        ~Logger();
+
+        Cell* acquire();
+        void publish(Cell* cell);
+        bool consume(LogRecord& record);
+        void run();
+        void write(const LogRecord& record);
+        static unsigned int threadIndex();
+
+        // argument encoding; each overload appends one argument
+        static void encode(LogRecord& record) {}
+        template <typename T, typename... Rest>
+        static void encode(LogRecord& record, const T& arg, const Rest&... rest) {
+            put(record, arg);
+            encode(record, rest...);
+        }
+        static void putRaw(LogRecord& record, LogArgType type, const void* value, size_t size);
+        static void put(LogRecord& record, int v)                   { long long x = v; putRaw(record, LOG_ARG_INT, &x, sizeof(x)); }
+        static void put(LogRecord& record, long v)                  { long long x = v; putRaw(record, LOG_ARG_INT, &x, sizeof(x)); }
+        static void put(LogRecord& record, long long v)             { putRaw(record, LOG_ARG_INT, &v, sizeof(v)); }
+        static void put(LogRecord& record, unsigned int v)          { unsigned long long x = v; putRaw(record, LOG_ARG_UINT, &x, sizeof(x)); }
+        static void put(LogRecord& record, unsigned long v)         { unsigned long long x = v; putRaw(record, LOG_ARG_UINT, &x, sizeof(x)); }
+        static void put(LogRecord& record, unsigned long long v)    { putRaw(record, LOG_ARG_UINT, &v, sizeof(v)); }
+        static void put(LogRecord& record, double v)                { putRaw(record, LOG_ARG_DOUBLE, &v, sizeof(v)); }
+        static void put(LogRecord& record, const void* v)           { putRaw(record, LOG_ARG_POINTER, &v, sizeof(v)); }
+        static void put(LogRecord& record, const char* v)           { putString(record, v ? v : "(null)", v ? strlen(v) : 6); }
+        static void put(LogRecord& record, const string& v)         { putString(record, v.c_str(), v.size()); }
+        static void putString(LogRecord& record, const char* s, size_t length);
+
+        std::chrono::steady_clock::time_point origin;
+        std::atomic<int> level;
+
+        Cell* cells;
+        std::atomic<size_t> enqueuePos;
+        size_t dequeuePos;
+        std::atomic<unsigned long long> dropped;
+
+        vector<LogSink*> sinks;
+        bool textSinks;
+        std::atomic<bool> running;
+        std::thread thread;
+};
+
+// the level check happens before any argument is evaluated
+#define LOG(level, category, ...) do { if ((level) >= Logger::get().getLevel()) Logger::get().log((level), (category), __VA_ARGS__); } while (0)
+#define LOG_TRACE(category, ...)    LOG(LOG_LEVEL_TRACE, category, __VA_ARGS__)
+#define LOG_DEBUG(category, ...)    LOG(LOG_LEVEL_DEBUG, category, __VA_ARGS__)
+#define LOG_INFO(category, ...)     LOG(LOG_LEVEL_INFO, category, __VA_ARGS__)
+#define LOG_WARN(category, ...)     LOG(LOG_LEVEL_WARN, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...)    LOG(LOG_LEVEL_ERROR, category, __VA_ARGS__)
+
+#endif
@@ -0,0 +1,358 @@
+/**
+ * @file metrics.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Process-wide metrics (lock-free counters, gauges and histograms) and an optional HTTP server exposing them at /metrics in Prometheus text format
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "metrics.h"
+
+#include <sstream>
+#include <string.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET socket_t;
+#define INVALID_SOCKET_VALUE INVALID_SOCKET
+#define closeSocket closesocket
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int socket_t;
+#define INVALID_SOCKET_VALUE -1
+#define closeSocket close
+#endif
+
+#include "log.h"
+
+// how often the server thread checks whether it should stop
+#define METRICS_POLL_MS 200
+
+// longest a client may take to send its request before it is dropped; the server answers one client at a time
+#define METRICS_RECV_MS 1000
+
+/**
+ * @brief Construct a new MetricHistogram object
+ *
+ * @param bounds Upper bounds of the buckets, ascending; a +Inf bucket is added
+ */
+MetricHistogram::MetricHistogram(const vector<double>& bounds) : bounds(bounds), buckets(new std::atomic<unsigned long long>[bounds.size() + 1]), count(0), sum(0) {
+    for (unsigned int i = 0; i <= bounds.size(); i ++)
+        buckets[i].store(0);
+}
+
+/**
+ * @brief Records one observation
+ *
+ * @param v Observed value
+ */
+void MetricHistogram::observe(double v) {
+    unsigned int i = 0;
+    while (i < bounds.size() && v > bounds[i])
+        i ++;
+    buckets[i].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+
+    double expected = sum.load(std::memory_order_relaxed);
+    while (!sum.compare_exchange_weak(expected, expected + v, std::memory_order_relaxed))
+        ;
+}
+
+/**
+ * @brief Writes the histogram's series (cumulative buckets, sum and count)
+ *
+ * @param out Stream written to
+ * @param name Family name
+ * @param labels Labels of this histogram, without braces (may be empty)
+ */
+void MetricHistogram::write(std::ostream& out, const string& name, const string& labels) const {
+    string prefix = labels.empty() ? "" : labels + ",";
+    unsigned long long cumulative = 0;
+    for (unsigned int i = 0; i <= bounds.size(); i ++) {
+        cumulative += buckets[i].load(std::memory_order_relaxed);
+        out << name << "_bucket{" << prefix << "le=\"";
+        if (i < bounds.size())
+            out << bounds[i];
+        else
+            out << "+Inf";
+        out << "\"} " << cumulative << "\n";
+    }
+    string suffix = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << suffix << " " << sum.load(std::memory_order_relaxed) << "\n";
+    out << name << "_count" << suffix << " " << count.load(std::memory_order_relaxed) << "\n";
+}
+
+/**
+ * @brief Returns the metrics of the process
+ *
+ * @return Metrics&
+ */
+Metrics& Metrics::get() {
+    static Metrics metrics;
+    return metrics;
+}
+
+/**
+ * @brief Destroy the Metrics object along with every metric
+ */
+Metrics::~Metrics() {
+    for (auto& it : families) {
+        for (auto& c : it.second.counters)
+            delete c.second;
+        for (auto& g : it.second.gauges)
+            delete g.second;
+        for (auto& h : it.second.histograms)
+            delete h.second;
+    }
+}
+
+/**
+ * @brief Returns the counter registered under name and labels, registering it first if needed
+ *
+ * @param name Metric name
+ * @param help Description written as # HELP
+ * @param labels Labels without braces, e.g. category="vertex"
+ * @return MetricCounter* valid for the lifetime of the process
+ */
+MetricCounter* Metrics::counter(const string& name, const string& help, const string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    MetricCounter*& metric = family(name, help, "counter").counters[labels];
+    if (metric == NULL)
+        metric = new MetricCounter();
+    return metric;
+}
+
+/**
+ * @brief Returns the gauge registered under name and labels, registering it first if needed
+ *
+ * @param name Metric name
+ * @param help Description written as # HELP
+ * @param labels Labels without braces
+ * @return MetricGauge* valid for the lifetime of the process
+ */
+MetricGauge* Metrics::gauge(const string& name, const string& help, const string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    MetricGauge*& metric = family(name, help, "gauge").gauges[labels];
+    if (metric == NULL)
+        metric = new MetricGauge();
+    return metric;
+}
+
+/**
+ * @brief Returns the histogram registered under name and labels, registering it first if needed
+ *
+ * @param name Metric name
+ * @param help Description written as # HELP
+ * @param bounds Bucket upper bounds, used only when the histogram is created
+ * @param labels Labels without braces
+ * @return MetricHistogram* valid for the lifetime of the process
+ */
+MetricHistogram* Metrics::histogram(const string& name, const string& help, const vector<double>& bounds, const string& labels) {
+    std::lock_guard<std::mutex> lock(mutex);
+    MetricHistogram*& metric = family(name, help, "histogram").histograms[labels];
+    if (metric == NULL)
+        metric = new MetricHistogram(bounds);
+    return metric;
+}
+
+/**
+ * @brief Writes every metric in Prometheus text exposition format (version 0.0.4)
+ *
+ * @param out Stream written to
+ */
+void Metrics::write(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& it : families) {
+        const string& name = it.first;
+        const Family& f = it.second;
+        out << "# HELP " << name << " " << f.help << "\n";
+        out << "# TYPE " << name << " " << f.type << "\n";
+
+        for (auto& c : f.counters)
+            out << name << (c.first.empty() ? "" : "{" + c.first + "}") << " " << c.second->get() << "\n";
+        for (auto& g : f.gauges)
+            out << name << (g.first.empty() ? "" : "{" + g.first + "}") << " " << g.second->get() << "\n";
+        for (auto& h : f.histograms)
+            h.second->write(out, name, h.first);
+    }
+}
+
+/**
+ * @brief Returns the family of a name, creating it on first use. Caller holds the mutex
+ *
+ * @param name Metric name
+ * @param help Description
+ * @param type Prometheus type
+ * @return Family&
+ */
+Metrics::Family& Metrics::family(const string& name, const string& help, const char* type) {
+    Family& f = families[name];
+    if (f.type.empty()) {
+        f.help = help;
+        f.type = type;
+    }
+    return f;
+}
+
+/**
+ * @brief Construct a new MetricsServer object. Nothing is opened until start
+ *
+ * @param port Local TCP port
+ */
+MetricsServer::MetricsServer(int port) : port(port), running(false), listenSocket(-1) {
+
+}
+
+/**
+ * @brief Destroy the MetricsServer object, stopping it if needed
+ */
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+/**
+ * @brief Binds to 127.0.0.1:port and starts serving on a background thread
+ *
+ * @return bool representing the success of the operation
+ */
+bool MetricsServer::start() {
+    if (running)
+        return true;
+
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        LOG_ERROR("metrics", "Unable to initialize Winsock");
+        return false;
+    }
+#endif
+
+    socket_t s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == INVALID_SOCKET_VALUE) {
+        LOG_ERROR("metrics", "Unable to create metrics socket");
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((unsigned short)port);
+    if (bind(s, (sockaddr*)&address, sizeof(address)) != 0 || listen(s, 4) != 0) {
+        LOG_ERROR("metrics", "Unable to listen for metrics on port %d", port);
+        closeSocket(s);
+        return false;
+    }
+
+    listenSocket = (long long)s;
+    running = true;
+    thread = std::thread(&MetricsServer::serve, this);
+    LOG_INFO("metrics", "Serving metrics at http://127.0.0.1:%d/metrics", port);
+    return true;
+}
+
+/**
+ * @brief Stops the server thread and closes the socket
+ */
+void MetricsServer::stop() {
+    if (!running)
+        return;
+
+    running = false;
+    thread.join();
+    closeSocket((socket_t)listenSocket);
+    listenSocket = -1;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+/**
+ * @brief Returns the port the server listens on
+ *
+ * @return int
+ */
+int MetricsServer::getPort() const {
+    return port;
+}
+
+/**
+ * @brief Accept loop of the server thread. Polls so stop() is noticed within METRICS_POLL_MS
+ */
+void MetricsServer::serve() {
+    socket_t s = (socket_t)listenSocket;
+    while (running) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(s, &readable);
+        timeval timeout = { 0, METRICS_POLL_MS * 1000 };
+        if (select((int)s + 1, &readable, NULL, NULL, &timeout) <= 0)
+            continue;
+
+        socket_t client = accept(s, NULL, NULL);
+        if (client == INVALID_SOCKET_VALUE)
+            continue;
+        handle((long long)client);
+        closeSocket(client);
+    }
+}
+
+/**
+ * @brief Answers one request
+ *
+ * @param client Connected socket
+ */
+void MetricsServer::handle(long long client) {
+    socket_t c = (socket_t)client;
+
+    // a client that connects and sends nothing must not hold up the server, and with it stop()
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(c, &readable);
+    timeval timeout = { METRICS_RECV_MS / 1000, (METRICS_RECV_MS % 1000) * 1000 };
+    if (select((int)c + 1, &readable, NULL, NULL, &timeout) <= 0)
+        return;
+
+    // only the request line matters
+    char request[1024];
+    int received = recv(c, request, sizeof(request) - 1, 0);
+    if (received <= 0)
+        return;
+    request[received] = '\0';
+
+    std::ostringstream body;
+    const char* status;
+    const char* type;
+    if (strncmp(request, "GET /metrics ", 13) == 0 || strncmp(request, "GET /metrics?", 13) == 0) {
+        Metrics::get().write(body);
+        status = "200 OK";
+        type = "text/plain; version=0.0.4";
+    } else {
+        body << "not found\n";
+        status = "404 Not Found";
+        type = "text/plain";
+    }
+
+    string content = body.str();
+    std::ostringstream response;
+    response << "HTTP/1.1 " << status << "\r\nContent-Type: " << type << "\r\nContent-Length: " << content.size() << "\r\nConnection: close\r\n\r\n" << content;
+    string data = response.str();
+
+    size_t sent = 0;
+    while (sent < data.size()) {
+        int n = send(c, data.c_str() + sent, (int)(data.size() - sent), 0);
+        if (n <= 0)
+            break;
+        sent += n;
+    }
+}
@@ -0,0 +1,157 @@
+/**
+ * @file metrics.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Process-wide metrics (lock-free counters, gauges and histograms) and an optional HTTP server exposing them at /metrics in Prometheus text format
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+
+// port the metrics server listens on when none is given (bound to localhost only)
+#define METRICS_DEFAULT_PORT 9464
+
+/**
+ * @brief Monotonically increasing count
+ */
+class MetricCounter {
+    public:
+        MetricCounter() : value(0) {}
+
+        void add(unsigned long long n = 1) {
+            value.fetch_add(n, std::memory_order_relaxed);
+        }
+        unsigned long long get() const {
+            return value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<unsigned long long> value;
+};
+
+/**
+ * @brief Value that can go up and down
+ */
+class MetricGauge {
+    public:
+        MetricGauge() : value(0) {}
+
+        void set(double v) {
+            value.store(v, std::memory_order_relaxed);
+        }
+        double get() const {
+            return value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<double> value;
+};
+
+/**
+ * @brief Distribution of observations over fixed buckets (upper bounds, ascending)
+ */
+class MetricHistogram {
+    public:
+        MetricHistogram(const vector<double>& bounds);
+
+        void observe(double v);
+        void write(std::ostream& out, const string& name, const string& labels) const;
+
+    private:
+        vector<double> bounds;
+        std::unique_ptr<std::atomic<unsigned long long>[]> buckets;    // per bucket (not cumulative); the last is +Inf
+        std::atomic<unsigned long long> count;
+        std::atomic<double> sum;
+};
+
+/**
+ * @brief Named metrics of the process. Registering takes a lock and should happen once per call site (cache the returned pointer); recording is lock-free
+ *
+ * Metrics registered under the same name with different labels (e.g. "category=\"vertex\"") form one family
+ */
+class Metrics {
+    public:
+        static Metrics& get();
+
+        MetricCounter* counter(const string& name, const string& help, const string& labels = "");
+        MetricGauge* gauge(const string& name, const string& help, const string& labels = "");
+        MetricHistogram* histogram(const string& name, const string& help, const vector<double>& bounds, const string& labels = "");
+
+        void write(std::ostream& out) const;
+
+    private:
+        struct Family {
+            string help;
+            string type;
+            std::map<string, MetricCounter*> counters;
+            std::map<string, MetricGauge*> gauges;
+            std::map<string, MetricHistogram*> histograms;
+        };
+
+        Metrics() {}
+        ~Metrics();
+        Family& family(const string& name, const string& help, const char* type);
+
+        mutable std::mutex mutex;
+        std::map<string, Family> families;
+};
+
+/**
+ * @brief Counts bytes sent to the GPU
+ *
+ * @param bytes Bytes uploaded
+ */
+inline void countUpload(size_t bytes) {
+    static MetricCounter* uploaded = Metrics::get().counter("ews_upload_bytes_total", "Bytes uploaded to GPU buffers and textures");
+    uploaded->add(bytes);
+}
+
+/**
+ * @brief Counts draw calls issued
+ *
+ * @param n Number of draw calls
+ */
+inline void countDrawCalls(unsigned int n = 1) {
+    static MetricCounter* draws = Metrics::get().counter("ews_draw_calls_total", "Draw calls issued");
+    draws->add(n);
+}
+
+/**
+ * @brief Serves Metrics::get() over HTTP on a background thread. Only GET /metrics is answered
+ */
+class MetricsServer {
+    public:
+        MetricsServer(int port = METRICS_DEFAULT_PORT);
+        ~MetricsServer();
+
+        bool start();
+        void stop();
+
+        int getPort() const;
+
+    private:
+        int port;
+        std::atomic<bool> running;
+        std::thread thread;
+        long long listenSocket;  // SOCKET on Windows, file descriptor elsewhere; -1 when closed
+
+        void serve();
+        void handle(long long client);
+};
+
+#endif
@@ -0,0 +1,390 @@
+/**
+ * @file perf.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Performance regression suite: repeated headless runs of a scenario, baselines stored per machine, and a statistical comparison of new runs against them
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "perf.h"
+
+#include <stdio.h>
+#include <math.h>
+#include <ctype.h>
+#include <string.h>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#endif
+
+#include "SDL2/SDL.h"
+
+// differences smaller than this are noise whatever their relative size
+#define PERF_MIN_DELTA_MS 0.02
+// the exact Mann-Whitney distribution is used up to this many runs per side (and without ties)
+#define PERF_EXACT_RUNS 20
+
+/**
+ * @brief Returns the processor's brand string, if it reports one
+ *
+ * @return string
+ */
+static string cpuBrand() {
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    unsigned int regs[12];
+    if (__get_cpuid(0x80000000, &regs[0], &regs[1], &regs[2], &regs[3]) && regs[0] >= 0x80000004) {
+        for (unsigned int leaf = 0; leaf < 3; leaf ++)
+            __get_cpuid(0x80000002 + leaf, &regs[leaf * 4], &regs[leaf * 4 + 1], &regs[leaf * 4 + 2], &regs[leaf * 4 + 3]);
+        string brand((const char*)regs, sizeof(regs));
+        brand = brand.c_str();
+        size_t first = brand.find_first_not_of(' ');
+        return first == string::npos ? "unknown" : brand.substr(first);
+    }
+#endif
+    return "unknown";
+}
+
+/**
+ * @brief Identifies the machine a run happened on. Baselines are only compared on the machine that recorded them
+ *
+ * @param device GL renderer and version (RunStats::device)
+ * @param description Receives the facts the fingerprint is made of
+ * @return string 16 hex digits
+ */
+string machineFingerprint(const string& device, string& description) {
+    std::ostringstream facts;
+    facts << "platform=" << SDL_GetPlatform() << "; cpu=" << cpuBrand() << "; cores=" << SDL_GetCPUCount()
+          << "; ram=" << SDL_GetSystemRAM() << "MB; gpu=" << device;
+    description = facts.str();
+
+    // FNV-1a
+    unsigned long long hash = 14695981039346656037ULL;
+    for (unsigned char c : description) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", hash);
+    return hex;
+}
+
+/**
+ * @brief Returns where the baseline of a scenario on a machine is kept
+ *
+ * @param directory Baseline directory
+ * @param fingerprint Machine fingerprint
+ * @param scenario Scenario; its name picks the file
+ * @return string
+ */
+string baselinePath(const string& directory, const string& fingerprint, const Scenario& scenario) {
+    string slug;
+    for (char c : scenario.name)
+        slug += isalnum((unsigned char)c) ? (char)tolower((unsigned char)c) : '_';
+    return directory + "/" + fingerprint + "-" + slug + ".baseline";
+}
+
+/**
+ * @brief Adds the metrics of one run: startup, frame-time summaries and the mean of every zone
+ *
+ * @param samples Samples to add to
+ * @param stats Statistics of the run
+ */
+void addPerfRun(PerfSamples& samples, const RunStats& stats) {
+    samples["startup"].push_back(stats.startupMs);
+    samples["frame.mean"].push_back(stats.meanMs);
+    samples["frame.p50"].push_back(stats.p50Ms);
+    samples["frame.p95"].push_back(stats.p95Ms);
+    for (auto& it : stats.zones)
+        samples[it.first].push_back(it.second);
+}
+
+/**
+ * @brief Reads a baseline file
+ *
+ * @param path Path of the file
+ * @param samples Receives the samples
+ * @param settings Receives the scenario settings the baseline was recorded with
+ * @param error Receives a description of the problem on failure
+ * @return bool representing the success of the operation
+ */
+bool loadBaseline(const string& path, PerfSamples& samples, string& settings, string& error) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        error = "no baseline at " + path;
+        return false;
+    }
+
+    string line;
+    while (std::getline(file, line)) {
+        std::istringstream in(line);
+        string tag;
+        in >> tag;
+        if (tag == "settings") {
+            std::getline(in >> std::ws, settings);
+        } else if (tag == "metric") {
+            string name;
+            double v;
+            in >> name;
+            vector<double>& values = samples[name];
+            while (in >> v)
+                values.push_back(v);
+        }
+    }
+    if (samples.empty()) {
+        error = path + " holds no metrics";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Writes a baseline file, creating its directory if needed
+ *
+ * @param path Path of the file
+ * @param samples Samples to store
+ * @param settings Scenario settings (describeScenario)
+ * @param machine Machine description (machineFingerprint)
+ * @return bool representing the success of the operation
+ */
+bool saveBaseline(const string& path, const PerfSamples& samples, const string& settings, const string& machine) {
+    size_t slash = path.find_last_of('/');
+    if (slash != string::npos) {
+#ifdef _WIN32
+        _mkdir(path.substr(0, slash).c_str());
+#else
+        mkdir(path.substr(0, slash).c_str(), 0755);
+#endif
+    }
+
+    std::ofstream file(path.c_str());
+    if (!file)
+        return false;
+
+    file << "# EWS performance baseline; times in ms, one value per run\n";
+    file << "machine " << machine << "\n";
+    file << "settings " << settings << "\n";
+    file.precision(9);
+    for (auto& it : samples) {
+        file << "metric " << it.first;
+        for (double v : it.second)
+            file << " " << v;
+        file << "\n";
+    }
+    return (bool)file;
+}
+
+/**
+ * @brief Returns every setting of a scenario on one line, so a baseline is only compared against the same workload
+ *
+ * @param scenario Scenario
+ * @return string
+ */
+string describeScenario(const Scenario& scenario) {
+    string settings;
+    for (const string& key : Scenario::keys()) {
+        if (key == "name")
+            continue;
+        settings += (settings.empty() ? "" : " ") + key + "=" + scenario.get(key);
+    }
+    return settings;
+}
+
+/**
+ * @brief Returns the median of a set of values
+ *
+ * @param values Values (copied)
+ * @return double, 0 when empty
+ */
+static double median(vector<double> values) {
+    if (values.empty())
+        return 0;
+    size_t mid = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + mid, values.end());
+    double upper = values[mid];
+    if (values.size() % 2 == 1)
+        return upper;
+    return 0.5 * (upper + *std::max_element(values.begin(), values.begin() + mid));
+}
+
+/**
+ * @brief One-sided Mann-Whitney U test of whether b tends to be larger than a
+ *
+ * Exact when both sides have at most PERF_EXACT_RUNS values and no ties, otherwise the normal approximation with tie and continuity corrections
+ *
+ * @param a First sample
+ * @param b Second sample
+ * @return double p-value (small when b is larger)
+ */
+double mannWhitneyGreater(const vector<double>& a, const vector<double>& b) {
+    int n = (int)a.size(), m = (int)b.size();
+    if (n == 0 || m == 0)
+        return 1.0;
+
+    // U counts the pairs where b is larger, ties counting half
+    double u = 0;
+    bool ties = false;
+    for (double x : a) {
+        for (double y : b) {
+            if (y > x)
+                u += 1;
+            else if (y == x) {
+                u += 0.5;
+                ties = true;
+            }
+        }
+    }
+
+    if (!ties && n <= PERF_EXACT_RUNS && m <= PERF_EXACT_RUNS) {
+        // count[i][j][k]: orderings of i values of a and j of b with U = k. The largest value is either from b (beating all i) or from a
+        vector<vector<vector<double> > > count(n + 1, vector<vector<double> >(m + 1));
+        for (int i = 0; i <= n; i ++) {
+            for (int j = 0; j <= m; j ++) {
+                count[i][j].assign(i * j + 1, 0);
+                if (i == 0 || j == 0) {
+                    count[i][j][0] = 1;
+                    continue;
+                }
+                for (int k = 0; k <= i * j; k ++)
+                    count[i][j][k] = (k >= i ? count[i][j - 1][k - i] : 0) + (k <= (i - 1) * j ? count[i - 1][j][k] : 0);
+            }
+        }
+        double total = 0, tail = 0;
+        for (int k = 0; k <= n * m; k ++) {
+            total += count[n][m][k];
+            if (k >= (int)u)
+                tail += count[n][m][k];
+        }
+        return tail / total;
+    }
+
+    // normal approximation, with the variance reduced by ties
+    vector<double> all(a);
+    all.insert(all.end(), b.begin(), b.end());
+    std::sort(all.begin(), all.end());
+    double tieTerm = 0;
+    for (size_t i = 0; i < all.size();) {
+        size_t j = i;
+        while (j < all.size() && all[j] == all[i])
+            j ++;
+        double t = (double)(j - i);
+        tieTerm += t * t * t - t;
+        i = j;
+    }
+    double N = n + m;
+    double mean = 0.5 * n * m;
+    double variance = n * m / 12.0 * ((N + 1) - tieTerm / (N * (N - 1)));
+    if (variance <= 0)
+        return u > mean ? 0.0 : 1.0;
+    double z = (u - mean - 0.5) / sqrt(variance);
+    return 0.5 * erfc(z / sqrt(2.0));
+}
+
+/**
+ * @brief Bootstraps a 95% confidence interval of the relative change of the median
+ *
+ * @param baseline Baseline sample
+ * @param candidate Candidate sample
+ * @param low Receives the 2.5th percentile of candidate / baseline - 1
+ * @param high Receives the 97.5th percentile
+ */
+void bootstrapChange(const vector<double>& baseline, const vector<double>& candidate, double& low, double& high) {
+    low = high = 0;
+    if (baseline.empty() || candidate.empty())
+        return;
+
+    // fixed seed: the same runs always give the same report
+    std::mt19937 rng(12345);
+    std::uniform_int_distribution<size_t> pickBase(0, baseline.size() - 1), pickCandidate(0, candidate.size() - 1);
+    vector<double> changes, a(baseline.size()), b(candidate.size());
+    for (int s = 0; s < PERF_BOOTSTRAP_SAMPLES; s ++) {
+        for (double& v : a)
+            v = baseline[pickBase(rng)];
+        for (double& v : b)
+            v = candidate[pickCandidate(rng)];
+        double base = median(a);
+        if (base > 0)
+            changes.push_back(median(b) / base - 1);
+    }
+    if (changes.empty())
+        return;
+
+    std::sort(changes.begin(), changes.end());
+    low = changes[(size_t)(0.025 * (changes.size() - 1))];
+    high = changes[(size_t)(0.975 * (changes.size() - 1))];
+}
+
+/**
+ * @brief Compares every metric of a candidate with its baseline
+ *
+ * A metric regresses when it is significantly slower (Mann-Whitney, PERF_ALPHA) and the whole confidence interval of its slowdown lies beyond threshold; improvements mirror that
+ *
+ * @param baseline Baseline samples
+ * @param candidate Candidate samples
+ * @param threshold Relative change worth flagging, e.g. 0.05
+ * @return vector<PerfComparison> one per candidate metric
+ */
+vector<PerfComparison> comparePerf(const PerfSamples& baseline, const PerfSamples& candidate, double threshold) {
+    vector<PerfComparison> comparisons;
+    for (auto& it : candidate) {
+        PerfComparison c;
+        c.metric = it.first;
+        c.candidateMs = median(it.second);
+        c.baselineMs = c.change = c.low = c.high = 0;
+        c.p = 1;
+        c.verdict = PERF_NEW;
+
+        auto base = baseline.find(it.first);
+        if (base != baseline.end() && !base->second.empty()) {
+            c.baselineMs = median(base->second);
+            c.change = c.baselineMs > 0 ? c.candidateMs / c.baselineMs - 1 : 0;
+            bootstrapChange(base->second, it.second, c.low, c.high);
+
+            double slower = mannWhitneyGreater(base->second, it.second);
+            double faster = mannWhitneyGreater(it.second, base->second);
+            c.p = c.change >= 0 ? slower : faster;
+            bool noticeable = fabs(c.candidateMs - c.baselineMs) >= PERF_MIN_DELTA_MS;
+
+            c.verdict = PERF_UNCHANGED;
+            if (noticeable && slower < PERF_ALPHA && c.low > threshold)
+                c.verdict = PERF_REGRESSED;
+            else if (noticeable && faster < PERF_ALPHA && c.high < -threshold)
+                c.verdict = PERF_IMPROVED;
+        }
+        comparisons.push_back(c);
+    }
+    return comparisons;
+}
+
+/**
+ * @brief Prints the comparison of a scenario to stdout
+ *
+ * @param name Scenario name
+ * @param comparisons Result of comparePerf
+ */
+void printPerfReport(const string& name, const vector<PerfComparison>& comparisons) {
+    printf("%s\n", name.c_str());
+    printf("  %-22s %10s %10s %8s %18s %8s  %s\n", "metric", "base ms", "new ms", "change", "95% CI", "p", "verdict");
+    for (const PerfComparison& c : comparisons) {
+        const char* verdict = c.verdict == PERF_REGRESSED ? "REGRESSED" : c.verdict == PERF_IMPROVED ? "improved" : c.verdict == PERF_NEW ? "new" : "";
+        if (c.verdict == PERF_NEW) {
+            printf("  %-22s %10s %10.3f %8s %18s %8s  %s\n", c.metric.c_str(), "-", c.candidateMs, "-", "-", "-", verdict);
+            continue;
+        }
+        char interval[32];
+        snprintf(interval, sizeof(interval), "[%+.1f%%, %+.1f%%]", 100 * c.low, 100 * c.high);
+        printf("  %-22s %10.3f %10.3f %+7.1f%% %18s %8.4f  %s\n", c.metric.c_str(), c.baselineMs, c.candidateMs, 100 * c.change, interval, c.p, verdict);
+    }
+    fflush(stdout);
+}
@@ -0,0 +1,66 @@
+/**
+ * @file perf.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Performance regression suite: repeated headless runs of a scenario, baselines stored per machine, and a statistical comparison of new runs against them
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include "scenario.h"
+
+#include <map>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+// runs per scenario; the comparison is between the runs' summaries, not between frames
+#define PERF_DEFAULT_RUNS 5
+// relative slowdown of a metric's median that is worth flagging
+#define PERF_DEFAULT_THRESHOLD 0.05
+// one-sided significance level of the Mann-Whitney test
+#define PERF_ALPHA 0.05
+#define PERF_BOOTSTRAP_SAMPLES 2000
+#define PERF_BASELINE_DIR "perf"
+
+// metric name -> one value per run; every metric is a time in ms, lower is better
+typedef std::map<string, vector<double> > PerfSamples;
+
+enum PerfVerdict {
+    PERF_UNCHANGED,
+    PERF_REGRESSED,
+    PERF_IMPROVED,
+    PERF_NEW            // not in the baseline
+};
+
+/**
+ * @brief How one metric of a candidate compares to its baseline
+ */
+struct PerfComparison {
+    string metric;
+    double baselineMs, candidateMs;     // medians over runs
+    double change;                      // relative change of the median, candidate / baseline - 1
+    double low, high;                   // bootstrap 95% confidence interval of change
+    double p;                           // one-sided Mann-Whitney p-value of the change's direction
+    PerfVerdict verdict;
+};
+
+string machineFingerprint(const string& device, string& description);
+string baselinePath(const string& directory, const string& fingerprint, const Scenario& scenario);
+
+void addPerfRun(PerfSamples& samples, const RunStats& stats);
+bool loadBaseline(const string& path, PerfSamples& samples, string& settings, string& error);
+bool saveBaseline(const string& path, const PerfSamples& samples, const string& settings, const string& machine);
+string describeScenario(const Scenario& scenario);
+
+double mannWhitneyGreater(const vector<double>& a, const vector<double>& b);
+void bootstrapChange(const vector<double>& baseline, const vector<double>& candidate, double& low, double& high);
+vector<PerfComparison> comparePerf(const PerfSamples& baseline, const PerfSamples& candidate, double threshold);
+void printPerfReport(const string& name, const vector<PerfComparison>& comparisons);
+
+#endif
@@ -0,0 +1,278 @@
+/**
+ * @file profiler.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Per-frame CPU/GPU timing zones and counters. GPU zones use timer queries that are read back asynchronously, so measuring a pass never stalls the pipeline
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "profiler.h"
+#include "recorder.h"
+
+/**
+ * @brief Construct a new GpuQuery object (requires a current GL context)
+ *
+ * @param target Query target, e.g. GL_TIME_ELAPSED or a pipeline statistic
+ */
+GpuQuery::GpuQuery(GLenum target) : value(0), target(target), cur(0) {
+    for (int i = 0; i < GPU_QUERY_LATENCY; i ++) {
+        queries[i].create();
+        issued[i] = false;
+    }
+}
+
+/**
+ * @brief Starts the query on the next slot in the ring. If that slot's result never arrived, it is dropped rather than waited on
+ */
+void GpuQuery::begin() {
+    glBeginQuery(target, queries[cur]);
+}
+
+/**
+ * @brief Ends the query on the current slot and polls for finished results
+ */
+void GpuQuery::end() {
+    glEndQuery(target);
+    issued[cur] = true;
+    cur = (cur + 1) % GPU_QUERY_LATENCY;
+    resolve();
+}
+
+/**
+ * @brief Reads back every finished query, oldest first, without blocking
+ *
+ * @return true if value was updated
+ */
+bool GpuQuery::resolve() {
+    bool updated = false;
+    for (int k = 0; k < GPU_QUERY_LATENCY; k ++) {
+        // cur is the oldest slot once the ring has wrapped
+        int i = (cur + k) % GPU_QUERY_LATENCY;
+        if (!issued[i])
+            continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            continue;
+
+        glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &value);
+        issued[i] = false;
+        updated = true;
+    }
+    return updated;
+}
+
+/**
+ * @brief Construct a new GpuTimer object (requires a current GL context)
+ */
+GpuTimer::GpuTimer() : GpuQuery(GL_TIME_ELAPSED), ms(0) {
+
+}
+
+/**
+ * @brief Reads back finished queries and converts the latest to milliseconds
+ *
+ * @return true if ms was updated
+ */
+bool GpuTimer::resolve() {
+    if (!GpuQuery::resolve())
+        return false;
+    ms = (float)(value / 1.0e6);
+    return true;
+}
+
+/**
+ * @brief Construct a new Profiler object
+ */
+Profiler::Profiler() : frameMs(0), gpuZonesEnabled(true), recorder(NULL) {
+    frameStart = std::chrono::steady_clock::now();
+    pipelineStatistics = GLEW_ARB_pipeline_statistics_query;
+}
+
+/**
+ * @brief Destroy the Profiler object along with its GPU timers
+ */
+Profiler::~Profiler() {
+    for (auto& it : gpuZones) {
+        for (int i = 0; i < PIPELINE_STATISTICS_COUNT; i ++)
+            delete it.second->statistics[i];
+        delete it.second;
+    }
+}
+
+/**
+ * @brief Starts recording a new frame. Counters written from here on belong to this frame
+ */
+void Profiler::beginFrame() {
+    frameStart = std::chrono::steady_clock::now();
+    counters.clear();
+}
+
+/**
+ * @brief Finishes the current frame, collects GPU results that have arrived, and publishes the frame's counters
+ */
+void Profiler::endFrame() {
+    for (auto& it : gpuZones) {
+        GpuZone* zone = it.second;
+        zone->timer.resolve();
+        counters["gpu." + it.first] = zone->timer.ms;
+
+        for (int i = 0; i < PIPELINE_STATISTICS_COUNT; i ++) {
+            if (zone->statistics[i] == NULL)
+                continue;
+            zone->statistics[i]->resolve();
+            counters["gpu." + it.first + "." + PIPELINE_STATISTICS[i].name] = (double)zone->statistics[i]->value;
+        }
+    }
+
+    std::chrono::duration<float, std::milli> diff = std::chrono::steady_clock::now() - frameStart;
+    frameMs = diff.count();
+    counters["cpu.frame"] = frameMs;
+
+    published.swap(counters);
+}
+
+/**
+ * @brief Starts a CPU timing zone
+ *
+ * @param name Zone name, reported as "cpu.<name>"
+ */
+void Profiler::beginZone(const string& name) {
+    zoneStarts[name] = std::chrono::steady_clock::now();
+}
+
+/**
+ * @brief Ends a CPU timing zone. Zones entered several times a frame accumulate
+ *
+ * @param name Zone name given to beginZone
+ */
+void Profiler::endZone(const string& name) {
+    auto it = zoneStarts.find(name);
+    if (it == zoneStarts.end())
+        return;
+
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> diff = end - it->second;
+    addCounter("cpu." + name, diff.count());
+    if (recorder)
+        recorder->recordZone(name, it->second, end);
+}
+
+/**
+ * @brief Starts a GPU zone: a timer, plus pipeline statistics when enabled. GPU zones must not overlap each other
+ *
+ * @param name Zone name, reported as "gpu.<name>" and "gpu.<name>.<statistic>"
+ */
+void Profiler::beginGpuZone(const string& name) {
+    if (!gpuZonesEnabled)
+        return;
+    GpuZone*& zone = gpuZones[name];
+    if (zone == NULL) {
+        zone = new GpuZone();
+        for (int i = 0; i < PIPELINE_STATISTICS_COUNT; i ++)
+            zone->statistics[i] = pipelineStatistics ? new GpuQuery(PIPELINE_STATISTICS[i].target) : NULL;
+    }
+
+    zone->timer.begin();
+    for (int i = 0; i < PIPELINE_STATISTICS_COUNT; i ++) {
+        if (zone->statistics[i] != NULL)
+            zone->statistics[i]->begin();
+    }
+}
+
+/**
+ * @brief Ends a GPU zone
+ *
+ * @param name Zone name given to beginGpuZone
+ */
+void Profiler::endGpuZone(const string& name) {
+    auto it = gpuZones.find(name);
+    if (it == gpuZones.end())
+        return;
+
+    GpuZone* zone = it->second;
+    zone->timer.end();
+    for (int i = 0; i < PIPELINE_STATISTICS_COUNT; i ++) {
+        if (zone->statistics[i] != NULL)
+            zone->statistics[i]->end();
+    }
+}
+
+/**
+ * @brief Enables or disables pipeline statistics for GPU zones. Ignored if ARB_pipeline_statistics_query is unsupported; existing zones keep their current setting
+ *
+ * @param enabled Whether newly created GPU zones collect pipeline statistics
+ */
+void Profiler::setPipelineStatistics(bool enabled) {
+    pipelineStatistics = enabled && GLEW_ARB_pipeline_statistics_query;
+}
+
+/**
+ * @brief Enables or disables GPU zones. Runs without a GL context (renderer backends other than GL) disable them, making beginGpuZone and endGpuZone no-ops
+ *
+ * @param enabled Whether GPU zones are timed
+ */
+void Profiler::setGpuZones(bool enabled) {
+    gpuZonesEnabled = enabled;
+}
+
+/**
+ * @brief Forwards completed CPU zones to a flight recorder
+ *
+ * @param recorder Recorder receiving zones (not owned), or NULL
+ */
+void Profiler::setRecorder(FlightRecorder* recorder) {
+    this->recorder = recorder;
+}
+
+/**
+ * @brief Sets a counter of the frame being recorded
+ *
+ * @param name Counter name
+ * @param value New value
+ */
+void Profiler::setCounter(const string& name, double value) {
+    counters[name] = value;
+}
+
+/**
+ * @brief Adds to a counter of the frame being recorded
+ *
+ * @param name Counter name
+ * @param value Amount to add
+ */
+void Profiler::addCounter(const string& name, double value) {
+    counters[name] += value;
+}
+
+/**
+ * @brief Returns a counter of the last completed frame
+ *
+ * @param name Counter name
+ * @return double value, or 0 if the counter was not written that frame
+ */
+double Profiler::getCounter(const string& name) const {
+    auto it = published.find(name);
+    return it == published.end() ? 0 : it->second;
+}
+
+/**
+ * @brief Returns all counters of the last completed frame, sorted by name
+ *
+ * @return const std::map<string, double>&
+ */
+const std::map<string, double>& Profiler::getCounters() const {
+    return published;
+}
+
+/**
+ * @brief Returns the CPU duration of the last completed frame
+ *
+ * @return float milliseconds
+ */
+float Profiler::getFrameMs() const {
+    return frameMs;
+}
@@ -0,0 +1,132 @@
+/**
+ * @file profiler.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Per-frame CPU/GPU timing zones and counters. GPU zones use timer queries that are read back asynchronously, so measuring a pass never stalls the pipeline
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include <chrono>
+#include <map>
+#include <string>
+using std::string;
+
+#include "../objects/glresource.h"
+
+class FlightRecorder;
+
+// number of frames a GPU query may stay in flight before its slot is reused
+#define GPU_QUERY_LATENCY 4
+
+/**
+ * @brief Ring of queries of one target. Results are polled, never waited on, so value lags the region it measures by a few frames
+ */
+class GpuQuery {
+    public:
+        GLuint64 value; // most recently resolved result
+
+        GpuQuery(GLenum target);
+        virtual ~GpuQuery() {}
+
+        void begin();
+        void end();
+        virtual bool resolve();
+
+    private:
+        GLenum target;
+        GLQuery queries[GPU_QUERY_LATENCY];
+        bool issued[GPU_QUERY_LATENCY];
+        int cur;
+};
+
+/**
+ * @brief GL_TIME_ELAPSED query ring, reporting milliseconds
+ */
+class GpuTimer : public GpuQuery {
+    public:
+        float ms;   // most recently resolved duration of the timed region
+
+        GpuTimer();
+
+        bool resolve() override;
+};
+
+/**
+ * @brief Pipeline statistics counters reported by every GPU zone (ARB_pipeline_statistics_query)
+ */
+struct PipelineStatistic {
+    GLenum target;
+    const char* name;
+};
+
+static const PipelineStatistic PIPELINE_STATISTICS[] = {
+    { GL_VERTICES_SUBMITTED_ARB,            "vertices" },
+    { GL_PRIMITIVES_SUBMITTED_ARB,          "primitives" },
+    { GL_VERTEX_SHADER_INVOCATIONS_ARB,     "vs_invocations" },
+    { GL_CLIPPING_INPUT_PRIMITIVES_ARB,     "clip_in" },
+    { GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,    "clip_out" },
+    { GL_FRAGMENT_SHADER_INVOCATIONS_ARB,   "fs_invocations" },
+    { GL_COMPUTE_SHADER_INVOCATIONS_ARB,    "cs_invocations" }
+};
+#define PIPELINE_STATISTICS_COUNT (int)(sizeof(PIPELINE_STATISTICS) / sizeof(PIPELINE_STATISTICS[0]))
+
+/**
+ * @brief Queries wrapped around one GPU zone: its duration and, if supported, its pipeline statistics
+ */
+struct GpuZone {
+    GpuTimer timer;
+    GpuQuery* statistics[PIPELINE_STATISTICS_COUNT];    // NULL when pipeline statistics are unavailable or disabled
+};
+
+/**
+ * @brief Collects named timings and counters for the frame being recorded, and publishes them as a snapshot once the frame ends
+ *
+ * Counter naming convention: "cpu.<zone>" and "gpu.<zone>" hold durations in milliseconds, "gpu.<zone>.<statistic>" the zone's pipeline statistics (see PIPELINE_STATISTICS), anything else is a subsystem counter ("<subsystem>.<name>")
+ */
+class Profiler {
+    public:
+        Profiler();
+        ~Profiler();
+
+        void beginFrame();
+        void endFrame();
+
+        void beginZone(const string& name);
+        void endZone(const string& name);
+        void beginGpuZone(const string& name);
+        void endGpuZone(const string& name);
+
+        void setPipelineStatistics(bool enabled);
+        void setGpuZones(bool enabled);
+        void setRecorder(FlightRecorder* recorder);
+
+        void setCounter(const string& name, double value);
+        void addCounter(const string& name, double value);
+
+        double getCounter(const string& name) const;
+        const std::map<string, double>& getCounters() const;
+        float getFrameMs() const;
+
+    private:
+        std::chrono::steady_clock::time_point frameStart;
+        float frameMs;
+
+        std::map<string, std::chrono::steady_clock::time_point> zoneStarts;
+        std::map<string, GpuZone*> gpuZones;
+        bool gpuZonesEnabled;       // false without a GL context
+        bool pipelineStatistics;    // whether new GPU zones also collect pipeline statistics
+        FlightRecorder* recorder;   // receives every completed CPU zone (may be NULL)
+
+        std::map<string, double> counters;  // counters of the frame being recorded
+        std::map<string, double> published; // counters of the last completed frame
+};
+
+#endif
@@ -0,0 +1,253 @@
+/**
+ * @file recorder.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Always-on flight recorder. Keeps the last few seconds of profiling zones (per thread) and per-frame counters in rings, and dumps them as a Chrome trace when a frame hitches
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "recorder.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+
+#include "log.h"
+
+// ring of the calling thread, created on its first zone. The owner is a recorder's id, not its address: a recorder created where
+// a deleted one lived must not find the deleted one's ring
+struct ThreadRing {
+    unsigned long long owner;
+    TraceRing* ring;
+};
+static thread_local ThreadRing currentRing = { 0, NULL };
+static std::atomic<unsigned long long> nextRecorderId(1);
+
+/**
+ * @brief Writes a string as a JSON string literal
+ *
+ * @param out Stream written to
+ * @param s String to quote
+ */
+static void writeJsonString(std::ofstream& out, const char* s) {
+    out << '"';
+    for (; *s; s ++) {
+        if (*s == '"' || *s == '\\')
+            out << '\\';
+        out << *s;
+    }
+    out << '"';
+}
+
+/**
+ * @brief Construct a new FlightRecorder object
+ */
+FlightRecorder::FlightRecorder() : hitchFactor(2.0f), minHitchMs(4.0f), enabled(true), framesWritten(0), recentCount(0), median(0), hitchFrame(0), hitchMs(0), lastDumpUs(-1), dumps(0) {
+    origin = std::chrono::steady_clock::now();
+    id = nextRecorderId ++;
+}
+
+/**
+ * @brief Destroy the FlightRecorder object and every thread's ring. Threads must have stopped recording
+ */
+FlightRecorder::~FlightRecorder() {
+    for (unsigned int i = 0; i < rings.size(); i ++)
+        delete rings[i];
+}
+
+/**
+ * @brief Records a completed zone on the calling thread's ring
+ *
+ * @param name Zone name
+ * @param start When the zone was entered
+ * @param end When the zone was left
+ */
+void FlightRecorder::recordZone(const string& name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    if (!enabled)
+        return;
+
+    TraceRing* ring = threadRing();
+    TraceEvent event = { intern(name), toUs(start), toUs(end) - toUs(start) };
+
+    std::lock_guard<std::mutex> lock(ring->mutex);
+    ring->events[ring->written % FLIGHT_RECORDER_EVENTS] = event;
+    ring->written ++;
+}
+
+/**
+ * @brief Records the counters of the frame the profiler just published, and checks it for a hitch
+ *
+ * @param frame Frame number
+ * @param profiler Profiler whose endFrame was just called
+ * @return true if the frame hitched and dump() should be called
+ */
+bool FlightRecorder::endFrame(int frame, const Profiler* profiler) {
+    if (!enabled)
+        return false;
+
+    float ms = profiler->getFrameMs();
+    long long startUs = toUs(std::chrono::steady_clock::now()) - (long long)(ms * 1000.0f);
+
+    FrameRecord& record = frames[framesWritten % FLIGHT_RECORDER_FRAMES];
+    record.frame = frame;
+    record.startUs = startUs;
+    record.ms = ms;
+    record.counters.clear();
+    for (auto& it : profiler->getCounters())
+        record.counters.push_back(std::make_pair(intern(it.first), it.second));
+    framesWritten ++;
+
+    // median of the frames before this one, so a hitch is not measured against itself
+    bool hitch = false;
+    if (recentCount == FLIGHT_RECORDER_MEDIAN_FRAMES) {
+        float sorted[FLIGHT_RECORDER_MEDIAN_FRAMES];
+        std::copy(recentMs, recentMs + FLIGHT_RECORDER_MEDIAN_FRAMES, sorted);
+        std::nth_element(sorted, sorted + FLIGHT_RECORDER_MEDIAN_FRAMES / 2, sorted + FLIGHT_RECORDER_MEDIAN_FRAMES);
+        median = sorted[FLIGHT_RECORDER_MEDIAN_FRAMES / 2];
+        hitch = ms > hitchFactor * median && ms > minHitchMs;
+    } else {
+        recentCount ++;
+    }
+    recentMs[framesWritten % FLIGHT_RECORDER_MEDIAN_FRAMES] = ms;
+
+    // a hitch inside the window of the previous dump is already covered by it
+    if (!hitch || dumps >= FLIGHT_RECORDER_MAX_DUMPS || startUs <= lastDumpUs)
+        return false;
+
+    hitchFrame = frame;
+    hitchMs = ms;
+    return true;
+}
+
+/**
+ * @brief Writes the recorded window ending now, and the given parameters, to FLIGHT_RECORDER_PATH<frame>.json
+ *
+ * @param params State of the hitching frame (camera, water, ...) stored in the trace's otherData
+ * @return bool representing the success of the operation
+ */
+bool FlightRecorder::dump(const std::map<string, double>& params) {
+    long long windowEnd = toUs(std::chrono::steady_clock::now());
+    long long windowStart = windowEnd - (long long)(FLIGHT_RECORDER_SECONDS * 1.0e6f);
+
+    string path = FLIGHT_RECORDER_PATH + std::to_string(hitchFrame) + ".json";
+    std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        LOG_ERROR("recorder", "Unable to write flight recorder dump %s", path);
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{";
+    out << "\"hitch_frame\":" << hitchFrame << ",\"hitch_ms\":" << hitchMs << ",\"median_ms\":" << median;
+    for (auto& it : params) {
+        out << ",";
+        writeJsonString(out, it.first.c_str());
+        out << ":" << it.second;
+    }
+    out << "},\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"frames\"}}";
+
+    // frames and their counters, on their own track
+    long long first = std::max(0LL, framesWritten - FLIGHT_RECORDER_FRAMES);
+    for (long long i = first; i < framesWritten; i ++) {
+        const FrameRecord& record = frames[i % FLIGHT_RECORDER_FRAMES];
+        if (record.startUs < windowStart)
+            continue;
+
+        out << ",\n{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":0,\"ts\":" << record.startUs << ",\"dur\":" << (long long)(record.ms * 1000.0f)
+            << ",\"args\":{\"frame\":" << record.frame << "}}";
+        for (unsigned int c = 0; c < record.counters.size(); c ++) {
+            out << ",\n{\"name\":";
+            writeJsonString(out, record.counters[c].first);
+            out << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << record.startUs << ",\"args\":{\"value\":" << record.counters[c].second << "}}";
+        }
+        if (record.frame == hitchFrame)
+            out << ",\n{\"name\":\"hitch\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":" << record.startUs << "}";
+    }
+
+    // zones of every thread
+    std::lock_guard<std::mutex> ringsLock(ringsMutex);
+    for (unsigned int r = 0; r < rings.size(); r ++) {
+        TraceRing* ring = rings[r];
+        std::lock_guard<std::mutex> lock(ring->mutex);
+
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << ring->threadIndex
+            << ",\"args\":{\"name\":\"thread " << ring->threadIndex << "\"}}";
+        long long firstEvent = std::max(0LL, ring->written - FLIGHT_RECORDER_EVENTS);
+        for (long long i = firstEvent; i < ring->written; i ++) {
+            const TraceEvent& event = ring->events[i % FLIGHT_RECORDER_EVENTS];
+            if (event.startUs + event.durationUs < windowStart)
+                continue;
+
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->threadIndex << ",\"ts\":" << event.startUs << ",\"dur\":" << event.durationUs << "}";
+        }
+    }
+    out << "\n]}\n";
+    out.close();
+
+    lastDumpUs = windowEnd;
+    dumps ++;
+    LOG_WARN("recorder", "Frame %d took %.2f ms (median %.2f ms), flight recorder written to %s", hitchFrame, hitchMs, median, path);
+    return true;
+}
+
+/**
+ * @brief Returns the number of dumps written so far
+ *
+ * @return int
+ */
+int FlightRecorder::getDumps() const {
+    return dumps;
+}
+
+/**
+ * @brief Returns the calling thread's ring, creating it on first use
+ *
+ * @return TraceRing*
+ */
+TraceRing* FlightRecorder::threadRing() {
+    if (currentRing.owner == id)
+        return currentRing.ring;
+
+    TraceRing* ring = new TraceRing();
+    ring->written = 0;
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    ring->threadIndex = (int)rings.size() + 1;
+    rings.push_back(ring);
+
+    currentRing.owner = id;
+    currentRing.ring = ring;
+    return ring;
+}
+
+/**
+ * @brief Returns a copy of name that lives as long as the recorder, so events can store a pointer instead of a string
+ *
+ * @param name Zone or counter name
+ * @return const char*
+ */
+const char* FlightRecorder::intern(const string& name) {
+    TraceRing* ring = threadRing();
+    auto cached = ring->interned.find(name);
+    if (cached != ring->interned.end())
+        return cached->second;
+
+    std::lock_guard<std::mutex> lock(namesMutex);
+    const char* interned = names.insert(name).first->c_str();
+    ring->interned[name] = interned;
+    return interned;
+}
+
+/**
+ * @brief Converts a time point to microseconds since the recorder was created
+ *
+ * @param t Time point
+ * @return long long
+ */
+long long FlightRecorder::toUs(std::chrono::steady_clock::time_point t) const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - origin).count();
+}
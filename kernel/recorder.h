@@ -0,0 +1,113 @@
+/**
+ * @file recorder.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Always-on flight recorder. Keeps the last few seconds of profiling zones (per thread) and per-frame counters in rings, and dumps them as a Chrome trace when a frame hitches
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include "profiler.h"
+
+// window kept in the rings and written to each dump
+#define FLIGHT_RECORDER_SECONDS 5.0f
+// ring capacities; the rings hold whichever is shorter, this or FLIGHT_RECORDER_SECONDS
+#define FLIGHT_RECORDER_EVENTS 16384
+#define FLIGHT_RECORDER_FRAMES 1024
+// recent frames the median frame time is taken over, and how many must be seen before hitches are detected
+#define FLIGHT_RECORDER_MEDIAN_FRAMES 120
+// dumps are written as FLIGHT_RECORDER_PATH<frame>.json, at most this many per run
+#define FLIGHT_RECORDER_PATH "hitch_"
+#define FLIGHT_RECORDER_MAX_DUMPS 16
+
+/**
+ * @brief One completed zone
+ */
+struct TraceEvent {
+    const char* name;   // interned, see FlightRecorder::intern
+    long long startUs;  // since the recorder was created
+    long long durationUs;
+};
+
+/**
+ * @brief Zones recorded by one thread. Only the owning thread writes; the lock is uncontended except while dumping
+ */
+struct TraceRing {
+    std::mutex mutex;
+    int threadIndex;
+    TraceEvent events[FLIGHT_RECORDER_EVENTS];
+    long long written;  // total events ever written; the newest is events[(written - 1) % FLIGHT_RECORDER_EVENTS]
+
+    std::map<string, const char*> interned;    // per-thread cache of FlightRecorder::intern, so recording takes no shared lock
+};
+
+/**
+ * @brief Counters of one completed frame
+ */
+struct FrameRecord {
+    int frame;
+    long long startUs;
+    float ms;
+    vector<std::pair<const char*, double> > counters;
+};
+
+/**
+ * @brief Records zones from any thread and counters once per frame, detects frames slower than hitchFactor times the recent median, and writes the recorded window around them to a trace file (chrome://tracing / Perfetto JSON)
+ */
+class FlightRecorder {
+    public:
+        float hitchFactor;  // a frame hitches when it takes longer than hitchFactor x the median
+        float minHitchMs;   // frames faster than this never count as hitches
+        bool enabled;
+
+        FlightRecorder();
+        ~FlightRecorder();
+
+        void recordZone(const string& name, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+        bool endFrame(int frame, const Profiler* profiler);
+        bool dump(const std::map<string, double>& params);
+
+        int getDumps() const;
+
+    private:
+        std::chrono::steady_clock::time_point origin;
+        unsigned long long id;  // unique per recorder in the process, identifies it in the threads' cached rings
+
+        std::mutex ringsMutex;
+        vector<TraceRing*> rings;
+
+        std::mutex namesMutex;
+        std::set<string> names;
+
+        FrameRecord frames[FLIGHT_RECORDER_FRAMES];
+        long long framesWritten;
+
+        float recentMs[FLIGHT_RECORDER_MEDIAN_FRAMES];
+        int recentCount;
+        float median;
+
+        int hitchFrame;         // frame that triggered the pending dump
+        float hitchMs;
+        long long lastDumpUs;   // end of the window of the last dump, so overlapping hitches are written once
+        int dumps;
+
+        TraceRing* threadRing();
+        const char* intern(const string& name);
+        long long toUs(std::chrono::steady_clock::time_point t) const;
+};
+
+#endif
@@ -0,0 +1,592 @@
+/**
+ * @file scenario.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Everything a run depends on (window, scene, water, threads, present mode, frame count), loaded from key = value files and command-line overrides, plus the statistics a run produces
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "scenario.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <fstream>
+#include <set>
+
+enum ScenarioFieldType {
+    FIELD_INT,
+    FIELD_UINT,
+    FIELD_FLOAT,
+    FIELD_BOOL,
+    FIELD_STRING,
+    FIELD_PRESENT,
+    FIELD_ENGINE,
+    FIELD_MATERIALS,
+    FIELD_RENDERER
+};
+
+// a key and the member of a particular Scenario it reads and writes, with the range set() accepts for numbers
+struct ScenarioField {
+    const char* key;
+    ScenarioFieldType type;
+    void* value;
+    double min = -HUGE_VAL;
+    double max = HUGE_VAL;
+};
+
+/**
+ * @brief Lists the keys of a scenario, bound to its members. The order is the order of --help and of scenario dumps
+ *
+ * @param s Scenario the fields point into
+ * @return vector<ScenarioField>
+ */
+static vector<ScenarioField> scenarioFields(Scenario& s) {
+    return vector<ScenarioField> {
+        { "name",               FIELD_STRING,   &s.name },
+        { "window.width",       FIELD_INT,      &s.width, 1, 16384 },
+        { "window.height",      FIELD_INT,      &s.height, 1, 16384 },
+        { "headless",           FIELD_BOOL,     &s.headless },
+        { "present",            FIELD_PRESENT,  &s.present },
+        { "frames",             FIELD_INT,      &s.frames, 0, INT_MAX },
+        { "warmup",             FIELD_INT,      &s.warmup, 0, INT_MAX },
+        { "time_step",          FIELD_FLOAT,    &s.timeStep, 0, HUGE_VAL },
+        { "threads",            FIELD_INT,      &s.threads, 0, 1024 },
+        { "renderer",           FIELD_RENDERER, &s.renderer },
+        { "sky",                FIELD_STRING,   &s.sky },
+        { "sun.elevation",      FIELD_FLOAT,    &s.sunElevation },
+        { "sun.azimuth",        FIELD_FLOAT,    &s.sunAzimuth },
+        { "camera.x",           FIELD_FLOAT,    &s.cameraPosition.x },
+        { "camera.y",           FIELD_FLOAT,    &s.cameraPosition.y },
+        { "camera.z",           FIELD_FLOAT,    &s.cameraPosition.z },
+        { "camera.yaw",         FIELD_FLOAT,    &s.cameraYaw },
+        { "camera.pitch",       FIELD_FLOAT,    &s.cameraPitch },
+        { "overlay",            FIELD_BOOL,     &s.overlay },
+        { "reflection",         FIELD_BOOL,     &s.reflections },
+        { "reflection.scale",   FIELD_FLOAT,    &s.reflectionScale, 0.01, 1 },
+        { "reflection.budget",  FIELD_FLOAT,    &s.reflectionBudget, 0, HUGE_VAL },
+        { "reflection.max_reuse", FIELD_INT,    &s.reflectionMaxReuse, 0, INT_MAX },
+        { "models",             FIELD_BOOL,     &s.models },
+        { "models.path",        FIELD_STRING,   &s.modelPath },
+        { "models.clip",        FIELD_INT,      &s.modelClip, -1, INT_MAX },
+        { "models.async",       FIELD_BOOL,     &s.modelsAsync },
+        { "models.grid",        FIELD_INT,      &s.modelGrid, 1, 1000 },
+        { "models.spacing",     FIELD_FLOAT,    &s.modelSpacing, 0, HUGE_VAL },
+        { "models.lod_error",   FIELD_FLOAT,    &s.modelLodError, 0, HUGE_VAL },
+        { "models.clusters",    FIELD_BOOL,     &s.modelClusters },
+        { "models.materials",   FIELD_MATERIALS, &s.modelMaterials },
+        { "water.engine",       FIELD_ENGINE,   &s.waterEngine },
+        { "water.x",            FIELD_INT,      &s.waterX },
+        { "water.z",            FIELD_INT,      &s.waterZ },
+        { "water.width",        FIELD_INT,      &s.waterWidth, 1, INT_MAX },
+        { "water.length",       FIELD_INT,      &s.waterLength, 1, INT_MAX },
+        { "water.grid_x",       FIELD_INT,      &s.gridX, 2, 8192 },
+        { "water.grid_z",       FIELD_INT,      &s.gridZ, 2, 8192 },
+        { "water.amplitude",    FIELD_FLOAT,    &s.amplitude, 0, HUGE_VAL },
+        { "water.waves",        FIELD_INT,      &s.waves, 1, 4096 },
+        { "water.directional",  FIELD_BOOL,     &s.directional },
+        { "water.rounded",      FIELD_BOOL,     &s.rounded },
+        { "water.seed",         FIELD_UINT,     &s.seed },
+        { "water.update_every", FIELD_INT,      &s.updateEvery, 1, INT_MAX },
+        { "particles",          FIELD_BOOL,     &s.particles },
+        { "particles.max",      FIELD_INT,      &s.particleMax, 1, 16777216 },
+        { "particles.threshold", FIELD_FLOAT,   &s.particleThreshold, 0, HUGE_VAL },
+        { "particles.rate",     FIELD_FLOAT,    &s.particleRate, 0, HUGE_VAL },
+        { "particles.reference", FIELD_BOOL,    &s.particleReference },
+        { "foam",               FIELD_BOOL,     &s.foam },
+        { "foam.resolution",    FIELD_INT,      &s.foamResolution, 1, 8192 },
+        { "foam.threshold",     FIELD_FLOAT,    &s.foamThreshold, 0, HUGE_VAL },
+        { "foam.gain",          FIELD_FLOAT,    &s.foamGain, 0, HUGE_VAL },
+        { "foam.decay",         FIELD_FLOAT,    &s.foamDecay, 0, HUGE_VAL },
+        { "foam.drift_x",       FIELD_FLOAT,    &s.foamDrift.x },
+        { "foam.drift_z",       FIELD_FLOAT,    &s.foamDrift.y },
+        { "caustics",           FIELD_BOOL,     &s.caustics },
+        { "caustics.resolution", FIELD_INT,     &s.causticsResolution, 1, 4096 },
+        { "caustics.tile",      FIELD_FLOAT,    &s.causticsTile, 0.001, HUGE_VAL },
+        { "caustics.depth",     FIELD_FLOAT,    &s.causticsDepth, 0, HUGE_VAL },
+        { "caustics.rate",      FIELD_FLOAT,    &s.causticsRate, 0, HUGE_VAL },
+        { "caustics.strength",  FIELD_FLOAT,    &s.causticsStrength, 0, HUGE_VAL }
+    };
+}
+
+/**
+ * @brief Returns a copy of s without leading and trailing whitespace
+ *
+ * @param s String to trim
+ * @return string
+ */
+static string trim(const string& s) {
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == string::npos)
+        return "";
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+/**
+ * @brief Checks a number against the range of its field
+ *
+ * @param field Field the number was parsed for
+ * @param v Number
+ * @param error Receives a description of the problem on failure
+ * @return bool whether the number lies in the field's range
+ */
+static bool inRange(const ScenarioField& field, double v, string& error) {
+    if (v >= field.min && v <= field.max)
+        return true;
+    char buffer[128];
+    if (field.max == HUGE_VAL)
+        snprintf(buffer, sizeof(buffer), "%s must be at least %.10g", field.key, field.min);
+    else
+        snprintf(buffer, sizeof(buffer), "%s must be between %.10g and %.10g", field.key, field.min, field.max);
+    error = buffer;
+    return false;
+}
+
+/**
+ * @brief Construct a new Scenario object holding the scene the application always started with
+ */
+Scenario::Scenario() : name("default"), width(700), height(700), headless(false), present(PRESENT_VSYNC), frames(0), warmup(0), timeStep(0), threads(0), renderer(RENDERER_GL),
+    sky("procedural"), sunElevation(20.0f), sunAzimuth(45.0f), cameraPosition(0, 0, 3), cameraYaw(-90.0f), cameraPitch(0.0f), overlay(true),
+    reflections(true), reflectionScale(0.5f), reflectionBudget(1.0f), reflectionMaxReuse(8),
+    models(false), modelPath("resources/backpack/backpack.obj"), modelClip(0), modelsAsync(false), modelGrid(1), modelSpacing(8.0f), modelLodError(1.0f), modelClusters(false), modelMaterials(MATERIALS_BOUND),
+    waterEngine(WATER_ENGINE_CPU), waterX(0), waterZ(0), waterWidth(100), waterLength(100), gridX(100), gridZ(100),
+    amplitude(0.01f), waves(20), directional(true), rounded(true), seed(1), updateEvery(2),
+    particles(false), particleMax(1048576), particleThreshold(0.3f), particleRate(2000.0f), particleReference(false),
+    foam(false), foamResolution(512), foamThreshold(0.2f), foamGain(4.0f), foamDecay(0.5f), foamDrift(0.5f, 0.0f),
+    caustics(false), causticsResolution(128), causticsTile(8.0f), causticsDepth(2.0f), causticsRate(30.0f), causticsStrength(0.8f) {
+
+}
+
+/**
+ * @brief Parses and stores the value of a key
+ *
+ * @param key Key, as listed by keys()
+ * @param value Value as text
+ * @param error Receives a description of the problem on failure, including numbers outside the key's range
+ * @return bool representing the success of the operation
+ */
+bool Scenario::set(const string& key, const string& value, string& error) {
+    vector<ScenarioField> fields = scenarioFields(*this);
+    for (const ScenarioField& field : fields) {
+        if (key != field.key)
+            continue;
+
+        const char* text = value.c_str();
+        char* end = NULL;
+        switch (field.type) {
+            case FIELD_INT: {
+                long v = strtol(text, &end, 10);
+                if (end == text || *end != '\0')
+                    break;
+                if (!inRange(field, v, error))
+                    return false;
+                *(int*)field.value = (int)v;
+                return true;
+            }
+            case FIELD_UINT: {
+                unsigned long v = strtoul(text, &end, 10);
+                if (end == text || *end != '\0')
+                    break;
+                if (!inRange(field, v, error))
+                    return false;
+                *(unsigned int*)field.value = (unsigned int)v;
+                return true;
+            }
+            case FIELD_FLOAT: {
+                float v = strtof(text, &end);
+                if (end == text || *end != '\0')
+                    break;
+                if (!inRange(field, v, error))
+                    return false;
+                *(float*)field.value = v;
+                return true;
+            }
+            case FIELD_BOOL:
+                if (value == "true" || value == "1" || value == "on" || value == "yes") {
+                    *(bool*)field.value = true;
+                    return true;
+                }
+                if (value == "false" || value == "0" || value == "off" || value == "no") {
+                    *(bool*)field.value = false;
+                    return true;
+                }
+                break;
+            case FIELD_STRING:
+                *(string*)field.value = value;
+                return true;
+            case FIELD_PRESENT:
+                for (int mode = PRESENT_VSYNC; mode <= PRESENT_ADAPTIVE; mode ++) {
+                    if (value == presentName((PresentMode)mode)) {
+                        *(PresentMode*)field.value = (PresentMode)mode;
+                        return true;
+                    }
+                }
+                break;
+            case FIELD_ENGINE:
+                for (int engine = WATER_ENGINE_STATIC; engine <= WATER_ENGINE_GPU; engine ++) {
+                    if (value == engineName((WaterEngine)engine)) {
+                        *(WaterEngine*)field.value = (WaterEngine)engine;
+                        return true;
+                    }
+                }
+                break;
+            case FIELD_MATERIALS:
+                for (int mode = MATERIALS_BOUND; mode <= MATERIALS_BINDLESS; mode ++) {
+                    if (value == materialsName((MaterialMode)mode)) {
+                        *(MaterialMode*)field.value = (MaterialMode)mode;
+                        return true;
+                    }
+                }
+                break;
+            case FIELD_RENDERER:
+                for (int backend = RENDERER_GL; backend <= RENDERER_SOFTWARE; backend ++) {
+                    if (value == Renderer::backendName((RendererBackend)backend)) {
+                        *(RendererBackend*)field.value = (RendererBackend)backend;
+                        return true;
+                    }
+                }
+                break;
+        }
+        error = "invalid value \"" + value + "\" for " + key;
+        return false;
+    }
+    error = "unknown key " + key;
+    return false;
+}
+
+/**
+ * @brief Returns the value of a key as text, as set() would accept it
+ *
+ * @param key Key, as listed by keys()
+ * @return string, empty for unknown keys
+ */
+string Scenario::get(const string& key) const {
+    vector<ScenarioField> fields = scenarioFields(const_cast<Scenario&>(*this));
+    char buffer[64];
+    for (const ScenarioField& field : fields) {
+        if (key != field.key)
+            continue;
+
+        switch (field.type) {
+            case FIELD_INT:     snprintf(buffer, sizeof(buffer), "%d", *(int*)field.value); return buffer;
+            case FIELD_UINT:    snprintf(buffer, sizeof(buffer), "%u", *(unsigned int*)field.value); return buffer;
+            case FIELD_FLOAT:   snprintf(buffer, sizeof(buffer), "%g", *(float*)field.value); return buffer;
+            case FIELD_BOOL:    return *(bool*)field.value ? "true" : "false";
+            case FIELD_STRING:  return *(string*)field.value;
+            case FIELD_PRESENT: return presentName(*(PresentMode*)field.value);
+            case FIELD_ENGINE:  return engineName(*(WaterEngine*)field.value);
+            case FIELD_MATERIALS: return materialsName(*(MaterialMode*)field.value);
+            case FIELD_RENDERER: return Renderer::backendName(*(RendererBackend*)field.value);
+        }
+    }
+    return "";
+}
+
+/**
+ * @brief Returns every key a scenario has
+ *
+ * @return vector<string>
+ */
+vector<string> Scenario::keys() {
+    Scenario s;
+    vector<string> keys;
+    for (const ScenarioField& field : scenarioFields(s))
+        keys.push_back(field.key);
+    return keys;
+}
+
+/**
+ * @brief Returns the name of a present mode
+ *
+ * @param mode Present mode
+ * @return const char*
+ */
+const char* Scenario::presentName(PresentMode mode) {
+    switch (mode) {
+        case PRESENT_IMMEDIATE: return "immediate";
+        case PRESENT_ADAPTIVE:  return "adaptive";
+        default:                return "vsync";
+    }
+}
+
+/**
+ * @brief Returns the name of a water engine
+ *
+ * @param engine Water engine
+ * @return const char*
+ */
+const char* Scenario::engineName(WaterEngine engine) {
+    switch (engine) {
+        case WATER_ENGINE_STATIC:   return "static";
+        case WATER_ENGINE_SSE2:     return "sse2";
+        case WATER_ENGINE_AVX2:     return "avx2";
+        case WATER_ENGINE_GPU:      return "gpu";
+        default:                    return "cpu";
+    }
+}
+
+/**
+ * @brief Returns the name of a material mode
+ *
+ * @param mode Material mode
+ * @return const char*
+ */
+const char* Scenario::materialsName(MaterialMode mode) {
+    switch (mode) {
+        case MATERIALS_ARRAYS:      return "arrays";
+        case MATERIALS_BINDLESS:    return "bindless";
+        default:                    return "bound";
+    }
+}
+
+/**
+ * @brief Reads a scenario file: one "key = value" per line, '#' starts a comment. A comma-separated list of values makes the key part of a sweep
+ *
+ * @param path Path of the file
+ * @param settings Receives the settings; keys already present are overridden
+ * @param error Receives "path:line: problem" on failure
+ * @return bool representing the success of the operation
+ */
+bool loadScenarioFile(const string& path, ScenarioSettings& settings, string& error) {
+    std::ifstream file(path.c_str());
+    if (!file) {
+        error = "unable to open " + path;
+        return false;
+    }
+
+    vector<string> keys = Scenario::keys();
+    string line;
+    int number = 0;
+    while (std::getline(file, line)) {
+        number ++;
+        size_t comment = line.find('#');
+        if (comment != string::npos)
+            line.erase(comment);
+        line = trim(line);
+        if (line.empty())
+            continue;
+
+        size_t equals = line.find('=');
+        string key = trim(line.substr(0, equals));
+        if (equals == string::npos || std::find(keys.begin(), keys.end(), key) == keys.end()) {
+            error = path + ":" + std::to_string(number) + ": " + (equals == string::npos ? "expected key = value" : "unknown key " + key);
+            return false;
+        }
+        setScenarioValues(settings, key, line.substr(equals + 1));
+    }
+    return true;
+}
+
+/**
+ * @brief Sets the values of a key, replacing any it had
+ *
+ * @param settings Settings to change
+ * @param key Key
+ * @param values One value, or several separated by commas
+ */
+void setScenarioValues(ScenarioSettings& settings, const string& key, const string& values) {
+    vector<string> list;
+    size_t start = 0;
+    for (;;) {
+        size_t comma = values.find(',', start);
+        list.push_back(trim(values.substr(start, comma == string::npos ? string::npos : comma - start)));
+        if (comma == string::npos)
+            break;
+        start = comma + 1;
+    }
+
+    for (auto& it : settings) {
+        if (it.first == key) {
+            it.second = list;
+            return;
+        }
+    }
+    settings.push_back(std::make_pair(key, list));
+}
+
+/**
+ * @brief Builds every combination of the settings' values on top of a base scenario
+ *
+ * @param base Scenario the settings are applied to
+ * @param settings Values per key
+ * @param scenarios Receives the scenarios, the first swept key varying slowest
+ * @param swept Receives the keys that have more than one value
+ * @param error Receives the first invalid value
+ * @return bool representing the success of the operation
+ */
+bool expandScenarios(const Scenario& base, const ScenarioSettings& settings, vector<Scenario>& scenarios, vector<string>& swept, string& error) {
+    swept.clear();
+    size_t combinations = 1;
+    for (auto& it : settings) {
+        if (it.second.size() > 1)
+            swept.push_back(it.first);
+        combinations *= it.second.size();
+    }
+
+    for (size_t c = 0; c < combinations; c ++) {
+        Scenario s = base;
+        // mixed-radix digits of c pick a value per key, the last key varying fastest
+        size_t rest = c;
+        for (auto it = settings.rbegin(); it != settings.rend(); it ++) {
+            const string& value = it->second[rest % it->second.size()];
+            rest /= it->second.size();
+            if (!s.set(it->first, value, error))
+                return false;
+        }
+        scenarios.push_back(s);
+    }
+    return true;
+}
+
+/**
+ * @brief Construct a new RunStats object for a run without frames
+ */
+RunStats::RunStats() : startupMs(0), frames(0), seconds(0), meanMs(0), p50Ms(0), p95Ms(0), p99Ms(0), maxMs(0) {
+
+}
+
+/**
+ * @brief Fills in the statistics of a run
+ *
+ * @param frameMs CPU time of every measured frame
+ * @param zoneSums Sum of every zone over the measured frames, in ms
+ * @param totalSeconds Wall-clock time of the measured frames
+ */
+void RunStats::compute(vector<float> frameMs, const std::map<string, double>& zoneSums, double totalSeconds) {
+    frames = (int)frameMs.size();
+    seconds = totalSeconds;
+    zones.clear();
+    if (frames == 0)
+        return;
+
+    std::sort(frameMs.begin(), frameMs.end());
+    double sum = 0;
+    for (float ms : frameMs)
+        sum += ms;
+    meanMs = sum / frames;
+
+    // nearest-rank percentiles
+    auto percentile = [&frameMs](double p) {
+        int rank = (int)ceil(p * frameMs.size());
+        return (double)frameMs[std::max(0, std::min(rank, (int)frameMs.size()) - 1)];
+    };
+    p50Ms = percentile(0.50);
+    p95Ms = percentile(0.95);
+    p99Ms = percentile(0.99);
+    maxMs = frameMs.back();
+
+    for (auto& it : zoneSums)
+        zones[it.first] = it.second / frames;
+}
+
+/**
+ * @brief Collects the columns of a sweep: the swept keys, the frame statistics, then every zone any run recorded
+ *
+ * @param scenarios Scenarios of the sweep
+ * @param swept Swept keys
+ * @param stats Statistics per scenario
+ * @param header Receives the column names
+ * @param rows Receives the cells, one row per scenario
+ */
+static void sweepColumns(const vector<Scenario>& scenarios, const vector<string>& swept, const vector<RunStats>& stats, vector<string>& header, vector<vector<string> >& rows) {
+    std::set<string> zoneNames;
+    for (const RunStats& s : stats)
+        for (auto& it : s.zones)
+            zoneNames.insert(it.first);
+
+    header = swept;
+    const char* columns[] = { "startup_ms", "frames", "fps", "mean_ms", "p50_ms", "p95_ms", "p99_ms", "max_ms" };
+    header.insert(header.end(), columns, columns + sizeof(columns) / sizeof(columns[0]));
+    header.insert(header.end(), zoneNames.begin(), zoneNames.end());
+
+    char buffer[32];
+    rows.clear();
+    for (unsigned int i = 0; i < scenarios.size() && i < stats.size(); i ++) {
+        const RunStats& s = stats[i];
+        vector<string> row;
+        for (const string& key : swept)
+            row.push_back(scenarios[i].get(key));
+
+        snprintf(buffer, sizeof(buffer), "%.1f", s.startupMs);
+        row.push_back(buffer);
+        row.push_back(std::to_string(s.frames));
+        double values[] = { s.seconds > 0 ? s.frames / s.seconds : 0, s.meanMs, s.p50Ms, s.p95Ms, s.p99Ms, s.maxMs };
+        for (double v : values) {
+            snprintf(buffer, sizeof(buffer), "%.3f", v);
+            row.push_back(buffer);
+        }
+        for (const string& zone : zoneNames) {
+            auto it = s.zones.find(zone);
+            if (it != s.zones.end()) {
+                snprintf(buffer, sizeof(buffer), "%.3f", it->second);
+                row.push_back(buffer);
+            } else {
+                row.push_back("-");
+            }
+        }
+        rows.push_back(row);
+    }
+}
+
+/**
+ * @brief Prints the results of a sweep to stdout as an aligned table
+ *
+ * @param scenarios Scenarios of the sweep
+ * @param swept Swept keys
+ * @param stats Statistics per scenario
+ */
+void printSweepTable(const vector<Scenario>& scenarios, const vector<string>& swept, const vector<RunStats>& stats) {
+    vector<string> header;
+    vector<vector<string> > rows;
+    sweepColumns(scenarios, swept, stats, header, rows);
+
+    vector<size_t> widths;
+    for (const string& h : header)
+        widths.push_back(h.size());
+    for (const vector<string>& row : rows)
+        for (unsigned int c = 0; c < row.size(); c ++)
+            widths[c] = std::max(widths[c], row[c].size());
+
+    for (unsigned int c = 0; c < header.size(); c ++)
+        printf("%s%*s", c ? "  " : "", (int)widths[c], header[c].c_str());
+    printf("\n");
+    for (const vector<string>& row : rows) {
+        for (unsigned int c = 0; c < row.size(); c ++)
+            printf("%s%*s", c ? "  " : "", (int)widths[c], row[c].c_str());
+        printf("\n");
+    }
+    fflush(stdout);
+}
+
+/**
+ * @brief Writes the results of a sweep as CSV, with the same columns as printSweepTable
+ *
+ * @param path Path of the file
+ * @param scenarios Scenarios of the sweep
+ * @param swept Swept keys
+ * @param stats Statistics per scenario
+ * @return bool representing the success of the operation
+ */
+bool writeSweepCSV(const string& path, const vector<Scenario>& scenarios, const vector<string>& swept, const vector<RunStats>& stats) {
+    vector<string> header;
+    vector<vector<string> > rows;
+    sweepColumns(scenarios, swept, stats, header, rows);
+
+    std::ofstream file(path.c_str());
+    if (!file)
+        return false;
+
+    rows.insert(rows.begin(), header);
+    for (const vector<string>& row : rows) {
+        for (unsigned int c = 0; c < row.size(); c ++)
+            file << (c ? "," : "") << row[c];
+        file << "\n";
+    }
+    return true;
+}
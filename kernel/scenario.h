@@ -0,0 +1,157 @@
+/**
+ * @file scenario.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Everything a run depends on (window, scene, water, threads, present mode, frame count), loaded from key = value files and command-line overrides, plus the statistics a run produces
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include <glm/glm.hpp>
+
+#include "../objects/renderer.h"
+
+// frames a sweep runs per scenario, and frames left out of the statistics, unless the scenario says otherwise
+#define SCENARIO_SWEEP_FRAMES 600
+#define SCENARIO_SWEEP_WARMUP 60
+
+enum PresentMode {
+    PRESENT_VSYNC,      // swap interval 1
+    PRESENT_IMMEDIATE,  // swap interval 0, may tear
+    PRESENT_ADAPTIVE    // swap interval -1 (late swaps tear), vsync where unsupported
+};
+
+enum WaterEngine {
+    WATER_ENGINE_STATIC,    // the mesh is evaluated once and never updated
+    WATER_ENGINE_CPU,       // sum of sines on the CPU, split across the thread pool
+    WATER_ENGINE_SSE2,      // as cpu, four points at a time
+    WATER_ENGINE_AVX2,      // as cpu, eight points at a time
+    WATER_ENGINE_GPU        // compute shader writing the vertex buffer
+};
+
+enum MaterialMode {
+    MATERIALS_BOUND,        // textures bound per mesh, one indirect draw per mesh and level of detail
+    MATERIALS_ARRAYS,       // textures packed into texture arrays, one multi-draw per model
+    MATERIALS_BINDLESS      // as arrays, with bindless handles instead where ARB_bindless_texture is supported
+};
+
+/**
+ * @brief Settings of one run. Every field has a key (see Scenario::keys()) usable in scenario files and as a --key option
+ */
+struct Scenario {
+    string name;
+
+    // window and frame loop
+    int width, height;
+    bool headless;          // hidden window, no mouse capture
+    PresentMode present;
+    int frames;             // frames to run before exiting, 0 to run until the window is closed
+    int warmup;             // frames left out of the run's statistics
+    float timeStep;         // fixed simulation step in seconds, 0 for wall-clock time
+    int threads;            // threads evaluating the water, 0 for every hardware thread
+    RendererBackend renderer;   // gl, or null / software to run without a GL context
+
+    // scene
+    string sky;             // "procedural", or the name of a folder in resources/skyboxes
+    float sunElevation, sunAzimuth;
+    glm::vec3 cameraPosition;
+    float cameraYaw, cameraPitch;
+    bool overlay;
+
+    bool reflections;
+    float reflectionScale;
+    float reflectionBudget;
+    int reflectionMaxReuse;
+
+    bool models;
+    string modelPath;
+    int modelClip;          // animation played by skinned models, -1 for the bind pose
+    bool modelsAsync;       // import models on a loader thread when first shown, drawing nothing until they are ready
+    int modelGrid;
+    float modelSpacing;
+    float modelLodError;    // pixels of screen-space error a level of detail may cause, 0 to always draw the full meshes
+    bool modelClusters;     // cull copies drawn at full detail meshlet by meshlet on the GPU
+    MaterialMode modelMaterials;
+
+    // water
+    WaterEngine waterEngine;
+    int waterX, waterZ, waterWidth, waterLength;
+    int gridX, gridZ;
+    float amplitude;
+    int waves;
+    bool directional, rounded;
+    unsigned int seed;      // seeds the random wave set
+    int updateEvery;        // frames between water updates
+
+    // spray and foam
+    bool particles;
+    int particleMax;            // most particles alive at once
+    float particleThreshold;    // slope (|grad H|) above which the surface emits
+    float particleRate;         // particles per second a point emits per unit of slope above the threshold
+    bool particleReference;     // simulate on the CPU even with GL, drawing nothing
+
+    // accumulated foam coverage (GL only)
+    bool foam;
+    int foamResolution;         // texels on each side of the coverage map
+    float foamThreshold;        // slope (|grad H|) above which foam is added
+    float foamGain;             // coverage added per second per unit of slope above the threshold
+    float foamDecay;            // rate of the exponential decay, per second
+    glm::vec2 foamDrift;        // world units per second the foam is carried by
+
+    // caustics on submerged models (GL only)
+    bool caustics;
+    int causticsResolution;     // texels, and rays, on each side of the caustics texture
+    float causticsTile;         // world units the texture spans before repeating
+    float causticsDepth;        // below the surface, of the plane the light is focused on
+    float causticsRate;         // updates per second, 0 for every water update
+    float causticsStrength;     // how much the caustics modulate submerged lighting
+
+    Scenario();
+
+    bool set(const string& key, const string& value, string& error);
+    string get(const string& key) const;
+
+    static vector<string> keys();
+    static const char* presentName(PresentMode mode);
+    static const char* engineName(WaterEngine engine);
+    static const char* materialsName(MaterialMode mode);
+};
+
+// values given per key, in the order keys were first set; more than one value makes the key part of a sweep
+typedef vector<std::pair<string, vector<string> > > ScenarioSettings;
+
+bool loadScenarioFile(const string& path, ScenarioSettings& settings, string& error);
+void setScenarioValues(ScenarioSettings& settings, const string& key, const string& values);
+bool expandScenarios(const Scenario& base, const ScenarioSettings& settings, vector<Scenario>& scenarios, vector<string>& swept, string& error);
+
+/**
+ * @brief Frame statistics of a run, over the frames after its warmup
+ */
+struct RunStats {
+    string device;                      // GL renderer and version the run used
+    double startupMs;                   // from Kernel::start to the first frame
+    int frames;
+    double seconds;                     // wall-clock time of the measured frames
+    double meanMs, p50Ms, p95Ms, p99Ms, maxMs;
+    std::map<string, double> zones;     // mean of every cpu.* and gpu.* zone, in ms
+
+    RunStats();
+
+    void compute(vector<float> frameMs, const std::map<string, double>& zoneSums, double totalSeconds);
+};
+
+void printSweepTable(const vector<Scenario>& scenarios, const vector<string>& swept, const vector<RunStats>& stats);
+bool writeSweepCSV(const string& path, const vector<Scenario>& scenarios, const vector<string>& swept, const vector<RunStats>& stats);
+
+#endif
@@ -0,0 +1,277 @@
+/**
+ * @file validation.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Determinism check of the water evaluators: every water update is evaluated again by each evaluator at several thread counts, and the quantized vertex buffers are checksummed and compared with the scalar single-threaded reference
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "validation.h"
+#include "log.h"
+
+#include <algorithm>
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+static const char* componentNames[6] = { "x", "y", "z", "normal.x", "normal.y", "normal.z" };
+static const char* countNames[2] = { "alive", "emitted" };
+
+/**
+ * @brief Construct a new ValidationResult object, with nothing compared yet
+ */
+ValidationResult::ValidationResult() : evaluator(WATER_EVAL_SCALAR), threads(1), updates(0), identical(0), diverged(0), maxError(0), checksum(0),
+    divergedUpdate(-1), vertex(0), component(0), expected(0), actual(0) {}
+
+/**
+ * @brief FNV-1a hash of values rounded to multiples of quantum, so evaluators that differ only below the quantum hash alike (unless a value straddles a rounding boundary)
+ *
+ * @param values Values to hash
+ * @param quantum Rounding step
+ * @return unsigned long long
+ */
+unsigned long long quantizedChecksum(const vector<float>& values, float quantum) {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (float value : values) {
+        // NaN and infinities hash as one sentinel each
+        int64_t q = isnan(value) ? INT64_MIN : isinf(value) ? (value > 0 ? INT64_MAX : INT64_MIN + 1) : (int64_t)llround(value / quantum);
+        for (int b = 0; b < 8; b ++) {
+            hash ^= (unsigned long long)((q >> (8 * b)) & 0xff);
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+/**
+ * @brief Construct a new WaterValidator object. Creates the thread pools it compares with, and the GPU evaluator's resources when a GL context is current
+ *
+ * @param water Water to validate. Not owned
+ * @param tolerance Largest absolute error still counted as agreement
+ */
+WaterValidator::WaterValidator(Water* water, float tolerance) : water(water), tolerance(tolerance), updates(0) {
+    std::map<string, double> params;
+    water->describe(params);
+    dimZ = std::max(1, (int)params["water.dim_z"]);
+
+    // 1, 2 and every hardware thread, without repeats
+    vector<ThreadPool*> threadPools(1, (ThreadPool*)NULL);
+    pools.push_back(new ThreadPool(2));
+    ThreadPool* all = new ThreadPool(0);
+    if (all->getThreads() > 2)
+        pools.push_back(all);
+    else
+        delete all;
+    threadPools.insert(threadPools.end(), pools.begin(), pools.end());
+
+    for (int e = 0; e < WATER_EVAL_COUNT; e ++) {
+        WaterEvaluator evaluator = (WaterEvaluator)e;
+        if (!Water::evaluatorSupported(evaluator)) {
+            LOG_INFO("validate", "%s evaluator not supported here, left out", Water::evaluatorName(evaluator));
+            continue;
+        }
+        for (ThreadPool* pool : threadPools) {
+            // the reference itself, and thread counts the GPU evaluator does not use
+            if ((evaluator == WATER_EVAL_SCALAR && pool == NULL) || (evaluator == WATER_EVAL_GPU && pool != NULL))
+                continue;
+            ValidationResult result;
+            result.evaluator = evaluator;
+            result.threads = pool == NULL ? 1 : pool->getThreads();
+            result.name = string(Water::evaluatorName(evaluator)) + (evaluator == WATER_EVAL_GPU ? "" : " x" + std::to_string(result.threads));
+            results.push_back(result);
+            resultPools.push_back(pool);
+        }
+    }
+}
+
+/**
+ * @brief Destroy the WaterValidator object, joining its thread pools
+ */
+WaterValidator::~WaterValidator() {
+    for (ThreadPool* pool : pools)
+        delete pool;
+}
+
+/**
+ * @brief Evaluates the water at its current time with the reference and then with every other evaluator and thread count, and compares them. Leaves the water's evaluator and pool as they were, but not its vertices: evaluate it again afterwards
+ */
+void WaterValidator::check() {
+    WaterEvaluator evaluator = water->getEvaluator();
+    ThreadPool* pool = water->getThreadPool();
+
+    water->setEvaluator(WATER_EVAL_SCALAR);
+    water->setThreadPool(NULL);
+    water->evaluate();
+    reference = water->vertices;
+    unsigned long long referenceChecksum = quantizedChecksum(reference, tolerance);
+    LOG_DEBUG("validate", "update %d: scalar x1 %016llx", updates, referenceChecksum);
+
+    for (unsigned int r = 0; r < results.size(); r ++) {
+        ValidationResult& result = results[r];
+        water->setEvaluator(result.evaluator);
+        water->setThreadPool(resultPools[r]);
+        water->evaluate();
+        water->readback();
+        const vector<float>& values = water->vertices;
+
+        result.updates ++;
+        result.checksum = quantizedChecksum(values, tolerance);
+        if (result.checksum == referenceChecksum)
+            result.identical ++;
+        else
+            LOG_DEBUG("validate", "update %d: %s %016llx", updates, result.name, result.checksum);
+
+        // a checksum can differ by rounding alone, so the values decide whether the evaluator diverged
+        int first = -1;
+        for (unsigned int i = 0; i < values.size() && i < reference.size(); i ++) {
+            double error = fabs((double)values[i] - reference[i]);
+            if (error > result.maxError)
+                result.maxError = error;
+            if (first < 0 && !(error <= tolerance))
+                first = i;
+        }
+        if (first < 0)
+            continue;
+
+        result.diverged ++;
+        if (result.divergedUpdate >= 0)
+            continue;
+        result.divergedUpdate = updates;
+        result.vertex = first / 6;
+        result.component = first % 6;
+        result.expected = reference[first];
+        result.actual = values[first];
+        LOG_WARN("validate", "%s diverges at update %d: vertex %d (row %d, column %d) %s is %g, reference %g (error %g)", result.name, updates,
+            result.vertex, result.vertex / dimZ, result.vertex % dimZ, componentNames[result.component], result.actual, result.expected,
+            fabs((double)result.actual - result.expected));
+    }
+
+    water->setEvaluator(evaluator);
+    water->setThreadPool(pool);
+    updates ++;
+}
+
+/**
+ * @brief Returns the comparison of every evaluator and thread count so far
+ *
+ * @return const vector<ValidationResult>&
+ */
+const vector<ValidationResult>& WaterValidator::getResults() const {
+    return results;
+}
+
+/**
+ * @brief Construct a new ParticleValidator object. Must be created before the particles' first step, so both are seeded alike
+ *
+ * @param water Water the particles are emitted from. Not owned
+ * @param particles Particles on the GPU. Not owned
+ * @param capacity Capacity the particles were created with
+ * @param threshold Threshold the particles were created with
+ * @param rate Rate the particles were created with
+ */
+ParticleValidator::ParticleValidator(Water* water, SprayParticles* particles, int capacity, float threshold, float rate) : water(water), particles(particles) {
+    reference = new SprayParticles(water, capacity, threshold, rate, false);
+    result.name = "particles";
+    result.evaluator = WATER_EVAL_GPU;
+    result.vertex = -1;
+}
+
+/**
+ * @brief Destroy the ParticleValidator object
+ */
+ParticleValidator::~ParticleValidator() {
+    delete reference;
+}
+
+/**
+ * @brief Steps the reference as the particles were just stepped, and compares their counts. Waits for the GPU
+ *
+ * @param dt Seconds the particles were stepped by
+ */
+void ParticleValidator::check(float dt) {
+    // the reference reads the CPU vertices, which the GPU evaluator does not write
+    water->readback();
+    reference->update(dt);
+
+    int expected[2], actual[2];
+    reference->readCounts(expected[0], expected[1]);
+    particles->readCounts(actual[0], actual[1]);
+    if (expected[0] != (int)reference->getParticles().size())
+        LOG_ERROR("validate", "particle reference counts %d live particles but holds %d", expected[0], (int)reference->getParticles().size());
+
+    result.updates ++;
+    if (actual[0] == expected[0] && actual[1] == expected[1])
+        result.identical ++;
+    int first = -1;
+    for (int c = 0; c < 2; c ++) {
+        int error = abs(actual[c] - expected[c]);
+        result.maxError = std::max(result.maxError, (double)error / std::max(expected[c], 1));
+        if (first < 0 && error > std::max((int)(PARTICLE_VALIDATION_TOLERANCE * expected[c]), PARTICLE_VALIDATION_SLACK))
+            first = c;
+    }
+    if (first < 0)
+        return;
+
+    result.diverged ++;
+    if (result.divergedUpdate >= 0)
+        return;
+    result.divergedUpdate = result.updates - 1;
+    result.component = first;
+    result.expected = expected[first];
+    result.actual = actual[first];
+    LOG_WARN("validate", "particles diverge at update %d: %d %s, reference %d", result.divergedUpdate, actual[first], countNames[first], expected[first]);
+}
+
+/**
+ * @brief Returns the comparison of the particle counts so far; maxError is relative to the reference
+ *
+ * @return const ValidationResult&
+ */
+const ValidationResult& ParticleValidator::getResult() const {
+    return result;
+}
+
+/**
+ * @brief Returns whether every evaluator stayed within the tolerance of the reference
+ *
+ * @param results Results of a run
+ * @return bool
+ */
+bool validationPassed(const vector<ValidationResult>& results) {
+    for (const ValidationResult& result : results) {
+        if (result.diverged > 0)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Prints a table of the results of a run, and the first diverging vertex of every evaluator that diverged
+ *
+ * @param name Name of the scenario
+ * @param results Results of the run
+ * @param tolerance Tolerance the run used
+ */
+void printValidationReport(const string& name, const vector<ValidationResult>& results, float tolerance) {
+    printf("%s: against scalar x1, tolerance %g\n", name.c_str(), tolerance);
+    printf("  %-12s %12s %12s %12s %18s\n", "evaluator", "identical", "diverged", "max error", "last checksum");
+    for (const ValidationResult& result : results) {
+        printf("  %-12s %5d / %-4d %5d / %-4d %12.3g   %016llx\n", result.name.c_str(), result.identical, result.updates,
+            result.diverged, result.updates, result.maxError, result.checksum);
+    }
+    for (const ValidationResult& result : results) {
+        if (result.divergedUpdate < 0)
+            continue;
+        if (result.vertex < 0) {
+            printf("  %s first diverges at update %d: %g %s instead of %g\n", result.name.c_str(), result.divergedUpdate, result.actual,
+                countNames[result.component], result.expected);
+            continue;
+        }
+        printf("  %s first diverges at update %d, vertex %d %s: %g instead of %g (error %g)\n", result.name.c_str(), result.divergedUpdate,
+            result.vertex, componentNames[result.component], result.actual, result.expected, fabs((double)result.actual - result.expected));
+    }
+}
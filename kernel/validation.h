@@ -0,0 +1,104 @@
+/**
+ * @file validation.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Determinism check of the water evaluators: every water update is evaluated again by each evaluator at several thread counts, and the quantized vertex buffers are checksummed and compared with the scalar single-threaded reference
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef VALIDATION_H
+#define VALIDATION_H
+
+#include "../objects/water.h"
+#include "../objects/particles.h"
+#include "../objects/threadpool.h"
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+// largest absolute difference from the reference that is still agreement; also the quantization step of the checksums
+#define VALIDATION_TOLERANCE 1e-4f
+// frames a validation run lasts unless the scenario says otherwise
+#define VALIDATION_FRAMES 120
+
+// particle counts on the GPU agree with the CPU reference while within this fraction of it, or this many particles of it: a
+// rounding difference flips single emissions, and the particle sets drift apart from there
+#define PARTICLE_VALIDATION_TOLERANCE 0.02f
+#define PARTICLE_VALIDATION_SLACK 16
+
+/**
+ * @brief How one evaluator at one thread count compared with the reference over a run
+ */
+struct ValidationResult {
+    string name;                    // e.g. "avx2 x8"
+    WaterEvaluator evaluator;
+    int threads;
+    int updates;                    // water updates compared
+    int identical;                  // updates whose checksum equalled the reference's
+    int diverged;                   // updates with a value further than the tolerance from the reference
+    double maxError;                // largest absolute error over every value compared
+    unsigned long long checksum;    // of the last update
+
+    // first value further than the tolerance from the reference; divergedUpdate is -1 when there was none. For particle counts
+    // vertex is -1 and component 0 for the live particles, 1 for the emitted ones
+    int divergedUpdate;
+    int vertex, component;
+    float expected, actual;
+
+    ValidationResult();
+};
+
+unsigned long long quantizedChecksum(const vector<float>& values, float quantum);
+
+/**
+ * @brief Re-evaluates a water surface with every evaluator this machine runs, each on one thread, two threads and every hardware thread (once for the GPU), and compares them with the scalar evaluator on the calling thread
+ */
+class WaterValidator {
+    public:
+        WaterValidator(Water* water, float tolerance = VALIDATION_TOLERANCE);
+        ~WaterValidator();
+
+        void check();
+
+        const vector<ValidationResult>& getResults() const;
+
+    private:
+        Water* water;       // not owned
+        float tolerance;
+        int dimZ;           // grid columns, to report a vertex as (row, column)
+        int updates;
+
+        vector<ThreadPool*> pools;          // owned, one per thread count above 1
+        vector<ValidationResult> results;
+        vector<ThreadPool*> resultPools;    // pool of each result, NULL for one thread
+        vector<float> reference;
+};
+
+/**
+ * @brief Steps a CPU reference of GPU particles alongside them on the same water, and compares their live and emitted particle
+ * counts after every step
+ */
+class ParticleValidator {
+    public:
+        ParticleValidator(Water* water, SprayParticles* particles, int capacity, float threshold, float rate);
+        ~ParticleValidator();
+
+        void check(float dt);
+
+        const ValidationResult& getResult() const;
+
+    private:
+        Water* water;                   // not owned
+        SprayParticles* particles;      // not owned
+        SprayParticles* reference;
+        ValidationResult result;
+};
+
+bool validationPassed(const vector<ValidationResult>& results);
+void printValidationReport(const string& name, const vector<ValidationResult>& results, float tolerance);
+
+#endif
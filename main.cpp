@@ -9,20 +9,444 @@
  */
 
 #include "kernel/kernel.h"
+#include "kernel/perf.h"
 
-#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
 
-int main(int argc, char* argv[]) {
+/**
+ * @brief Routes SDL's own messages into the logger
+ *
+ * @param userdata Unused
+ * @param category SDL log category
+ * @param priority SDL log priority, mapped to a level
+ * @param message Message text
+ */
+static void logSDL(void* userdata, int category, SDL_LogPriority priority, const char* message) {
+    LogLevel level = priority >= SDL_LOG_PRIORITY_ERROR ? LOG_LEVEL_ERROR : priority == SDL_LOG_PRIORITY_WARN ? LOG_LEVEL_WARN
+        : priority == SDL_LOG_PRIORITY_INFO ? LOG_LEVEL_INFO : LOG_LEVEL_DEBUG;
+    LOG(level, "sdl", "%s", message);
+}
 
-    std::cout << "Reached line " << __LINE__ << " in " << __FILE__ << std::endl;
+/**
+ * @brief Prints the command line options and every scenario key with its default
+ */
+static void printUsage() {
+    printf("usage: EWS.exe [scenario file] [options]\n\n");
+    printf("  --scenario <file>     load settings from a scenario file (later files and options override earlier ones)\n");
+    printf("  --<key> <value>       set a scenario key, also --<key>=<value>; a comma-separated list sweeps the key\n");
+    printf("  --sweep               run every combination of the swept keys headless, then print a table of timings\n");
+    printf("  --sweep-csv <file>    also write the sweep table as CSV\n");
+    printf("  --perf                run each scenario --perf-runs times headless and compare with this machine's baseline\n");
+    printf("  --perf-runs <n>       runs per scenario (default %d)\n", PERF_DEFAULT_RUNS);
+    printf("  --perf-threshold <%%>  slowdown worth flagging (default %.0f)\n", 100 * PERF_DEFAULT_THRESHOLD);
+    printf("  --perf-dir <dir>      where baselines are kept (default %s)\n", PERF_BASELINE_DIR);
+    printf("  --perf-update         record the runs as the new baseline instead of comparing\n");
+    printf("  --validate            check every water update of each scenario against every evaluator and thread count\n");
+    printf("  --validate-tolerance <x>  largest absolute error still counted as agreement (default %g)\n", VALIDATION_TOLERANCE);
+    printf("  --golden              render each scenario headless and compare --golden-frames with the images in --golden-dir\n");
+    printf("  --golden-frames <list>  frames to compare (default %s)\n", GOLDEN_FRAMES);
+    printf("  --golden-dir <dir>    where golden images are kept (default %s)\n", GOLDEN_DIR);
+    printf("  --golden-ssim <x>     SSIM below which a frame fails (default %g)\n", GOLDEN_MIN_SSIM);
+    printf("  --golden-update       record the frames as the new golden images instead of comparing\n");
+    printf("  --golden-record-missing  record the frames that have no golden image yet, compare the others\n");
+    printf("  --import-bench <file> import a model on 1, 2, 4... threads and print the import times\n");
+    printf("  --import-runs <n>     imports per thread count (default %d)\n", IMPORT_BENCH_RUNS);
+    printf("  --software-gl         ask Mesa for its llvmpipe rasterizer (implied by --golden)\n");
+    printf("  --gl-debug            create a debug GL context and capture its messages\n");
+    printf("  --metrics             serve Prometheus metrics on port %d\n", METRICS_DEFAULT_PORT);
+    printf("  --metrics-port <n>    serve Prometheus metrics on port n\n");
+    printf("  --log-level <level>   trace, debug, info, warn, error or off\n");
+    printf("  --log-binary <file>   also write unformatted log records to file\n");
+    printf("  --help                show this\n\n");
+    printf("scenario keys (defaults):\n");
+    Scenario defaults;
+    for (const string& key : Scenario::keys())
+        printf("  %-22s %s\n", key.c_str(), defaults.get(key).c_str());
+}
 
+/**
+ * @brief Runs one scenario to completion
+ *
+ * @param scenario Scenario to run
+ * @param debugContext Whether to create a debug GL context
+ * @param metricsPort Port to serve metrics on, 0 for none
+ * @param stats Receives the frame statistics of the run
+ * @return bool whether the scenario could be started
+ */
+static bool runScenario(const Scenario& scenario, bool debugContext, int metricsPort, RunStats& stats) {
     Kernel* kernel = new Kernel();
+    kernel->setScenario(scenario);
+    kernel->setDebugContext(debugContext);
+    kernel->setMetricsPort(metricsPort);
+    bool started = kernel->start(string("EWS - ") + scenario.name, scenario.width, scenario.height);
+    stats = kernel->getStats();
+    delete kernel;
+    return started;
+}
 
-    std::cout << "Reached line " << __LINE__ << " in " << __FILE__ << std::endl;
-    kernel->start(string("Window"), 700, 700);
+/**
+ * @brief Runs one scenario, re-evaluating each water update with every evaluator and thread count
+ *
+ * @param scenario Scenario to run
+ * @param tolerance Largest absolute error still counted as agreement
+ * @param results Receives how each evaluator compared with the reference
+ * @return bool whether the scenario could be started
+ */
+static bool runValidation(const Scenario& scenario, float tolerance, vector<ValidationResult>& results) {
+    Kernel* kernel = new Kernel();
+    kernel->setScenario(scenario);
+    kernel->setValidation(tolerance);
+    bool started = kernel->start(string("EWS - ") + scenario.name, scenario.width, scenario.height);
+    results = kernel->getValidation();
+    delete kernel;
+    return started;
+}
 
-    std::cout << "Reached line " << __LINE__ << " in " << __FILE__ << std::endl;
-    
+/**
+ * @brief Parses a comma-separated list of frame numbers
+ *
+ * @param list List, e.g. "1,30,60"
+ * @param frames Receives the frames
+ * @return bool false when an entry is not a positive number
+ */
+static bool parseFrames(const string& list, vector<int>& frames) {
+    frames.clear();
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        string entry = list.substr(start, comma == string::npos ? string::npos : comma - start);
+        char* end;
+        long frame = strtol(entry.c_str(), &end, 10);
+        if (entry.empty() || *end != '\0' || frame <= 0)
+            return false;
+        frames.push_back((int)frame);
+        if (comma == string::npos)
+            break;
+        start = comma + 1;
+    }
+    return !frames.empty();
+}
+
+/**
+ * @brief Runs one scenario, reading back the given frames, and compares them with their golden images (or records them)
+ *
+ * @param scenario Scenario to run
+ * @param frames Frames to compare
+ * @param directory Golden directory
+ * @param minSSIM SSIM below which a frame fails
+ * @param update Whether to record the frames as golden images instead of comparing
+ * @param recordMissing Whether to record the frames that have no golden image yet
+ * @param results Receives one result per frame
+ * @param device Receives the GL renderer the frames were rendered with
+ * @return bool whether the scenario could be started
+ */
+static bool runGolden(const Scenario& scenario, const vector<int>& frames, const string& directory, double minSSIM, bool update, bool recordMissing, vector<GoldenResult>& results, string& device) {
+    Kernel* kernel = new Kernel();
+    kernel->setScenario(scenario);
+    kernel->setCaptureFrames(frames);
+    bool started = kernel->start(string("EWS - ") + scenario.name, scenario.width, scenario.height);
+    device = kernel->getStats().device;
+    if (started)
+        results = compareGoldens(directory, scenario, kernel->getCaptures(), minSSIM, update, recordMissing);
     delete kernel;
-    return 0;
-}
\ No newline at end of file
+    return started;
+}
+
+/**
+ * @brief Returns whether any metric of a comparison regressed
+ *
+ * @param comparisons Comparison from runPerf
+ * @return bool
+ */
+static bool perfRegressed(const vector<PerfComparison>& comparisons) {
+    for (const PerfComparison& c : comparisons) {
+        if (c.verdict == PERF_REGRESSED)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Runs a scenario several times and compares the runs with the baseline recorded on this machine, or records one
+ *
+ * @param scenario Scenario to run
+ * @param runs Runs per scenario
+ * @param threshold Relative slowdown worth flagging
+ * @param directory Baseline directory
+ * @param update Whether to record a new baseline instead of comparing
+ * @param comparisons Receives the comparison (empty when a baseline was recorded)
+ * @param status Receives the outcome: "ok", "regressed", "recorded" or an error
+ * @return bool false when a run failed to start or the baseline could not be written or compared, true otherwise (even when
+ * a regression was found, see perfRegressed)
+ */
+static bool runPerf(const Scenario& scenario, int runs, double threshold, const string& directory, bool update, vector<PerfComparison>& comparisons, string& status) {
+    PerfSamples candidate;
+    string device;
+    for (int r = 0; r < runs; r ++) {
+        LOG_INFO("perf", "%s: run %d/%d", scenario.name, r + 1, runs);
+        RunStats stats;
+        if (!runScenario(scenario, false, 0, stats)) {
+            status = "failed to start";
+            return false;
+        }
+        addPerfRun(candidate, stats);
+        device = stats.device;
+    }
+
+    string machine, settings = describeScenario(scenario), baselineSettings, error;
+    string path = baselinePath(directory, machineFingerprint(device, machine), scenario);
+    PerfSamples baseline;
+    if (update || !loadBaseline(path, baseline, baselineSettings, error)) {
+        if (!saveBaseline(path, candidate, settings, machine)) {
+            status = "unable to write " + path;
+            return false;
+        }
+        status = "baseline recorded in " + path;
+        return true;
+    }
+    if (baselineSettings != settings) {
+        status = "baseline " + path + " was recorded with other settings; rerun with --perf-update";
+        return false;
+    }
+
+    comparisons = comparePerf(baseline, candidate, threshold);
+    status = perfRegressed(comparisons) ? "regressed" : "ok";
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Logger& logger = Logger::get();
+    const char* binaryLog = NULL;
+    bool debugContext = false, sweep = false, perf = false, perfUpdate = false, validate = false;
+    bool golden = false, goldenUpdate = false, goldenRecordMissing = false, softwareGL = false;
+    int metricsPort = 0, perfRuns = PERF_DEFAULT_RUNS, importRuns = IMPORT_BENCH_RUNS;
+    double perfThreshold = PERF_DEFAULT_THRESHOLD, goldenSSIM = GOLDEN_MIN_SSIM;
+    float validateTolerance = VALIDATION_TOLERANCE;
+    string sweepCSV, perfDir = PERF_BASELINE_DIR, goldenDir = GOLDEN_DIR, importBench, error;
+    vector<int> goldenFrames;
+    parseFrames(GOLDEN_FRAMES, goldenFrames);
+    ScenarioSettings settings;
+    vector<string> keys = Scenario::keys();
+
+    for (int i = 1; i < argc; i ++) {
+        string arg = argv[i];
+        LogLevel level;
+        if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else if (arg == "--log-level" && i + 1 < argc && Logger::parseLevel(argv[i + 1], level)) {
+            logger.setLevel(level);
+            i ++;
+        } else if (arg == "--log-binary" && i + 1 < argc)
+            binaryLog = argv[++ i];
+        else if (arg == "--gl-debug")
+            debugContext = true;
+        else if (arg == "--metrics")
+            metricsPort = METRICS_DEFAULT_PORT;
+        else if (arg == "--metrics-port" && i + 1 < argc)
+            metricsPort = atoi(argv[++ i]);
+        else if (arg == "--sweep")
+            sweep = true;
+        else if (arg == "--sweep-csv" && i + 1 < argc)
+            sweepCSV = argv[++ i];
+        else if (arg == "--perf")
+            perf = true;
+        else if (arg == "--perf-runs" && i + 1 < argc)
+            perfRuns = std::max(1, atoi(argv[++ i]));
+        else if (arg == "--perf-threshold" && i + 1 < argc)
+            perfThreshold = atof(argv[++ i]) / 100;
+        else if (arg == "--perf-dir" && i + 1 < argc)
+            perfDir = argv[++ i];
+        else if (arg == "--perf-update")
+            perf = perfUpdate = true;
+        else if (arg == "--validate")
+            validate = true;
+        else if (arg == "--validate-tolerance" && i + 1 < argc) {
+            validate = true;
+            validateTolerance = std::max(1e-9f, (float)atof(argv[++ i]));
+        }
+        else if (arg == "--golden")
+            golden = true;
+        else if (arg == "--golden-update")
+            golden = goldenUpdate = true;
+        else if (arg == "--golden-record-missing")
+            golden = goldenRecordMissing = true;
+        else if (arg == "--golden-dir" && i + 1 < argc)
+            goldenDir = argv[++ i];
+        else if (arg == "--golden-ssim" && i + 1 < argc)
+            goldenSSIM = atof(argv[++ i]);
+        else if (arg == "--golden-frames" && i + 1 < argc) {
+            if (!parseFrames(argv[++ i], goldenFrames)) {
+                fprintf(stderr, "invalid frame list %s\n", argv[i]);
+                return 1;
+            }
+        } else if (arg == "--import-bench" && i + 1 < argc)
+            importBench = argv[++ i];
+        else if (arg == "--import-runs" && i + 1 < argc)
+            importRuns = std::max(1, atoi(argv[++ i]));
+        else if (arg == "--software-gl")
+            softwareGL = true;
+        else if ((arg == "--scenario" && i + 1 < argc) || arg.compare(0, 2, "--") != 0) {
+            if (!loadScenarioFile(arg == "--scenario" ? argv[++ i] : arg, settings, error)) {
+                fprintf(stderr, "%s\n", error.c_str());
+                return 1;
+            }
+        } else {
+            // --key value or --key=value
+            size_t equals = arg.find('=');
+            string key = arg.substr(2, equals == string::npos ? string::npos : equals - 2);
+            if (std::find(keys.begin(), keys.end(), key) == keys.end() || (equals == string::npos && i + 1 >= argc)) {
+                fprintf(stderr, "unknown or incomplete option %s (see --help)\n", arg.c_str());
+                return 1;
+            }
+            setScenarioValues(settings, key, equals == string::npos ? argv[++ i] : arg.substr(equals + 1));
+        }
+    }
+
+    // sweeps, perf, validation and golden runs default to short headless runs that are not capped by the display
+    Scenario base;
+    if (sweep || perf || validate || golden) {
+        base.headless = true;
+        base.present = PRESENT_IMMEDIATE;
+        base.frames = validate ? VALIDATION_FRAMES : golden ? 0 : SCENARIO_SWEEP_FRAMES;
+        base.warmup = validate || golden ? 0 : SCENARIO_SWEEP_WARMUP;
+    }
+    if (golden)
+        base.overlay = false;
+    vector<Scenario> scenarios;
+    vector<string> swept;
+    if (!expandScenarios(base, settings, scenarios, swept, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    if (!sweep && !perf && !validate && !golden && scenarios.size() > 1) {
+        fprintf(stderr, "%d scenarios given (values of %s); pass --sweep, --perf, --validate or --golden to run them all\n", (int)scenarios.size(), swept[0].c_str());
+        return 1;
+    }
+
+    logger.addSink(new StderrLogSink());
+    logger.addSink(new FileLogSink(LOG_DEFAULT_PATH));
+    if (binaryLog != NULL)
+        logger.addSink(new BinaryLogSink(binaryLog));
+    logger.start();
+    SDL_LogSetOutputFunction(logSDL, NULL);
+
+    if (!importBench.empty()) {
+        // import only: no window, no GL
+        vector<ImportTiming> timings = benchmarkImport(importBench, importRuns);
+        logger.stop();
+        printImportReport(importBench, timings);
+        return timings.empty() ? 1 : 0;
+    }
+
+    // must be set before SDL loads the GL library
+    if (golden || softwareGL)
+        requestSoftwareGL();
+
+    int status = 0;
+    if (golden) {
+        // exit code 4 when a frame differs from its golden image, 5 when there was none to compare with. A frame only matches an image if the run does not depend on timing: fixed steps, a fixed reflection interval, and enough frames
+        int lastFrame = *std::max_element(goldenFrames.begin(), goldenFrames.end());
+        vector<vector<GoldenResult> > results(scenarios.size());
+        vector<string> devices(scenarios.size());
+        vector<bool> started(scenarios.size());
+        for (unsigned int i = 0; i < scenarios.size(); i ++) {
+            for (const string& key : swept)
+                scenarios[i].name += " " + key + "=" + scenarios[i].get(key);
+            if (scenarios[i].timeStep <= 0)
+                scenarios[i].timeStep = GOLDEN_TIME_STEP;
+            scenarios[i].reflectionBudget = 0;
+            scenarios[i].frames = std::max(scenarios[i].frames, lastFrame);
+            started[i] = runGolden(scenarios[i], goldenFrames, goldenDir, goldenSSIM, goldenUpdate, goldenRecordMissing, results[i], devices[i]);
+            if (!started[i])
+                status = 1;
+            else if (!goldensPassed(results[i]) && (status == 0 || status == 5))
+                status = 4;
+            else if (goldensMissing(results[i]) && status == 0)
+                status = 5;
+        }
+        logger.stop();
+
+        for (unsigned int i = 0; i < scenarios.size(); i ++) {
+            if (!started[i]) {
+                printf("%s: failed to start\n\n", scenarios[i].name.c_str());
+                continue;
+            }
+            printGoldenReport(scenarios[i].name, devices[i], results[i]);
+            if (!isSoftwareGL(devices[i]))
+                printf("  warning: not a software rasterizer, images may differ from ones recorded on llvmpipe\n");
+            const char* outcome = !goldensPassed(results[i]) ? "differs" : goldensMissing(results[i]) ? "no golden images" : goldenUpdate ? "recorded" : "ok";
+            printf("%s: %s\n\n", scenarios[i].name.c_str(), outcome);
+        }
+        return status;
+    }
+
+    if (validate) {
+        // exit code 3 when an evaluator diverged from the reference
+        vector<vector<ValidationResult> > results(scenarios.size());
+        vector<bool> started(scenarios.size());
+        for (unsigned int i = 0; i < scenarios.size(); i ++) {
+            for (const string& key : swept)
+                scenarios[i].name += " " + key + "=" + scenarios[i].get(key);
+            started[i] = runValidation(scenarios[i], validateTolerance, results[i]);
+            if (!started[i])
+                status = 1;
+            else if (!validationPassed(results[i]) && status == 0)
+                status = 3;
+        }
+        logger.stop();
+
+        for (unsigned int i = 0; i < scenarios.size(); i ++) {
+            if (!started[i])
+                printf("%s: failed to start\n\n", scenarios[i].name.c_str());
+            else {
+                printValidationReport(scenarios[i].name, results[i], validateTolerance);
+                printf("%s: %s\n\n", scenarios[i].name.c_str(), validationPassed(results[i]) ? "ok" : "diverged");
+            }
+        }
+        return status;
+    }
+
+    if (perf) {
+        // a scenario per combination of the swept keys, each named after its values so baselines stay apart; exit code 2 when a
+        // metric regressed, 1 when a scenario could not be run or compared
+        vector<vector<PerfComparison> > comparisons(scenarios.size());
+        vector<string> outcomes(scenarios.size());
+        for (unsigned int i = 0; i < scenarios.size(); i ++) {
+            for (const string& key : swept)
+                scenarios[i].name += " " + key + "=" + scenarios[i].get(key);
+            if (!runPerf(scenarios[i], perfRuns, perfThreshold, perfDir, perfUpdate, comparisons[i], outcomes[i]))
+                status = 1;
+            else if (perfRegressed(comparisons[i]) && status == 0)
+                status = 2;
+        }
+        logger.stop();
+
+        for (unsigned int i = 0; i < scenarios.size(); i ++) {
+            if (!comparisons[i].empty())
+                printPerfReport(scenarios[i].name, comparisons[i]);
+            printf("%s: %s\n\n", scenarios[i].name.c_str(), outcomes[i].c_str());
+        }
+        return status;
+    }
+
+    vector<RunStats> results(scenarios.size());
+    for (unsigned int i = 0; i < scenarios.size(); i ++) {
+        if (sweep)
+            LOG_INFO("scenario", "Sweep %d/%d", (int)i + 1, (int)scenarios.size());
+        if (!runScenario(scenarios[i], debugContext, metricsPort, results[i]))
+            status = 1;
+    }
+    logger.stop();
+
+    if (sweep) {
+        printSweepTable(scenarios, swept, results);
+        if (!sweepCSV.empty() && !writeSweepCSV(sweepCSV, scenarios, swept, results)) {
+            fprintf(stderr, "unable to write %s\n", sweepCSV.c_str());
+            status = 1;
+        }
+    }
+    return status;
+}
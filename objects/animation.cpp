@@ -0,0 +1,237 @@
+/**
+ * @file animation.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Skeletal animation
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "animation.h"
+#include "threadpool.h"
+
+#include <math.h>
+#include <algorithm>
+#include <functional>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+/**
+ * @brief Converts an Assimp matrix (row-major) to glm (column-major)
+ *
+ * @param m Assimp matrix
+ * @return glm::mat4
+ */
+glm::mat4 toGlm(const aiMatrix4x4& m) {
+    return glm::mat4(m.a1, m.b1, m.c1, m.d1,
+                     m.a2, m.b2, m.c2, m.d2,
+                     m.a3, m.b3, m.c3, m.d3,
+                     m.a4, m.b4, m.c4, m.d4);
+}
+
+/**
+ * @brief Construct a new empty Skeleton object
+ */
+Skeleton::Skeleton() : globalInverse(1.0f) {}
+
+/**
+ * @brief Reads the node hierarchy and the clips of a scene. Bones are added by the meshes binding vertices to nodes (see addBone)
+ *
+ * @param scene Scene read by Assimp
+ */
+void Skeleton::import(const aiScene* scene) {
+    nodes.clear();
+    bones.clear();
+    clips.clear();
+    globalInverse = glm::inverse(toGlm(scene->mRootNode->mTransformation));
+
+    // parents first, so a single pass in order resolves global transforms
+    std::function<void(const aiNode*, int)> visit = [&](const aiNode* node, int parent) {
+        SkeletonNode entry;
+        entry.name = node->mName.C_Str();
+        entry.parent = parent;
+        entry.transform = toGlm(node->mTransformation);
+        entry.bone = -1;
+        nodes.push_back(entry);
+        int index = nodes.size() - 1;
+        for (unsigned int i = 0; i < node->mNumChildren; i ++)
+            visit(node->mChildren[i], index);
+    };
+    visit(scene->mRootNode, -1);
+
+    for (unsigned int a = 0; a < scene->mNumAnimations; a ++) {
+        const aiAnimation* animation = scene->mAnimations[a];
+        AnimationClip clip;
+        clip.name = animation->mName.C_Str();
+        clip.duration = animation->mDuration;
+        clip.ticksPerSecond = animation->mTicksPerSecond > 0 ? animation->mTicksPerSecond : ANIMATION_DEFAULT_TICKS;
+        clip.channelOf.assign(nodes.size(), -1);
+        for (unsigned int c = 0; c < animation->mNumChannels; c ++) {
+            const aiNodeAnim* source = animation->mChannels[c];
+            AnimationChannel channel;
+            channel.node = findNode(source->mNodeName.C_Str());
+            if (channel.node < 0)
+                continue;
+            for (unsigned int k = 0; k < source->mNumPositionKeys; k ++) {
+                const aiVectorKey& key = source->mPositionKeys[k];
+                channel.positionTimes.push_back(key.mTime);
+                channel.positions.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            for (unsigned int k = 0; k < source->mNumRotationKeys; k ++) {
+                const aiQuatKey& key = source->mRotationKeys[k];
+                channel.rotationTimes.push_back(key.mTime);
+                channel.rotations.push_back(glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            for (unsigned int k = 0; k < source->mNumScalingKeys; k ++) {
+                const aiVectorKey& key = source->mScalingKeys[k];
+                channel.scaleTimes.push_back(key.mTime);
+                channel.scales.push_back(glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z));
+            }
+            clip.channelOf[channel.node] = clip.channels.size();
+            clip.channels.push_back(channel);
+        }
+        clips.push_back(clip);
+    }
+}
+
+/**
+ * @brief Returns the index of a bone, adding it the first time its node binds vertices
+ *
+ * @param name Name of the bone's node
+ * @param offset Mesh to bone space in the bind pose
+ * @return int index into bones, -1 if no node has that name
+ */
+int Skeleton::addBone(const string& name, const glm::mat4& offset) {
+    int node = findNode(name);
+    if (node < 0)
+        return -1;
+    if (nodes[node].bone < 0) {
+        BoneInfo bone;
+        bone.name = name;
+        bone.node = node;
+        bone.offset = offset;
+        nodes[node].bone = bones.size();
+        bones.push_back(bone);
+    }
+    return nodes[node].bone;
+}
+
+/**
+ * @brief Returns the node with a name
+ *
+ * @param name Node name
+ * @return int index into nodes, -1 if there is none
+ */
+int Skeleton::findNode(const string& name) const {
+    for (unsigned int i = 0; i < nodes.size(); i ++) {
+        if (nodes[i].name == name)
+            return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Returns whether the skeleton has bones and something to animate them with
+ *
+ * @return bool
+ */
+bool Skeleton::animated() const {
+    return !bones.empty() && !clips.empty();
+}
+
+/**
+ * @brief Returns the key interval holding a time, as the index of its first key and how far through it the time is
+ *
+ * @param times Key times, increasing
+ * @param time Time to look up
+ * @param factor Receives the interpolation factor in [0, 1]
+ * @return size_t index of the key before the time (the last key past the end)
+ */
+static size_t findKey(const vector<float>& times, float time, float& factor) {
+    factor = 0;
+    if (times.size() < 2 || time <= times[0])
+        return 0;
+    size_t next = std::upper_bound(times.begin(), times.end(), time) - times.begin();
+    if (next >= times.size())
+        return times.size() - 1;
+    float span = times[next] - times[next - 1];
+    factor = span > 0 ? (time - times[next - 1]) / span : 0;
+    return next - 1;
+}
+
+/**
+ * @brief Interpolates a node's keys at a time into its transform relative to its parent
+ *
+ * @param channel Keys of the node
+ * @param time Time in ticks
+ * @return glm::mat4
+ */
+static glm::mat4 sampleChannel(const AnimationChannel& channel, float time) {
+    float t;
+    glm::vec3 position(0), scale(1);
+    glm::quat rotation(1, 0, 0, 0);
+    if (!channel.positions.empty()) {
+        size_t k = findKey(channel.positionTimes, time, t);
+        position = k + 1 < channel.positions.size() ? glm::mix(channel.positions[k], channel.positions[k + 1], t) : channel.positions[k];
+    }
+    if (!channel.rotations.empty()) {
+        size_t k = findKey(channel.rotationTimes, time, t);
+        rotation = k + 1 < channel.rotations.size() ? glm::slerp(channel.rotations[k], channel.rotations[k + 1], t) : channel.rotations[k];
+    }
+    if (!channel.scales.empty()) {
+        size_t k = findKey(channel.scaleTimes, time, t);
+        scale = k + 1 < channel.scales.size() ? glm::mix(channel.scales[k], channel.scales[k + 1], t) : channel.scales[k];
+    }
+    return glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(glm::normalize(rotation)) * glm::scale(glm::mat4(1.0f), scale);
+}
+
+/**
+ * @brief Construct a new Animator object, posed at rest
+ *
+ * @param skeleton Skeleton to animate (not owned)
+ */
+Animator::Animator(const Skeleton* skeleton) : skeleton(skeleton), locals(skeleton->nodes.size()), globals(skeleton->nodes.size()),
+    palette(skeleton->bones.size(), glm::mat4(1.0f)) {}
+
+/**
+ * @brief Poses the skeleton at a time of a clip, looping it. Keyframes of the nodes are interpolated on the pool (the bulk of the
+ * work on large skeletons); the hierarchy is then walked once, parents first
+ *
+ * @param clip Index into the skeleton's clips; out of range poses the bind pose
+ * @param seconds Time since the clip started
+ * @param pool Threads to sample on (may be NULL), not running another parallelFor meanwhile
+ */
+void Animator::sample(int clip, double seconds, ThreadPool* pool) {
+    const AnimationClip* animation = clip >= 0 && clip < (int)skeleton->clips.size() ? &skeleton->clips[clip] : NULL;
+    float time = 0;
+    if (animation != NULL && animation->duration > 0)
+        time = fmod(seconds * animation->ticksPerSecond, animation->duration);
+
+    auto body = [&](int from, int to) {
+        for (int i = from; i < to; i ++) {
+            int channel = animation != NULL ? animation->channelOf[i] : -1;
+            locals[i] = channel >= 0 ? sampleChannel(animation->channels[channel], time) : skeleton->nodes[i].transform;
+        }
+    };
+    if (pool != NULL)
+        pool->parallelFor(0, locals.size(), body);
+    else
+        body(0, locals.size());
+
+    for (unsigned int i = 0; i < skeleton->nodes.size(); i ++) {
+        const SkeletonNode& node = skeleton->nodes[i];
+        globals[i] = node.parent >= 0 ? globals[node.parent] * locals[i] : locals[i];
+        if (node.bone >= 0)
+            palette[node.bone] = skeleton->globalInverse * globals[i] * skeleton->bones[node.bone].offset;
+    }
+}
+
+/**
+ * @brief Returns the bone palette of the last pose sampled
+ *
+ * @return const vector<glm::mat4>&
+ */
+const vector<glm::mat4>& Animator::getPalette() const {
+    return palette;
+}
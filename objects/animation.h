@@ -0,0 +1,105 @@
+/**
+ * @file animation.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Skeletal animation. Skeleton holds a model's node hierarchy, bones and keyframed clips as Assimp imports them; Animator samples a clip into the bone palette that skinning (see skinning.h) deforms the vertices with
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <assimp/scene.h>
+
+class ThreadPool;
+
+// ticks per second of clips that do not say
+#define ANIMATION_DEFAULT_TICKS 25.0
+
+/**
+ * @brief A bone: a node that deforms vertices, and the transform from the mesh into its space in the bind pose
+ */
+struct BoneInfo {
+    string name;
+    int node;
+    glm::mat4 offset;
+};
+
+/**
+ * @brief A node of the hierarchy; parents come before their children
+ */
+struct SkeletonNode {
+    string name;
+    int parent;             // -1 for the root
+    glm::mat4 transform;    // relative to the parent, when no clip animates the node
+    int bone;               // -1 for nodes no vertex is bound to
+};
+
+/**
+ * @brief Keyframes of one node in a clip, in ticks
+ */
+struct AnimationChannel {
+    int node;
+    vector<float> positionTimes, rotationTimes, scaleTimes;
+    vector<glm::vec3> positions;
+    vector<glm::quat> rotations;
+    vector<glm::vec3> scales;
+};
+
+/**
+ * @brief One animation of a model
+ */
+struct AnimationClip {
+    string name;
+    double duration;        // ticks
+    double ticksPerSecond;
+    vector<AnimationChannel> channels;
+    vector<int> channelOf;  // channel animating each node, -1 if none
+};
+
+/**
+ * @brief Node hierarchy, bones and clips of a model
+ */
+struct Skeleton {
+    vector<SkeletonNode> nodes;
+    vector<BoneInfo> bones;
+    vector<AnimationClip> clips;
+    glm::mat4 globalInverse;    // inverse of the root's transform
+
+    Skeleton();
+
+    void import(const aiScene* scene);
+    int addBone(const string& name, const glm::mat4& offset);
+    int findNode(const string& name) const;
+    bool animated() const;
+};
+
+/**
+ * @brief Samples clips of a skeleton into bone palettes. A palette entry maps a bind-pose vertex into model space for the pose
+ */
+class Animator {
+    public:
+        Animator(const Skeleton* skeleton);
+
+        void sample(int clip, double seconds, ThreadPool* pool);
+        const vector<glm::mat4>& getPalette() const;
+
+    private:
+        const Skeleton* skeleton;
+        vector<glm::mat4> locals, globals;
+        vector<glm::mat4> palette;
+};
+
+glm::mat4 toGlm(const aiMatrix4x4& m);
+
+#endif
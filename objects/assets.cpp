@@ -0,0 +1,283 @@
+/**
+ * @file assets.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Asset bookkeeping and handles resolving on first use
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "assets.h"
+#include "helper.h"
+#include "threadpool.h"
+#include "../kernel/log.h"
+
+#include <stdio.h>
+#include <algorithm>
+
+/**
+ * @brief Construct a new AssetRecord object
+ */
+AssetRecord::AssetRecord() : state(ASSET_UNLOADED), frame(0), loadMs(0), uploadMs(0), loads(0) {}
+
+/**
+ * @brief Construct a new AssetLog object
+ */
+AssetLog::AssetLog() : frame(0) {}
+
+/**
+ * @brief Returns the asset log of the process
+ *
+ * @return AssetLog&
+ */
+AssetLog& AssetLog::get() {
+    static AssetLog log;
+    return log;
+}
+
+/**
+ * @brief Sets the frame assets touched from now on are attributed to
+ *
+ * @param frame Frame number, 0 during startup
+ */
+void AssetLog::setFrame(int frame) {
+    std::lock_guard<std::mutex> lock(mutex);
+    this->frame = frame;
+}
+
+/**
+ * @brief Records that an asset was read
+ *
+ * @param kind Kind of asset
+ * @param path File it was read from
+ * @param state State the asset is in afterwards
+ * @param ms Time spent reading and decoding it
+ */
+void AssetLog::loaded(const string& kind, const string& path, AssetState state, double ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    AssetRecord& record = find(kind, path);
+    record.state = state;
+    record.loadMs += ms;
+    record.loads ++;
+}
+
+/**
+ * @brief Records that the GL objects of an asset were created
+ *
+ * @param kind Kind of asset
+ * @param path File it was read from
+ * @param ms Time spent creating them
+ */
+void AssetLog::uploaded(const string& kind, const string& path, double ms) {
+    std::lock_guard<std::mutex> lock(mutex);
+    AssetRecord& record = find(kind, path);
+    record.state = ASSET_READY;
+    record.uploadMs += ms;
+}
+
+/**
+ * @brief Returns the assets touched so far, in the order they were first touched
+ *
+ * @return vector<AssetRecord>
+ */
+vector<AssetRecord> AssetLog::getRecords() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return records;
+}
+
+/**
+ * @brief Logs the assets touched during startup, or those first touched once frames were running
+ *
+ * @param startup true for the startup report, false for the assets resolved later
+ */
+void AssetLog::logReport(bool startup) const {
+    static const char* stateNames[] = { "unloaded", "loading", "imported", "ready", "failed" };
+
+    vector<AssetRecord> touched = getRecords();
+    int count = 0;
+    double loadMs = 0, uploadMs = 0;
+    for (const AssetRecord& record : touched) {
+        if ((record.frame == 0) != startup)
+            continue;
+        count ++;
+        loadMs += record.loadMs;
+        uploadMs += record.uploadMs;
+        LOG_INFO("assets", "  %-8s %-9s frame %5d  load %8.2f ms  upload %7.2f ms  %s", record.kind, stateNames[record.state],
+            record.frame, record.loadMs, record.uploadMs, record.path);
+    }
+    LOG_INFO("assets", "%d assets touched %s: load %.2f ms, upload %.2f ms", count, startup ? "during startup" : "after startup", loadMs, uploadMs);
+}
+
+/**
+ * @brief Returns the record of an asset, adding it if it was not touched before. The mutex must be held
+ *
+ * @param kind Kind of asset
+ * @param path File it is read from
+ * @return AssetRecord&
+ */
+AssetRecord& AssetLog::find(const string& kind, const string& path) {
+    for (AssetRecord& record : records) {
+        if (record.kind == kind && record.path == path)
+            return record;
+    }
+    records.push_back(AssetRecord());
+    records.back().kind = kind;
+    records.back().path = path;
+    records.back().frame = frame;
+    return records.back();
+}
+
+/**
+ * @brief Construct a new ModelHandle object. Nothing is read until get() is called
+ *
+ * @param path File of the model
+ * @param async Whether get() imports on a loader thread instead of blocking
+ * @param pool Threads a synchronous import converts meshes and decodes textures on (not owned; may be NULL). An asynchronous import starts threads of its own, since the pool is busy with frames meanwhile
+ */
+ModelHandle::ModelHandle(const string& path, bool async, ThreadPool* pool) : path(path), async(async), pool(pool), model(NULL), state(ASSET_UNLOADED) {}
+
+/**
+ * @brief Destroy the ModelHandle object, waiting for an import in flight. Must run on the GL thread once the model was uploaded
+ */
+ModelHandle::~ModelHandle() {
+    if (loader.joinable())
+        loader.join();
+    delete model;
+}
+
+/**
+ * @brief Resolves the model. Call from the GL thread
+ *
+ * @return Model* ready to draw, or NULL while an asynchronous import is in flight or if the import failed
+ */
+Model* ModelHandle::get() {
+    int current = state.load(std::memory_order_acquire);
+    if (current == ASSET_READY)
+        return model;
+
+    if (current == ASSET_UNLOADED) {
+        state.store(ASSET_LOADING, std::memory_order_relaxed);
+        if (!async) {
+            import();
+        } else {
+            loader = std::thread(&ModelHandle::import, this);
+            return NULL;
+        }
+        current = state.load(std::memory_order_acquire);
+    }
+
+    // the import is done: the GL objects are created on this thread
+    if (current == ASSET_IMPORTED) {
+        if (loader.joinable())
+            loader.join();
+        model->upload();
+        state.store(ASSET_READY, std::memory_order_release);
+        return model;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Returns how far the model got
+ *
+ * @return AssetState
+ */
+AssetState ModelHandle::getState() const {
+    return (AssetState)state.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief Returns the file of the model
+ *
+ * @return const string&
+ */
+const string& ModelHandle::getPath() const {
+    return path;
+}
+
+/**
+ * @brief Reads the model and decodes its textures without touching GL, on whichever thread calls it
+ */
+void ModelHandle::import() {
+    Model* imported;
+    if (async) {
+        ThreadPool loaders(pool != NULL ? pool->getThreads() : 0);
+        imported = new Model(path, false, false, &loaders);
+    } else
+        imported = new Model(path, false, false, pool);
+    if (imported->meshes.empty()) {
+        delete imported;
+        state.store(ASSET_FAILED, std::memory_order_release);
+        return;
+    }
+    model = imported;
+    state.store(ASSET_IMPORTED, std::memory_order_release);
+}
+
+/**
+ * @brief Imports a model repeatedly on 1, 2, 4... threads up to the hardware's, without uploading it, after one import warming the file cache
+ *
+ * @param path File of the model
+ * @param runs Imports per thread count; the medians are kept
+ * @return vector<ImportTiming> one entry per thread count, empty if the model could not be imported
+ */
+vector<ImportTiming> benchmarkImport(const string& path, int runs) {
+    vector<ImportTiming> timings;
+    IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG | IMG_INIT_TIF);
+    {
+        Model warmup(path, false, false);
+        if (warmup.meshes.empty())
+            return timings;
+    }
+
+    int hardware = std::max(1, (int)std::thread::hardware_concurrency());
+    vector<int> counts;
+    for (int threads = 1; threads < hardware; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(hardware);
+
+    for (int threads : counts) {
+        ThreadPool pool(threads);
+        vector<double> read, process, total;
+        ImportTiming timing;
+        timing.threads = threads;
+        for (int run = 0; run < runs; run ++) {
+            auto start = std::chrono::steady_clock::now();
+            Model model(path, false, false, &pool);
+            total.push_back(elapsedMs(start));
+            read.push_back(model.readMs);
+            process.push_back(model.processMs);
+            timing.meshes = model.meshes.size();
+            timing.textures = model.textures_loaded.size();
+        }
+        std::sort(read.begin(), read.end());
+        std::sort(process.begin(), process.end());
+        std::sort(total.begin(), total.end());
+        timing.readMs = read[read.size() / 2];
+        timing.processMs = process[process.size() / 2];
+        timing.totalMs = total[total.size() / 2];
+        timings.push_back(timing);
+        LOG_INFO("assets", "Import of %s on %d threads: %.2f ms", path, threads, timing.totalMs);
+    }
+    return timings;
+}
+
+/**
+ * @brief Prints import times per thread count, with the speedup of the parallel stage and of the whole import over one thread
+ *
+ * @param path File of the model
+ * @param timings Timings from benchmarkImport
+ */
+void printImportReport(const string& path, const vector<ImportTiming>& timings) {
+    if (timings.empty()) {
+        printf("%s: could not be imported\n", path.c_str());
+        return;
+    }
+    printf("%s: %d meshes, %d textures (medians)\n", path.c_str(), timings[0].meshes, timings[0].textures);
+    printf("  %7s %10s %12s %10s %9s %9s\n", "threads", "read_ms", "process_ms", "total_ms", "process_x", "total_x");
+    for (const ImportTiming& timing : timings) {
+        printf("  %7d %10.2f %12.2f %10.2f %9.2f %9.2f\n", timing.threads, timing.readMs, timing.processMs, timing.totalMs,
+            timings[0].processMs / std::max(1e-6, timing.processMs), timings[0].totalMs / std::max(1e-6, timing.totalMs));
+    }
+}
@@ -0,0 +1,111 @@
+/**
+ * @file assets.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Asset bookkeeping and handles resolving on first use. Every file the application reads (models, textures, cubemaps, shaders) is recorded with when it was first touched and what it cost, and models are only imported once something draws them
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using std::string;
+using std::vector;
+
+// imports per thread count measured by benchmarkImport
+#define IMPORT_BENCH_RUNS 5
+
+class Model;
+class ThreadPool;
+
+enum AssetState {
+    ASSET_UNLOADED,     // not requested yet
+    ASSET_LOADING,      // being read and decoded on a loader thread
+    ASSET_IMPORTED,     // in memory, GL objects not created yet
+    ASSET_READY,
+    ASSET_FAILED
+};
+
+/**
+ * @brief One file read by the application
+ */
+struct AssetRecord {
+    string kind;        // "model", "texture", "cubemap", "shader"
+    string path;
+    AssetState state;
+    int frame;          // frame it was first touched in, 0 during startup
+    double loadMs;      // reading and decoding, summed over every load
+    double uploadMs;    // creating its GL objects
+    int loads;
+
+    AssetRecord();
+};
+
+/**
+ * @brief Process-wide record of the assets touched so far, so a run can report what it actually paid for. Safe from any thread
+ */
+class AssetLog {
+    public:
+        static AssetLog& get();
+
+        void setFrame(int frame);
+        void loaded(const string& kind, const string& path, AssetState state, double ms);
+        void uploaded(const string& kind, const string& path, double ms);
+
+        vector<AssetRecord> getRecords() const;
+        void logReport(bool startup) const;
+
+    private:
+        AssetLog();
+        AssetRecord& find(const string& kind, const string& path);
+
+        mutable std::mutex mutex;
+        vector<AssetRecord> records;    // in the order they were first touched
+        int frame;
+};
+
+/**
+ * @brief Median import time of a model on a number of threads
+ */
+struct ImportTiming {
+    int threads;
+    int meshes, textures;
+    double readMs;      // Assimp reading the file, serial
+    double processMs;   // mesh conversion and texture decodes, on the threads
+    double totalMs;
+};
+
+vector<ImportTiming> benchmarkImport(const string& path, int runs);
+void printImportReport(const string& path, const vector<ImportTiming>& timings);
+
+/**
+ * @brief A model on disk, imported the first time get() is called. Synchronous handles import and upload in that call; asynchronous ones import on a loader thread and return NULL (draw nothing in its place) until the import finished, then create the GL objects on the calling thread
+ */
+class ModelHandle {
+    public:
+        ModelHandle(const string& path, bool async, ThreadPool* pool = NULL);
+        ~ModelHandle();
+
+        Model* get();
+        AssetState getState() const;
+        const string& getPath() const;
+
+    private:
+        string path;
+        bool async;
+        ThreadPool* pool;
+        Model* model;
+        std::atomic<int> state;
+        std::thread loader;
+
+        void import();
+};
+
+#endif
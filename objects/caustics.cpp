@@ -0,0 +1,127 @@
+/**
+ * @file caustics.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Animated caustics
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "caustics.h"
+
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Construct a new CausticsMap object, dark until the first update computes it. Needs GL
+ *
+ * @param water Surface the light is refracted through (not owned)
+ * @param resolution Texels on each side of the texture, one ray each
+ * @param tile World units the texture spans before repeating; the rays are cast through this much of the surface from its corner
+ * @param depth Depth below the mean surface the rays are landed at, in world units
+ * @param rate Updates per second, 0 for every call
+ */
+CausticsMap::CausticsMap(Water* water, int resolution, float tile, float depth, float rate) : water(water), resolution(std::max(1, resolution)),
+    tile(tile > 0 ? tile : 1.0f), depth(depth), period(rate > 0 ? 1.0f / rate : 0.0f), elapsed(period) {
+    vector<unsigned int> zeros((size_t)this->resolution * this->resolution, 0);
+    accumulation.create();
+    glBindTexture(GL_TEXTURE_2D, accumulation);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, this->resolution, this->resolution);
+    accumulation.setSize(GLMEM_TEXTURE, textureBytes(this->resolution, this->resolution, 4));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, this->resolution, this->resolution, GL_RED_INTEGER, GL_UNSIGNED_INT, zeros.data());
+    countUpload(textureBytes(this->resolution, this->resolution, 4));
+    labelObject(GL_TEXTURE, accumulation, "Caustics accumulation");
+
+    caustics.create();
+    glBindTexture(GL_TEXTURE_2D, caustics);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R16F, this->resolution, this->resolution);
+    caustics.setSize(GLMEM_TEXTURE, textureBytes(this->resolution, this->resolution, 2));
+    vector<unsigned short> halfZeros((size_t)this->resolution * this->resolution, 0);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, this->resolution, this->resolution, GL_RED, GL_HALF_FLOAT, halfZeros.data());
+    countUpload(textureBytes(this->resolution, this->resolution, 2));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    labelObject(GL_TEXTURE, caustics, "Caustics");
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    WaterGrid grid = water->getGrid();
+    shader = new ComputeShader("shaders/caustics.cs");
+    shader->use();
+    shader->setInt("resolution", this->resolution);
+    shader->setFloat("tile", this->tile);
+    shader->setFloat("depth", depth);
+    shader->setFloat("fixedScale", CAUSTICS_FIXED);
+    shader->setInt("originX", grid.originX);
+    shader->setInt("originZ", grid.originZ);
+    shader->setInt("sizeX", grid.sizeX);
+    shader->setInt("sizeZ", grid.sizeZ);
+    shader->setInt("dimX", grid.dimX);
+    shader->setInt("dimZ", grid.dimZ);
+}
+
+/**
+ * @brief Destroy the CausticsMap object
+ */
+CausticsMap::~CausticsMap() {
+    delete shader;
+}
+
+/**
+ * @brief Recomputes the caustics from the surface as last evaluated, if the update period has passed. The cost of an update is
+ * fixed by the resolution. The period is in seconds, so dt must span every frame since the last call, not just the latest one
+ *
+ * @param dt Seconds since the last call
+ * @param sunDirection Direction toward the sun
+ * @return bool whether the caustics were recomputed
+ */
+bool CausticsMap::update(float dt, const glm::vec3& sunDirection) {
+    elapsed += dt;
+    if (elapsed < period)
+        return false;
+    elapsed = period > 0 ? fmodf(elapsed, period) : 0;
+
+    shader->use();
+    shader->setVec3("sunDir", sunDirection);
+    glBindImageTexture(0, accumulation, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+    glBindImageTexture(1, caustics, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, water->getVertexBuffer());
+
+    // the GPU evaluator leaves the water's buffer synchronized for drawing only
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    shader->setInt("stage", 0);
+    shader->dispatch(resolution, resolution, 1, CAUSTICS_GROUP, CAUSTICS_GROUP);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    shader->setInt("stage", 1);
+    shader->dispatch(resolution, resolution, 1, CAUSTICS_GROUP, CAUSTICS_GROUP);
+    glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+    return true;
+}
+
+/**
+ * @brief Binds the caustics for backpack.fs, which lights fragments below the mean surface with them
+ *
+ * @param shader Shader in use
+ * @param strength How much the caustics modulate submerged lighting, 0 to leave it unchanged
+ */
+void CausticsMap::bind(Shader* shader, float strength) {
+    glActiveTexture(GL_TEXTURE0 + CAUSTICS_UNIT);
+    glBindTexture(GL_TEXTURE_2D, caustics);
+    glActiveTexture(GL_TEXTURE0);
+    WaterGrid grid = water->getGrid();
+    shader->setInt("caustics", CAUSTICS_UNIT);
+    shader->setVec2("causticsOrigin", (float)grid.originX, (float)grid.originZ);
+    shader->setFloat("causticsTile", tile);
+    shader->setFloat("causticsStrength", strength);
+}
+
+/**
+ * @brief Returns the caustics texture, in its red channel
+ *
+ * @return unsigned int
+ */
+unsigned int CausticsMap::getTexture() const {
+    return caustics;
+}
@@ -0,0 +1,53 @@
+/**
+ * @file caustics.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Animated caustics. A compute pass refracts the sun through the water's normals over one tile of the surface, lands the rays on a plane below it and accumulates them into a small texture that wraps around, at a fixed rate. Submerged geometry tiles the texture over the sea floor with one fetch, so the cost does not grow with how much of the scene is underwater
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef CAUSTICS_H
+#define CAUSTICS_H
+
+#include "helper.h"
+#include "water.h"
+#include "material.h"
+
+// local size of caustics.cs, in texels on each side
+#define CAUSTICS_GROUP 8
+
+// texture unit backpack.fs samples the caustics from, past the material arrays
+#define CAUSTICS_UNIT (MATERIAL_FIRST_UNIT + MATERIAL_MAX_ARRAYS)
+
+// light gathered per ray, in units of 1 / CAUSTICS_FIXED; a flat surface lands one ray on every texel, for an intensity of 1
+#define CAUSTICS_FIXED 256.0f
+
+/**
+ * @brief Caustics under a water surface, kept in an R16F texture covering tile x tile world units and repeating beyond them
+ */
+class CausticsMap {
+    public:
+        CausticsMap(Water* water, int resolution, float tile, float depth, float rate);
+        ~CausticsMap();
+
+        bool update(float dt, const glm::vec3& sunDirection);
+        void bind(Shader* shader, float strength);
+
+        unsigned int getTexture() const;
+
+    private:
+        Water* water;       // not owned
+        int resolution;     // texels (and rays) on each side
+        float tile;         // world units the texture spans before repeating
+        float depth;        // below the mean surface, of the plane the rays are landed on
+        float period;       // seconds between updates
+        float elapsed;      // since the last update; starts at period so the first update computes the caustics
+
+        ComputeShader* shader;
+        GLTexture accumulation;     // R32UI sums of the light landed, cleared by the resolve
+        GLTexture caustics;
+};
+
+#endif
@@ -0,0 +1,622 @@
+/**
+ * @file culling.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief GPU visibility culling. HiZ builds a hierarchical depth pyramid from the previous frame, ModelInstances tests per-instance (and per-meshlet) bounds against it and compacts the survivors into indirect draws
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "culling.h"
+
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief A meshlet as cluster.cs reads it (std430)
+ */
+struct GpuCluster {
+    glm::vec4 sphere;
+    glm::vec4 cone;
+    unsigned int mesh;
+    unsigned int sourceFirst;
+    unsigned int count;
+    unsigned int pad;
+};
+
+/**
+ * @brief Construct a new HiZ object
+ *
+ * @param rx Window width
+ * @param ry Window height
+ * @param computePath Path to the pyramid reduction compute shader
+ */
+HiZ::HiZ(int rx, int ry, const char* computePath) : width(0), height(0), levels(0), viewProjection(1.0f), valid(false) {
+    shader = new ComputeShader(computePath);
+    depthFBO.create();
+    resize(rx, ry);
+}
+
+/**
+ * @brief Destroy the HiZ object
+ */
+HiZ::~HiZ() {
+    delete shader;
+}
+
+/**
+ * @brief (Re)allocates the depth copy and pyramid for a window size
+ *
+ * @param rx Window width
+ * @param ry Window height
+ */
+void HiZ::resize(int rx, int ry) {
+    width = rx;
+    height = ry;
+    levels = (int)floor(log2((float)std::max(rx, ry))) + 1;
+    valid = false;
+
+    // immutable storage cannot be resized, so both textures are recreated
+    // must match the default framebuffer's depth format for the blit (see Kernel::initSDL)
+    depthTexture.create();
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH24_STENCIL8, width, height);
+    depthTexture.setSize(GLMEM_RENDER_TARGET, textureBytes(width, height, 4));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    labelObject(GL_TEXTURE, depthTexture, "Hi-Z depth copy");
+
+    pyramid.create();
+    glBindTexture(GL_TEXTURE_2D, pyramid);
+    labelObject(GL_TEXTURE, pyramid, "Hi-Z pyramid");
+    glTexStorage2D(GL_TEXTURE_2D, levels, GL_R32F, width, height);
+    pyramid.setSize(GLMEM_RENDER_TARGET, textureBytes(width, height, 4, levels));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+    labelObject(GL_FRAMEBUFFER, depthFBO, "Hi-Z depth FBO");
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        LOG_ERROR("gl", "Hi-Z depth framebuffer is incomplete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/**
+ * @brief Copies the default framebuffer's depth and reduces it into the pyramid. Call after the frame's opaque geometry is drawn
+ *
+ * @param viewProjection View-projection the frame was rendered with
+ */
+void HiZ::capture(const glm::mat4& viewProjection) {
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthFBO);
+    glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    shader->use();
+    shader->setInt("depth", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+
+    for (int level = 0; level < levels; level ++) {
+        int w = std::max(1, width >> level);
+        int h = std::max(1, height >> level);
+
+        glBindImageTexture(0, pyramid, std::max(level - 1, 0), GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+        glBindImageTexture(1, pyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        shader->setInt("level", level);
+        shader->dispatch(w, h, 1, 8, 8);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+    }
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+    this->viewProjection = viewProjection;
+    valid = true;
+}
+
+/**
+ * @brief Construct a new ModelInstances object
+ *
+ * @param model Model drawn for every instance (not owned)
+ * @param cullShader Compiled cull.cs program (not owned)
+ * @param clusterShader Compiled cluster.cs program (not owned), or NULL to draw copies at full detail whole
+ * @param materials Valid material table of the model (not owned), or NULL to bind textures and draw each mesh separately. The
+ * meshes must draw their own vertices (not skinned copies)
+ */
+ModelInstances::ModelInstances(Model* model, ComputeShader* cullShader, ComputeShader* clusterShader, MaterialTable* materials) : model(model),
+    cullShader(cullShader), materials(materials), clusterShader(clusterShader), clusterCount(0), clusterSlots(0), meshletPass(false), cur(0), drawnClusters(0), drawnClusterTriangles(0) {
+    instanceSSBO.create();
+    visibleSSBO.create();
+    commandBuffer.create();
+    lodSSBO.create();
+    readbackBuffer.create();
+    for (int level = 0; level < MESH_LOD_LEVELS; level ++)
+        visibleCounts[level] = 0;
+
+    // meshlets of every mesh, indexing one copy of all the meshes' full-detail indices
+    vector<GpuCluster> clusters;
+    vector<unsigned int> sources;
+    if (clusterShader != NULL) {
+        for (unsigned int i = 0; i < model->meshes.size(); i ++) {
+            const Mesh& mesh = model->meshes[i];
+            meshFirst.push_back(sources.size());
+            for (const Meshlet& meshlet : mesh.meshlets) {
+                GpuCluster cluster = { glm::vec4(meshlet.center, meshlet.radius), glm::vec4(meshlet.coneAxis, meshlet.coneCutoff), i,
+                    (unsigned int)sources.size() + meshlet.firstIndex, meshlet.count, 0 };
+                clusters.push_back(cluster);
+            }
+            sources.insert(sources.end(), mesh.indices.begin(), mesh.indices.begin() + mesh.lods[0].count);
+        }
+        meshFirst.push_back(sources.size());
+        clusterCount = clusters.size();
+    }
+    if (clustered()) {
+        clusterSSBO.create();
+        sourceSSBO.create();
+        outputBuffer.create();
+        clusterCommandBuffer.create();
+        instanceIdBuffer.create();
+        statsSSBO.create();
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, clusters.size() * sizeof(GpuCluster), clusters.data(), GL_STATIC_DRAW);
+        clusterSSBO.setSize(GLMEM_STORAGE, clusters.size() * sizeof(GpuCluster));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, sourceSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sources.size() * sizeof(unsigned int), sources.data(), GL_STATIC_DRAW);
+        sourceSSBO.setSize(GLMEM_STORAGE, sources.size() * sizeof(unsigned int));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, 3 * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+        statsSSBO.setSize(GLMEM_STORAGE, 3 * sizeof(unsigned int));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        countUpload(clusters.size() * sizeof(GpuCluster) + sources.size() * sizeof(unsigned int));
+    }
+
+    // merged copies of the meshes, each starting at its first vertex and index
+    vector<unsigned int> vertexFirst, indexFirst;
+    size_t vertexCount = 0, indexCount = 0;
+    for (const Mesh& mesh : model->meshes) {
+        vertexFirst.push_back(vertexCount);
+        indexFirst.push_back(indexCount);
+        vertexCount += mesh.vertices.size();
+        indexCount += mesh.indices.size();
+    }
+    if (batched()) {
+        batchVAO.create();
+        batchVBO.create();
+        batchEBO.create();
+        drawBuffer.create();
+        glBindVertexArray(batchVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, batchVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), NULL, GL_STATIC_DRAW);
+        batchVBO.setSize(GLMEM_VERTEX, vertexCount * sizeof(Vertex));
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batchEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), NULL, GL_STATIC_DRAW);
+        batchEBO.setSize(GLMEM_INDEX, indexCount * sizeof(unsigned int));
+        for (unsigned int i = 0; i < model->meshes.size(); i ++) {
+            const Mesh& mesh = model->meshes[i];
+            glBufferSubData(GL_ARRAY_BUFFER, vertexFirst[i] * sizeof(Vertex), mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data());
+            glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexFirst[i] * sizeof(unsigned int), mesh.indices.size() * sizeof(unsigned int), mesh.indices.data());
+        }
+        countUpload(vertexCount * sizeof(Vertex) + indexCount * sizeof(unsigned int));
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+        glBindBuffer(GL_ARRAY_BUFFER, drawBuffer);
+        glEnableVertexAttribArray(4);
+        glVertexAttribIPointer(4, 2, GL_UNSIGNED_INT, 2 * sizeof(unsigned int), (void*)0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        labelObject(GL_VERTEX_ARRAY, batchVAO, model->directory + " batch VAO");
+        labelObject(GL_BUFFER, batchVBO, model->directory + " batch VBO");
+        labelObject(GL_BUFFER, batchEBO, model->directory + " batch EBO");
+        labelObject(GL_BUFFER, drawBuffer, model->directory + " batch draws");
+    }
+
+    // one command per level and mesh, level-major, drawing the level's range of the mesh's indices; instanceCount is filled by the cull pass.
+    // Batched, commands index the merged copies and their baseInstance is their own index
+    vector<DrawElementsIndirectCommand> commands;
+    for (int level = 0; level < MESH_LOD_LEVELS; level ++) {
+        for (unsigned int i = 0; i < model->meshes.size(); i ++) {
+            const MeshLod& lod = model->meshes[i].lods[level];
+            DrawElementsIndirectCommand command = { lod.count, 0, lod.firstIndex, 0, 0 };
+            if (batched()) {
+                command.firstIndex += indexFirst[i];
+                command.baseVertex = vertexFirst[i];
+                command.baseInstance = commands.size();
+            }
+            commands.push_back(command);
+        }
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW);
+    commandBuffer.setSize(GLMEM_STORAGE, commands.size() * sizeof(DrawElementsIndirectCommand));
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, GPU_QUERY_LATENCY * CULL_READBACK_VALUES * sizeof(unsigned int), NULL, GL_STREAM_READ);
+    readbackBuffer.setSize(GLMEM_STORAGE, GPU_QUERY_LATENCY * CULL_READBACK_VALUES * sizeof(unsigned int));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // allocates the instance buffers so they exist as objects before being labelled
+    setTransforms(vector<glm::mat4>());
+
+    labelObject(GL_BUFFER, instanceSSBO, model->directory + " instances");
+    labelObject(GL_BUFFER, visibleSSBO, model->directory + " visible instances");
+    labelObject(GL_BUFFER, commandBuffer, model->directory + " indirect commands");
+    labelObject(GL_BUFFER, lodSSBO, model->directory + " instance levels");
+    labelObject(GL_BUFFER, readbackBuffer, model->directory + " visible count readback");
+
+    // each mesh draws its compacted lists through a vertex array of its own, sharing its vertex buffer
+    if (clustered()) {
+        for (const Mesh& mesh : model->meshes) {
+            GLVertexArray vao;
+            vao.create();
+            glBindVertexArray(vao);
+            mesh.bindVertexAttributes();
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outputBuffer);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceIdBuffer);
+            glEnableVertexAttribArray(3);
+            glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(unsigned int), (void*)0);
+            glVertexAttribDivisor(3, 1);
+            glBindVertexArray(0);
+            labelObject(GL_VERTEX_ARRAY, vao, mesh.name + " cluster VAO");
+            clusterVAOs.push_back(std::move(vao));
+        }
+        labelObject(GL_BUFFER, clusterSSBO, model->directory + " meshlets");
+        labelObject(GL_BUFFER, sourceSSBO, model->directory + " meshlet indices");
+        labelObject(GL_BUFFER, outputBuffer, model->directory + " compacted meshlet indices");
+        labelObject(GL_BUFFER, clusterCommandBuffer, model->directory + " meshlet commands");
+        labelObject(GL_BUFFER, instanceIdBuffer, model->directory + " meshlet draw slots");
+        labelObject(GL_BUFFER, statsSSBO, model->directory + " meshlet counters");
+    }
+
+    for (int i = 0; i < GPU_QUERY_LATENCY; i ++)
+        fences[i] = 0;
+}
+
+/**
+ * @brief Destroy the ModelInstances object
+ */
+ModelInstances::~ModelInstances() {
+    for (int i = 0; i < GPU_QUERY_LATENCY; i ++) {
+        if (fences[i])
+            glDeleteSync(fences[i]);
+    }
+}
+
+/**
+ * @brief Replaces the set of instances, which start at the full level of detail
+ *
+ * @param transforms Model matrix of each instance
+ */
+void ModelInstances::setTransforms(const vector<glm::mat4>& transforms) {
+    this->transforms = transforms;
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max((size_t)1, transforms.size()) * sizeof(glm::mat4), transforms.empty() ? NULL : transforms.data(), GL_STATIC_DRAW);
+    instanceSSBO.setSize(GLMEM_STORAGE, std::max((size_t)1, transforms.size()) * sizeof(glm::mat4));
+    // visible instances are compacted into one section per level, after the meshlet slots (see visibleFirst)
+    clusterSlots = clustered() ? std::max((size_t)1, std::min(transforms.size(), (size_t)CLUSTER_MAX_SLOTS)) : 0;
+    size_t visibleSize = clusterSlots + std::max((size_t)1, transforms.size()) * MESH_LOD_LEVELS;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, visibleSize * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+    visibleSSBO.setSize(GLMEM_STORAGE, visibleSize * sizeof(unsigned int));
+    vector<unsigned int> levels(std::max((size_t)1, transforms.size()), 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, lodSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, levels.size() * sizeof(unsigned int), levels.data(), GL_DYNAMIC_DRAW);
+    lodSSBO.setSize(GLMEM_STORAGE, levels.size() * sizeof(unsigned int));
+
+    // every mesh gets a section of compacted indices, and a command drawing it, per slot; a command's baseInstance is its slot. The
+    // slots are capped so the lists stay a few copies of the model however many instances there are
+    if (clustered()) {
+        size_t slots = clusterSlots;
+        clusterCommands.clear();
+        for (unsigned int i = 0; i + 1 < meshFirst.size(); i ++) {
+            for (size_t slot = 0; slot < slots; slot ++) {
+                DrawElementsIndirectCommand command = { 0, 1, (unsigned int)(slots * meshFirst[i] + slot * (meshFirst[i + 1] - meshFirst[i])), 0, (unsigned int)slot };
+                clusterCommands.push_back(command);
+            }
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, outputBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, slots * meshFirst.back() * sizeof(unsigned int), NULL, GL_DYNAMIC_DRAW);
+        outputBuffer.setSize(GLMEM_INDEX, slots * meshFirst.back() * sizeof(unsigned int));
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterCommandBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, clusterCommands.size() * sizeof(DrawElementsIndirectCommand), clusterCommands.data(), GL_DYNAMIC_DRAW);
+        clusterCommandBuffer.setSize(GLMEM_STORAGE, clusterCommands.size() * sizeof(DrawElementsIndirectCommand));
+
+        vector<unsigned int> ids(slots);
+        for (size_t slot = 0; slot < slots; slot ++)
+            ids[slot] = slot;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceIdBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, ids.size() * sizeof(unsigned int), ids.data(), GL_STATIC_DRAW);
+        instanceIdBuffer.setSize(GLMEM_VERTEX, ids.size() * sizeof(unsigned int));
+    }
+
+    // each command's material and section of the visible list; with a divisor of at least the instance count, every instance of a
+    // command reads the entry at its baseInstance
+    if (batched()) {
+        vector<glm::uvec2> draws;
+        for (int level = 0; level < MESH_LOD_LEVELS; level ++) {
+            for (unsigned int i = 0; i < model->meshes.size(); i ++)
+                draws.push_back(glm::uvec2(materials->getMaterial(i), visibleFirst(level)));
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, drawBuffer);
+        glBufferData(GL_ARRAY_BUFFER, draws.size() * sizeof(glm::uvec2), draws.data(), GL_STATIC_DRAW);
+        drawBuffer.setSize(GLMEM_VERTEX, draws.size() * sizeof(glm::uvec2));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(batchVAO);
+        glVertexAttribDivisor(4, std::max((size_t)1, transforms.size()));
+        glBindVertexArray(0);
+    }
+    countUpload(transforms.size() * sizeof(glm::mat4));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/**
+ * @brief Tests every instance against a frustum and, optionally, a Hi-Z pyramid; visible instances are compacted by level of detail for draw()
+ *
+ * @param frustum Frustum of the pass about to draw the instances
+ * @param occluder Depth pyramid of the previous frame, or NULL for frustum culling only (e.g. mirrored passes)
+ * @param lod Camera levels are picked for (see selectLod, which cull.cs mirrors)
+ * @param mainView Whether this is the main view, the only one whose full-detail copies are culled by meshlet (spending the
+ * CLUSTER_MAX_SLOTS budget) and whose counts report() publishes; other views draw their full-detail copies whole
+ */
+void ModelInstances::cull(const Frustum& frustum, HiZ* occluder, const LodView& lod, bool mainView) {
+    unsigned int zero = 0;
+    size_t meshCount = model->meshes.size();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    for (int level = 0; level < MESH_LOD_LEVELS; level ++)
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, level * meshCount * sizeof(DrawElementsIndirectCommand) + offsetof(DrawElementsIndirectCommand, instanceCount), sizeof(unsigned int), &zero);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    meshletPass = clustered() && mainView;
+    if (meshletPass) {
+        unsigned int zeros[3] = { 0, 0, 0 };
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, statsSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(zeros), zeros);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+
+    if (transforms.empty())
+        return;
+
+    cullShader->use();
+    glUniform1ui(glGetUniformLocation(cullShader->ID, "instanceCount"), (unsigned int)transforms.size());
+    cullShader->setVec3("boundsMin", model->boundsMin);
+    cullShader->setVec3("boundsMax", model->boundsMax);
+    for (int i = 0; i < 6; i ++)
+        cullShader->setVec4("frustum[" + std::to_string(i) + "]", frustum.planes[i]);
+    glUniform1ui(glGetUniformLocation(cullShader->ID, "meshCount"), (unsigned int)meshCount);
+    glUniform1ui(glGetUniformLocation(cullShader->ID, "clusterSlots"), (unsigned int)clusterSlots);
+    cullShader->setBool("meshlets", meshletPass);
+    for (int level = 0; level < MESH_LOD_LEVELS; level ++)
+        cullShader->setFloat("lodErrors[" + std::to_string(level) + "]", model->lodErrors[level]);
+    cullShader->setVec3("cameraPosition", lod.position);
+    cullShader->setFloat("pixelsPerUnit", lod.pixelsPerUnit);
+    cullShader->setFloat("lodThreshold", lod.threshold);
+    cullShader->setBool("lodUpdate", lod.update);
+
+    bool useHiZ = occluder != NULL && occluder->valid;
+    cullShader->setBool("useHiZ", useHiZ);
+    if (useHiZ) {
+        cullShader->setInt("hiz", 0);
+        cullShader->setMat4("hizViewProjection", occluder->viewProjection);
+        cullShader->setVec2("hizSize", (float)occluder->width, (float)occluder->height);
+        cullShader->setInt("hizLevels", occluder->levels);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, occluder->pyramid);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, lodSSBO);
+    if (meshletPass)
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, statsSSBO);
+    cullShader->dispatch(transforms.size(), 1, 1, 64);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+
+    // every mesh of a level draws the same visible set
+    glBindBuffer(GL_COPY_READ_BUFFER, commandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+    for (int level = 0; level < MESH_LOD_LEVELS; level ++) {
+        size_t first = level * meshCount * sizeof(DrawElementsIndirectCommand) + offsetof(DrawElementsIndirectCommand, instanceCount);
+        for (unsigned int i = 1; i < meshCount; i ++)
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, first, first + i * sizeof(DrawElementsIndirectCommand), sizeof(unsigned int));
+    }
+
+    if (meshletPass)
+        cullClusters(frustum, occluder, lod.position);
+
+    // only one view's counts go through the delayed readback, so the ring advances once per frame and the counters describe that view
+    if (mainView)
+        queueReadback();
+}
+
+/**
+ * @brief Collects the counts of the frame GPU_QUERY_LATENCY frames ago if they have arrived, then queues the ones of the cull just
+ * run
+ */
+void ModelInstances::queueReadback() {
+    size_t meshCount = model->meshes.size();
+    glBindBuffer(GL_COPY_READ_BUFFER, commandBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer);
+    if (fences[cur]) {
+        GLenum state = glClientWaitSync(fences[cur], 0, 0);
+        if (state == GL_ALREADY_SIGNALED || state == GL_CONDITION_SATISFIED) {
+            unsigned int counts[CULL_READBACK_VALUES];
+            glGetBufferSubData(GL_COPY_WRITE_BUFFER, cur * sizeof(counts), sizeof(counts), counts);
+            for (int level = 0; level < MESH_LOD_LEVELS; level ++)
+                visibleCounts[level] = counts[level];
+            // level 0's command only counts the full-detail instances drawn whole
+            if (clustered()) {
+                visibleCounts[0] = counts[MESH_LOD_LEVELS];
+                drawnClusters = counts[MESH_LOD_LEVELS + 1];
+                drawnClusterTriangles = counts[MESH_LOD_LEVELS + 2];
+            }
+        }
+        glDeleteSync(fences[cur]);
+    }
+    for (int level = 0; level < MESH_LOD_LEVELS; level ++) {
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, level * meshCount * sizeof(DrawElementsIndirectCommand) + offsetof(DrawElementsIndirectCommand, instanceCount),
+            (cur * CULL_READBACK_VALUES + level) * sizeof(unsigned int), sizeof(unsigned int));
+    }
+    if (clustered()) {
+        glBindBuffer(GL_COPY_READ_BUFFER, statsSSBO);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, (cur * CULL_READBACK_VALUES + MESH_LOD_LEVELS) * sizeof(unsigned int), 3 * sizeof(unsigned int));
+    }
+    fences[cur] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    cur = (cur + 1) % GPU_QUERY_LATENCY;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * @brief Culls the meshlets of the instances cull.cs gave a slot at full detail, compacting the indices of the survivors. Runs
+ * after the instance pass, reading its full-detail count and visible list
+ *
+ * @param frustum Frustum of the pass
+ * @param occluder Depth pyramid of the previous frame, or NULL
+ * @param camera Position the pass is seen from, for the normal cones
+ */
+void ModelInstances::cullClusters(const Frustum& frustum, HiZ* occluder, const glm::vec3& camera) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, clusterCommandBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, clusterCommands.size() * sizeof(DrawElementsIndirectCommand), clusterCommands.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    clusterShader->use();
+    glUniform1ui(glGetUniformLocation(clusterShader->ID, "clusterCount"), clusterCount);
+    glUniform1ui(glGetUniformLocation(clusterShader->ID, "slotCount"), (unsigned int)clusterSlots);
+    clusterShader->setVec3("cameraPosition", camera);
+    for (int i = 0; i < 6; i ++)
+        clusterShader->setVec4("frustum[" + std::to_string(i) + "]", frustum.planes[i]);
+
+    bool useHiZ = occluder != NULL && occluder->valid;
+    clusterShader->setBool("useHiZ", useHiZ);
+    if (useHiZ) {
+        clusterShader->setInt("hiz", 0);
+        clusterShader->setMat4("hizViewProjection", occluder->viewProjection);
+        clusterShader->setVec2("hizSize", (float)occluder->width, (float)occluder->height);
+        clusterShader->setInt("hizLevels", occluder->levels);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, occluder->pyramid);
+    }
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, clusterSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, sourceSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, outputBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, clusterCommandBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, statsSSBO);
+    clusterShader->dispatch(clusterCount, clusterSlots, 1, 64);
+    glMemoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+/**
+ * @brief Returns whether copies at full detail are culled by meshlet
+ *
+ * @return bool
+ */
+bool ModelInstances::clustered() const {
+    return clusterShader != NULL && clusterCount > 0;
+}
+
+/**
+ * @brief Returns whether every level and mesh is drawn by one multi-draw, with materials from a table
+ *
+ * @return bool
+ */
+bool ModelInstances::batched() const {
+    return materials != NULL;
+}
+
+/**
+ * @brief Returns where a level's instances drawn whole start in the visible list. The full-detail instances holding a meshlet slot
+ * come before every level, drawn by the clustered commands instead; the offsets are the same whether or not a pass culls meshlets
+ *
+ * @param level Level of detail
+ * @return unsigned int
+ */
+unsigned int ModelInstances::visibleFirst(int level) const {
+    return clusterSlots + level * std::max((size_t)1, transforms.size());
+}
+
+/**
+ * @brief Draws the instances that survived the last cull()
+ *
+ * @param shader Shader supporting the instanced path of backpack.vs
+ */
+void ModelInstances::draw(Shader* shader) {
+    shader->setBool("instanced", true);
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleSSBO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    size_t meshCount = model->meshes.size();
+    if (batched()) {
+        materials->bind(shader);
+        glBindVertexArray(batchVAO);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, MESH_LOD_LEVELS * meshCount, 0);
+        countDrawCalls();
+        glBindVertexArray(0);
+    } else {
+        // the meshes' vertex arrays leave attribute 4 disabled, so draws read its current value
+        for (int level = 0; level < MESH_LOD_LEVELS; level ++) {
+            glVertexAttribI2ui(4, 0, visibleFirst(level));
+            for (unsigned int i = 0; i < meshCount; i ++)
+                model->meshes[i].drawIndirect(shader, (level * meshCount + i) * sizeof(DrawElementsIndirectCommand));
+        }
+    }
+
+    // the first full-detail instances draw their compacted meshlets, one command per slot (those past the count draw nothing)
+    if (meshletPass && !transforms.empty()) {
+        shader->setBool("clustered", true);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, clusterCommandBuffer);
+        for (unsigned int i = 0; i < model->meshes.size(); i ++) {
+            if (!batched())
+                bindMaterialTextures(shader, model->meshes[i].textures);
+            glVertexAttribI2ui(4, batched() ? materials->getMaterial(i) : 0, 0);
+            glBindVertexArray(clusterVAOs[i]);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(i * clusterSlots * sizeof(DrawElementsIndirectCommand)), clusterSlots, 0);
+            countDrawCalls();
+        }
+        glBindVertexArray(0);
+        shader->setBool("clustered", false);
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glVertexAttribI2ui(4, 0, 0);
+
+    shader->setBool("materialTable", false);
+    shader->setBool("instanced", false);
+}
+
+/**
+ * @brief Publishes instance and (delayed) visible counts, in total and per level of detail, and the meshlets drawn when culling them
+ *
+ * @param profiler Profiler receiving the counters of the current frame
+ */
+void ModelInstances::report(Profiler* profiler) {
+    int visible = 0;
+    for (int level = 0; level < MESH_LOD_LEVELS; level ++) {
+        visible += visibleCounts[level];
+        profiler->setCounter("culling.lod" + std::to_string(level), visibleCounts[level]);
+    }
+    profiler->setCounter("culling.instances", transforms.size());
+    profiler->setCounter("culling.visible", visible);
+    if (clustered()) {
+        profiler->setCounter("culling.meshlets", clusterCount * std::min((size_t)visibleCounts[0], clusterSlots));
+        profiler->setCounter("culling.meshlets_drawn", drawnClusters);
+        profiler->setCounter("culling.meshlet_triangles", drawnClusterTriangles);
+    }
+}
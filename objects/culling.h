@@ -0,0 +1,106 @@
+/**
+ * @file culling.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief GPU visibility culling. HiZ builds a hierarchical depth pyramid from the previous frame, ModelInstances tests per-instance (and per-meshlet) bounds against it and compacts the survivors into indirect draws
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "helper.h"
+#include "material.h"
+#include "../kernel/profiler.h"
+
+// values read back per frame by ModelInstances: the visible instances of each level, then the instances kept at full detail, the
+// drawn clusters and their triangles
+#define CULL_READBACK_VALUES (MESH_LOD_LEVELS + 3)
+
+// full-detail instances culled by meshlet at most; the compacted index lists are sized for this many copies of the model, and
+// full-detail instances past it are drawn whole
+#define CLUSTER_MAX_SLOTS 16
+
+/**
+ * @brief Hierarchical-Z pyramid. Level 0 is a copy of the depth buffer, each further level keeps the farthest depth of the texels it covers
+ */
+class HiZ {
+    public:
+        GLTexture pyramid;          // R32F texture with a full mip chain
+        int width, height, levels;
+        glm::mat4 viewProjection;   // view-projection the pyramid's depth was rendered with
+        bool valid;                 // false until a frame has been captured
+
+        HiZ(int rx, int ry, const char* computePath);
+        ~HiZ();
+
+        void resize(int rx, int ry);
+        void capture(const glm::mat4& viewProjection);
+
+    private:
+        GLFramebuffer depthFBO;
+        GLTexture depthTexture;
+        ComputeShader* shader;
+};
+
+/**
+ * @brief Many transformed copies of a Model, culled on the GPU and drawn with one indirect draw per mesh and level of detail. The cull pass also picks each copy's level, keeping it from frame to frame for hysteresis.
+ * With a cluster shader, the main view's first copies at full detail are culled further meshlet by meshlet (frustum, back-facing normal cone, Hi-Z); the survivors' triangles are compacted into an index list per mesh and copy, drawn with one multi-draw per mesh.
+ * With a material table, every level of every mesh is drawn by a single multi-draw over merged copies of the meshes' vertices and indices, each command reading its material and section of the visible list as a per-draw attribute
+ */
+class ModelInstances {
+    public:
+        Model* model;
+        vector<glm::mat4> transforms;
+
+        ModelInstances(Model* model, ComputeShader* cullShader, ComputeShader* clusterShader = NULL, MaterialTable* materials = NULL);
+        ~ModelInstances();
+
+        void setTransforms(const vector<glm::mat4>& transforms);
+
+        void cull(const Frustum& frustum, HiZ* occluder, const LodView& lod, bool mainView);
+        void draw(Shader* shader);
+
+        void report(Profiler* profiler);
+
+    private:
+        ComputeShader* cullShader;
+        GLBuffer instanceSSBO, visibleSSBO, commandBuffer;
+        GLBuffer lodSSBO;   // level each instance was last drawn at
+
+        // batching (unused without a material table): every mesh's vertices and indices in one buffer each, and the material and
+        // visible offset of each command, read at its baseInstance through attribute 4
+        MaterialTable* materials;
+        GLVertexArray batchVAO;
+        GLBuffer batchVBO, batchEBO, drawBuffer;
+
+        // meshlet culling (unused without a cluster shader or meshlets): bounds of every meshlet and a copy of the full-detail
+        // indices they index, the compacted index lists (one section per mesh and slot) with their draw commands, and the vertex
+        // arrays drawing each mesh from them; instanceIdBuffer feeds each draw's baseInstance to the vertex shader as its slot.
+        // statsSSBO counts the instances kept at full detail, then the drawn clusters and their triangles
+        ComputeShader* clusterShader;
+        unsigned int clusterCount;
+        size_t clusterSlots;    // min(instances, CLUSTER_MAX_SLOTS), 0 when not clustered
+        bool meshletPass;       // whether the last cull() culled meshlets, which only the main view does
+        GLBuffer clusterSSBO, sourceSSBO, outputBuffer, clusterCommandBuffer, instanceIdBuffer, statsSSBO;
+        vector<GLVertexArray> clusterVAOs;
+        vector<DrawElementsIndirectCommand> clusterCommands;
+        vector<unsigned int> meshFirst;     // full-detail indices of the meshes before each
+
+        // delayed readback of CULL_READBACK_VALUES for the main view, so reporting them never stalls
+        GLBuffer readbackBuffer;
+        GLsync fences[GPU_QUERY_LATENCY];
+        int cur;
+        int visibleCounts[MESH_LOD_LEVELS];
+        int drawnClusters, drawnClusterTriangles;
+
+        bool clustered() const;
+        bool batched() const;
+        unsigned int visibleFirst(int level) const;
+        void queueReadback();
+        void cullClusters(const Frustum& frustum, HiZ* occluder, const glm::vec3& camera);
+};
+
+#endif
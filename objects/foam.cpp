@@ -0,0 +1,121 @@
+/**
+ * @file foam.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Accumulated foam coverage
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "foam.h"
+
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Construct a new FoamMap object with no foam yet. Needs GL
+ *
+ * @param water Surface the foam lies on (not owned)
+ * @param resolution Texels on each side of the map, which spans the water grid
+ * @param threshold Slope (|grad H|) above which foam is added
+ * @param gain Coverage added per second per unit of slope above the threshold
+ * @param decay Rate of the exponential decay, per second
+ * @param drift World units per second the foam is carried by
+ */
+FoamMap::FoamMap(Water* water, int resolution, float threshold, float gain, float decay, glm::vec2 drift) : water(water), resolution(std::max(1, resolution)),
+    threshold(threshold), gain(gain), decay(decay), drift(drift), cur(0) {
+    vector<unsigned short> zeros((size_t)this->resolution * this->resolution, 0);
+    for (int i = 0; i < 2; i ++) {
+        coverage[i].create();
+        glBindTexture(GL_TEXTURE_2D, coverage[i]);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R16F, this->resolution, this->resolution);
+        coverage[i].setSize(GLMEM_TEXTURE, textureBytes(this->resolution, this->resolution, 2));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, this->resolution, this->resolution, GL_RED, GL_HALF_FLOAT, zeros.data());
+        countUpload(textureBytes(this->resolution, this->resolution, 2));
+
+        // foam drifting in from past the edges of the water is none
+        float border[4] = { 0, 0, 0, 0 };
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, border);
+        labelObject(GL_TEXTURE, coverage[i], "Foam coverage " + std::to_string(i));
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    WaterGrid grid = water->getGrid();
+    shader = new ComputeShader("shaders/foam.cs");
+    shader->use();
+    shader->setInt("previous", 0);
+    shader->setInt("resolution", this->resolution);
+    shader->setFloat("threshold", threshold);
+    shader->setFloat("gain", gain);
+    shader->setInt("originX", grid.originX);
+    shader->setInt("originZ", grid.originZ);
+    shader->setInt("sizeX", grid.sizeX);
+    shader->setInt("sizeZ", grid.sizeZ);
+    shader->setInt("dimX", grid.dimX);
+    shader->setInt("dimZ", grid.dimZ);
+}
+
+/**
+ * @brief Destroy the FoamMap object
+ */
+FoamMap::~FoamMap() {
+    delete shader;
+}
+
+/**
+ * @brief Advances the coverage by dt from the surface as last evaluated, into the other texture. Decay, drift and gain are rates per
+ * second, so dt must span every frame since the last call, not just the latest one
+ *
+ * @param dt Seconds since the last update
+ */
+void FoamMap::update(float dt) {
+    WaterGrid grid = water->getGrid();
+    shader->use();
+    shader->setFloat("dt", dt);
+    shader->setFloat("keep", exp(-decay * dt));
+    shader->setVec2("offset", drift.x * dt / grid.sizeX, drift.y * dt / grid.sizeZ);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, coverage[cur]);
+    glBindImageTexture(0, coverage[1 - cur], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R16F);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, water->getVertexBuffer());
+
+    // the GPU evaluator leaves the water's buffer synchronized for drawing only
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    shader->dispatch(resolution, resolution, 1, FOAM_GROUP, FOAM_GROUP);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+    cur = 1 - cur;
+}
+
+/**
+ * @brief Returns the texture holding the latest coverage, in its red channel
+ *
+ * @return unsigned int
+ */
+unsigned int FoamMap::getTexture() const {
+    return coverage[cur];
+}
+
+/**
+ * @brief Returns the world x and z of the map's corner at texture coordinates (0, 0)
+ *
+ * @return glm::vec2
+ */
+glm::vec2 FoamMap::getOrigin() const {
+    WaterGrid grid = water->getGrid();
+    return glm::vec2(grid.originX, grid.originZ);
+}
+
+/**
+ * @brief Returns the world extent of the map along x and z
+ *
+ * @return glm::vec2
+ */
+glm::vec2 FoamMap::getSize() const {
+    WaterGrid grid = water->getGrid();
+    return glm::vec2(grid.sizeX, grid.sizeZ);
+}
@@ -0,0 +1,47 @@
+/**
+ * @file foam.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Accumulated foam coverage. A texture spanning the water grid in world space is advanced on every water update by a compute pass: last update's coverage is advected by a drift, decays exponentially, and gains foam wherever the surface is steeper than a threshold. water.fs reads it with a single fetch, so the foam costs the same however the surface is drawn
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef FOAM_H
+#define FOAM_H
+
+#include "helper.h"
+#include "water.h"
+
+// local size of foam.cs, in texels on each side
+#define FOAM_GROUP 8
+
+/**
+ * @brief Foam coverage in [0, 1] over a water surface, kept in two R16F textures written alternately
+ */
+class FoamMap {
+    public:
+        FoamMap(Water* water, int resolution, float threshold, float gain, float decay, glm::vec2 drift);
+        ~FoamMap();
+
+        void update(float dt);
+
+        unsigned int getTexture() const;
+        glm::vec2 getOrigin() const;
+        glm::vec2 getSize() const;
+
+    private:
+        Water* water;       // not owned
+        int resolution;     // texels on each side
+        float threshold;    // slope (|grad H|) above which foam is added
+        float gain;         // coverage added per second per unit of slope above the threshold
+        float decay;        // fraction of coverage lost per second is 1 - exp(-decay)
+        glm::vec2 drift;    // world units per second the foam is carried by
+
+        ComputeShader* shader;
+        GLTexture coverage[2];
+        int cur;            // texture holding the latest coverage
+};
+
+#endif
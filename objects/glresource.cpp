@@ -0,0 +1,305 @@
+/**
+ * @file glresource.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Move-only owning handles for GL objects, and a registry that tracks every live object and the video memory it holds per category
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "glresource.h"
+#include "../kernel/profiler.h"
+
+#include "../kernel/log.h"
+
+#define MIB (1024.0 * 1024.0)
+
+/**
+ * @brief Creates one object of a namespace
+ *
+ * @param identifier GL_BUFFER, GL_VERTEX_ARRAY, GL_TEXTURE, GL_FRAMEBUFFER, GL_RENDERBUFFER, GL_PROGRAM or GL_QUERY
+ * @return GLuint name of the new object, 0 for an unknown namespace
+ */
+GLuint createGLObject(GLenum identifier) {
+    GLuint name = 0;
+    switch (identifier) {
+        case GL_BUFFER:         glGenBuffers(1, &name); break;
+        case GL_VERTEX_ARRAY:   glGenVertexArrays(1, &name); break;
+        case GL_TEXTURE:        glGenTextures(1, &name); break;
+        case GL_FRAMEBUFFER:    glGenFramebuffers(1, &name); break;
+        case GL_RENDERBUFFER:   glGenRenderbuffers(1, &name); break;
+        case GL_PROGRAM:        name = glCreateProgram(); break;
+        case GL_QUERY:          glGenQueries(1, &name); break;
+    }
+    return name;
+}
+
+/**
+ * @brief Deletes one object of a namespace
+ *
+ * @param identifier Namespace given to createGLObject
+ * @param name Object name
+ */
+void destroyGLObject(GLenum identifier, GLuint name) {
+    switch (identifier) {
+        case GL_BUFFER:         glDeleteBuffers(1, &name); break;
+        case GL_VERTEX_ARRAY:   glDeleteVertexArrays(1, &name); break;
+        case GL_TEXTURE:        glDeleteTextures(1, &name); break;
+        case GL_FRAMEBUFFER:    glDeleteFramebuffers(1, &name); break;
+        case GL_RENDERBUFFER:   glDeleteRenderbuffers(1, &name); break;
+        case GL_PROGRAM:        glDeleteProgram(name); break;
+        case GL_QUERY:          glDeleteQueries(1, &name); break;
+    }
+}
+
+/**
+ * @brief Returns the registry shared by all handles
+ *
+ * @return GLResourceRegistry&
+ */
+GLResourceRegistry& GLResourceRegistry::get() {
+    static GLResourceRegistry registry;
+    return registry;
+}
+
+/**
+ * @brief Construct a new GLResourceRegistry object
+ */
+GLResourceRegistry::GLResourceRegistry() : budget((size_t)VRAM_BUDGET_MB * 1024 * 1024), warned(false) {
+    for (int i = 0; i < GLMEM_CATEGORY_COUNT; i ++)
+        bytes[i] = 0;
+}
+
+/**
+ * @brief Starts tracking a new object
+ *
+ * @param identifier Object namespace
+ * @param name Object name
+ */
+void GLResourceRegistry::add(GLenum identifier, GLuint name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry entry = { GLMEM_NONE, 0, string() };
+    objects[std::make_pair(identifier, name)] = entry;
+}
+
+/**
+ * @brief Stops tracking an object and releases the bytes it held
+ *
+ * @param identifier Object namespace
+ * @param name Object name
+ */
+void GLResourceRegistry::remove(GLenum identifier, GLuint name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = objects.find(std::make_pair(identifier, name));
+    if (it == objects.end())
+        return;
+
+    bytes[it->second.category] -= it->second.bytes;
+    objects.erase(it);
+    if (budget && getTotalBytesLocked() <= budget)
+        warned = false;
+}
+
+/**
+ * @brief Remembers the label of a tracked object for reports. Untracked objects are ignored
+ *
+ * @param identifier Object namespace
+ * @param name Object name
+ * @param label Human-readable label
+ */
+void GLResourceRegistry::setLabel(GLenum identifier, GLuint name, const string& label) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = objects.find(std::make_pair(identifier, name));
+    if (it != objects.end())
+        it->second.label = label;
+}
+
+/**
+ * @brief Records the storage held by a tracked object, replacing its previous size
+ *
+ * @param identifier Object namespace
+ * @param name Object name
+ * @param category What the storage is used for
+ * @param size Bytes held
+ */
+void GLResourceRegistry::setSize(GLenum identifier, GLuint name, GLMemoryCategory category, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = objects.find(std::make_pair(identifier, name));
+    if (it == objects.end())
+        return;
+
+    bytes[it->second.category] -= it->second.bytes;
+    it->second.category = category;
+    it->second.bytes = size;
+    bytes[category] += size;
+    checkBudget();
+}
+
+/**
+ * @brief Returns the bytes held by live objects of one category
+ *
+ * @param category Category
+ * @return size_t
+ */
+size_t GLResourceRegistry::getBytes(GLMemoryCategory category) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bytes[category];
+}
+
+/**
+ * @brief Returns the bytes held by all live objects
+ *
+ * @return size_t
+ */
+size_t GLResourceRegistry::getTotalBytes() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return getTotalBytesLocked();
+}
+
+/**
+ * @brief Returns the number of live objects
+ *
+ * @return int
+ */
+int GLResourceRegistry::getObjectCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return (int)objects.size();
+}
+
+/**
+ * @brief Sets the video memory budget. Allocations that push the total over it log a warning once per excursion
+ *
+ * @param bytes Budget in bytes, 0 to disable
+ */
+void GLResourceRegistry::setBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = bytes;
+    warned = false;
+    checkBudget();
+}
+
+/**
+ * @brief Returns the video memory budget
+ *
+ * @return size_t bytes, 0 if disabled
+ */
+size_t GLResourceRegistry::getBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget;
+}
+
+/**
+ * @brief Whether live objects currently hold more than the budget
+ *
+ * @return bool
+ */
+bool GLResourceRegistry::overBudget() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget && getTotalBytesLocked() > budget;
+}
+
+/**
+ * @brief Publishes memory use as counters of the current frame
+ *
+ * @param profiler Profiler receiving the counters
+ */
+void GLResourceRegistry::report(Profiler* profiler) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (int i = GLMEM_NONE + 1; i < GLMEM_CATEGORY_COUNT; i ++)
+        profiler->setCounter(string("vram.") + categoryName((GLMemoryCategory)i), bytes[i] / MIB);
+    profiler->setCounter("vram.total", getTotalBytesLocked() / MIB);
+    profiler->setCounter("vram.budget", budget / MIB);
+    profiler->setCounter("vram.objects", (double)objects.size());
+}
+
+/**
+ * @brief Logs memory use per category
+ */
+void GLResourceRegistry::logSummary() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    LOG_INFO("vram", "GL resources: %d objects, %.2f MiB (budget %.0f MiB)", (int)objects.size(), getTotalBytesLocked() / MIB, budget / MIB);
+    for (int i = GLMEM_NONE + 1; i < GLMEM_CATEGORY_COUNT; i ++)
+        LOG_INFO("vram", "  %-14s %8.2f MiB", categoryName((GLMemoryCategory)i), bytes[i] / MIB);
+}
+
+/**
+ * @brief Logs every object still alive. Call once all owners have been destroyed, before the context is
+ *
+ * @return int number of leaked objects
+ */
+int GLResourceRegistry::checkLeaks() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& it : objects) {
+        const Entry& entry = it.second;
+        LOG_WARN("vram", "GL leak: %s %u \"%s\" (%s, %lu bytes)", identifierName(it.first.first), it.first.second,
+            entry.label, categoryName(entry.category), (unsigned long)entry.bytes);
+    }
+    if (!objects.empty())
+        LOG_WARN("vram", "GL resources: %d objects leaked, %.2f MiB", (int)objects.size(), getTotalBytesLocked() / MIB);
+    return (int)objects.size();
+}
+
+/**
+ * @brief Short name of a memory category
+ *
+ * @param category Category
+ * @return const char*
+ */
+const char* GLResourceRegistry::categoryName(GLMemoryCategory category) {
+    switch (category) {
+        case GLMEM_VERTEX:          return "vertex";
+        case GLMEM_INDEX:           return "index";
+        case GLMEM_STORAGE:         return "storage";
+        case GLMEM_TEXTURE:         return "texture";
+        case GLMEM_RENDER_TARGET:   return "render_target";
+        default:                    return "none";
+    }
+}
+
+/**
+ * @brief Short name of an object namespace
+ *
+ * @param identifier Object namespace
+ * @return const char*
+ */
+const char* GLResourceRegistry::identifierName(GLenum identifier) {
+    switch (identifier) {
+        case GL_BUFFER:         return "buffer";
+        case GL_VERTEX_ARRAY:   return "vertex_array";
+        case GL_TEXTURE:        return "texture";
+        case GL_FRAMEBUFFER:    return "framebuffer";
+        case GL_RENDERBUFFER:   return "renderbuffer";
+        case GL_PROGRAM:        return "program";
+        case GL_QUERY:          return "query";
+        default:                return "object";
+    }
+}
+
+/**
+ * @brief Sum of all categories. Caller holds the mutex
+ *
+ * @return size_t
+ */
+size_t GLResourceRegistry::getTotalBytesLocked() const {
+    size_t total = 0;
+    for (int i = 0; i < GLMEM_CATEGORY_COUNT; i ++)
+        total += bytes[i];
+    return total;
+}
+
+/**
+ * @brief Logs a warning the first time the total exceeds the budget. Caller holds the mutex
+ */
+void GLResourceRegistry::checkBudget() {
+    size_t total = getTotalBytesLocked();
+    if (budget == 0 || total <= budget) {
+        warned = false;
+        return;
+    }
+    if (warned)
+        return;
+
+    LOG_WARN("vram", "GL resources use %.2f MiB, over the %.0f MiB budget", total / MIB, budget / MIB);
+    warned = true;
+}
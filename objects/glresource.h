@@ -0,0 +1,222 @@
+/**
+ * @file glresource.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Move-only owning handles for GL objects, and a registry that tracks every live object and the video memory it holds per category
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef GLRESOURCE_H
+#define GLRESOURCE_H
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+#include "SDL2/SDL.h"
+
+#include <stddef.h>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <string>
+using std::string;
+
+class Profiler;
+
+// video memory the application expects to stay under; crossing it logs a warning (see GLResourceRegistry::setBudget)
+#define VRAM_BUDGET_MB 512
+
+/**
+ * @brief What the memory of an object is used for. Objects that own no storage (vertex arrays, framebuffers, programs, queries) stay GLMEM_NONE
+ */
+enum GLMemoryCategory {
+    GLMEM_NONE,
+    GLMEM_VERTEX,           // vertex buffers
+    GLMEM_INDEX,            // index buffers
+    GLMEM_STORAGE,          // shader storage, indirect and readback buffers
+    GLMEM_TEXTURE,          // sampled textures loaded from disk or computed once
+    GLMEM_RENDER_TARGET,    // attachments and textures rewritten every frame
+    GLMEM_CATEGORY_COUNT
+};
+
+/**
+ * @brief Tracks every live GL object created through a GLHandle, its label and the bytes it holds. Sizes are estimates from the requested formats; drivers may pad
+ *
+ * Publishes "vram.<category>", "vram.total" and "vram.budget" (MiB) and "vram.objects" through report()
+ */
+class GLResourceRegistry {
+    public:
+        static GLResourceRegistry& get();
+
+        void add(GLenum identifier, GLuint name);
+        void remove(GLenum identifier, GLuint name);
+        void setLabel(GLenum identifier, GLuint name, const string& label);
+        void setSize(GLenum identifier, GLuint name, GLMemoryCategory category, size_t bytes);
+
+        size_t getBytes(GLMemoryCategory category) const;
+        size_t getTotalBytes() const;
+        int getObjectCount() const;
+
+        void setBudget(size_t bytes);
+        size_t getBudget() const;
+        bool overBudget() const;
+
+        void report(Profiler* profiler) const;
+        void logSummary() const;
+        int checkLeaks() const;
+
+        static const char* categoryName(GLMemoryCategory category);
+        static const char* identifierName(GLenum identifier);
+
+    private:
+        struct Entry {
+            GLMemoryCategory category;
+            size_t bytes;
+            string label;
+        };
+
+        GLResourceRegistry();
+        size_t getTotalBytesLocked() const;
+        void checkBudget();
+
+        mutable std::mutex mutex;
+        std::map<std::pair<GLenum, GLuint>, Entry> objects;
+        size_t bytes[GLMEM_CATEGORY_COUNT];
+        size_t budget;
+        bool warned;    // whether the current excursion over budget was already logged
+};
+
+/**
+ * @brief Returns whether a GL context is current on this thread. Renderer backends other than GL run without one, so objects only create GL state when this holds
+ *
+ * @return bool
+ */
+inline bool glContextCurrent() {
+    return SDL_GL_GetCurrentContext() != NULL;
+}
+
+GLuint createGLObject(GLenum identifier);
+void destroyGLObject(GLenum identifier, GLuint name);
+
+/**
+ * @brief Names a GL object so driver debug messages, graphics debuggers and leak reports can refer to it (the GL label is a no-op without KHR_debug)
+ *
+ * @param identifier Object namespace (GL_BUFFER, GL_VERTEX_ARRAY, GL_TEXTURE, GL_PROGRAM, GL_FRAMEBUFFER, ...)
+ * @param name Object name; buffers and vertex arrays must have been bound once
+ * @param label Human-readable label
+ */
+inline void labelObject(GLenum identifier, GLuint name, const string& label) {
+    if (GLEW_KHR_debug || GLEW_VERSION_4_3)
+        glObjectLabel(identifier, name, (GLsizei)label.size(), label.c_str());
+    GLResourceRegistry::get().setLabel(identifier, name, label);
+}
+
+/**
+ * @brief Bytes of a 2D texture (or one cube face / array layer) with the given number of mip levels
+ *
+ * @param width Width of level 0
+ * @param height Height of level 0
+ * @param bytesPerTexel Size of one texel of the internal format
+ * @param levels Number of mip levels
+ * @return size_t
+ */
+inline size_t textureBytes(int width, int height, int bytesPerTexel, int levels = 1) {
+    size_t total = 0;
+    for (int level = 0; level < levels; level ++) {
+        size_t w = width >> level, h = height >> level;
+        total += (w ? w : 1) * (h ? h : 1) * bytesPerTexel;
+    }
+    return total;
+}
+
+/**
+ * @brief Number of levels in a full mip chain
+ *
+ * @param width Width of level 0
+ * @param height Height of level 0
+ * @return int
+ */
+inline int mipLevels(int width, int height) {
+    int levels = 1;
+    for (int size = width > height ? width : height; size > 1; size >>= 1)
+        levels ++;
+    return levels;
+}
+
+/**
+ * @brief Owns one GL object of the namespace Identifier. Move-only; the object is deleted (and unregistered) when the handle is destroyed or reset
+ *
+ * Converts implicitly to GLuint, so handles can be passed straight to GL calls
+ */
+template <GLenum Identifier>
+class GLHandle {
+    public:
+        GLHandle() : name(0) {}
+        ~GLHandle() {
+            reset();
+        }
+
+        GLHandle(GLHandle&& other) noexcept : name(other.name) {
+            other.name = 0;
+        }
+        GLHandle& operator=(GLHandle&& other) noexcept {
+            if (this != &other) {
+                reset();
+                name = other.name;
+                other.name = 0;
+            }
+            return *this;
+        }
+
+        GLHandle(const GLHandle&) = delete;
+        GLHandle& operator=(const GLHandle&) = delete;
+
+        // Creates a new object, deleting the one currently held
+        void create() {
+            reset();
+            name = createGLObject(Identifier);
+            GLResourceRegistry::get().add(Identifier, name);
+        }
+
+        // Deletes the object held, if any
+        void reset() {
+            if (name == 0)
+                return;
+            GLResourceRegistry::get().remove(Identifier, name);
+            destroyGLObject(Identifier, name);
+            name = 0;
+        }
+
+        // Records the storage the object holds after an allocation (glBufferData, glTexStorage*, ...), replacing the previous amount
+        void setSize(GLMemoryCategory category, size_t bytes) {
+            if (name)
+                GLResourceRegistry::get().setSize(Identifier, name, category, bytes);
+        }
+
+        void setLabel(const string& label) {
+            if (name)
+                labelObject(Identifier, name, label);
+        }
+
+        GLuint get() const {
+            return name;
+        }
+        operator GLuint() const {
+            return name;
+        }
+
+    private:
+        GLuint name;
+};
+
+typedef GLHandle<GL_BUFFER>         GLBuffer;
+typedef GLHandle<GL_VERTEX_ARRAY>   GLVertexArray;
+typedef GLHandle<GL_TEXTURE>        GLTexture;
+typedef GLHandle<GL_FRAMEBUFFER>    GLFramebuffer;
+typedef GLHandle<GL_RENDERBUFFER>   GLRenderbuffer;
+typedef GLHandle<GL_PROGRAM>        GLProgram;
+typedef GLHandle<GL_QUERY>          GLQuery;
+
+#endif
@@ -24,6 +24,8 @@ using std::vector;
 #include <string>
 using std::string;
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -32,14 +34,34 @@ using std::string;
 #include <glm/vec3.hpp>
 #include <glm/vec4.hpp>
 #include <glm/matrix.hpp>
+#include <glm/geometric.hpp>
+#include <glm/common.hpp>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "glresource.h"
+#include "renderer.h"
+#include "assets.h"
+#include "threadpool.h"
+#include "lod.h"
+#include "meshlet.h"
+#include "animation.h"
+#include "../kernel/metrics.h"
+#include "../kernel/log.h"
+
 #define MAX_BONE_INFLUENCE 4
 
-inline unsigned int textureFromFile(const char *path, const string &directory, bool gamma = false);
+inline GLTexture textureFromFile(const char *path, const string &directory, bool gamma = false);
+struct TextureImage;
+inline TextureImage* loadTextureImage(const char *path, const string &directory);
+inline GLTexture uploadTexture(const TextureImage& image, const string &label, bool gamma = false);
+
+// milliseconds since a steady_clock time point
+inline double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 
 /**
  * @brief Defines a single vertex in OpenGL space (adapted from https://learnopengl.com/Model-Loading/Mesh)
@@ -63,6 +85,77 @@ struct Texture {
     string path;
 };
 
+/**
+ * @brief A decoded texture holding only the channels it uses, rows tightly packed
+ */
+struct TextureImage {
+    int width, height;
+    int channels;       // 1 (grey), 2 (grey and alpha), 3 (colour) or 4 (colour and alpha)
+    bool bgr;           // colour stored blue first, uploaded as GL_BGR/GL_BGRA
+    vector<unsigned char> pixels;
+
+    TextureImage() : width(0), height(0), channels(0), bgr(false) {}
+};
+
+/**
+ * @brief View frustum as six inward-facing planes (xyz normal, w offset), extracted from a view-projection matrix
+ */
+struct Frustum {
+    glm::vec4 planes[6];
+
+    Frustum() {}
+
+    // Gribb-Hartmann plane extraction; glm matrices are column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    Frustum(const glm::mat4& viewProjection) {
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i ++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+        planes[0] = rows[3] + rows[0]; // left
+        planes[1] = rows[3] - rows[0]; // right
+        planes[2] = rows[3] + rows[1]; // bottom
+        planes[3] = rows[3] - rows[1]; // top
+        planes[4] = rows[3] + rows[2]; // near
+        planes[5] = rows[3] - rows[2]; // far
+
+        for (int i = 0; i < 6; i ++)
+            planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+
+    // true if any part of the sphere lies inside the frustum
+    bool intersectsSphere(const glm::vec3& center, float radius) const {
+        for (int i = 0; i < 6; i ++) {
+            if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+                return false;
+        }
+        return true;
+    }
+
+    // true if any part of the axis-aligned box lies inside the frustum (conservative)
+    bool intersectsBox(const glm::vec3& bmin, const glm::vec3& bmax) const {
+        for (int i = 0; i < 6; i ++) {
+            // test the corner furthest along the plane normal
+            glm::vec3 p(planes[i].x >= 0 ? bmax.x : bmin.x,
+                        planes[i].y >= 0 ? bmax.y : bmin.y,
+                        planes[i].z >= 0 ? bmax.z : bmin.z);
+            if (glm::dot(glm::vec3(planes[i]), p) + planes[i].w < 0)
+                return false;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Layout of one glDrawElementsIndirect command, as read from a GL_DRAW_INDIRECT_BUFFER (and written by culling compute passes)
+ */
+struct DrawElementsIndirectCommand {
+    unsigned int count;
+    unsigned int instanceCount;
+    unsigned int firstIndex;
+    int baseVertex;
+    unsigned int baseInstance;
+};
+
 /**
  * @brief Abstract light class
  */
@@ -107,9 +200,10 @@ class SptLight : public Light {
  */
 class Shader {
     public:
-        unsigned int ID;
+        GLProgram ID;
         
         Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = NULL) {
+            auto start = std::chrono::steady_clock::now();
             string vertexCode;
             string fragmentCode;
             string geometryCode;
@@ -149,7 +243,7 @@ class Shader {
                     geometryCode = gShaderStream.str();
                 }
             } catch (std::ifstream::failure& e) {
-                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << e.what() << std::endl;
+                LOG_ERROR("shader", "Shader file not successfully read: %s", e.what());
             }
             
             const char* vShaderCode = vertexCode.c_str();
@@ -181,19 +275,21 @@ class Shader {
             }
             
             // shader Program
-            ID = glCreateProgram();
+            ID.create();
             glAttachShader(ID, vertex);
             glAttachShader(ID, fragment);
             if(geometryPath != nullptr)
                 glAttachShader(ID, geometry);
             glLinkProgram(ID);
             checkCompileErrors(ID, "PROGRAM");
+            labelObject(GL_PROGRAM, ID, string(vertexPath) + " + " + fragmentPath);
             
             // delete the shaders as they're linked into our program now and no longer necessery
             glDeleteShader(vertex);
             glDeleteShader(fragment);
             if(geometryPath != nullptr)
                 glDeleteShader(geometry);
+            AssetLog::get().loaded("shader", string(vertexPath) + " + " + fragmentPath, ASSET_READY, elapsedMs(start));
         }
 
         void use() { 
@@ -245,7 +341,10 @@ class Shader {
             glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
         }
 
-    private:
+    protected:
+        // used by derived programs that build their own stages
+        Shader() {}
+
         void checkCompileErrors(GLuint shader, string type) {
             GLint success;
             GLchar infoLog[1024];
@@ -253,19 +352,90 @@ class Shader {
                 glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
                 if(!success) {
                     glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-                    std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << std::endl;
+                    LOG_ERROR("shader", "Compilation error of type %s:\n%s", type, infoLog);
                 }
             }
             else {
                 glGetProgramiv(shader, GL_LINK_STATUS, &success);
                 if(!success) {
                     glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-                    std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << std::endl;
+                    LOG_ERROR("shader", "Linking error of type %s:\n%s", type, infoLog);
                 }
             }
         }
 };
 
+/**
+ * @brief Defines a compute shader program. Shares uniform setters with Shader
+ */
+class ComputeShader : public Shader {
+    public:
+        ComputeShader(const char* computePath) {
+            auto start = std::chrono::steady_clock::now();
+            string computeCode;
+            std::ifstream cShaderFile;
+            cShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+
+            try {
+                cShaderFile.open(computePath);
+                std::stringstream cShaderStream;
+                cShaderStream << cShaderFile.rdbuf();
+                cShaderFile.close();
+                computeCode = cShaderStream.str();
+            } catch (std::ifstream::failure& e) {
+                LOG_ERROR("shader", "Shader file not successfully read: %s", e.what());
+            }
+
+            const char* cShaderCode = computeCode.c_str();
+
+            // compute shader
+            unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+            glShaderSource(compute, 1, &cShaderCode, NULL);
+            glCompileShader(compute);
+            checkCompileErrors(compute, "COMPUTE");
+
+            // shader Program
+            ID.create();
+            glAttachShader(ID, compute);
+            glLinkProgram(ID);
+            checkCompileErrors(ID, "PROGRAM");
+            labelObject(GL_PROGRAM, ID, computePath);
+
+            glDeleteShader(compute);
+            AssetLog::get().loaded("shader", computePath, ASSET_READY, elapsedMs(start));
+        }
+
+        // dispatches enough work groups to cover a (x, y, z) grid of invocations, given the shader's local size
+        void dispatch(unsigned int x, unsigned int y = 1, unsigned int z = 1, unsigned int localX = 1, unsigned int localY = 1, unsigned int localZ = 1) {
+            glDispatchCompute((x + localX - 1) / localX, (y + localY - 1) / localY, (z + localZ - 1) / localZ);
+        }
+};
+
+/**
+ * @brief Binds textures to consecutive units and points the shader's material.texture_<type>N samplers at them
+ *
+ * @param shader Shader in use
+ * @param textures Textures to bind
+ */
+inline void bindMaterialTextures(Shader* shader, const vector<Texture>& textures) {
+    unsigned int diffuseNr = 1;
+    unsigned int specularNr = 1;
+    for(unsigned int i = 0; i < textures.size(); i++) {
+        glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
+        // retrieve texture number
+        string number;
+        string name = textures[i].type;
+        if(name == "texture_diffuse")
+            number = std::to_string(diffuseNr++);
+        else if(name == "texture_specular")
+            number = std::to_string(specularNr++);
+
+        shader->setInt(("material." + name + number).c_str(), i);
+        glBindTexture(GL_TEXTURE_2D, textures[i].id);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
 /**
  * @brief Defines a mesh including sets of vertices, indices, and texture structs
  */
@@ -275,54 +445,67 @@ class Mesh {
         vector<Vertex> vertices;
         vector<unsigned int> indices;
         vector<Texture> textures;
-
-        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures) {
-            this->vertices = vertices;
-            this->indices = indices;
-            this->textures = textures;
-
-            setupMesh();
-        }
-
-        void draw(Shader* shader) {
-            unsigned int diffuseNr = 1;
-            unsigned int specularNr = 1;
-            for(unsigned int i = 0; i < textures.size(); i++) {
-                glActiveTexture(GL_TEXTURE0 + i); // activate proper texture unit before binding
-                // retrieve texture number
-                string number;
-                string name = textures[i].type;
-                if(name == "texture_diffuse")
-                    number = std::to_string(diffuseNr++);
-                else if(name == "texture_specular")
-                    number = std::to_string(specularNr++);
-
-                shader->setInt(("material." + name + number).c_str(), i);
-                glBindTexture(GL_TEXTURE_2D, textures[i].id);
+        string name;    // used to label GL objects
+
+        // MESH_LOD_LEVELS ranges of indices, the full mesh first; without levels given every one draws the full mesh
+        vector<MeshLod> lods;
+
+        // clusters partitioning the full level of detail (may be empty)
+        vector<Meshlet> meshlets;
+
+        // without upload only the CPU copies are kept, until upload() is called on the GL thread
+        Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, string name = "Mesh", bool upload = true,
+            vector<MeshLod> lods = vector<MeshLod>(), vector<Meshlet> meshlets = vector<Meshlet>()) {
+            this->vertices = std::move(vertices);
+            this->indices = std::move(indices);
+            this->textures = std::move(textures);
+            this->name = name;
+            this->lods = std::move(lods);
+            this->meshlets = std::move(meshlets);
+            if (this->lods.empty()) {
+                MeshLod full = { 0, (unsigned int)this->indices.size(), 0.0f };
+                this->lods.assign(MESH_LOD_LEVELS, full);
             }
-            glActiveTexture(GL_TEXTURE0);
 
-            // draw mesh
-            glBindVertexArray(VAO);
-            glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
-        } 
-    private:
-        // render data
-        unsigned int VAO, VBO, EBO;
+            if (upload)
+                setupMesh();
+        }
 
-        void setupMesh() {
-            glGenVertexArrays(1, &VAO);
-            glGenBuffers(1, &VBO);
-            glGenBuffers(1, &EBO);
-        
-            glBindVertexArray(VAO);
-            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        // creates the GL buffers of a mesh constructed without them
+        void upload() {
+            if (VAO == 0)
+                setupMesh();
+        }
 
-            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+        // draws a level of the mesh with a renderer; texture paths are relative to directory
+        void draw(Renderer* renderer, Shader* shader, const string& directory, const glm::mat4& model, int level = 0) {
+            DrawGeometry geometry;
+            geometry.vao = VAO;
+            geometry.vertices = (const float*)vertices.data();
+            geometry.stride = sizeof(Vertex) / sizeof(float);
+            geometry.vertexCount = vertices.size();
+            geometry.normalOffset = offsetof(Vertex, normal) / sizeof(float);
+            geometry.uvOffset = offsetof(Vertex, texCoords) / sizeof(float);
+            geometry.indices = indices.data();
+            geometry.firstIndex = lods[level].firstIndex;
+            geometry.indexCount = lods[level].count;
+            renderer->drawMesh(geometry, shader, textures, directory, model);
+        }
 
-            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        // draws the mesh with the DrawElementsIndirectCommand at offset (bytes) in the bound GL_DRAW_INDIRECT_BUFFER
+        void drawIndirect(Shader* shader, size_t offset) {
+            bindMaterialTextures(shader, textures);
+
+            glBindVertexArray(VAO);
+            glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset);
+            countDrawCalls();
+            glBindVertexArray(0);
+        }
+
+        // points vertex attributes 0-2 (position, normal, texture coordinates) of the bound vertex array at this mesh's vertices,
+        // for vertex arrays drawing them with other indices
+        void bindVertexAttributes() const {
+            glBindBuffer(GL_ARRAY_BUFFER, vertexSource != 0 ? vertexSource : (unsigned int)VBO);
 
             // vertex positions
             glEnableVertexAttribArray(0);	
@@ -335,7 +518,53 @@ class Mesh {
             // vertex texture coords
             glEnableVertexAttribArray(2);	
             glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+        }
 
+        // buffer of bind-pose vertices, as uploaded
+        unsigned int getVertexBuffer() const {
+            return VBO;
+        }
+
+        // makes every draw of the mesh read its vertices from another buffer of Vertex (e.g. skinned each frame), 0 for its own.
+        // Vertex arrays made with bindVertexAttributes before the call keep reading the old one
+        void setVertexSource(unsigned int buffer) {
+            vertexSource = buffer;
+            if (VAO == 0)
+                return;
+            glBindVertexArray(VAO);
+            bindVertexAttributes();
+            glBindVertexArray(0);
+        }
+    private:
+        // render data
+        GLVertexArray VAO;
+        GLBuffer VBO, EBO;
+        unsigned int vertexSource = 0;  // not owned
+
+        void setupMesh() {
+            // renderers other than GL draw from the CPU copies alone
+            if (!glContextCurrent())
+                return;
+            VAO.create();
+            VBO.create();
+            EBO.create();
+        
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ARRAY_BUFFER, VBO);
+
+            glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
+            VBO.setSize(GLMEM_VERTEX, vertices.size() * sizeof(Vertex));
+
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+            EBO.setSize(GLMEM_INDEX, indices.size() * sizeof(unsigned int));
+            countUpload(vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int));
+
+            labelObject(GL_VERTEX_ARRAY, VAO, name + " VAO");
+            labelObject(GL_BUFFER, VBO, name + " VBO");
+            labelObject(GL_BUFFER, EBO, name + " EBO");
+
+            bindVertexAttributes();
             glBindVertexArray(0);
         }
 };
@@ -347,66 +576,185 @@ class Model {
     public:
         // model data 
         vector<Texture> textures_loaded;
+        vector<GLTexture> textureObjects;   // owns the GL textures referenced by textures_loaded
         vector<Mesh> meshes;
         string directory;
         bool gammaCorrection;
 
-        // constructor, expects a filepath to a 3D model.
-        Model(string const &path, bool gamma = false) : gammaCorrection(gamma) {
-            loadModel(path);
+        // object-space bounding box of all meshes
+        glm::vec3 boundsMin, boundsMax;
+
+        // error of each level of detail, the largest over the meshes (see selectLod)
+        vector<float> lodErrors;
+
+        // nodes, bones and clips; vertices' m_BoneIDs index skeleton.bones. Culling and levels of detail use the bind pose
+        Skeleton skeleton;
+
+        // time spent importing: reading the file with Assimp (serial), then converting meshes and decoding textures (parallel)
+        double readMs, processMs;
+
+        // constructor, expects a filepath to a 3D model. Without upload the model is only imported (no GL calls, so any thread may
+        // construct it), and upload() creates its GL objects later; meshes is empty if the import failed. Meshes are converted and
+        // textures decoded on pool when one is given, which must not be running another parallelFor meanwhile
+        Model(string const &path, bool gamma = false, bool upload = true, ThreadPool* pool = NULL) : gammaCorrection(gamma), boundsMin(0), boundsMax(0), lodErrors(MESH_LOD_LEVELS, 0.0f), readMs(0), processMs(0) {
+            auto start = std::chrono::steady_clock::now();
+            source = path;
+            loadModel(path, pool);
+            AssetLog::get().loaded("model", path, meshes.empty() ? ASSET_FAILED : ASSET_IMPORTED, elapsedMs(start));
+            if (upload)
+                this->upload();
+        }
+
+        ~Model() {
+            for (TextureImage* image : images)
+                delete image;
         }
 
-        // draws the model, and thus all its meshes
-        void draw(Shader* shader) {
+        // creates the mesh buffers and the textures decoded by the import, freeing the decoded copies. Needs the GL thread
+        void upload() {
+            auto start = std::chrono::steady_clock::now();
+            for (unsigned int i = 0; i < meshes.size(); i ++)
+                meshes[i].upload();
+
+            for (unsigned int i = 0; i < images.size(); i ++) {
+                if (images[i] == NULL)
+                    continue;
+                GLTexture object = uploadTexture(*images[i], directory + '/' + textures_loaded[i].path, gammaCorrection);
+                textures_loaded[i].id = object;
+                textureObjects.push_back(std::move(object));
+                delete images[i];
+                images[i] = NULL;
+            }
+
+            // meshes keep copies of the texture structs, made before the ids existed
+            for (Mesh& mesh : meshes) {
+                for (Texture& texture : mesh.textures) {
+                    for (const Texture& loaded : textures_loaded) {
+                        if (loaded.path == texture.path)
+                            texture.id = loaded.id;
+                    }
+                }
+            }
+            AssetLog::get().uploaded("model", source, elapsedMs(start));
+        }
+
+        // draws a level of detail of the model, and thus of all its meshes
+        void draw(Renderer* renderer, Shader* shader, const glm::mat4& model, int level = 0) {
             for(unsigned int i = 0; i < meshes.size(); i++)
-                meshes[i].draw(shader);
+                meshes[i].draw(renderer, shader, directory, model, level);
         }
     
     private:
+        // file the model was imported from
+        string source;
+
+        // decoded textures_loaded (same order) waiting for upload(), NULL once uploaded (or when the file could not be read)
+        vector<TextureImage*> images;
+
         // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-        void loadModel(string const &path) {
+        void loadModel(string const &path, ThreadPool* pool) {
+            auto start = std::chrono::steady_clock::now();
+
             // read file via ASSIMP
             Assimp::Importer importer;
             const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
             
             // check for errors
             if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
-                std::cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << std::endl;
+                LOG_ERROR("assets", "Assimp: %s", importer.GetErrorString());
                 return;
             }
             
             // retrieve the directory path of the filepath
             directory = path.substr(0, path.find_last_of('/'));
-
-            // process ASSIMP's root node recursively
-            processNode(scene->mRootNode, scene);
+            skeleton.import(scene);
+            readMs = elapsedMs(start);
+            start = std::chrono::steady_clock::now();
+
+            // meshes in the order the node tree lists them
+            vector<aiMesh*> order;
+            collectMeshes(scene->mRootNode, scene, order);
+
+            // materials are resolved serially first, so every texture file is decoded once however many meshes share it
+            vector<vector<Texture> > textures(order.size());
+            for (unsigned int i = 0; i < order.size(); i ++)
+                textures[i] = materialTextures(scene->mMaterials[order[i]->mMaterialIndex]);
+
+            // then texture decodes and mesh conversions (with their meshlets and levels of detail) are fanned out, decodes (the
+            // longest tasks) first; each task fills its own slot
+            int decodes = textures_loaded.size();
+            images.assign(decodes, NULL);
+            vector<vector<Vertex> > vertices(order.size());
+            vector<vector<unsigned int> > indices(order.size());
+            vector<vector<MeshLod> > lods(order.size());
+            vector<vector<Meshlet> > meshlets(order.size());
+            vector<vector<BoneInfo> > meshBones(order.size());
+            vector<glm::vec3> meshMin(order.size()), meshMax(order.size());
+            auto body = [&](int from, int to) {
+                for (int k = from; k < to; k ++) {
+                    if (k < decodes) {
+                        images[k] = loadTextureImage(textures_loaded[k].path.c_str(), directory);
+                        continue;
+                    }
+                    int i = k - decodes;
+                    convertMesh(order[i], vertices[i], indices[i], meshBones[i], meshMin[i], meshMax[i]);
+                    buildMeshlets((const float*)vertices[i].data(), sizeof(Vertex) / sizeof(float), vertices[i].size(), indices[i], indices[i].size(), meshlets[i]);
+                    buildLods((const float*)vertices[i].data(), sizeof(Vertex) / sizeof(float), vertices[i].size(), indices[i], lods[i]);
+                }
+            };
+            if (pool != NULL)
+                pool->parallelFor(0, decodes + (int)order.size(), body);
+            else
+                body(0, decodes + (int)order.size());
+
+            // only the bounds, the level errors, the bone table and the Mesh objects are put together serially
+            meshes.reserve(order.size());
+            bool bounded = false;
+            for (unsigned int i = 0; i < order.size(); i ++) {
+                if (!meshBones[i].empty()) {
+                    vector<int> global(meshBones[i].size());
+                    for (unsigned int b = 0; b < meshBones[i].size(); b ++)
+                        global[b] = skeleton.addBone(meshBones[i][b].name, meshBones[i][b].offset);
+                    for (Vertex& vertex : vertices[i]) {
+                        for (int k = 0; k < MAX_BONE_INFLUENCE; k ++) {
+                            if (vertex.m_Weights[k] > 0 && global[vertex.m_BoneIDs[k]] < 0)
+                                vertex.m_Weights[k] = 0;
+                            vertex.m_BoneIDs[k] = vertex.m_Weights[k] > 0 ? global[vertex.m_BoneIDs[k]] : 0;
+                        }
+                    }
+                }
+                if (!vertices[i].empty()) {
+                    boundsMin = bounded ? glm::min(boundsMin, meshMin[i]) : meshMin[i];
+                    boundsMax = bounded ? glm::max(boundsMax, meshMax[i]) : meshMax[i];
+                    bounded = true;
+                }
+                for (int level = 0; level < MESH_LOD_LEVELS; level ++)
+                    lodErrors[level] = std::max(lodErrors[level], lods[i][level].error);
+                meshes.push_back(Mesh(std::move(vertices[i]), std::move(indices[i]), std::move(textures[i]), directory + "/" + order[i]->mName.C_Str(), false, std::move(lods[i]), std::move(meshlets[i])));
+            }
+            processMs = elapsedMs(start);
         }
 
-        // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-        void processNode(aiNode *node, const aiScene *scene) {
-            // process each mesh located at the current node
-            for(unsigned int i = 0; i < node->mNumMeshes; i++) {
-                // the node object only contains indices to index the actual objects in the scene. 
-                // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-                aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-                meshes.push_back(processMesh(mesh, scene));
-            }
-            
-            // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
-            for(unsigned int i = 0; i < node->mNumChildren; i++) {
-                processNode(node->mChildren[i], scene);
-            }
+        // lists the meshes of a node and of its children, recursively. The node object only contains indices to index the actual
+        // objects in the scene; the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
+        static void collectMeshes(aiNode *node, const aiScene *scene, vector<aiMesh*>& order) {
+            for(unsigned int i = 0; i < node->mNumMeshes; i++)
+                order.push_back(scene->mMeshes[node->mMeshes[i]]);
+            for(unsigned int i = 0; i < node->mNumChildren; i++)
+                collectMeshes(node->mChildren[i], scene, order);
         }
 
-        Mesh processMesh(aiMesh *mesh, const aiScene *scene) {
-            // data to fill
-            vector<Vertex> vertices;
-            vector<unsigned int> indices;
-            vector<Texture> textures;
+        // converts the vertices and faces of a mesh into arrays sized up front, binding vertices to the MAX_BONE_INFLUENCE bones
+        // weighing most on them (m_BoneIDs index the mesh's own bones until loadModel maps them to the skeleton's). Touches nothing
+        // shared, so meshes may be converted concurrently
+        static void convertMesh(aiMesh *mesh, vector<Vertex>& vertices, vector<unsigned int>& indices, vector<BoneInfo>& bones, glm::vec3& bmin, glm::vec3& bmax) {
+            vertices.resize(mesh->mNumVertices);
+            bmin = glm::vec3(0);
+            bmax = glm::vec3(0);
 
             // walk through each of the mesh's vertices
             for(unsigned int i = 0; i < mesh->mNumVertices; i++) {
-                Vertex vertex;
+                Vertex& vertex = vertices[i];
                 glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
                 
                 // positions
@@ -414,6 +762,10 @@ class Model {
                 vector.y = mesh->mVertices[i].y;
                 vector.z = mesh->mVertices[i].z;
                 vertex.position = vector;
+
+                // grow mesh bounds
+                bmin = i == 0 ? vector : glm::min(bmin, vector);
+                bmax = i == 0 ? vector : glm::max(bmax, vector);
                 
                 // normals
                 if (mesh->HasNormals()) {
@@ -444,20 +796,58 @@ class Model {
                 }
                 else
                     vertex.texCoords = glm::vec2(0, 0);
-
-                vertices.push_back(vertex);
             }
 
             // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+            unsigned int count = 0;
+            for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+                count += mesh->mFaces[i].mNumIndices;
+            indices.resize(count);
+            count = 0;
             for(unsigned int i = 0; i < mesh->mNumFaces; i++) {
-                aiFace face = mesh->mFaces[i];
+                const aiFace& face = mesh->mFaces[i];
                 // retrieve all indices of the face and store them in the indices vector
                 for(unsigned int j = 0; j < face.mNumIndices; j++)
-                    indices.push_back(face.mIndices[j]);
+                    indices[count ++] = face.mIndices[j];
             }
-           
-            // process materials
-            aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
+
+            // bones, each replacing a vertex's lightest influence when it weighs more
+            bones.resize(mesh->mNumBones);
+            for (unsigned int b = 0; b < mesh->mNumBones; b ++) {
+                const aiBone* bone = mesh->mBones[b];
+                bones[b].name = bone->mName.C_Str();
+                bones[b].node = -1;
+                bones[b].offset = toGlm(bone->mOffsetMatrix);
+                for (unsigned int w = 0; w < bone->mNumWeights; w ++) {
+                    const aiVertexWeight& weight = bone->mWeights[w];
+                    if (weight.mVertexId >= vertices.size() || weight.mWeight <= 0)
+                        continue;
+                    Vertex& vertex = vertices[weight.mVertexId];
+                    int lightest = 0;
+                    for (int k = 1; k < MAX_BONE_INFLUENCE; k ++) {
+                        if (vertex.m_Weights[k] < vertex.m_Weights[lightest])
+                            lightest = k;
+                    }
+                    if (weight.mWeight > vertex.m_Weights[lightest]) {
+                        vertex.m_BoneIDs[lightest] = b;
+                        vertex.m_Weights[lightest] = weight.mWeight;
+                    }
+                }
+            }
+            if (mesh->mNumBones > 0) {
+                for (Vertex& vertex : vertices) {
+                    float total = 0;
+                    for (int k = 0; k < MAX_BONE_INFLUENCE; k ++)
+                        total += vertex.m_Weights[k];
+                    for (int k = 0; total > 0 && k < MAX_BONE_INFLUENCE; k ++)
+                        vertex.m_Weights[k] /= total;
+                }
+            }
+        }
+
+        // textures of a material, registering new files in textures_loaded
+        vector<Texture> materialTextures(aiMaterial* material) {
+            vector<Texture> textures;
             // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
             // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
             // Same applies to other texture as the following list summarizes:
@@ -480,14 +870,15 @@ class Model {
             // 4. height maps
             std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
             textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-            
-            // return a mesh object created from the extracted mesh data
-            return Mesh(vertices, indices, textures);
+            return textures;
         }
 
-        // checks all material textures of a given type and loads the textures if they're not loaded yet.
+        // checks all material textures of a given type and registers the textures that are not known yet; loadModel decodes them.
         // the required info is returned as a Texture struct.
         vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName) {
+            static MetricCounter* cacheHits = Metrics::get().counter("ews_texture_cache_lookups_total", "Material texture lookups, by whether the texture was already loaded", "result=\"hit\"");
+            static MetricCounter* cacheMisses = Metrics::get().counter("ews_texture_cache_lookups_total", "Material texture lookups, by whether the texture was already loaded", "result=\"miss\"");
+
             vector<Texture> textures;
             for(unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
                 aiString str;
@@ -502,9 +893,12 @@ class Model {
                         break;
                     }
                 }
-                if(!skip) {
+                if(skip) {
+                    cacheHits->add();
+                } else {
+                    cacheMisses->add();
                     Texture texture;
-                    texture.id = textureFromFile(str.C_Str(), this->directory);
+                    texture.id = 0;     // set by upload()
                     texture.type = typeName;
                     texture.path = str.C_Str();
                     textures.push_back(texture);
@@ -516,31 +910,172 @@ class Model {
 };
 
 /**
- * @brief Flips an SDL_Surface vertically such that texture is aligned properly in the final result
+ * @brief Copies a surface into a TextureImage, keeping only the channels it uses: grey images become one channel (two with alpha), and opaque ones lose their alpha
  * 
- * @param surface Surface of which to flip
+ * @param surface Decoded surface, in any SDL pixel format
+ * @param flip Whether to store the rows bottom to top, as 2D textures expect (cubemap faces are not flipped)
+ * @param image Receives the pixels
+ * @return bool false if the surface could not be converted
  */
-inline void flipSurface(SDL_Surface* surface) {
+inline bool decodeSurface(SDL_Surface* surface, bool flip, TextureImage& image) {
+    // paletted and packed (e.g. 16 bit) formats are expanded; 24 and 32 bit ones with a byte per channel are read in place
+    const SDL_PixelFormat* format = surface->format;
+    SDL_Surface* converted = NULL;
+    bool bytes = (format->BytesPerPixel == 3 || format->BytesPerPixel == 4) && format->Rloss == 0 && format->Gloss == 0 && format->Bloss == 0
+        && format->Rshift % 8 == 0 && format->Gshift % 8 == 0 && format->Bshift % 8 == 0 && (format->Amask == 0 || (format->Aloss == 0 && format->Ashift % 8 == 0));
+    if (format->palette != NULL) {
+        // a grey palette indexed by value is already a single-channel image
+        bool identity = true;
+        for (int i = 0; i < format->palette->ncolors && identity; i ++) {
+            const SDL_Color& c = format->palette->colors[i];
+            identity = c.r == i && c.g == i && c.b == i && c.a == 255;
+        }
+        Uint32 key;
+        if (identity && format->BytesPerPixel == 1 && SDL_GetColorKey(surface, &key) != 0) {
+            image.width = surface->w;
+            image.height = surface->h;
+            image.channels = 1;
+            image.bgr = false;
+            image.pixels.resize((size_t)surface->w * surface->h);
+            SDL_LockSurface(surface);
+            for (int y = 0; y < surface->h; y ++) {
+                const unsigned char* row = (const unsigned char*)surface->pixels + (size_t)(flip ? surface->h - 1 - y : y) * surface->pitch;
+                memcpy(&image.pixels[(size_t)y * surface->w], row, surface->w);
+            }
+            SDL_UnlockSurface(surface);
+            return true;
+        }
+        bytes = false;
+    }
+    if (!bytes) {
+        converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+        if (converted == NULL)
+            return false;
+        surface = converted;
+        format = surface->format;
+    }
+
+    // byte of each channel within a pixel
+    int bpp = format->BytesPerPixel;
+    int r = format->Rshift / 8, g = format->Gshift / 8, b = format->Bshift / 8, a = format->Amask != 0 ? format->Ashift / 8 : -1;
+#if SDL_BYTEORDER == SDL_BIG_ENDIAN
+    r = bpp - 1 - r; g = bpp - 1 - g; b = bpp - 1 - b;
+    if (a >= 0)
+        a = bpp - 1 - a;
+#endif
+
+    // one pass to find the channels in use
     SDL_LockSurface(surface);
-    
-    int pitch = surface->pitch; // row size
-    char* temp = new char[pitch]; // intermediate buffer
-    char* pixels = (char*) surface->pixels;
-    
-    for(int i = 0; i < surface->h / 2; ++i) {
-        // get pointers to the two rows to swap
-        char* row1 = pixels + i * pitch;
-        char* row2 = pixels + (surface->h - i - 1) * pitch;
-        
-        // swap rows
-        memcpy(temp, row1, pitch);
-        memcpy(row1, row2, pitch);
-        memcpy(row2, temp, pitch);
+    bool grey = true, opaque = true;
+    for (int y = 0; y < surface->h && (grey || opaque); y ++) {
+        const unsigned char* p = (const unsigned char*)surface->pixels + (size_t)y * surface->pitch;
+        for (int x = 0; x < surface->w; x ++, p += bpp) {
+            grey = grey && p[r] == p[g] && p[g] == p[b];
+            opaque = opaque && (a < 0 || p[a] == 255);
+        }
     }
-    
-    delete[] temp;
 
+    image.width = surface->w;
+    image.height = surface->h;
+    image.channels = grey ? (opaque ? 1 : 2) : (opaque ? 3 : 4);
+    image.pixels.resize((size_t)image.width * image.height * image.channels);
+
+    // rows laid out as GL reads them are copied whole (blue-first ones are uploaded as GL_BGR/GL_BGRA); anything else is gathered
+    bool rgb = r == 0 && g == 1 && b == 2, bgrOrder = b == 0 && g == 1 && r == 2;
+    bool whole = (rgb || bgrOrder) && ((image.channels == 3 && bpp == 3) || (image.channels == 4 && a == 3));
+    image.bgr = whole && bgrOrder;
+    size_t rowBytes = (size_t)image.width * image.channels;
+    for (int y = 0; y < image.height; y ++) {
+        const unsigned char* p = (const unsigned char*)surface->pixels + (size_t)(flip ? image.height - 1 - y : y) * surface->pitch;
+        unsigned char* out = &image.pixels[(size_t)y * rowBytes];
+        if (whole) {
+            memcpy(out, p, rowBytes);
+            continue;
+        }
+        for (int x = 0; x < image.width; x ++, p += bpp) {
+            if (grey) {
+                *out ++ = p[r];
+            } else {
+                *out ++ = p[r];
+                *out ++ = p[g];
+                *out ++ = p[b];
+            }
+            if (!opaque)
+                *out ++ = p[a];
+        }
+    }
     SDL_UnlockSurface(surface);
+
+    if (converted != NULL)
+        SDL_FreeSurface(converted);
+    return true;
+}
+
+/**
+ * @brief Returns the formats an image is stored and uploaded with, and how its channels are swizzled so shaders read grey images as grey.
+ * Core GL has no one- or two-channel sRGB formats: sRGB grey is stored as GL_SRGB8 (GL fills green and blue on upload), and sRGB grey and
+ * alpha must be expanded to four channels first (see expandGreyAlpha), as alpha is never decoded
+ * 
+ * @param image Decoded image
+ * @param gamma Whether colour channels are sRGB encoded
+ * @param internalFormat Receives the sized internal format
+ * @param format Receives the format of the pixels
+ * @param swizzle Receives GL_TEXTURE_SWIZZLE_RGBA
+ */
+inline void textureFormats(const TextureImage& image, bool gamma, GLenum& internalFormat, GLenum& format, GLint swizzle[4]) {
+    swizzle[0] = GL_RED; swizzle[1] = GL_GREEN; swizzle[2] = GL_BLUE; swizzle[3] = GL_ALPHA;
+    switch (image.channels) {
+        case 1:
+            internalFormat = gamma ? GL_SRGB8 : GL_R8;
+            format = GL_RED;
+            swizzle[1] = swizzle[2] = GL_RED;
+            swizzle[3] = GL_ONE;
+            break;
+        case 2:
+            internalFormat = GL_RG8;
+            format = GL_RG;
+            swizzle[1] = swizzle[2] = GL_RED;
+            swizzle[3] = GL_GREEN;
+            break;
+        case 3:
+            internalFormat = gamma ? GL_SRGB8 : GL_RGB8;
+            format = image.bgr ? GL_BGR : GL_RGB;
+            break;
+        default:
+            internalFormat = gamma ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+            format = image.bgr ? GL_BGRA : GL_RGBA;
+            break;
+    }
+}
+
+/**
+ * @brief Returns a grey and alpha image as RGBA, the grey copied to every colour channel
+ * 
+ * @param image Decoded image with 2 channels
+ * @return TextureImage
+ */
+inline TextureImage expandGreyAlpha(const TextureImage& image) {
+    TextureImage expanded;
+    expanded.width = image.width;
+    expanded.height = image.height;
+    expanded.channels = 4;
+    expanded.pixels.resize((size_t)image.width * image.height * 4);
+    for (size_t i = 0; i < (size_t)image.width * image.height; i ++) {
+        unsigned char* p = &expanded.pixels[i * 4];
+        p[0] = p[1] = p[2] = image.pixels[i * 2];
+        p[3] = image.pixels[i * 2 + 1];
+    }
+    return expanded;
+}
+
+/**
+ * @brief Returns the largest GL_UNPACK_ALIGNMENT tightly packed rows of a given length satisfy
+ * 
+ * @param rowBytes Bytes per row
+ * @return int 8, 4, 2 or 1
+ */
+inline int unpackAlignment(size_t rowBytes) {
+    return rowBytes % 8 == 0 ? 8 : rowBytes % 4 == 0 ? 4 : rowBytes % 2 == 0 ? 2 : 1;
 }
 
 /**
@@ -549,47 +1084,93 @@ inline void flipSurface(SDL_Surface* surface) {
  * @param path File name/path to file from directory
  * @param directory Directory path to file/to path
  * @param gamma Load with gamma or not
- * @return unsigned int representing the loaded texture ID
+ * @return GLTexture owning the loaded texture (empty on failure, or without a GL context)
  */
-inline unsigned int textureFromFile(const char *path, const string &directory, bool gamma) {
+inline GLTexture textureFromFile(const char *path, const string &directory, bool gamma) {
+    // renderers other than GL load the file themselves
+    if (!glContextCurrent())
+        return GLTexture();
+
+    TextureImage* image = loadTextureImage(path, directory);
+    if (image == NULL)
+        return GLTexture();
+
+    GLTexture textureID = uploadTexture(*image, directory + '/' + path, gamma);
+    delete image;
+    return textureID;
+}
+
+/**
+ * @brief Reads and decodes a texture, flipped so its first row is the bottom one as GL expects. Makes no GL calls, so it may run on any thread
+ * 
+ * @param path File name/path to file from directory
+ * @param directory Directory path to file/to path
+ * @return TextureImage* owned by the caller, NULL if the file could not be read
+ */
+inline TextureImage* loadTextureImage(const char *path, const string &directory) {
+    auto start = std::chrono::steady_clock::now();
     string filename = string(path);
     filename = directory + '/' + filename;
 
     SDL_Surface* surf = IMG_Load(filename.c_str());
-    flipSurface(surf);
     if (surf == NULL) {
-        SDL_Log("Unable to initialize texture: %s\n", IMG_GetError()); return 0;
+        LOG_ERROR("assets", "Unable to load texture %s: %s", filename, IMG_GetError());
+        AssetLog::get().loaded("texture", filename, ASSET_FAILED, elapsedMs(start));
+        return NULL;
     }
+    TextureImage* image = new TextureImage();
+    bool decoded = decodeSurface(surf, true, *image);
+    SDL_FreeSurface(surf);
+    if (!decoded) {
+        LOG_ERROR("assets", "Unable to convert texture %s: %s", filename, SDL_GetError());
+        AssetLog::get().loaded("texture", filename, ASSET_FAILED, elapsedMs(start));
+        delete image;
+        return NULL;
+    }
+    AssetLog::get().loaded("texture", filename, ASSET_IMPORTED, elapsedMs(start));
+    return image;
+}
+
+/**
+ * @brief Creates a mipmapped 2D texture, in immutable storage of the format matching the image's channels
+ * 
+ * @param image Decoded image, as returned by loadTextureImage
+ * @param label Name of the texture in debuggers and the asset report
+ * @param gamma Whether colour channels are sRGB encoded
+ * @return GLTexture owning the texture (empty without a GL context)
+ */
+inline GLTexture uploadTexture(const TextureImage& image, const string &label, bool gamma) {
+    if (!glContextCurrent())
+        return GLTexture();
+    if (gamma && image.channels == 2)
+        return uploadTexture(expandGreyAlpha(image), label, gamma);
+    auto start = std::chrono::steady_clock::now();
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+    GLTexture textureID;
+    textureID.create();
 
-    int width, height;
-    void *data = surf->pixels;
-    width = surf->w;
-    height = surf->h;
-
-    GLenum format;
-    // TODO: Reimplement texture format detection accurately
-    /*if (nrComponents == 1)
-        format = GL_RED;
-    else if (nrComponents == 3)
-        format = GL_RGB;
-    else if (nrComponents == 4)
-        format = GL_RGBA;*/
-    format = GL_RGB;
+    GLenum internalFormat, format;
+    GLint swizzle[4];
+    textureFormats(image, gamma, internalFormat, format, swizzle);
+    int levels = mipLevels(image.width, image.height);
 
     glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    labelObject(GL_TEXTURE, textureID, label);
+    glTexStorage2D(GL_TEXTURE_2D, levels, internalFormat, image.width, image.height);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment((size_t)image.width * image.channels));
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image.width, image.height, format, GL_UNSIGNED_BYTE, image.pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     glGenerateMipmap(GL_TEXTURE_2D);
+    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+    textureID.setSize(GLMEM_TEXTURE, textureBytes(image.width, image.height, internalFormat == GL_SRGB8 ? 3 : image.channels, levels));
+    countUpload(textureBytes(image.width, image.height, image.channels));
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    SDL_FreeSurface(surf);
-    
+    AssetLog::get().uploaded("texture", label, elapsedMs(start));
     return textureID;
 }
 
@@ -597,28 +1178,55 @@ inline unsigned int textureFromFile(const char *path, const string &directory, b
  * @brief Loads a cubemap from a list of file paths
  * 
  * @param faces List of paths to cubemap sides
- * @return unsigned int 
+ * @return GLTexture owning the cubemap (empty on failure, or without a GL context)
  */
-inline unsigned int loadCubemap(vector<std::string> faces) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
+inline GLTexture loadCubemap(vector<std::string> faces) {
+    if (!glContextCurrent())
+        return GLTexture();
+    auto start = std::chrono::steady_clock::now();
+
+    GLTexture textureID;
+    textureID.create();
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+    if (!faces.empty())
+        labelObject(GL_TEXTURE, textureID, "Cubemap " + faces.at(0));
     
-    int width, height;
+    // faces share the storage allocated for the first one; GL converts the others' formats as they are uploaded
+    int width = 0, height = 0, channels = 3;
     for (unsigned int i = 0; i < faces.size(); i ++) {
         SDL_Surface* surf = IMG_Load(faces.at(i).c_str());
-        if (surf == NULL) {
-            SDL_Log("Unable to initialize texture: %s\n", IMG_GetError()); return 0;
+        TextureImage image;
+        if (surf == NULL || !decodeSurface(surf, false, image)) {
+            LOG_ERROR("assets", "Unable to load texture %s: %s", faces.at(i), IMG_GetError());
+            if (surf != NULL)
+                SDL_FreeSurface(surf);
+            AssetLog::get().loaded("cubemap", faces.at(0), ASSET_FAILED, elapsedMs(start));
+            return GLTexture();
         }
-        //flipSurface(surf);
-
-        void *data = surf->pixels;
-        width = surf->w;
-        height = surf->h;
-        
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
         SDL_FreeSurface(surf);
+
+        GLenum internalFormat, format;
+        GLint swizzle[4];
+        textureFormats(image, false, internalFormat, format, swizzle);
+        if (i == 0) {
+            width = image.width;
+            height = image.height;
+            channels = image.channels;
+            glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, internalFormat, width, height);
+            glTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        }
+        if (image.width != width || image.height != height || (image.channels < 3) != (channels < 3)) {
+            LOG_ERROR("assets", "Cubemap face %s does not match %s", faces.at(i), faces.at(0));
+            AssetLog::get().loaded("cubemap", faces.at(0), ASSET_FAILED, elapsedMs(start));
+            return GLTexture();
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment((size_t)image.width * image.channels));
+        glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, image.pixels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
     }
+    textureID.setSize(GLMEM_TEXTURE, faces.size() * textureBytes(width, height, channels));
+    countUpload(faces.size() * textureBytes(width, height, channels));
 
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -626,6 +1234,8 @@ inline unsigned int loadCubemap(vector<std::string> faces) {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
+    if (!faces.empty())
+        AssetLog::get().loaded("cubemap", faces.at(0), ASSET_READY, elapsedMs(start));
     return textureID;
 }
 
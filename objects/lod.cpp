@@ -0,0 +1,461 @@
+/**
+ * @file lod.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Level-of-detail chains for meshes
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "lod.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+/**
+ * @brief Sum of squared distances to a set of planes, as the symmetric 4x4 matrix of Garland and Heckbert (upper triangle)
+ */
+struct Quadric {
+    double a[10];
+
+    Quadric() {
+        memset(a, 0, sizeof(a));
+    }
+
+    // the plane n.p + d = 0 (n unit length)
+    Quadric(const glm::dvec3& n, double d) {
+        a[0] = n.x * n.x; a[1] = n.x * n.y; a[2] = n.x * n.z; a[3] = n.x * d;
+        a[4] = n.y * n.y; a[5] = n.y * n.z; a[6] = n.y * d;
+        a[7] = n.z * n.z; a[8] = n.z * d;
+        a[9] = d * d;
+    }
+
+    void add(const Quadric& q) {
+        for (int i = 0; i < 10; i ++)
+            a[i] += q.a[i];
+    }
+
+    double evaluate(const glm::dvec3& p) const {
+        return a[0] * p.x * p.x + 2 * a[1] * p.x * p.y + 2 * a[2] * p.x * p.z + 2 * a[3] * p.x
+            + a[4] * p.y * p.y + 2 * a[5] * p.y * p.z + 2 * a[6] * p.y
+            + a[7] * p.z * p.z + 2 * a[8] * p.z
+            + a[9];
+    }
+};
+
+/**
+ * @brief A candidate collapse of vertex from onto vertex to, valid while neither changed since it was queued
+ */
+struct Collapse {
+    double cost;
+    unsigned int from, to;
+    unsigned int fromStamp, toStamp;
+
+    bool operator<(const Collapse& other) const {
+        return cost > other.cost;   // cheapest on top of std::priority_queue
+    }
+};
+
+/**
+ * @brief Edge-collapse state of one mesh, on its vertices welded by position so the surface is simplified as one piece across UV
+ * and normal seams. Vertices on a seam (whose originals differ in more than position) are locked, so seams keep their shape and
+ * every remaining corner draws with the attributes of its own side of the seam
+ */
+class Simplifier {
+    public:
+        Simplifier(const float* vertices, int stride, int vertexCount, const vector<unsigned int>& indices);
+
+        void simplify(size_t targetTriangles);
+        void write(vector<unsigned int>& out) const;
+
+        size_t triangles() const { return live; }
+        float error() const { return (float)sqrt(std::max(0.0, maxCost)); }
+
+    private:
+        vector<glm::dvec3> positions;       // per welded vertex
+        vector<unsigned int> original;      // an original vertex at each welded position
+        vector<bool> seams;                 // whether the originals at a welded position differ in more than position
+        vector<Quadric> quadrics;
+        vector<bool> locked;                // on an open border or a seam: never removed
+        vector<bool> removed;
+        vector<unsigned int> stamps;        // bumped whenever a vertex moves or its neighbourhood changes
+        vector<vector<unsigned int> > around;   // triangles around each welded vertex (may list dead ones)
+
+        vector<unsigned int> corners;       // welded vertex of each corner
+        vector<unsigned int> originals;     // original vertex each corner draws with
+        vector<bool> dead;
+        size_t live;
+
+        std::priority_queue<Collapse> queue;
+        double maxCost;
+
+        void push(unsigned int u, unsigned int v);
+        bool flips(unsigned int from, unsigned int to) const;
+        void collapse(unsigned int from, unsigned int to);
+};
+
+/**
+ * @brief Welds the vertices, accumulates the face quadrics and queues every edge
+ *
+ * @param vertices Interleaved vertices, position first
+ * @param stride Floats per vertex
+ * @param vertexCount Number of vertices
+ * @param indices Triangle list
+ */
+Simplifier::Simplifier(const float* vertices, int stride, int vertexCount, const vector<unsigned int>& indices) : live(0), maxCost(0) {
+    // weld by exact position
+    struct Key {
+        float x, y, z;
+        bool operator==(const Key& o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            unsigned int h[3];
+            memcpy(h, &k, sizeof(h));
+            return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+        }
+    };
+    std::unordered_map<Key, unsigned int, KeyHash> welded;
+    vector<unsigned int> weld(vertexCount);
+    for (int i = 0; i < vertexCount; i ++) {
+        const float* p = vertices + (size_t)i * stride;
+        Key key = { p[0], p[1], p[2] };
+        auto it = welded.find(key);
+        if (it == welded.end()) {
+            it = welded.insert(std::make_pair(key, (unsigned int)positions.size())).first;
+            positions.push_back(glm::dvec3(p[0], p[1], p[2]));
+            original.push_back(i);
+        }
+        weld[i] = it->second;
+    }
+
+    // a position is on a seam when the triangles draw it with originals that differ in more than position
+    size_t count = positions.size();
+    vector<bool> referenced(count, false);
+    seams.assign(count, false);
+    for (unsigned int i : indices) {
+        unsigned int w = weld[i];
+        if (!referenced[w]) {
+            referenced[w] = true;
+            original[w] = i;
+        } else if (memcmp(vertices + (size_t)i * stride + 3, vertices + (size_t)original[w] * stride + 3, (stride - 3) * sizeof(float)) != 0)
+            seams[w] = true;
+    }
+
+    quadrics.resize(count);
+    locked = seams;
+    removed.assign(count, false);
+    stamps.assign(count, 0);
+    around.resize(count);
+
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        unsigned int a = weld[indices[t]], b = weld[indices[t + 1]], c = weld[indices[t + 2]];
+        if (a == b || b == c || a == c)
+            continue;
+        unsigned int id = corners.size() / 3;
+        corners.push_back(a); corners.push_back(b); corners.push_back(c);
+        originals.push_back(indices[t]); originals.push_back(indices[t + 1]); originals.push_back(indices[t + 2]);
+        dead.push_back(false);
+        live ++;
+        around[a].push_back(id);
+        around[b].push_back(id);
+        around[c].push_back(id);
+
+        glm::dvec3 n = glm::cross(positions[b] - positions[a], positions[c] - positions[a]);
+        double length = glm::length(n);
+        if (length > 0) {
+            n /= length;
+            Quadric q(n, -glm::dot(n, positions[a]));
+            quadrics[a].add(q);
+            quadrics[b].add(q);
+            quadrics[c].add(q);
+        }
+    }
+
+    // an edge used by a single triangle is an open border; its vertices stay, so levels do not open holes
+    std::unordered_map<unsigned long long, int> edges;
+    for (size_t t = 0; t < dead.size(); t ++) {
+        for (int k = 0; k < 3; k ++) {
+            unsigned int u = corners[t * 3 + k], v = corners[t * 3 + (k + 1) % 3];
+            edges[((unsigned long long)std::min(u, v) << 32) | std::max(u, v)] ++;
+        }
+    }
+    for (auto& edge : edges) {
+        if (edge.second == 1) {
+            locked[edge.first >> 32] = true;
+            locked[edge.first & 0xFFFFFFFFu] = true;
+        }
+    }
+
+    for (size_t t = 0; t < dead.size(); t ++) {
+        for (int k = 0; k < 3; k ++) {
+            unsigned int u = corners[t * 3 + k], v = corners[t * 3 + (k + 1) % 3];
+            if (u < v)
+                push(u, v);
+        }
+    }
+}
+
+/**
+ * @brief Queues the cheaper direction of collapsing an edge
+ *
+ * @param u One end
+ * @param v Other end
+ */
+void Simplifier::push(unsigned int u, unsigned int v) {
+    Quadric q = quadrics[u];
+    q.add(quadrics[v]);
+    double toV = locked[u] ? INFINITY : q.evaluate(positions[v]);
+    double toU = locked[v] ? INFINITY : q.evaluate(positions[u]);
+    if (std::isinf(toV) && std::isinf(toU))
+        return;
+
+    Collapse c;
+    if (toV <= toU) {
+        c.cost = toV; c.from = u; c.to = v;
+    } else {
+        c.cost = toU; c.from = v; c.to = u;
+    }
+    c.fromStamp = stamps[c.from];
+    c.toStamp = stamps[c.to];
+    queue.push(c);
+}
+
+/**
+ * @brief Returns whether moving a vertex onto another would fold the surface: turn a surrounding triangle over (or make it
+ * degenerate), or join two vertices sharing more neighbours than the triangles on their edge (which pinches the surface)
+ *
+ * @param from Vertex that would be removed
+ * @param to Vertex it would move onto
+ * @return bool
+ */
+bool Simplifier::flips(unsigned int from, unsigned int to) const {
+    vector<unsigned int> fromNeighbours, toNeighbours;
+    int shared = 0;
+    for (int pass = 0; pass < 2; pass ++) {
+        unsigned int vertex = pass == 0 ? from : to;
+        vector<unsigned int>& neighbours = pass == 0 ? fromNeighbours : toNeighbours;
+        for (unsigned int t : around[vertex]) {
+            if (dead[t])
+                continue;
+            const unsigned int* c = &corners[t * 3];
+            if (pass == 0 && (c[0] == to || c[1] == to || c[2] == to))
+                shared ++;
+            for (int k = 0; k < 3; k ++) {
+                if (c[k] != from && c[k] != to && std::find(neighbours.begin(), neighbours.end(), c[k]) == neighbours.end())
+                    neighbours.push_back(c[k]);
+            }
+        }
+    }
+    int common = 0;
+    for (unsigned int n : fromNeighbours)
+        common += std::find(toNeighbours.begin(), toNeighbours.end(), n) != toNeighbours.end();
+    if (common != shared)
+        return true;
+
+    for (unsigned int t : around[from]) {
+        if (dead[t])
+            continue;
+        const unsigned int* c = &corners[t * 3];
+        if (c[0] == to || c[1] == to || c[2] == to)
+            continue;   // collapses away
+        glm::dvec3 p[3], q[3];
+        for (int k = 0; k < 3; k ++) {
+            p[k] = positions[c[k]];
+            q[k] = c[k] == from ? positions[to] : p[k];
+        }
+        glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+        glm::dvec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+        if (glm::dot(before, after) <= 0.0 || glm::dot(after, after) < 1e-24)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Moves a vertex onto another, dropping the triangles that become degenerate. The moved corners draw with the original
+ * vertex the collapsing triangles use at the kept one: the removed vertex is never on a seam, so all its triangles lie on that side
+ * of any seam through the kept vertex
+ *
+ * @param from Vertex removed
+ * @param to Vertex kept
+ */
+void Simplifier::collapse(unsigned int from, unsigned int to) {
+    unsigned int wedge = original[to];
+    for (unsigned int t : around[from]) {
+        const unsigned int* c = &corners[t * 3];
+        if (dead[t] || (c[0] != to && c[1] != to && c[2] != to))
+            continue;
+        for (int k = 0; k < 3; k ++) {
+            if (c[k] == to)
+                wedge = originals[t * 3 + k];
+        }
+        break;
+    }
+
+    for (unsigned int t : around[from]) {
+        if (dead[t])
+            continue;
+        unsigned int* c = &corners[t * 3];
+        if (c[0] == to || c[1] == to || c[2] == to) {
+            dead[t] = true;
+            live --;
+            continue;
+        }
+        for (int k = 0; k < 3; k ++) {
+            if (c[k] == from) {
+                c[k] = to;
+                originals[t * 3 + k] = wedge;
+            }
+        }
+        around[to].push_back(t);
+    }
+    around[from].clear();
+    removed[from] = true;
+    quadrics[to].add(quadrics[from]);
+    stamps[to] ++;
+
+    // requeue the edges around the kept vertex, and drop triangles gone from its list
+    vector<unsigned int> kept;
+    vector<unsigned int> neighbours;
+    for (unsigned int t : around[to]) {
+        if (dead[t] || std::find(kept.begin(), kept.end(), t) != kept.end())
+            continue;
+        kept.push_back(t);
+        for (int k = 0; k < 3; k ++) {
+            unsigned int n = corners[t * 3 + k];
+            if (n != to && std::find(neighbours.begin(), neighbours.end(), n) == neighbours.end())
+                neighbours.push_back(n);
+        }
+    }
+    around[to] = kept;
+    for (unsigned int n : neighbours)
+        push(to, n);
+}
+
+/**
+ * @brief Collapses the cheapest edges until at most targetTriangles remain, or no collapse is left that keeps the surface the right way round
+ *
+ * @param targetTriangles Triangles to stop at
+ */
+void Simplifier::simplify(size_t targetTriangles) {
+    while (live > targetTriangles && !queue.empty()) {
+        Collapse c = queue.top();
+        queue.pop();
+        if (removed[c.from] || removed[c.to] || stamps[c.from] != c.fromStamp || stamps[c.to] != c.toStamp)
+            continue;
+        if (flips(c.from, c.to))
+            continue;
+        maxCost = std::max(maxCost, c.cost);
+        collapse(c.from, c.to);
+    }
+}
+
+/**
+ * @brief Appends the remaining triangles, indexing the original vertices
+ *
+ * @param out Index list to append to
+ */
+void Simplifier::write(vector<unsigned int>& out) const {
+    for (size_t t = 0; t < dead.size(); t ++) {
+        if (dead[t])
+            continue;
+        out.push_back(originals[t * 3]);
+        out.push_back(originals[t * 3 + 1]);
+        out.push_back(originals[t * 3 + 2]);
+    }
+}
+
+/**
+ * @brief Builds the levels of a mesh. Level 0 is the mesh as given; every further level keeps about MESH_LOD_RATIO of the triangles of the one before and is appended to the same index list
+ *
+ * @param vertices Interleaved vertices, position first
+ * @param stride Floats per vertex
+ * @param vertexCount Number of vertices
+ * @param indices Triangle list of the full mesh, receiving the other levels after it
+ * @param lods Receives MESH_LOD_LEVELS levels; a mesh too small to simplify repeats its last level
+ */
+void buildLods(const float* vertices, int stride, int vertexCount, vector<unsigned int>& indices, vector<MeshLod>& lods) {
+    lods.clear();
+    MeshLod full = { 0, (unsigned int)indices.size(), 0.0f };
+    lods.push_back(full);
+    if (indices.size() / 3 < MESH_LOD_MIN_TRIANGLES) {
+        while (lods.size() < MESH_LOD_LEVELS)
+            lods.push_back(full);
+        return;
+    }
+
+    // each level continues from the last, so errors only grow
+    Simplifier simplifier(vertices, stride, vertexCount, indices);
+    size_t target = indices.size() / 3;
+    while (lods.size() < MESH_LOD_LEVELS) {
+        target = std::max((size_t)MESH_LOD_MIN_TRIANGLES, (size_t)(target * MESH_LOD_RATIO));
+        simplifier.simplify(target);
+        MeshLod level;
+        level.firstIndex = indices.size();
+        level.error = simplifier.error();
+        simplifier.write(indices);
+        level.count = indices.size() - level.firstIndex;
+        lods.push_back(level);
+    }
+}
+
+/**
+ * @brief Construct a new LodView object that always picks the full meshes
+ */
+LodView::LodView() : position(0), pixelsPerUnit(1), threshold(0), update(false) {}
+
+/**
+ * @brief Construct a new LodView object
+ *
+ * @param position Camera position
+ * @param fovY Vertical field of view (radians)
+ * @param viewportHeight Height of the viewport in pixels
+ * @param threshold Pixels of error allowed, 0 to always draw the full meshes
+ * @param update Whether the pass picks levels (see LodView::update)
+ */
+LodView::LodView(const glm::vec3& position, float fovY, int viewportHeight, float threshold, bool update)
+    : position(position), pixelsPerUnit(viewportHeight / (2.0f * tanf(fovY * 0.5f))), threshold(threshold), update(update) {}
+
+/**
+ * @brief Returns the distance from the camera to the bounding sphere of a transformed object, in object units so object-space errors compare with it
+ *
+ * @param transform Model matrix of the object
+ * @param boundsMin Object-space bounding box, lower corner
+ * @param boundsMax Object-space bounding box, upper corner
+ * @param camera Camera position
+ * @return float 0 inside the sphere
+ */
+float lodDistance(const glm::mat4& transform, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec3& camera) {
+    float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+    glm::vec3 center = glm::vec3(transform * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+    float radius = glm::length(boundsMax - boundsMin) * 0.5f * scale;
+    return std::max(glm::length(camera - center) - radius, 0.0f) / std::max(scale, 1e-6f);
+}
+
+/**
+ * @brief Picks the coarsest level whose error covers at most view.threshold pixels. Leaving the current level takes a margin of MESH_LOD_HYSTERESIS, so an object at a boundary keeps its level. cull.cs mirrors this
+ *
+ * @param errors Object-space error of each level, growing
+ * @param distance Distance from the camera to the object (its nearest point)
+ * @param view Camera of the pass
+ * @param current Level drawn last frame
+ * @return int
+ */
+int selectLod(const vector<float>& errors, float distance, const LodView& view, int current) {
+    if (view.threshold <= 0 || errors.empty())
+        return 0;
+    current = std::min(std::max(current, 0), (int)errors.size() - 1);
+    float scale = view.pixelsPerUnit / std::max(distance, 1e-3f);
+
+    // finer while the current level's error is clearly too large, coarser while the next one's is clearly small enough
+    while (current > 0 && errors[current] * scale > view.threshold * (1.0f + MESH_LOD_HYSTERESIS))
+        current --;
+    while (current + 1 < (int)errors.size() && errors[current + 1] * scale < view.threshold * (1.0f - MESH_LOD_HYSTERESIS))
+        current ++;
+    return current;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file lod.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Level-of-detail chains for meshes. Levels are built at import by quadric-error edge collapse (Garland and Heckbert) onto existing vertices, so every level indexes the same vertex buffer, and picked at run time by the screen-space size of their error
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef LOD_H
+#define LOD_H
+
+#include <vector>
+using std::vector;
+
+#include <glm/glm.hpp>
+
+// levels per mesh, the full mesh included, and the share of triangles each keeps of the previous one
+#define MESH_LOD_LEVELS 4
+#define MESH_LOD_RATIO 0.25f
+
+// meshes with fewer triangles are not simplified further
+#define MESH_LOD_MIN_TRIANGLES 32
+
+// how far (as a share of the error threshold) an object must cross a level's threshold before it switches, so it does not flicker between two levels
+#define MESH_LOD_HYSTERESIS 0.25f
+
+/**
+ * @brief One level of a mesh: a range of its index buffer
+ */
+struct MeshLod {
+    unsigned int firstIndex;
+    unsigned int count;
+    float error;        // object-space distance the level may stray from the full mesh
+};
+
+/**
+ * @brief Camera a pass picks levels for
+ */
+struct LodView {
+    glm::vec3 position;
+    float pixelsPerUnit;    // pixels covered by one unit at distance 1
+    float threshold;        // pixels of error allowed, 0 to always draw the full meshes
+    bool update;            // whether the pass picks levels, or reuses the last ones picked (mirrored passes)
+
+    LodView();
+    LodView(const glm::vec3& position, float fovY, int viewportHeight, float threshold, bool update);
+};
+
+void buildLods(const float* vertices, int stride, int vertexCount, vector<unsigned int>& indices, vector<MeshLod>& lods);
+float lodDistance(const glm::mat4& transform, const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::vec3& camera);
+int selectLod(const vector<float>& errors, float distance, const LodView& view, int current);
+
+#endif
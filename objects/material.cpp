@@ -0,0 +1,239 @@
+/**
+ * @file material.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Material tables
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "material.h"
+
+#include <string.h>
+
+/**
+ * @brief Size, format and swizzle of a texture; textures sharing all of them can be layers of one array
+ */
+struct TextureLayout {
+    GLint width, height, levels;
+    GLint internalFormat;
+    GLint swizzle[4];
+
+    bool operator==(const TextureLayout& other) const {
+        return width == other.width && height == other.height && levels == other.levels && internalFormat == other.internalFormat
+            && memcmp(swizzle, other.swizzle, sizeof(swizzle)) == 0;
+    }
+};
+
+/**
+ * @brief Reads the layout of a 2D texture made by uploadTexture
+ *
+ * @param texture Texture name
+ * @return TextureLayout
+ */
+static TextureLayout textureLayout(GLuint texture) {
+    TextureLayout layout;
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &layout.width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &layout.height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &layout.internalFormat);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_LEVELS, &layout.levels);
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, layout.swizzle);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return layout;
+}
+
+/**
+ * @brief Returns the bytes per texel uploadTexture accounts a format with
+ *
+ * @param internalFormat One of the formats textureFormats picks
+ * @return int
+ */
+static int formatBytes(GLint internalFormat) {
+    switch (internalFormat) {
+        case GL_R8:     return 1;
+        case GL_RG8:    return 2;
+        case GL_RGB8:
+        case GL_SRGB8:  return 3;
+        default:        return 4;
+    }
+}
+
+/**
+ * @brief Construct a new MaterialTable object from the uploaded textures of a model. Check valid() before drawing with it
+ *
+ * @param model Uploaded model (not owned)
+ * @param bindless Use bindless handles when the driver supports them, else texture arrays
+ */
+MaterialTable::MaterialTable(Model* model, bool bindless) : model(model), bindless(bindless && GLEW_ARB_bindless_texture), packed(true) {
+    if (bindless && !this->bindless)
+        LOG_WARN("assets", "ARB_bindless_texture is not supported, materials of %s use texture arrays", model->directory);
+
+    // one material per distinct diffuse texture, 0 standing for meshes without one
+    vector<GLuint> textures;
+    for (const Mesh& mesh : model->meshes) {
+        GLuint diffuse = 0;
+        for (const Texture& texture : mesh.textures) {
+            if (texture.type == "texture_diffuse") {
+                diffuse = texture.id;
+                break;
+            }
+        }
+        int material = std::find(textures.begin(), textures.end(), diffuse) - textures.begin();
+        if (material == (int)textures.size())
+            textures.push_back(diffuse);
+        meshMaterials.push_back(material);
+    }
+
+    // layouts of the arrays, and the array and layer of each texture
+    vector<TextureLayout> layouts;
+    vector<int> layerCounts;
+    materials.resize(textures.size());
+    for (unsigned int i = 0; i < textures.size(); i ++) {
+        GpuMaterial& material = materials[i];
+        material.diffuseArray = -1;
+        material.diffuseLayer = 0;
+        material.diffuseHandle = glm::uvec2(0);
+        if (textures[i] == 0)
+            continue;
+
+        if (this->bindless) {
+            GLuint64 handle = glGetTextureHandleARB(textures[i]);
+            glMakeTextureHandleResidentARB(handle);
+            handles.push_back(handle);
+            material.diffuseHandle = glm::uvec2((unsigned int)(handle & 0xFFFFFFFFu), (unsigned int)(handle >> 32));
+            continue;
+        }
+
+        TextureLayout layout = textureLayout(textures[i]);
+        int array = std::find(layouts.begin(), layouts.end(), layout) - layouts.begin();
+        if (array == (int)layouts.size()) {
+            if (array == MATERIAL_MAX_ARRAYS) {
+                packed = false;
+                continue;
+            }
+            layouts.push_back(layout);
+            layerCounts.push_back(0);
+        }
+        material.diffuseArray = array;
+        material.diffuseLayer = layerCounts[array] ++;
+    }
+    if (!packed) {
+        LOG_WARN("assets", "Textures of %s need more than %d texture arrays, materials are bound per mesh", model->directory, MATERIAL_MAX_ARRAYS);
+        return;
+    }
+
+    // copies every level of each texture into its layer; the arrays sample as the textures they replace
+    for (unsigned int a = 0; a < layouts.size(); a ++) {
+        const TextureLayout& layout = layouts[a];
+        GLTexture array;
+        array.create();
+        glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+        glTexStorage3D(GL_TEXTURE_2D_ARRAY, layout.levels, layout.internalFormat, layout.width, layout.height, layerCounts[a]);
+        array.setSize(GLMEM_TEXTURE, textureBytes(layout.width, layout.height, formatBytes(layout.internalFormat), layout.levels) * layerCounts[a]);
+        glTexParameteriv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_SWIZZLE_RGBA, layout.swizzle);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        labelObject(GL_TEXTURE, array, model->directory + " material array " + std::to_string(a));
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        arrays.push_back(std::move(array));
+    }
+    for (unsigned int i = 0; i < textures.size(); i ++) {
+        const GpuMaterial& material = materials[i];
+        if (material.diffuseArray < 0)
+            continue;
+        const TextureLayout& layout = layouts[material.diffuseArray];
+        for (int level = 0; level < layout.levels; level ++) {
+            glCopyImageSubData(textures[i], GL_TEXTURE_2D, level, 0, 0, 0, arrays[material.diffuseArray], GL_TEXTURE_2D_ARRAY, level, 0, 0, material.diffuseLayer,
+                std::max(1, layout.width >> level), std::max(1, layout.height >> level), 1);
+        }
+    }
+
+    materialSSBO.create();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, materialSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max((size_t)1, materials.size()) * sizeof(GpuMaterial), materials.empty() ? NULL : materials.data(), GL_STATIC_DRAW);
+    materialSSBO.setSize(GLMEM_STORAGE, std::max((size_t)1, materials.size()) * sizeof(GpuMaterial));
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    countUpload(materials.size() * sizeof(GpuMaterial));
+    labelObject(GL_BUFFER, materialSSBO, model->directory + " materials");
+
+    string storage = this->bindless ? string("bindless handles") : std::to_string(arrays.size()) + " texture arrays";
+    LOG_INFO("assets", "Materials of %s: %d, in %s", model->directory, (int)materials.size(), storage);
+}
+
+/**
+ * @brief Destroy the MaterialTable object, releasing its resident handles
+ */
+MaterialTable::~MaterialTable() {
+    for (GLuint64 handle : handles)
+        glMakeTextureHandleNonResidentARB(handle);
+}
+
+/**
+ * @brief Returns whether every material could be placed, so draws may use the table
+ *
+ * @return bool
+ */
+bool MaterialTable::valid() const {
+    return packed;
+}
+
+/**
+ * @brief Returns whether materials are addressed through bindless handles rather than texture arrays
+ *
+ * @return bool
+ */
+bool MaterialTable::isBindless() const {
+    return bindless;
+}
+
+/**
+ * @brief Returns the material a mesh of the model draws with
+ *
+ * @param mesh Index into the model's meshes
+ * @return int index into the table
+ */
+int MaterialTable::getMaterial(int mesh) const {
+    return meshMaterials[mesh];
+}
+
+/**
+ * @brief Returns how many materials the table holds
+ *
+ * @return int
+ */
+int MaterialTable::getMaterialCount() const {
+    return materials.size();
+}
+
+/**
+ * @brief Binds the material entries and arrays, and points backpack.fs at them. Draws made until materialTable is set false again
+ * read their material from the table
+ *
+ * @param shader Shader in use, whose materialArrays were assigned with assignUnits
+ */
+void MaterialTable::bind(Shader* shader) {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDING, materialSSBO);
+    for (unsigned int a = 0; a < arrays.size(); a ++) {
+        glActiveTexture(GL_TEXTURE0 + MATERIAL_FIRST_UNIT + a);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[a]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+    shader->setBool("materialTable", true);
+    shader->setBool("bindless", bindless);
+}
+
+/**
+ * @brief Points a shader's materialArrays samplers at units of their own, once after linking; left on unit 0 they would clash
+ * with the 2D samplers of meshes bound per draw
+ *
+ * @param shader Shader declaring materialArrays[MATERIAL_MAX_ARRAYS]
+ */
+void MaterialTable::assignUnits(Shader* shader) {
+    shader->use();
+    for (int a = 0; a < MATERIAL_MAX_ARRAYS; a ++)
+        shader->setInt("materialArrays[" + std::to_string(a) + "]", MATERIAL_FIRST_UNIT + a);
+}
@@ -0,0 +1,60 @@
+/**
+ * @file material.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Material tables. The textures of a model's materials are gathered once, either copied into layers of texture arrays grouped by size and format or, where ARB_bindless_texture is supported, made resident as handles, and each material is described by an entry of a storage buffer; draws then pick their material by index instead of binding textures, so one multi-draw can cover meshes with different materials
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include "helper.h"
+
+// texture arrays a table binds, and the unit the first goes to (units below are left to bindMaterialTextures)
+#define MATERIAL_MAX_ARRAYS 4
+#define MATERIAL_FIRST_UNIT 8
+
+// storage buffer binding of the material entries in backpack.fs
+#define MATERIAL_BINDING 2
+
+/**
+ * @brief A material as backpack.fs reads it (std430). Only the diffuse texture is sampled
+ */
+struct GpuMaterial {
+    int diffuseArray;           // texture array holding the diffuse texture, -1 for none (or when bindless)
+    int diffuseLayer;
+    glm::uvec2 diffuseHandle;   // bindless handle, low word first; 0 unless bindless
+};
+
+/**
+ * @brief Materials of a model, one per distinct diffuse texture, addressed by index from the draws
+ */
+class MaterialTable {
+    public:
+        MaterialTable(Model* model, bool bindless);
+        ~MaterialTable();
+
+        bool valid() const;
+        bool isBindless() const;
+        int getMaterial(int mesh) const;
+        int getMaterialCount() const;
+
+        void bind(Shader* shader);
+
+        static void assignUnits(Shader* shader);
+
+    private:
+        Model* model;
+        bool bindless;
+        bool packed;                    // false if the textures needed more than MATERIAL_MAX_ARRAYS arrays
+        vector<int> meshMaterials;      // material of each mesh
+        vector<GpuMaterial> materials;
+        vector<GLTexture> arrays;
+        vector<GLuint64> handles;       // resident while the table lives
+        GLBuffer materialSSBO;
+};
+
+#endif
@@ -0,0 +1,174 @@
+/**
+ * @file meshlet.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Meshlets: small clusters of neighbouring triangles
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "meshlet.h"
+
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Computes the bounding sphere and normal cone of a meshlet
+ *
+ * @param vertices Interleaved vertices, position first
+ * @param stride Floats per vertex
+ * @param indices Index list holding the meshlet
+ * @param meshlet Meshlet whose range is set, receiving its bounds
+ */
+static void boundMeshlet(const float* vertices, int stride, const vector<unsigned int>& indices, Meshlet& meshlet) {
+    auto position = [&](unsigned int i) {
+        const float* p = vertices + (size_t)indices[i] * stride;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    glm::vec3 bmin = position(meshlet.firstIndex), bmax = bmin;
+    for (unsigned int i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.count; i ++) {
+        bmin = glm::min(bmin, position(i));
+        bmax = glm::max(bmax, position(i));
+    }
+    meshlet.center = (bmin + bmax) * 0.5f;
+    meshlet.radius = 0;
+    for (unsigned int i = meshlet.firstIndex; i < meshlet.firstIndex + meshlet.count; i ++)
+        meshlet.radius = std::max(meshlet.radius, glm::length(position(i) - meshlet.center));
+
+    // the cone around the mean face normal holding every face normal
+    vector<glm::vec3> normals;
+    glm::vec3 sum(0);
+    for (unsigned int i = meshlet.firstIndex; i + 2 < meshlet.firstIndex + meshlet.count; i += 3) {
+        glm::vec3 n = glm::cross(position(i + 1) - position(i), position(i + 2) - position(i));
+        float length = glm::length(n);
+        if (length <= 0)
+            continue;
+        normals.push_back(n / length);
+        sum += normals.back();
+    }
+    meshlet.coneAxis = glm::vec3(0);
+    meshlet.coneCutoff = 1;
+    float length = glm::length(sum);
+    if (normals.empty() || length <= 0)
+        return;
+
+    glm::vec3 axis = sum / length;
+    float spread = 1;
+    for (const glm::vec3& n : normals)
+        spread = std::min(spread, glm::dot(axis, n));
+    if (spread <= MESHLET_CONE_MIN_SPREAD)
+        return;
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = sqrtf(1 - spread * spread);
+}
+
+/**
+ * @brief Splits the first count indices of a mesh into meshlets and reorders those triangles so each meshlet is a contiguous range.
+ * Meshlets grow greedily from a seed triangle, taking the neighbouring triangle that adds the fewest new vertices (then the one
+ * closest to the meshlet's centre), until a limit is reached or no neighbour is left
+ *
+ * @param vertices Interleaved vertices, position first
+ * @param stride Floats per vertex
+ * @param vertexCount Number of vertices
+ * @param indices Triangle list; its first count indices are reordered (triangles keep their winding)
+ * @param count Indices to split, e.g. the full level of detail
+ * @param meshlets Receives the meshlets, in index order
+ */
+void buildMeshlets(const float* vertices, int stride, int vertexCount, vector<unsigned int>& indices, unsigned int count, vector<Meshlet>& meshlets) {
+    meshlets.clear();
+    unsigned int triangles = count / 3;
+
+    // triangles around each vertex, as offsets into one list
+    vector<unsigned int> offsets(vertexCount + 1, 0), around(triangles * 3);
+    for (unsigned int i = 0; i < triangles * 3; i ++)
+        offsets[indices[i] + 1] ++;
+    for (int v = 0; v < vertexCount; v ++)
+        offsets[v + 1] += offsets[v];
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (unsigned int t = 0; t < triangles; t ++) {
+        for (int k = 0; k < 3; k ++)
+            around[fill[indices[t * 3 + k]] ++] = t;
+    }
+
+    auto centroid = [&](unsigned int t) {
+        glm::vec3 c(0);
+        for (int k = 0; k < 3; k ++) {
+            const float* p = vertices + (size_t)indices[t * 3 + k] * stride;
+            c += glm::vec3(p[0], p[1], p[2]);
+        }
+        return c / 3.0f;
+    };
+
+    vector<bool> emitted(triangles, false);
+    vector<unsigned int> order;     // triangles in meshlet order
+    order.reserve(triangles);
+    vector<unsigned int> clusterVertices;
+    unsigned int seed = 0;
+    while (true) {
+        while (seed < triangles && emitted[seed])
+            seed ++;
+        if (seed == triangles)
+            break;
+
+        Meshlet meshlet;
+        meshlet.firstIndex = order.size() * 3;
+        clusterVertices.clear();
+        glm::vec3 center(0);
+        unsigned int taken = 0;
+        unsigned int next = seed;
+        while (true) {
+            // take the triangle
+            emitted[next] = true;
+            order.push_back(next);
+            center = (center * (float)taken + centroid(next)) / (float)(taken + 1);
+            taken ++;
+            for (int k = 0; k < 3; k ++) {
+                unsigned int v = indices[next * 3 + k];
+                if (std::find(clusterVertices.begin(), clusterVertices.end(), v) == clusterVertices.end())
+                    clusterVertices.push_back(v);
+            }
+            if (taken == MESHLET_MAX_TRIANGLES)
+                break;
+
+            // pick the next among the triangles touching the meshlet's vertices
+            int bestNew = 4;
+            float bestDistance = 0;
+            bool found = false;
+            for (unsigned int v : clusterVertices) {
+                for (unsigned int a = offsets[v]; a < offsets[v + 1]; a ++) {
+                    unsigned int t = around[a];
+                    if (emitted[t])
+                        continue;
+                    int added = 0;
+                    for (int k = 0; k < 3; k ++)
+                        added += std::find(clusterVertices.begin(), clusterVertices.end(), indices[t * 3 + k]) == clusterVertices.end();
+                    if (clusterVertices.size() + added > MESHLET_MAX_VERTICES)
+                        continue;
+                    float distance = glm::length(centroid(t) - center);
+                    if (!found || added < bestNew || (added == bestNew && distance < bestDistance)) {
+                        found = true;
+                        bestNew = added;
+                        bestDistance = distance;
+                        next = t;
+                    }
+                }
+            }
+            if (!found)
+                break;
+        }
+        meshlet.count = taken * 3;
+        meshlets.push_back(meshlet);
+    }
+
+    // rewrite the range in meshlet order, then bound each meshlet
+    vector<unsigned int> reordered(triangles * 3);
+    for (unsigned int i = 0; i < triangles; i ++) {
+        for (int k = 0; k < 3; k ++)
+            reordered[i * 3 + k] = indices[order[i] * 3 + k];
+    }
+    std::copy(reordered.begin(), reordered.end(), indices.begin());
+    for (Meshlet& meshlet : meshlets)
+        boundMeshlet(vertices, stride, indices, meshlet);
+}
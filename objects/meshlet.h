@@ -0,0 +1,40 @@
+/**
+ * @file meshlet.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Meshlets: small clusters of neighbouring triangles with a bounding sphere and a cone bounding their normals, so dense meshes can be culled piece by piece (frustum, back faces, occlusion) instead of as a whole
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef MESHLET_H
+#define MESHLET_H
+
+#include <vector>
+using std::vector;
+
+#include <glm/glm.hpp>
+
+// limits of a meshlet, the sizes mesh shading hardware favours
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// cones wider than this (cosine of the widest normal from the axis) never cull, being back-facing from almost nowhere
+#define MESHLET_CONE_MIN_SPREAD 0.1f
+
+/**
+ * @brief A cluster of triangles: a range of a mesh's index buffer and its bounds
+ */
+struct Meshlet {
+    unsigned int firstIndex;
+    unsigned int count;         // indices, three per triangle
+    glm::vec3 center;           // bounding sphere
+    float radius;
+    glm::vec3 coneAxis;         // mean normal of the triangles
+    float coneCutoff;           // sine of the widest angle between a normal and the axis, 1 when the cone never culls
+};
+
+void buildMeshlets(const float* vertices, int stride, int vertexCount, vector<unsigned int>& indices, unsigned int count, vector<Meshlet>& meshlets);
+
+#endif
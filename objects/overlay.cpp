@@ -0,0 +1,267 @@
+/**
+ * @file overlay.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Screen-space HUD. Text is rasterized once with SDL_ttf into a glyph atlas, and every glyph, panel and graph bar of a frame is drawn with a single instanced call
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "overlay.h"
+
+#include <algorithm>
+
+// the atlas starts with a small opaque block that untextured quads (panels, graphs) sample
+#define OVERLAY_WHITE_SIZE 2
+
+/**
+ * @brief Construct a new Overlay object
+ *
+ * @param vertexPath Path to the overlay vertex shader
+ * @param fragmentPath Path to the overlay fragment shader
+ * @param font Font rasterized into the atlas (only used during construction)
+ */
+Overlay::Overlay(const char* vertexPath, const char* fragmentPath, TTF_Font* font) : instanceCapacity(0), atlasHeight(0), lineSkip(0), screenW(1), screenH(1) {
+    shader = new Shader(vertexPath, fragmentPath);
+    buildAtlas(font);
+
+    // one instance per quad; the corner comes from gl_VertexID
+    VAO.create();
+    instanceBuffer.create();
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    labelObject(GL_VERTEX_ARRAY, VAO, "Overlay VAO");
+    labelObject(GL_BUFFER, instanceBuffer, "Overlay instances");
+    for (int i = 0; i < 3; i ++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribPointer(i, 4, GL_FLOAT, GL_FALSE, sizeof(OverlayQuad), (void*)(i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(i, 1);
+    }
+    glBindVertexArray(0);
+}
+
+/**
+ * @brief Destroy the Overlay object
+ */
+Overlay::~Overlay() {
+    delete shader;
+}
+
+/**
+ * @brief Starts collecting the quads of a frame
+ *
+ * @param rx Window width
+ * @param ry Window height
+ */
+void Overlay::begin(int rx, int ry) {
+    screenW = rx;
+    screenH = ry;
+    quads.clear();
+}
+
+/**
+ * @brief Draws everything collected since begin() over the current framebuffer
+ */
+void Overlay::end() {
+    if (quads.empty())
+        return;
+
+    // orphan and refill; the buffer only grows
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (quads.size() > instanceCapacity) {
+        instanceCapacity = quads.size() * 2;
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(OverlayQuad), NULL, GL_STREAM_DRAW);
+        instanceBuffer.setSize(GLMEM_VERTEX, instanceCapacity * sizeof(OverlayQuad));
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(OverlayQuad), NULL, GL_STREAM_DRAW);
+    }
+    glBufferSubData(GL_ARRAY_BUFFER, 0, quads.size() * sizeof(OverlayQuad), quads.data());
+    countUpload(quads.size() * sizeof(OverlayQuad));
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    shader->use();
+    shader->setVec2("screen", (float)screenW, (float)screenH);
+    shader->setInt("atlas", 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, atlas);
+
+    glBindVertexArray(VAO);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)quads.size());
+    glBindVertexArray(0);
+    countDrawCalls();
+
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
+
+/**
+ * @brief Adds a line of text. Characters outside printable ASCII are skipped
+ *
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param s Text
+ * @param color Text color
+ * @return float x just past the last character
+ */
+float Overlay::text(float x, float y, const string& s, const glm::vec4& color) {
+    for (unsigned int i = 0; i < s.size(); i ++) {
+        int c = (unsigned char)s[i];
+        if (c < OVERLAY_FIRST_CHAR || c > OVERLAY_LAST_CHAR)
+            continue;
+
+        const OverlayGlyph& g = glyphs[c - OVERLAY_FIRST_CHAR];
+        if (c != ' ') {
+            OverlayQuad quad;
+            quad.rect = glm::vec4(x, y, g.w, g.h);
+            quad.uv = glm::vec4((float)g.x / OVERLAY_ATLAS_WIDTH, (float)g.y / atlasHeight, (float)(g.x + g.w) / OVERLAY_ATLAS_WIDTH, (float)(g.y + g.h) / atlasHeight);
+            quad.color = color;
+            quads.push_back(quad);
+        }
+        x += g.advance;
+    }
+    return x;
+}
+
+/**
+ * @brief Adds a solid rectangle
+ *
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param w Width in pixels
+ * @param h Height in pixels
+ * @param color Fill color
+ */
+void Overlay::rect(float x, float y, float w, float h, const glm::vec4& color) {
+    // sample the middle of the white block so filtering never reaches a glyph
+    float u = 0.5f * OVERLAY_WHITE_SIZE / OVERLAY_ATLAS_WIDTH, v = 0.5f * OVERLAY_WHITE_SIZE / atlasHeight;
+
+    OverlayQuad quad;
+    quad.rect = glm::vec4(x, y, w, h);
+    quad.uv = glm::vec4(u, v, u, v);
+    quad.color = color;
+    quads.push_back(quad);
+}
+
+/**
+ * @brief Adds a bar graph, oldest value on the left
+ *
+ * @param x Left edge in pixels
+ * @param y Top edge in pixels
+ * @param w Width in pixels
+ * @param h Height in pixels
+ * @param values Values to plot
+ * @param count Number of values
+ * @param maxValue Value drawn at full height (larger values are clamped)
+ * @param color Bar color
+ */
+void Overlay::graph(float x, float y, float w, float h, const float* values, int count, float maxValue, const glm::vec4& color) {
+    if (count <= 0 || maxValue <= 0)
+        return;
+
+    float barW = w / count;
+    for (int i = 0; i < count; i ++) {
+        float barH = std::min(values[i] / maxValue, 1.0f) * h;
+        rect(x + i * barW, y + h - barH, std::max(barW - 1.0f, 1.0f), barH, color);
+    }
+}
+
+/**
+ * @brief Returns the distance between two lines of text
+ *
+ * @return int pixels
+ */
+int Overlay::lineHeight() const {
+    return lineSkip;
+}
+
+/**
+ * @brief Returns the width a line of text would take
+ *
+ * @param s Text
+ * @return float pixels
+ */
+float Overlay::textWidth(const string& s) const {
+    float w = 0;
+    for (unsigned int i = 0; i < s.size(); i ++) {
+        int c = (unsigned char)s[i];
+        if (c >= OVERLAY_FIRST_CHAR && c <= OVERLAY_LAST_CHAR)
+            w += glyphs[c - OVERLAY_FIRST_CHAR].advance;
+    }
+    return w;
+}
+
+/**
+ * @brief Rasterizes printable ASCII into a single-channel coverage atlas, packed in rows
+ *
+ * @param font Font to rasterize
+ */
+void Overlay::buildAtlas(TTF_Font* font) {
+    lineSkip = TTF_FontLineSkip(font);
+
+    const int glyphCount = OVERLAY_LAST_CHAR - OVERLAY_FIRST_CHAR + 1;
+    SDL_Surface* surfaces[glyphCount];
+    SDL_Color white = { 255, 255, 255, 255 };
+
+    // place glyphs left to right, wrapping to a new row when the atlas is full
+    int x = OVERLAY_WHITE_SIZE + 1, y = 0, rowHeight = OVERLAY_WHITE_SIZE;
+    for (int i = 0; i < glyphCount; i ++) {
+        OverlayGlyph& g = glyphs[i];
+        int minx, maxx, miny, maxy;
+        TTF_GlyphMetrics(font, (Uint16)(OVERLAY_FIRST_CHAR + i), &minx, &maxx, &miny, &maxy, &g.advance);
+
+        surfaces[i] = TTF_RenderGlyph_Blended(font, (Uint16)(OVERLAY_FIRST_CHAR + i), white);
+        g.w = surfaces[i] ? surfaces[i]->w : 0;
+        g.h = surfaces[i] ? surfaces[i]->h : 0;
+        if (x + g.w > OVERLAY_ATLAS_WIDTH) {
+            x = 0;
+            y += rowHeight + 1;
+            rowHeight = 0;
+        }
+        g.x = x;
+        g.y = y;
+        x += g.w + 1;
+        rowHeight = std::max(rowHeight, g.h);
+    }
+    atlasHeight = y + rowHeight;
+
+    // coverage is the rendered glyph's alpha
+    vector<unsigned char> pixels(OVERLAY_ATLAS_WIDTH * atlasHeight, 0);
+    for (int py = 0; py < OVERLAY_WHITE_SIZE; py ++)
+        for (int px = 0; px < OVERLAY_WHITE_SIZE; px ++)
+            pixels[py * OVERLAY_ATLAS_WIDTH + px] = 255;
+
+    for (int i = 0; i < glyphCount; i ++) {
+        SDL_Surface* surf = surfaces[i];
+        if (surf == NULL)
+            continue;
+
+        SDL_Surface* converted = SDL_ConvertSurfaceFormat(surf, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_LockSurface(converted);
+        for (int py = 0; py < converted->h; py ++) {
+            const unsigned char* row = (const unsigned char*)converted->pixels + py * converted->pitch;
+            for (int px = 0; px < converted->w; px ++)
+                pixels[(glyphs[i].y + py) * OVERLAY_ATLAS_WIDTH + glyphs[i].x + px] = row[px * 4 + 3];
+        }
+        SDL_UnlockSurface(converted);
+        SDL_FreeSurface(converted);
+        SDL_FreeSurface(surf);
+    }
+
+    atlas.create();
+    glBindTexture(GL_TEXTURE_2D, atlas);
+    labelObject(GL_TEXTURE, atlas, "Overlay glyph atlas");
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_R8, OVERLAY_ATLAS_WIDTH, atlasHeight);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, OVERLAY_ATLAS_WIDTH, atlasHeight, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    atlas.setSize(GLMEM_TEXTURE, textureBytes(OVERLAY_ATLAS_WIDTH, atlasHeight, 1));
+    countUpload(textureBytes(OVERLAY_ATLAS_WIDTH, atlasHeight, 1));
+}
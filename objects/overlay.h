@@ -0,0 +1,76 @@
+/**
+ * @file overlay.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Screen-space HUD. Text is rasterized once with SDL_ttf into a glyph atlas, and every glyph, panel and graph bar of a frame is drawn with a single instanced call
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef OVERLAY_H
+#define OVERLAY_H
+
+#include "helper.h"
+
+#include "SDL2/SDL_ttf.h"
+
+// width of the glyph atlas; its height is whatever the glyphs need
+#define OVERLAY_ATLAS_WIDTH 512
+// printable ASCII is rasterized into the atlas
+#define OVERLAY_FIRST_CHAR 32
+#define OVERLAY_LAST_CHAR 126
+
+/**
+ * @brief One quad of the overlay, as laid out in the instance buffer (see overlay.vs)
+ */
+struct OverlayQuad {
+    glm::vec4 rect;     // x, y, width, height in pixels, origin at the top left of the window
+    glm::vec4 uv;       // u0, v0, u1, v1 in the atlas
+    glm::vec4 color;
+};
+
+/**
+ * @brief Where a glyph lives in the atlas and how far it advances the pen
+ */
+struct OverlayGlyph {
+    int x, y, w, h;
+    int advance;
+};
+
+/**
+ * @brief Collects text, rectangles and graphs between begin() and end(), then draws them in one instanced call on top of the frame
+ */
+class Overlay {
+    public:
+        Overlay(const char* vertexPath, const char* fragmentPath, TTF_Font* font);
+        ~Overlay();
+
+        void begin(int rx, int ry);
+        void end();
+
+        float text(float x, float y, const string& s, const glm::vec4& color = glm::vec4(1.0f));
+        void rect(float x, float y, float w, float h, const glm::vec4& color);
+        void graph(float x, float y, float w, float h, const float* values, int count, float maxValue, const glm::vec4& color);
+
+        int lineHeight() const;
+        float textWidth(const string& s) const;
+
+    private:
+        Shader* shader;
+        GLTexture atlas;
+        GLVertexArray VAO;
+        GLBuffer instanceBuffer;
+        size_t instanceCapacity;    // quads the instance buffer currently holds
+
+        int atlasHeight;
+        int lineSkip;
+        OverlayGlyph glyphs[OVERLAY_LAST_CHAR - OVERLAY_FIRST_CHAR + 1];
+
+        int screenW, screenH;
+        vector<OverlayQuad> quads;
+
+        void buildAtlas(TTF_Font* font);
+};
+
+#endif
@@ -0,0 +1,366 @@
+/**
+ * @file particles.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Spray and foam particles emitted from wave crests
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "particles.h"
+
+#include <math.h>
+#include <stddef.h>
+#include <algorithm>
+
+/**
+ * @brief The commands and counters particles.cs keeps between stages (std430)
+ */
+struct ParticleState {
+    unsigned int dispatch[3];   // DispatchIndirectCommand over the live particles
+    unsigned int draw[4];       // DrawArraysIndirectCommand of the live particles
+    unsigned int appended;
+    unsigned int emitted;
+    unsigned int lastEmitted;
+};
+
+/**
+ * @brief Integer hash (lowbias32), as particles.cs computes it
+ *
+ * @param x Value to hash
+ * @return unsigned int
+ */
+static unsigned int particleHash(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * @brief A float in [0, 1) from a hash of x, as particles.cs computes it
+ *
+ * @param x Value to hash
+ * @return float
+ */
+static float particleRandom(unsigned int x) {
+    return (float)(particleHash(x) >> 8) / 16777216.0f;
+}
+
+/**
+ * @brief Returns the grid point nearest a position
+ *
+ * @param grid Water grid
+ * @param p Position
+ * @return int vertex index, -1 off the grid
+ */
+static int nearestPoint(const WaterGrid& grid, const glm::vec3& p) {
+    int i = (int)floor((p.x - (float)grid.originX) * (float)grid.dimX / (float)grid.sizeX + 0.5f);
+    int j = (int)floor((p.z - (float)grid.originZ) * (float)grid.dimZ / (float)grid.sizeZ + 0.5f);
+    if (i < 0 || j < 0 || i >= grid.dimX || j >= grid.dimZ)
+        return -1;
+    return i * grid.dimZ + j;
+}
+
+/**
+ * @brief Advances a particle, as stage 0 of particles.cs does. Spray reaching the surface becomes foam, which follows it
+ *
+ * @param p Particle
+ * @param dt Seconds to advance
+ * @param grid Water grid
+ * @param water Water vertices (x, H, z, -ddxH, -ddyH, 1 per point)
+ * @return bool whether the particle is still alive
+ */
+static bool simulateParticle(Particle& p, float dt, const WaterGrid& grid, const vector<float>& water) {
+    bool foam = p.velocity.w > 0.5f;
+    p.position.w -= dt;
+    if (!foam)
+        p.velocity.y -= PARTICLE_GRAVITY * dt;
+    p.velocity = glm::vec4(glm::vec3(p.velocity) * std::max(0.0f, 1.0f - PARTICLE_DRAG * dt), p.velocity.w);
+    p.position = glm::vec4(glm::vec3(p.position) + glm::vec3(p.velocity) * dt, p.position.w);
+
+    int point = nearestPoint(grid, glm::vec3(p.position));
+    if (p.position.w <= 0 || point < 0)
+        return false;
+    float surface = water[point * 6 + 1];
+    if (foam) {
+        p.position.y = surface;
+    } else if (p.position.y <= surface) {
+        p.position = glm::vec4(p.position.x, surface, p.position.z, PARTICLE_FOAM_LIFE);
+        p.velocity = glm::vec4(p.velocity.x * PARTICLE_FOAM_KEEP, 0, p.velocity.z * PARTICLE_FOAM_KEEP, 1);
+    }
+    return true;
+}
+
+/**
+ * @brief Construct a new SprayParticles object, with no particles yet
+ *
+ * @param water Surface emitting the particles (not owned)
+ * @param capacity Most particles alive at once
+ * @param threshold Slope (|grad H|) above which points of the surface emit
+ * @param rate Particles per second a point emits per unit of slope above the threshold
+ * @param gpu Simulate and draw on the GPU; otherwise the CPU reference simulates and nothing is drawn
+ */
+SprayParticles::SprayParticles(Water* water, int capacity, float threshold, float rate, bool gpu) : water(water), capacity(std::max(1, capacity)),
+    threshold(threshold), rate(rate), gpu(gpu), step(0), alive(0), emitted(0), stepShader(NULL), drawShader(NULL), cur(0), readbackCur(0) {
+    for (int i = 0; i < GPU_QUERY_LATENCY; i ++)
+        fences[i] = 0;
+    if (!gpu)
+        return;
+
+    for (int i = 0; i < 2; i ++) {
+        particleBuffers[i].create();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, particleBuffers[i]);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (size_t)this->capacity * sizeof(Particle), NULL, GL_DYNAMIC_COPY);
+        particleBuffers[i].setSize(GLMEM_STORAGE, (size_t)this->capacity * sizeof(Particle));
+        labelObject(GL_BUFFER, particleBuffers[i], "Particles " + std::to_string(i));
+    }
+    ParticleState state = { { 0, 1, 1 }, { 0, 1, 0, 0 }, 0, 0, 0 };
+    stateBuffer.create();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, stateBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(state), &state, GL_DYNAMIC_COPY);
+    stateBuffer.setSize(GLMEM_STORAGE, sizeof(state));
+    labelObject(GL_BUFFER, stateBuffer, "Particle commands");
+    countUpload(sizeof(state));
+
+    readbackBuffer.create();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, GPU_QUERY_LATENCY * 2 * sizeof(unsigned int), NULL, GL_STREAM_READ);
+    readbackBuffer.setSize(GLMEM_STORAGE, GPU_QUERY_LATENCY * 2 * sizeof(unsigned int));
+    labelObject(GL_BUFFER, readbackBuffer, "Particle count readback");
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // points are drawn without vertex attributes, but core profiles still want a vertex array bound
+    pointVAO.create();
+    labelObject(GL_VERTEX_ARRAY, pointVAO, "Particle VAO");
+
+    WaterGrid grid = water->getGrid();
+    stepShader = new ComputeShader("shaders/particles.cs");
+    stepShader->use();
+    glUniform1ui(glGetUniformLocation(stepShader->ID, "capacity"), this->capacity);
+    stepShader->setFloat("threshold", threshold);
+    stepShader->setFloat("rate", rate);
+    stepShader->setInt("originX", grid.originX);
+    stepShader->setInt("originZ", grid.originZ);
+    stepShader->setInt("sizeX", grid.sizeX);
+    stepShader->setInt("sizeZ", grid.sizeZ);
+    stepShader->setInt("dimX", grid.dimX);
+    stepShader->setInt("dimZ", grid.dimZ);
+
+    drawShader = new Shader("shaders/particles.vs", "shaders/particles.fs");
+    drawShader->use();
+    drawShader->setFloat("spraySize", PARTICLE_SPRAY_SIZE);
+    drawShader->setFloat("foamSize", PARTICLE_FOAM_SIZE);
+    drawShader->setFloat("foamLife", PARTICLE_FOAM_LIFE);
+}
+
+/**
+ * @brief Destroy the SprayParticles object
+ */
+SprayParticles::~SprayParticles() {
+    for (int i = 0; i < GPU_QUERY_LATENCY; i ++) {
+        if (fences[i])
+            glDeleteSync(fences[i]);
+    }
+    delete stepShader;
+    delete drawShader;
+}
+
+/**
+ * @brief Advances the particles and emits new ones from the surface as last evaluated
+ *
+ * @param dt Seconds to advance
+ */
+void SprayParticles::update(float dt) {
+    if (gpu)
+        stepGpu(dt);
+    else
+        stepCpu(dt);
+    step ++;
+}
+
+/**
+ * @brief One step of the CPU reference: stage 0 then stage 1 of particles.cs, serially. Reads the water's CPU vertices, which the
+ * GPU evaluator leaves as they were
+ *
+ * @param dt Seconds to advance
+ */
+void SprayParticles::stepCpu(float dt) {
+    WaterGrid grid = water->getGrid();
+    const vector<float>& surface = water->vertices;
+
+    vector<Particle> next;
+    next.reserve(particles.size());
+    for (Particle p : particles) {
+        if (simulateParticle(p, dt, grid, surface))
+            next.push_back(p);
+    }
+
+    emitted = 0;
+    glm::vec2 cell((float)grid.sizeX / grid.dimX, (float)grid.sizeZ / grid.dimZ);
+    for (unsigned int id = 0; id < (unsigned int)(grid.dimX * grid.dimZ) && (int)next.size() < capacity; id ++) {
+        const float* v = &surface[id * 6];
+        glm::vec2 slope(v[3], v[4]);
+        float steepness = glm::length(slope);
+        if (steepness <= threshold)
+            continue;
+        unsigned int key = particleHash(id ^ particleHash(step));
+        unsigned int count = (unsigned int)floor((steepness - threshold) * rate * dt + particleRandom(key));
+        count = std::min(count, (unsigned int)(capacity - next.size()));
+
+        glm::vec3 origin(v[0], v[1], v[2]);
+        glm::vec3 normal = glm::normalize(glm::vec3(slope.x, 1.0f, slope.y));
+        for (unsigned int k = 0; k < count; k ++) {
+            unsigned int r = key + 4 * k;
+            Particle p;
+            p.position = glm::vec4(origin + glm::vec3((particleRandom(r + 1) - 0.5f) * cell.x, 0.0f, (particleRandom(r + 2) - 0.5f) * cell.y),
+                PARTICLE_SPRAY_LIFE * (0.5f + 0.5f * particleRandom(r + 3)));
+            p.velocity = glm::vec4(normal * PARTICLE_SPRAY_SPEED * (0.5f + particleRandom(r + 4)), 0.0f);
+            next.push_back(p);
+        }
+        emitted += count;
+    }
+    particles.swap(next);
+    alive = particles.size();
+}
+
+/**
+ * @brief One step on the GPU: simulates the live particles into the other buffer through the dispatch the last step sized, emits
+ * into it, and sizes the next dispatch and the draw. Queues a copy of the counts for report() without waiting for it
+ *
+ * @param dt Seconds to advance
+ */
+void SprayParticles::stepGpu(float dt) {
+    WaterGrid grid = water->getGrid();
+    stepShader->use();
+    stepShader->setFloat("dt", dt);
+    glUniform1ui(glGetUniformLocation(stepShader->ID, "seed"), step);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleBuffers[cur]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, particleBuffers[1 - cur]);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, stateBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, water->getVertexBuffer());
+
+    // the GPU evaluator leaves the water's buffer synchronized for drawing only
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    stepShader->setInt("stage", 0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, stateBuffer);
+    glDispatchComputeIndirect(0);
+    glBindBuffer(GL_DISPATCH_INDIRECT_BUFFER, 0);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    stepShader->setInt("stage", 1);
+    stepShader->dispatch(grid.dimX * grid.dimZ, 1, 1, PARTICLE_GROUP);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    stepShader->setInt("stage", 2);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    cur = 1 - cur;
+
+    // collect the counts from a few steps ago if they have arrived, then queue this step's
+    glBindBuffer(GL_COPY_READ_BUFFER, stateBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, readbackBuffer);
+    if (fences[readbackCur]) {
+        GLenum state = glClientWaitSync(fences[readbackCur], 0, 0);
+        if (state == GL_ALREADY_SIGNALED || state == GL_CONDITION_SATISFIED) {
+            unsigned int counts[2];
+            glGetBufferSubData(GL_COPY_WRITE_BUFFER, readbackCur * sizeof(counts), sizeof(counts), counts);
+            alive = counts[0];
+            emitted = counts[1];
+        }
+        glDeleteSync(fences[readbackCur]);
+    }
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offsetof(ParticleState, draw), readbackCur * 2 * sizeof(unsigned int), sizeof(unsigned int));
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offsetof(ParticleState, lastEmitted), (readbackCur * 2 + 1) * sizeof(unsigned int), sizeof(unsigned int));
+    fences[readbackCur] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    readbackCur = (readbackCur + 1) % GPU_QUERY_LATENCY;
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+/**
+ * @brief Draws the live particles as soft points, blended over the scene without writing depth. Nothing is drawn by the CPU reference
+ *
+ * @param view View matrix of the pass
+ * @param projection Projection matrix of the pass
+ * @param pixelsPerUnit Pixels a unit spans at a distance of one unit (see LodView)
+ */
+void SprayParticles::draw(const glm::mat4& view, const glm::mat4& projection, float pixelsPerUnit) {
+    if (!gpu)
+        return;
+    drawShader->use();
+    drawShader->setMat4("view", view);
+    drawShader->setMat4("projection", projection);
+    drawShader->setFloat("pixelsPerUnit", pixelsPerUnit);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particleBuffers[cur]);
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDepthMask(GL_FALSE);
+
+    glBindVertexArray(pointVAO);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, stateBuffer);
+    glDrawArraysIndirect(GL_POINTS, (void*)offsetof(ParticleState, draw));
+    countDrawCalls();
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    glDisable(GL_BLEND);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+/**
+ * @brief Publishes the live and newly emitted particles, delayed by a few steps on the GPU
+ *
+ * @param profiler Profiler receiving the counters of the current frame
+ */
+void SprayParticles::report(Profiler* profiler) {
+    profiler->setCounter("particles.alive", alive);
+    profiler->setCounter("particles.emitted", emitted);
+    profiler->setCounter("particles.capacity", capacity);
+}
+
+/**
+ * @brief Returns whether the particles are simulated on the GPU
+ *
+ * @return bool
+ */
+bool SprayParticles::onGpu() const {
+    return gpu;
+}
+
+/**
+ * @brief Returns the particles of the CPU reference (empty on the GPU)
+ *
+ * @return const vector<Particle>&
+ */
+const vector<Particle>& SprayParticles::getParticles() const {
+    return particles;
+}
+
+/**
+ * @brief Returns the exact counts of the last step. On the GPU this waits for the step to finish, so it is meant for validation,
+ * not for every frame (report() publishes delayed counts without waiting)
+ *
+ * @param alive Receives the particles alive after the last step
+ * @param emitted Receives the particles the last step emitted
+ */
+void SprayParticles::readCounts(int& alive, int& emitted) {
+    if (!gpu) {
+        alive = this->alive;
+        emitted = this->emitted;
+        return;
+    }
+    ParticleState state;
+    glBindBuffer(GL_COPY_READ_BUFFER, stateBuffer);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(state), &state);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    alive = state.draw[0];
+    emitted = state.lastEmitted;
+}
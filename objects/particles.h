@@ -0,0 +1,86 @@
+/**
+ * @file particles.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Spray and foam particles emitted from wave crests. Points of the water grid steeper than a threshold launch spray along the surface normal; spray falling back onto the surface turns into foam drifting on it. On the GPU a step is three compute passes over ping-ponged particle buffers (simulate and compact the live particles, emit new ones, then size the next step's dispatch and the draw), so nothing is read back to drive them; the CPU reference runs the same step serially for runs without GL
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include "helper.h"
+#include "water.h"
+#include "../kernel/profiler.h"
+
+// local size of particles.cs
+#define PARTICLE_GROUP 256
+
+// motion, in world units and seconds
+#define PARTICLE_GRAVITY 9.81f
+#define PARTICLE_DRAG 0.8f              // fraction of velocity lost per second
+#define PARTICLE_SPRAY_SPEED 1.5f       // launch speed along the normal, scaled by 0.5 to 1.5 at random
+#define PARTICLE_SPRAY_LIFE 2.0f        // longest a spray particle flies, scaled by 0.5 to 1 at random
+#define PARTICLE_FOAM_LIFE 4.0f         // seconds foam lasts on the surface
+#define PARTICLE_FOAM_KEEP 0.3f         // fraction of horizontal velocity spray keeps as foam
+
+// size of the points drawn, in world units
+#define PARTICLE_SPRAY_SIZE 0.04f
+#define PARTICLE_FOAM_SIZE 0.12f
+
+/**
+ * @brief A particle as particles.cs reads it (std430)
+ */
+struct Particle {
+    glm::vec4 position;     // xyz, w: seconds left to live
+    glm::vec4 velocity;     // xyz, w: 0 for spray, 1 for foam
+};
+
+/**
+ * @brief Spray and foam over a water surface, simulated on the GPU or, as a reference, on the CPU
+ */
+class SprayParticles {
+    public:
+        SprayParticles(Water* water, int capacity, float threshold, float rate, bool gpu);
+        ~SprayParticles();
+
+        void update(float dt);
+        void draw(const glm::mat4& view, const glm::mat4& projection, float pixelsPerUnit);
+
+        void report(Profiler* profiler);
+
+        bool onGpu() const;
+        const vector<Particle>& getParticles() const;
+        void readCounts(int& alive, int& emitted);
+
+    private:
+        Water* water;       // not owned
+        int capacity;
+        float threshold;    // slope (|grad H|) above which points emit
+        float rate;         // particles per second a point emits per unit of slope above the threshold
+        bool gpu;
+        unsigned int step;  // seeds the random numbers of each step
+
+        // CPU reference: the live particles, and the counts of the last step
+        vector<Particle> particles;
+        int alive, emitted;
+
+        // GPU: particle buffers read and written alternately (cur is read), the dispatch and draw commands with the append counters,
+        // and a delayed readback of the counts for report()
+        ComputeShader* stepShader;
+        Shader* drawShader;
+        GLBuffer particleBuffers[2];
+        GLBuffer stateBuffer;
+        GLVertexArray pointVAO;
+        int cur;
+        GLBuffer readbackBuffer;
+        GLsync fences[GPU_QUERY_LATENCY];
+        int readbackCur;
+
+        void stepCpu(float dt);
+        void stepGpu(float dt);
+};
+
+#endif
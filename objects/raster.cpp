@@ -0,0 +1,611 @@
+/**
+ * @file raster.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief CPU renderer backend: vertices are transformed on the thread pool, triangles binned into screen tiles, and tiles rasterized in parallel with SSE2 edge functions and depth tests, shading the water, skybox and meshes the way their shaders do
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "raster.h"
+#include "helper.h"
+#include "threadpool.h"
+#include "../kernel/profiler.h"
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "SDL2/SDL.h"
+#include "SDL2/SDL_image.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Construct a new empty RasterImage object
+ */
+RasterImage::RasterImage() : width(0), height(0) {}
+
+/**
+ * @brief Loads an image file (any format SDL_image reads) as RGB
+ *
+ * @param path Path of the file
+ * @return bool representing the success of the operation
+ */
+bool RasterImage::load(const string& path) {
+    SDL_Surface* loaded = IMG_Load(path.c_str());
+    if (loaded == NULL) {
+        LOG_ERROR("assets", "Unable to load texture %s: %s", path, IMG_GetError());
+        return false;
+    }
+    SDL_Surface* surface = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGB24, 0);
+    SDL_FreeSurface(loaded);
+    if (surface == NULL) {
+        LOG_ERROR("assets", "Unable to convert texture %s: %s", path, SDL_GetError());
+        return false;
+    }
+
+    width = surface->w;
+    height = surface->h;
+    rgb.resize((size_t)width * height * 3);
+    SDL_LockSurface(surface);
+    for (int y = 0; y < height; y ++)
+        memcpy(&rgb[(size_t)y * width * 3], (unsigned char*)surface->pixels + y * surface->pitch, width * 3);
+    SDL_UnlockSurface(surface);
+    SDL_FreeSurface(surface);
+    return true;
+}
+
+/**
+ * @brief Returns one texel as a color in [0, 1]
+ *
+ * @param x Column, clamped to the image
+ * @param y Row from the top, clamped to the image
+ * @return glm::vec3, white for an empty image
+ */
+glm::vec3 RasterImage::texel(int x, int y) const {
+    if (rgb.empty())
+        return glm::vec3(1.0f);
+    x = std::max(0, std::min(width - 1, x));
+    y = std::max(0, std::min(height - 1, y));
+    const unsigned char* p = &rgb[((size_t)y * width + x) * 3];
+    return glm::vec3(p[0], p[1], p[2]) * (1.0f / 255.0f);
+}
+
+/**
+ * @brief Samples the image with repeating texture coordinates. The image is a 2D texture uploaded flipped, so v = 0 is its bottom row
+ *
+ * @param uv Texture coordinates
+ * @return glm::vec3
+ */
+glm::vec3 RasterImage::sample(glm::vec2 uv) const {
+    float u = uv.x - floorf(uv.x), v = uv.y - floorf(uv.y);
+    return texel((int)(u * width), (int)((1.0f - v) * height));
+}
+
+/**
+ * @brief Returns the cubemap texel a direction points at, following GL's face selection (faces in the order +x, -x, +y, -y, +z, -z, uploaded unflipped)
+ *
+ * @param faces The six faces
+ * @param d Direction, need not be normalized
+ * @return glm::vec3
+ */
+static glm::vec3 sampleCubemap(const vector<RasterImage>& faces, glm::vec3 d) {
+    glm::vec3 a = glm::abs(d);
+    int face;
+    float sc, tc, ma;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = d.x > 0 ? 0 : 1;
+        sc = d.x > 0 ? -d.z : d.z;
+        tc = -d.y;
+        ma = a.x;
+    } else if (a.y >= a.z) {
+        face = d.y > 0 ? 2 : 3;
+        sc = d.x;
+        tc = d.y > 0 ? d.z : -d.z;
+        ma = a.y;
+    } else {
+        face = d.z > 0 ? 4 : 5;
+        sc = d.z > 0 ? d.x : -d.x;
+        tc = -d.y;
+        ma = a.z;
+    }
+    if (ma <= 0)
+        return glm::vec3(0);
+    const RasterImage& image = faces[face];
+    float s = (sc / ma + 1) * 0.5f, t = (tc / ma + 1) * 0.5f;
+    return image.texel((int)(s * image.width), (int)(t * image.height));
+}
+
+/**
+ * @brief Construct a new SoftwareRenderer object
+ *
+ * @param pool Threads transforming vertices and rasterizing tiles (not owned; NULL runs everything on the caller)
+ */
+SoftwareRenderer::SoftwareRenderer(ThreadPool* pool) : pool(pool), width(0), height(0), view(1.0f), projection(1.0f), cameraPosition(0),
+    sky(NULL), sunDirection(0, 1, 0), draws(0), clipped(0), tiles(0) {}
+
+/**
+ * @brief Returns RENDERER_SOFTWARE
+ *
+ * @return RendererBackend
+ */
+RendererBackend SoftwareRenderer::backend() const {
+    return RENDERER_SOFTWARE;
+}
+
+/**
+ * @brief Starts a frame: clears the color to black and the depth to the far plane
+ *
+ * @param width Width of the frame
+ * @param height Height of the frame
+ */
+void SoftwareRenderer::beginFrame(int width, int height) {
+    this->width = width;
+    this->height = height;
+    color.assign((size_t)width * height * 3, 0);
+    depth.assign((size_t)width * height, 1.0f);
+    triangles.clear();
+    sky = NULL;
+    draws = 0;
+    clipped = 0;
+}
+
+/**
+ * @brief Sets the matrices of the draws that follow
+ *
+ * @param view View matrix
+ * @param projection Projection matrix
+ * @param position Position of the camera in world space
+ */
+void SoftwareRenderer::setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position) {
+    this->view = view;
+    this->projection = projection;
+    cameraPosition = position;
+}
+
+/**
+ * @brief Queues the water surface, shaded at the end of the frame as water.fs does without a planar reflection: 0.7 times the sky in the reflected direction
+ *
+ * @param geometry Water vertices (positions and normals) and strip indices
+ * @param shader Unused
+ * @param env Sun direction used when no skybox is drawn this frame
+ */
+void SoftwareRenderer::drawWater(const DrawGeometry& geometry, Shader* shader, const WaterEnvironment& env) {
+    (void)shader;
+    sunDirection = env.sunDirection;
+    transform(geometry, projection * view, glm::mat4(1.0f));
+    assemble(geometry, RASTER_WATER, NULL);
+}
+
+/**
+ * @brief Queues the skybox on the far plane, loading its faces the first time they are drawn
+ *
+ * @param geometry Cube vertices
+ * @param shader Unused
+ * @param cubemap Unused
+ * @param faces Paths of the faces, none for a gradient sky
+ * @param sunDirection Direction toward the sun of a gradient sky
+ */
+void SoftwareRenderer::drawSkybox(const DrawGeometry& geometry, Shader* shader, unsigned int cubemap, const vector<string>& faces, const glm::vec3& sunDirection) {
+    (void)shader; (void)cubemap;
+    this->sunDirection = sunDirection;
+    sky = NULL;
+    if (faces.size() == 6) {
+        auto it = cubemaps.find(faces[0]);
+        if (it == cubemaps.end()) {
+            vector<RasterImage> loaded(6);
+            for (int i = 0; i < 6; i ++)
+                loaded[i].load(faces[i]);
+            it = cubemaps.insert(std::make_pair(faces[0], loaded)).first;
+        }
+        sky = &it->second;
+    }
+
+    // translation of the view is discarded, as skybox.vs does
+    transform(geometry, projection * glm::mat4(glm::mat3(view)), glm::mat4(1.0f));
+    assemble(geometry, RASTER_SKY, NULL);
+}
+
+/**
+ * @brief Queues a mesh, shaded as backpack.fs does: its first diffuse texture lit by the unnormalized light (1, 5, 1)
+ *
+ * @param geometry Mesh vertices (positions, normals, texture coordinates) and triangle indices
+ * @param shader Unused
+ * @param textures Textures of the mesh
+ * @param directory Directory the texture paths are relative to
+ * @param model Model matrix
+ */
+void SoftwareRenderer::drawMesh(const DrawGeometry& geometry, Shader* shader, const vector<Texture>& textures, const string& directory, const glm::mat4& model) {
+    (void)shader;
+    const RasterImage* diffuse = NULL;
+    for (const Texture& t : textures) {
+        if (t.type == "texture_diffuse") {
+            diffuse = texture(directory + "/" + t.path);
+            break;
+        }
+    }
+    transform(geometry, projection * view * model, model);
+    assemble(geometry, RASTER_MESH, diffuse);
+}
+
+/**
+ * @brief Bins the frame's triangles into tiles and rasterizes the tiles in parallel
+ */
+void SoftwareRenderer::endFrame() {
+    int tilesX = (width + RASTER_TILE - 1) / RASTER_TILE, tilesY = (height + RASTER_TILE - 1) / RASTER_TILE;
+    bins.resize(tilesX * tilesY);
+    for (vector<int>& bin : bins)
+        bin.clear();
+    for (int i = 0; i < (int)triangles.size(); i ++) {
+        const Triangle& t = triangles[i];
+        for (int ty = t.minY / RASTER_TILE; ty <= t.maxY / RASTER_TILE; ty ++) {
+            for (int tx = t.minX / RASTER_TILE; tx <= t.maxX / RASTER_TILE; tx ++)
+                bins[ty * tilesX + tx].push_back(i);
+        }
+    }
+
+    tiles = 0;
+    for (const vector<int>& bin : bins)
+        tiles += !bin.empty();
+
+    auto rasterize = [this](int from, int to) {
+        for (int tile = from; tile < to; tile ++)
+            rasterizeTile(tile);
+    };
+    if (pool != NULL)
+        pool->parallelFor(0, (int)bins.size(), rasterize);
+    else
+        rasterize(0, (int)bins.size());
+}
+
+/**
+ * @brief Copies the last frame
+ *
+ * @param width Receives the width of the image
+ * @param height Receives the height of the image
+ * @param rgb Receives the pixels, rows top to bottom
+ * @return bool true
+ */
+bool SoftwareRenderer::readPixels(int& width, int& height, vector<unsigned char>& rgb) const {
+    width = this->width;
+    height = this->height;
+    rgb = color;
+    return true;
+}
+
+/**
+ * @brief Publishes "renderer.draws", "renderer.triangles" (after clipping), "renderer.clipped" and "renderer.tiles" (tiles holding any triangle) of the last frame
+ *
+ * @param profiler Profiler receiving the counters
+ */
+void SoftwareRenderer::report(Profiler* profiler) const {
+    profiler->setCounter("renderer.draws", draws);
+    profiler->setCounter("renderer.triangles", (double)triangles.size());
+    profiler->setCounter("renderer.clipped", clipped);
+    profiler->setCounter("renderer.tiles", tiles);
+}
+
+/**
+ * @brief Runs the vertex stage of a draw into transformed, on the pool
+ *
+ * @param geometry Draw
+ * @param matrix Object to clip space
+ * @param model Object to world space
+ */
+void SoftwareRenderer::transform(const DrawGeometry& geometry, const glm::mat4& matrix, const glm::mat4& model) {
+    transformed.resize(geometry.vertexCount);
+    auto vertices = [&](int from, int to) {
+        for (int i = from; i < to; i ++) {
+            const float* v = geometry.vertices + (size_t)i * geometry.stride;
+            glm::vec4 position(v[0], v[1], v[2], 1.0f);
+            ClipVertex& out = transformed[i];
+            out.clip = matrix * position;
+            out.world = glm::vec3(model * position);
+            out.normal = geometry.normalOffset >= 0 ? glm::vec3(v[geometry.normalOffset], v[geometry.normalOffset + 1], v[geometry.normalOffset + 2]) : glm::vec3(0, 1, 0);
+            out.uv = geometry.uvOffset >= 0 ? glm::vec2(v[geometry.uvOffset], v[geometry.uvOffset + 1]) : glm::vec2(0);
+        }
+    };
+    if (pool != NULL)
+        pool->parallelFor(0, geometry.vertexCount, vertices);
+    else
+        vertices(0, geometry.vertexCount);
+}
+
+/**
+ * @brief Assembles the transformed vertices of a draw into triangles, as GL would for its mode
+ *
+ * @param geometry Draw
+ * @param material How its pixels are shaded
+ * @param texture Its diffuse texture, or NULL
+ */
+void SoftwareRenderer::assemble(const DrawGeometry& geometry, Material material, const RasterImage* texture) {
+    draws ++;
+    auto index = [&](int i) {
+        return geometry.indices != NULL ? (int)geometry.indices[geometry.firstIndex + i] : i;
+    };
+
+    if (geometry.mode == GL_TRIANGLE_STRIP) {
+        for (int s = 0; s < geometry.strips; s ++) {
+            int base = s * geometry.stripLength;
+            for (int k = 0; k + 2 < geometry.stripLength; k ++)
+                clipTriangle(transformed[index(base + k)], transformed[index(base + k + 1)], transformed[index(base + k + 2)], material, texture);
+        }
+        return;
+    }
+
+    int count = geometry.indices != NULL ? geometry.indexCount : geometry.vertexCount;
+    for (int i = 0; i + 2 < count; i += 3)
+        clipTriangle(transformed[index(i)], transformed[index(i + 1)], transformed[index(i + 2)], material, texture);
+}
+
+/**
+ * @brief Interpolates two vertices of the vertex stage
+ *
+ * @param a First vertex
+ * @param b Second vertex
+ * @param t Weight of b
+ * @return ClipVertex
+ */
+SoftwareRenderer::ClipVertex SoftwareRenderer::lerp(const ClipVertex& a, const ClipVertex& b, float t) {
+    ClipVertex v;
+    v.clip = a.clip + (b.clip - a.clip) * t;
+    v.world = a.world + (b.world - a.world) * t;
+    v.normal = a.normal + (b.normal - a.normal) * t;
+    v.uv = a.uv + (b.uv - a.uv) * t;
+    return v;
+}
+
+/**
+ * @brief Clips a triangle against the near plane (z >= -w), the only plane that must be clipped before the divide; the others are handled by the screen bounds
+ *
+ * @param a First vertex
+ * @param b Second vertex
+ * @param c Third vertex
+ * @param material How its pixels are shaded
+ * @param texture Its diffuse texture, or NULL
+ */
+void SoftwareRenderer::clipTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Material material, const RasterImage* texture) {
+    const ClipVertex* in[3] = { &a, &b, &c };
+    float d[3];
+    int inside = 0;
+    for (int i = 0; i < 3; i ++) {
+        d[i] = in[i]->clip.z + in[i]->clip.w;
+        inside += d[i] >= 0;
+    }
+    if (inside == 3) {
+        setupTriangle(a, b, c, material, texture);
+        return;
+    }
+    clipped ++;
+    if (inside == 0)
+        return;
+
+    // walk the edges, keeping inside vertices and the crossings (at most four vertices)
+    ClipVertex out[4];
+    int n = 0;
+    for (int i = 0; i < 3; i ++) {
+        int j = (i + 1) % 3;
+        if (d[i] >= 0)
+            out[n ++] = *in[i];
+        if ((d[i] >= 0) != (d[j] >= 0))
+            out[n ++] = lerp(*in[i], *in[j], d[i] / (d[i] - d[j]));
+    }
+    for (int i = 1; i + 1 < n; i ++)
+        setupTriangle(out[0], out[i], out[i + 1], material, texture);
+}
+
+/**
+ * @brief Projects a clipped triangle to the screen and queues it, unless it is degenerate or off screen
+ *
+ * @param a First vertex
+ * @param b Second vertex
+ * @param c Third vertex
+ * @param material How its pixels are shaded
+ * @param texture Its diffuse texture, or NULL
+ */
+void SoftwareRenderer::setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Material material, const RasterImage* texture) {
+    const ClipVertex* v[3] = { &a, &b, &c };
+    Triangle t;
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+    for (int i = 0; i < 3; i ++) {
+        float w = v[i]->clip.w;
+        if (w <= 0)
+            return;
+        float invW = 1.0f / w;
+        t.screen[i] = glm::vec2((v[i]->clip.x * invW + 1) * 0.5f * width, (1 - v[i]->clip.y * invW) * 0.5f * height);
+        // the skybox is drawn at z = w (depth 1), as skybox.vs does with gl_Position.xyww
+        t.depth[i] = material == RASTER_SKY ? 1.0f : v[i]->clip.z * invW * 0.5f + 0.5f;
+        t.invW[i] = invW;
+        t.world[i] = v[i]->world * invW;
+        t.normal[i] = v[i]->normal * invW;
+        t.uv[i] = v[i]->uv * invW;
+        minX = std::min(minX, t.screen[i].x);
+        minY = std::min(minY, t.screen[i].y);
+        maxX = std::max(maxX, t.screen[i].x);
+        maxY = std::max(maxY, t.screen[i].y);
+    }
+
+    glm::vec2 e1 = t.screen[1] - t.screen[0], e2 = t.screen[2] - t.screen[0];
+    if (fabsf(e1.x * e2.y - e1.y * e2.x) < 1e-8f)
+        return;
+    if (maxX < 0 || maxY < 0 || minX >= width || minY >= height)
+        return;
+    // clamped as floats first: vertices close to the near plane project far outside the int range
+    t.minX = (int)floorf(std::max(minX, 0.0f));
+    t.minY = (int)floorf(std::max(minY, 0.0f));
+    t.maxX = (int)ceilf(std::min(maxX, (float)(width - 1)));
+    t.maxY = (int)ceilf(std::min(maxY, (float)(height - 1)));
+    t.material = material;
+    t.texture = texture;
+    t.camera = cameraPosition;
+    triangles.push_back(t);
+}
+
+/**
+ * @brief Rasterizes every triangle binned into a tile, in submission order, with a LEQUAL depth test. Pixels are tested four at a time with SSE2, and one at a time at the end of a row that is not a multiple of four
+ *
+ * @param tile Index of the tile, row-major
+ */
+void SoftwareRenderer::rasterizeTile(int tile) {
+    int tilesX = (width + RASTER_TILE - 1) / RASTER_TILE;
+    int x0 = (tile % tilesX) * RASTER_TILE, y0 = (tile / tilesX) * RASTER_TILE;
+    int x1 = std::min(x0 + RASTER_TILE, width), y1 = std::min(y0 + RASTER_TILE, height);
+
+    for (int index : bins[tile]) {
+        const Triangle& t = triangles[index];
+        int minX = std::max(x0, t.minX), maxX = std::min(x1 - 1, t.maxX);
+        int minY = std::max(y0, t.minY), maxY = std::min(y1 - 1, t.maxY);
+        if (minX > maxX || minY > maxY)
+            continue;
+
+        // edge i is opposite vertex i: E(p) = A x + B y + C, positive inside once oriented by the sign of the area
+        float A[3], B[3], C[3];
+        for (int i = 0; i < 3; i ++) {
+            const glm::vec2& p = t.screen[(i + 1) % 3];
+            const glm::vec2& q = t.screen[(i + 2) % 3];
+            A[i] = p.y - q.y;
+            B[i] = q.x - p.x;
+            C[i] = p.x * q.y - p.y * q.x;
+        }
+        float area = C[0] + C[1] + C[2];
+        float invArea = 1.0f / area;
+        for (int i = 0; i < 3; i ++) {
+            A[i] *= invArea;
+            B[i] *= invArea;
+            C[i] *= invArea;
+        }
+        float dz1 = t.depth[1] - t.depth[0], dz2 = t.depth[2] - t.depth[0];
+
+        for (int y = minY; y <= maxY; y ++) {
+            float py = y + 0.5f;
+            float* depthRow = &depth[(size_t)y * width];
+            int x = minX;
+#ifdef __SSE2__
+            const __m128 lanes = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 right = _mm_set1_ps((float)(maxX + 1));
+            __m128 a0 = _mm_set1_ps(A[0]), a1 = _mm_set1_ps(A[1]), a2 = _mm_set1_ps(A[2]);
+            __m128 r0 = _mm_set1_ps(B[0] * py + C[0]), r1 = _mm_set1_ps(B[1] * py + C[1]), r2 = _mm_set1_ps(B[2] * py + C[2]);
+            __m128 z0 = _mm_set1_ps(t.depth[0]), vdz1 = _mm_set1_ps(dz1), vdz2 = _mm_set1_ps(dz2);
+            // whole groups of four only: past the end of the row they would read the next row, which another tile's thread writes.
+            // Tiles start on multiples of four, so groups never reach into the tile on the left
+            for (x = minX & ~3; x <= maxX && x + 4 <= width; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lanes);
+                __m128 b0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+                __m128 b1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+                __m128 b2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+                __m128 covered = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(b0, zero), _mm_cmpge_ps(b1, zero)),
+                    _mm_and_ps(_mm_cmpge_ps(b2, zero), _mm_cmplt_ps(px, right)));
+                if (_mm_movemask_ps(covered) == 0)
+                    continue;
+                __m128 z = _mm_add_ps(z0, _mm_add_ps(_mm_mul_ps(b1, vdz1), _mm_mul_ps(b2, vdz2)));
+                int mask = _mm_movemask_ps(_mm_and_ps(covered, _mm_cmple_ps(z, _mm_loadu_ps(depthRow + x))));
+                if (mask == 0)
+                    continue;
+
+                float w0[4], w1[4], w2[4], zs[4];
+                _mm_storeu_ps(w0, b0);
+                _mm_storeu_ps(w1, b1);
+                _mm_storeu_ps(w2, b2);
+                _mm_storeu_ps(zs, z);
+                for (int lane = 0; lane < 4; lane ++) {
+                    if (mask & (1 << lane))
+                        shadePixel(t, w0[lane], w1[lane], w2[lane], x + lane, y, zs[lane]);
+                }
+            }
+            x = std::max(x, minX);
+#endif
+            for (; x <= maxX; x ++) {
+                float px = x + 0.5f;
+                float b0 = A[0] * px + B[0] * py + C[0];
+                float b1 = A[1] * px + B[1] * py + C[1];
+                float b2 = A[2] * px + B[2] * py + C[2];
+                if (b0 < 0 || b1 < 0 || b2 < 0)
+                    continue;
+                float z = t.depth[0] + b1 * dz1 + b2 * dz2;
+                if (z <= depthRow[x])
+                    shadePixel(t, b0, b1, b2, x, y, z);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Shades one covered pixel that passed the depth test and writes its color and depth
+ *
+ * @param t Triangle
+ * @param b0 Screen-space barycentric weight of vertex 0
+ * @param b1 Of vertex 1
+ * @param b2 Of vertex 2
+ * @param x Column
+ * @param y Row from the top
+ * @param z Window depth
+ */
+void SoftwareRenderer::shadePixel(const Triangle& t, float b0, float b1, float b2, int x, int y, float z) {
+    // perspective-correct weights
+    float w = 1.0f / (b0 * t.invW[0] + b1 * t.invW[1] + b2 * t.invW[2]);
+    b0 *= w; b1 *= w; b2 *= w;
+
+    glm::vec3 c;
+    switch (t.material) {
+        case RASTER_WATER: {
+            glm::vec3 position = t.world[0] * b0 + t.world[1] * b1 + t.world[2] * b2;
+            glm::vec3 normal = glm::normalize(t.normal[0] * b0 + t.normal[1] * b1 + t.normal[2] * b2);
+            glm::vec3 I = glm::normalize(position - t.camera);
+            c = skyColor(glm::reflect(I, normal)) * 0.7f;
+            break;
+        }
+        case RASTER_SKY:
+            c = skyColor(t.world[0] * b0 + t.world[1] * b1 + t.world[2] * b2);
+            break;
+        default: {
+            glm::vec3 normal = t.normal[0] * b0 + t.normal[1] * b1 + t.normal[2] * b2;
+            glm::vec2 uv = t.uv[0] * b0 + t.uv[1] * b1 + t.uv[2] * b2;
+            c = (t.texture != NULL ? t.texture->sample(uv) : glm::vec3(1.0f)) * glm::dot(glm::vec3(1, 5, 1), normal);
+            break;
+        }
+    }
+
+    c = glm::clamp(c, 0.0f, 1.0f);
+    unsigned char* p = &color[((size_t)y * width + x) * 3];
+    p[0] = (unsigned char)(c.r * 255 + 0.5f);
+    p[1] = (unsigned char)(c.g * 255 + 0.5f);
+    p[2] = (unsigned char)(c.b * 255 + 0.5f);
+    depth[(size_t)y * width + x] = z;
+}
+
+/**
+ * @brief Color of the sky in a direction: the skybox of the frame, or a gradient from horizon to zenith with a sun
+ *
+ * @param direction Direction, need not be normalized
+ * @return glm::vec3
+ */
+glm::vec3 SoftwareRenderer::skyColor(glm::vec3 direction) const {
+    if (sky != NULL)
+        return sampleCubemap(*sky, direction);
+
+    glm::vec3 d = glm::normalize(direction);
+    glm::vec3 horizon(0.75f, 0.82f, 0.9f), zenith(0.22f, 0.42f, 0.75f), ground(0.18f, 0.2f, 0.22f);
+    glm::vec3 c = d.y >= 0 ? glm::mix(horizon, zenith, sqrtf(d.y)) : glm::mix(horizon, ground, sqrtf(-d.y));
+    float sun = std::max(0.0f, glm::dot(d, glm::normalize(sunDirection)));
+    return c + glm::vec3(1.0f, 0.9f, 0.7f) * powf(sun, 256.0f);
+}
+
+/**
+ * @brief Returns a mesh texture, loading it the first time
+ *
+ * @param path Path of the image
+ * @return const RasterImage*, empty (sampled as white) when it could not be loaded
+ */
+const RasterImage* SoftwareRenderer::texture(const string& path) {
+    auto it = images.find(path);
+    if (it == images.end()) {
+        it = images.insert(std::make_pair(path, RasterImage())).first;
+        it->second.load(path);
+    }
+    return &it->second;
+}
@@ -0,0 +1,123 @@
+/**
+ * @file raster.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief CPU renderer backend: vertices are transformed on the thread pool, triangles binned into screen tiles, and tiles rasterized in parallel with SSE2 edge functions and depth tests, shading the water, skybox and meshes the way their shaders do
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "renderer.h"
+
+#include <map>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include <glm/glm.hpp>
+
+// side of the square screen tiles triangles are binned into; a tile is rasterized by one thread
+#define RASTER_TILE 64
+
+/**
+ * @brief An 8-bit RGB image in memory, rows top to bottom, sampled nearest-texel with GL's conventions
+ */
+struct RasterImage {
+    int width, height;
+    vector<unsigned char> rgb;
+
+    RasterImage();
+
+    bool load(const string& path);
+    glm::vec3 texel(int x, int y) const;
+    glm::vec3 sample(glm::vec2 uv) const;
+};
+
+/**
+ * @brief Renders into memory without GL, so frames can be produced and timed on machines without a GPU. Planar reflections, the procedural sky's LUTs and the overlay are GL only; a procedural sky is drawn as a gradient with a sun
+ *
+ * Publishes "renderer.draws", "renderer.triangles", "renderer.clipped" and "renderer.tiles" through report()
+ */
+class SoftwareRenderer : public Renderer {
+    public:
+        SoftwareRenderer(ThreadPool* pool);
+
+        RendererBackend backend() const override;
+
+        void beginFrame(int width, int height) override;
+        void setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position) override;
+
+        void drawWater(const DrawGeometry& geometry, Shader* shader, const WaterEnvironment& env) override;
+        void drawSkybox(const DrawGeometry& geometry, Shader* shader, unsigned int cubemap, const vector<string>& faces, const glm::vec3& sunDirection) override;
+        void drawMesh(const DrawGeometry& geometry, Shader* shader, const vector<Texture>& textures, const string& directory, const glm::mat4& model) override;
+
+        void endFrame() override;
+
+        bool readPixels(int& width, int& height, vector<unsigned char>& rgb) const override;
+        void report(Profiler* profiler) const override;
+
+    private:
+        enum Material {
+            RASTER_WATER,
+            RASTER_SKY,
+            RASTER_MESH
+        };
+
+        // a vertex after the vertex stage
+        struct ClipVertex {
+            glm::vec4 clip;
+            glm::vec3 world;        // world position (water), cube direction (sky)
+            glm::vec3 normal;
+            glm::vec2 uv;
+        };
+
+        // a triangle ready to rasterize; varyings are divided by w for perspective-correct interpolation
+        struct Triangle {
+            glm::vec2 screen[3];    // pixels, y down
+            float depth[3];         // window depth in [0, 1]
+            float invW[3];
+            glm::vec3 world[3], normal[3];
+            glm::vec2 uv[3];
+            int minX, minY, maxX, maxY;
+            Material material;
+            const RasterImage* texture;     // diffuse texture of meshes, NULL for white
+            glm::vec3 camera;               // camera position of the pass
+        };
+
+        ThreadPool* pool;
+        int width, height;
+        glm::mat4 view, projection;
+        glm::vec3 cameraPosition;
+
+        vector<unsigned char> color;    // RGB, rows top to bottom
+        vector<float> depth;            // one per pixel, rows top to bottom
+        vector<ClipVertex> transformed;
+        vector<Triangle> triangles;
+        vector<vector<int> > bins;      // triangles overlapping each tile, in submission order
+
+        // the sky drawn this frame, which the water reflects: a cubemap, or a gradient toward sunDirection when there is none
+        const vector<RasterImage>* sky;
+        glm::vec3 sunDirection;
+        std::map<string, RasterImage> images;           // mesh textures by path
+        std::map<string, vector<RasterImage> > cubemaps;   // skybox faces by the path of the first
+
+        int draws, clipped, tiles;
+
+        void transform(const DrawGeometry& geometry, const glm::mat4& matrix, const glm::mat4& model);
+        void assemble(const DrawGeometry& geometry, Material material, const RasterImage* texture);
+        void clipTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Material material, const RasterImage* texture);
+        void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, Material material, const RasterImage* texture);
+        void rasterizeTile(int tile);
+        void shadePixel(const Triangle& triangle, float b0, float b1, float b2, int x, int y, float z);
+        static ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t);
+
+        glm::vec3 skyColor(glm::vec3 direction) const;
+        const RasterImage* texture(const string& path);
+};
+
+#endif
@@ -0,0 +1,208 @@
+/**
+ * @file reflection.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Planar reflection of the scene about the mean water plane. Rendered offscreen at a fraction of the window resolution with an oblique near plane, and reused across frames while the camera barely moves
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "reflection.h"
+
+#include <math.h>
+#include <algorithm>
+
+/**
+ * @brief Construct a new Reflection object and its render target
+ *
+ * @param rx Window width
+ * @param ry Window height
+ * @param scale Fraction of the window resolution to render the reflection at
+ * @param planeHeight Height of the mirror plane (mean water level)
+ */
+Reflection::Reflection(int rx, int ry, float scale, float planeHeight) : scale(scale), planeHeight(planeHeight) {
+    budgetMs = REFLECTION_BUDGET;
+    moveThreshold = 0.05f;
+    turnThreshold = 0.9995f;
+    maxReuse = 8;
+
+    valid = false;
+    updated = false;
+    reused = 0;
+    interval = 1;
+    lastZoom = 0;
+
+    width = height = 0;
+
+    FBO.create();
+    texture.create();
+    RBO.create();
+
+    resize(rx, ry);
+
+    labelObject(GL_FRAMEBUFFER, FBO, "Reflection FBO");
+    labelObject(GL_TEXTURE, texture, "Reflection color");
+    labelObject(GL_RENDERBUFFER, RBO, "Reflection depth");
+}
+
+/**
+ * @brief (Re)allocates the render target for a window size. Invalidates the current reflection
+ *
+ * @param rx Window width
+ * @param ry Window height
+ */
+void Reflection::resize(int rx, int ry) {
+    width = std::max(1, (int)(rx * scale));
+    height = std::max(1, (int)(ry * scale));
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    texture.setSize(GLMEM_RENDER_TARGET, textureBytes(width, height, 4));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindRenderbuffer(GL_RENDERBUFFER, RBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    RBO.setSize(GLMEM_RENDER_TARGET, textureBytes(width, height, 4));
+
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, RBO);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        LOG_ERROR("gl", "Reflection framebuffer is incomplete");
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    valid = false;
+}
+
+/**
+ * @brief Forces the reflection to be re-rendered next frame, e.g. after the reflected scene changed
+ */
+void Reflection::invalidate() {
+    valid = false;
+    interval = 1;
+}
+
+/**
+ * @brief Decides whether the reflection must be re-rendered this frame. The previous reflection is reused while the camera is nearly still, or while the pass is over budget
+ *
+ * @param camera Camera the reflection is rendered for
+ * @return true if begin()/end() should be called this frame
+ */
+bool Reflection::needsUpdate(Camera* camera) {
+    updated = false;
+    if (!valid)
+        return true;
+
+    // over budget: spread renders out so the averaged cost stays under budgetMs
+    if (reused + 1 < interval) {
+        reused ++;
+        return false;
+    }
+
+    bool moved = glm::length(camera->position - lastPosition) > moveThreshold
+              || glm::dot(camera->front, lastFront) < turnThreshold
+              || camera->zoom != lastZoom;
+    if (!moved && reused + 1 < maxReuse) {
+        reused ++;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Binds the reflection target and computes the mirrored view, oblique projection and frustum for this frame
+ *
+ * @param camera Camera the reflection is rendered for
+ * @param cameraProjection Projection of the main pass
+ */
+void Reflection::begin(Camera* camera, const glm::mat4& cameraProjection) {
+    view = camera->getViewMatrix() * mirror();
+    projection = obliqueProjection(cameraProjection, view);
+    frustum = Frustum(projection * view);
+
+    lastPosition = camera->position;
+    lastFront = camera->front;
+    lastZoom = camera->zoom;
+    valid = true;
+    updated = true;
+    reused = 0;
+
+    timer.begin();
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // mirroring flips triangle winding
+    glFrontFace(GL_CW);
+}
+
+/**
+ * @brief Restores the default framebuffer and adapts the render interval to the measured cost
+ *
+ * @param rx Window width
+ * @param ry Window height
+ */
+void Reflection::end(int rx, int ry) {
+    glFrontFace(GL_CCW);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, rx, ry);
+    timer.end();
+
+    if (budgetMs > 0)
+        interval = std::min(maxReuse, std::max(1, (int)ceil(timer.ms / budgetMs)));
+}
+
+/**
+ * @brief Publishes the reflection's per-frame cost and reuse state
+ *
+ * @param profiler Profiler receiving the counters of the current frame
+ */
+void Reflection::report(Profiler* profiler) {
+    profiler->setCounter("reflection.updated", updated ? 1 : 0);
+    profiler->setCounter("reflection.interval", interval);
+    profiler->setCounter("reflection.pixels", width * height);
+    profiler->setCounter("reflection.gpu_ms", timer.ms);
+    profiler->setCounter("reflection.amortized_ms", timer.ms / interval);
+}
+
+/**
+ * @brief Reflection matrix about the plane y = planeHeight
+ *
+ * @return glm::mat4
+ */
+glm::mat4 Reflection::mirror() {
+    glm::mat4 m = glm::mat4(1.0f);
+    m[1][1] = -1;
+    m[3][1] = 2 * planeHeight;
+    return m;
+}
+
+/**
+ * @brief Replaces the near plane of a projection with the mirror plane so geometry below the water is clipped for free (Lengyel, "Oblique View Frustum Depth Projection and Clipping")
+ *
+ * @param proj Perspective projection of the main pass
+ * @param mirroredView Mirrored view matrix
+ * @return glm::mat4 oblique projection
+ */
+glm::mat4 Reflection::obliqueProjection(glm::mat4 proj, const glm::mat4& mirroredView) {
+    // clip plane in view space, keeping everything above the water
+    glm::vec4 plane = glm::transpose(glm::inverse(mirroredView)) * glm::vec4(0, 1, 0, -planeHeight);
+
+    glm::vec4 q;
+    q.x = ((plane.x > 0) - (plane.x < 0) + proj[2][0]) / proj[0][0];
+    q.y = ((plane.y > 0) - (plane.y < 0) + proj[2][1]) / proj[1][1];
+    q.z = -1.0f;
+    q.w = (1.0f + proj[2][2]) / proj[3][2];
+
+    glm::vec4 c = plane * (2.0f / glm::dot(plane, q));
+    proj[0][2] = c.x;
+    proj[1][2] = c.y;
+    proj[2][2] = c.z + 1.0f;
+    proj[3][2] = c.w;
+    return proj;
+}
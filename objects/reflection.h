@@ -0,0 +1,76 @@
+/**
+ * @file reflection.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Planar reflection of the scene about the mean water plane. Rendered offscreen at a fraction of the window resolution with an oblique near plane, and reused across frames while the camera barely moves
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef REFLECTION_H
+#define REFLECTION_H
+
+#include "helper.h"
+#include "camera.h"
+#include "../kernel/profiler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+// default fraction of the window resolution the reflection is rendered at
+#define REFLECTION_SCALE 0.5f
+
+// default GPU budget of the reflection pass, in milliseconds per frame (averaged over reused frames)
+#define REFLECTION_BUDGET 1.0f
+
+/**
+ * @brief Offscreen mirrored render target for planar water reflections
+ *
+ * Usage per frame: if needsUpdate(), call begin(), draw the scene with the mirrored view/projection (culling against frustum), then end()
+ */
+class Reflection {
+    public:
+        glm::mat4 view;         // mirrored view matrix of the last rendered reflection
+        glm::mat4 projection;   // oblique projection of the last rendered reflection
+        Frustum frustum;        // mirrored frustum, for culling objects out of the reflection pass
+        GLTexture texture;      // color attachment sampled by water.fs
+
+        float scale;            // fraction of the window resolution
+        float planeHeight;      // height of the mirror plane (mean water level)
+        float budgetMs;         // averaged GPU budget of the pass
+        float moveThreshold;    // camera translation (world units) under which a reflection may be reused
+        float turnThreshold;    // camera rotation (cosine of angle) above which a reflection may be reused
+        int maxReuse;           // frames a reflection may be reused for
+
+        Reflection(int rx, int ry, float scale = REFLECTION_SCALE, float planeHeight = 0);
+
+        void resize(int rx, int ry);
+        void invalidate();
+
+        bool needsUpdate(Camera* camera);
+        void begin(Camera* camera, const glm::mat4& cameraProjection);
+        void end(int rx, int ry);
+
+        void report(Profiler* profiler);
+
+    private:
+        GLFramebuffer FBO;
+        GLRenderbuffer RBO;
+        int width, height;
+
+        GpuTimer timer;
+
+        // camera state when the reflection was last rendered
+        glm::vec3 lastPosition, lastFront;
+        float lastZoom;
+        bool valid;
+
+        int reused;     // frames since the reflection was last rendered
+        int interval;   // minimum frames between renders, grows when the pass exceeds its budget
+        bool updated;   // whether the reflection was rendered this frame
+
+        glm::mat4 mirror();
+        glm::mat4 obliqueProjection(glm::mat4 proj, const glm::mat4& mirroredView);
+};
+
+#endif
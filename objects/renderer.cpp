@@ -0,0 +1,337 @@
+/**
+ * @file renderer.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Draw submission of the water, skybox and meshes behind one interface, with a GL backend, a null backend that only records and counts commands, and a CPU software rasterizer (raster.h)
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "renderer.h"
+#include "raster.h"
+#include "helper.h"
+#include "../kernel/profiler.h"
+
+/**
+ * @brief Construct a new empty DrawGeometry object
+ */
+DrawGeometry::DrawGeometry() : vao(0), vertices(NULL), stride(3), vertexCount(0), normalOffset(-1), uvOffset(-1),
+    indices(NULL), firstIndex(0), indexCount(0), mode(GL_TRIANGLES), strips(0), stripLength(0) {}
+
+/**
+ * @brief Returns how many triangles the draw rasterizes
+ *
+ * @return int
+ */
+int DrawGeometry::triangles() const {
+    if (mode == GL_TRIANGLE_STRIP)
+        return strips * std::max(0, stripLength - 2);
+    return (indices != NULL ? indexCount : vertexCount) / 3;
+}
+
+/**
+ * @brief Copies the last frame out of backends that render to memory
+ *
+ * @param width Receives the width of the image
+ * @param height Receives the height of the image
+ * @param rgb Receives the pixels, rows top to bottom
+ * @return bool false, leaving the arguments alone, when the backend keeps no image
+ */
+bool Renderer::readPixels(int& width, int& height, vector<unsigned char>& rgb) const {
+    (void)width; (void)height; (void)rgb;
+    return false;
+}
+
+/**
+ * @brief Publishes the backend's counters for the last frame. Backends issuing GL draws leave that to the GPU zones
+ *
+ * @param profiler Profiler receiving "renderer.<counter>" entries
+ */
+void Renderer::report(Profiler* profiler) const {
+    (void)profiler;
+}
+
+/**
+ * @brief Returns the name of a backend, as the renderer scenario key takes it
+ *
+ * @param backend Backend
+ * @return const char*
+ */
+const char* Renderer::backendName(RendererBackend backend) {
+    switch (backend) {
+        case RENDERER_NULL:     return "null";
+        case RENDERER_SOFTWARE: return "software";
+        default:                return "gl";
+    }
+}
+
+/**
+ * @brief Construct a new GLRenderer object. Needs a current GL context
+ */
+GLRenderer::GLRenderer() : width(0), height(0), view(1.0f), projection(1.0f), cameraPosition(0) {}
+
+/**
+ * @brief Returns RENDERER_GL
+ *
+ * @return RendererBackend
+ */
+RendererBackend GLRenderer::backend() const {
+    return RENDERER_GL;
+}
+
+/**
+ * @brief Starts a frame. The caller clears the framebuffer, since passes such as the planar reflection render to their own
+ *
+ * @param width Width of the viewport
+ * @param height Height of the viewport
+ */
+void GLRenderer::beginFrame(int width, int height) {
+    this->width = width;
+    this->height = height;
+}
+
+/**
+ * @brief Sets the matrices of the draws that follow
+ *
+ * @param view View matrix
+ * @param projection Projection matrix
+ * @param position Position of the camera in world space
+ */
+void GLRenderer::setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position) {
+    this->view = view;
+    this->projection = projection;
+    cameraPosition = position;
+}
+
+/**
+ * @brief Draws the water grid with the water shader, strip by strip
+ *
+ * @param geometry Water VAO, drawn as geometry.strips strips of geometry.stripLength indices
+ * @param shader Water shader
+ * @param env Sky and reflection textures the surface reflects
+ */
+void GLRenderer::drawWater(const DrawGeometry& geometry, Shader* shader, const WaterEnvironment& env) {
+    shader->use();
+    shader->setMat4("projection", projection);
+    shader->setMat4("view", view);
+    shader->setMat4("model", glm::mat4(1.0f));
+    shader->setVec3("cameraPos", cameraPosition);
+    shader->setVec2("viewport", (float)width, (float)height);
+    shader->setFloat("distortion", 0.02f);
+    if (env.skyView != 0)
+        shader->setFloat("exposure", env.exposure);
+
+    shader->setInt("skybox", 0);
+    shader->setInt("reflection", 1);
+    shader->setInt("skyView", 2);
+    shader->setInt("foamMap", 3);
+    shader->setVec2("foamOrigin", env.foamOrigin.x, env.foamOrigin.y);
+    shader->setVec2("foamSize", env.foamSize.x, env.foamSize.y);
+    shader->setBool("planarReflection", env.reflection != 0);
+    shader->setBool("proceduralSky", env.skyView != 0);
+    shader->setVec3("sunDir", env.sunDirection);
+
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, env.cubeTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, env.reflection);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, env.skyView);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, env.foam);
+    glActiveTexture(GL_TEXTURE0);
+
+    // render the mesh triangle strip by triangle strip - each row at a time
+    glBindVertexArray(geometry.vao);
+    for (int i = 0; i < geometry.strips; i ++) {
+        glDrawElements(GL_TRIANGLE_STRIP, geometry.stripLength, GL_UNSIGNED_INT,
+            (void*)(sizeof(unsigned int) * geometry.stripLength * i));
+    }
+    countDrawCalls(geometry.strips);
+}
+
+/**
+ * @brief Draws the skybox cube on the far plane. Translation of the view is discarded
+ *
+ * @param geometry Cube VAO
+ * @param shader Skybox shader
+ * @param cubemap Cubemap texture
+ * @param faces Unused, the cubemap holds them
+ * @param sunDirection Unused, the cubemap holds the sun
+ */
+void GLRenderer::drawSkybox(const DrawGeometry& geometry, Shader* shader, unsigned int cubemap, const vector<string>& faces, const glm::vec3& sunDirection) {
+    (void)faces; (void)sunDirection;
+    shader->use();
+    shader->setInt("skybox", 0);
+
+    glDepthFunc(GL_LEQUAL);
+    shader->setMat4("view", glm::mat4(glm::mat3(view)));
+    shader->setMat4("projection", projection);
+
+    glBindVertexArray(geometry.vao);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+    glDrawArrays(GL_TRIANGLES, 0, geometry.vertexCount);
+    countDrawCalls();
+    glBindVertexArray(0);
+    glDepthFunc(GL_LESS);
+}
+
+/**
+ * @brief Draws one mesh with its textures bound following the material.texture_<type>N convention
+ *
+ * @param geometry Mesh VAO and index count
+ * @param shader Mesh shader
+ * @param textures Textures of the mesh
+ * @param directory Unused, the textures are loaded
+ * @param model Model matrix
+ */
+void GLRenderer::drawMesh(const DrawGeometry& geometry, Shader* shader, const vector<Texture>& textures, const string& directory, const glm::mat4& model) {
+    (void)directory;
+    shader->use();
+    shader->setMat4("projection", projection);
+    shader->setMat4("view", view);
+    shader->setMat4("model", model);
+    shader->setVec3("cameraPos", cameraPosition);
+    shader->setBool("instanced", false);
+
+    bindMaterialTextures(shader, textures);
+
+    glBindVertexArray(geometry.vao);
+    glDrawElements(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, (void*)(geometry.firstIndex * sizeof(unsigned int)));
+    countDrawCalls();
+    glBindVertexArray(0);
+}
+
+/**
+ * @brief Ends the frame; the caller presents it
+ */
+void GLRenderer::endFrame() {
+    glFlush();
+}
+
+/**
+ * @brief Construct a new NullRenderer object
+ */
+NullRenderer::NullRenderer() : cameras(0), lastDraws(0), lastTriangles(0), lastVertices(0), lastPasses(0) {}
+
+/**
+ * @brief Returns RENDERER_NULL
+ *
+ * @return RendererBackend
+ */
+RendererBackend NullRenderer::backend() const {
+    return RENDERER_NULL;
+}
+
+/**
+ * @brief Starts recording a frame, dropping the draws of the last one
+ *
+ * @param width Unused
+ * @param height Unused
+ */
+void NullRenderer::beginFrame(int width, int height) {
+    (void)width; (void)height;
+    draws.clear();
+    cameras = 0;
+}
+
+/**
+ * @brief Counts a pass
+ */
+void NullRenderer::setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position) {
+    (void)view; (void)projection; (void)position;
+    cameras ++;
+}
+
+/**
+ * @brief Records a water draw
+ */
+void NullRenderer::drawWater(const DrawGeometry& geometry, Shader* shader, const WaterEnvironment& env) {
+    (void)shader; (void)env;
+    record("water", geometry, 0);
+}
+
+/**
+ * @brief Records a skybox draw
+ */
+void NullRenderer::drawSkybox(const DrawGeometry& geometry, Shader* shader, unsigned int cubemap, const vector<string>& faces, const glm::vec3& sunDirection) {
+    (void)shader; (void)cubemap; (void)sunDirection;
+    record("skybox", geometry, (int)faces.size());
+}
+
+/**
+ * @brief Records a mesh draw
+ */
+void NullRenderer::drawMesh(const DrawGeometry& geometry, Shader* shader, const vector<Texture>& textures, const string& directory, const glm::mat4& model) {
+    (void)shader; (void)directory; (void)model;
+    record("mesh", geometry, (int)textures.size());
+}
+
+/**
+ * @brief Totals the draws recorded this frame
+ */
+void NullRenderer::endFrame() {
+    lastDraws = (int)draws.size();
+    lastTriangles = 0;
+    lastVertices = 0;
+    lastPasses = cameras;
+    for (const RecordedDraw& draw : draws) {
+        lastTriangles += draw.triangles;
+        lastVertices += draw.vertices;
+    }
+}
+
+/**
+ * @brief Publishes "renderer.draws", "renderer.triangles", "renderer.vertices" and "renderer.passes" of the last frame
+ *
+ * @param profiler Profiler receiving the counters
+ */
+void NullRenderer::report(Profiler* profiler) const {
+    profiler->setCounter("renderer.draws", lastDraws);
+    profiler->setCounter("renderer.triangles", lastTriangles);
+    profiler->setCounter("renderer.vertices", lastVertices);
+    profiler->setCounter("renderer.passes", lastPasses);
+}
+
+/**
+ * @brief Returns the draws of the frame being recorded (of the last frame, between frames)
+ *
+ * @return const vector<RecordedDraw>&
+ */
+const vector<RecordedDraw>& NullRenderer::getDraws() const {
+    return draws;
+}
+
+/**
+ * @brief Appends a draw, counting what a GL draw of it would process
+ *
+ * @param kind Kind of draw
+ * @param geometry Its geometry
+ * @param textures Textures it samples
+ */
+void NullRenderer::record(const char* kind, const DrawGeometry& geometry, int textures) {
+    RecordedDraw draw;
+    draw.kind = kind;
+    draw.vertices = geometry.vertexCount;
+    draw.indices = geometry.mode == GL_TRIANGLE_STRIP ? geometry.strips * geometry.stripLength : geometry.indexCount;
+    draw.triangles = geometry.triangles();
+    draw.textures = textures;
+    draws.push_back(draw);
+}
+
+/**
+ * @brief Creates a backend
+ *
+ * @param backend Backend to create; RENDERER_GL needs a current GL context
+ * @param pool Threads the software rasterizer runs on (not owned; may be NULL)
+ * @return Renderer* owned by the caller
+ */
+Renderer* createRenderer(RendererBackend backend, ThreadPool* pool) {
+    switch (backend) {
+        case RENDERER_NULL:     return new NullRenderer();
+        case RENDERER_SOFTWARE: return new SoftwareRenderer(pool);
+        default:                return new GLRenderer();
+    }
+}
@@ -0,0 +1,162 @@
+/**
+ * @file renderer.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Draw submission of the water, skybox and meshes behind one interface, with a GL backend, a null backend that only records and counts commands, and a CPU software rasterizer (raster.h)
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+#include <glm/glm.hpp>
+
+// helper.h includes this header, so the types draws refer to are only declared here
+class Shader;
+struct Texture;
+class Profiler;
+class ThreadPool;
+
+enum RendererBackend {
+    RENDERER_GL,
+    RENDERER_NULL,          // records and counts draws, touches no GL
+    RENDERER_SOFTWARE       // tile-based CPU rasterizer, touches no GL
+};
+
+// Textures and lighting the water surface reflects
+struct WaterEnvironment {
+    unsigned int cubeTexture;   // skybox cubemap (0 when the sky is procedural)
+    unsigned int skyView;       // procedural sky-view LUT (0 when a skybox cubemap is used)
+    unsigned int reflection;    // planar reflection of the scene (0 to reflect the sky only)
+    glm::vec3 sunDirection;     // direction toward the sun, used with the sky-view LUT
+    float exposure;             // of the procedural sky
+    unsigned int foam;          // foam coverage in red (0 for none)
+    glm::vec2 foamOrigin;       // world x and z of the coverage's texture coordinates (0, 0)
+    glm::vec2 foamSize;         // world extent of the coverage along x and z
+
+    WaterEnvironment() : cubeTexture(0), skyView(0), reflection(0), sunDirection(0, 1, 0), exposure(1), foam(0), foamOrigin(0), foamSize(1) {}
+};
+
+/**
+ * @brief Vertices and indices of a draw, as GL objects for the GL backend and as CPU copies for the others
+ */
+struct DrawGeometry {
+    unsigned int vao;
+
+    const float* vertices;      // interleaved, position first
+    int stride;                 // floats per vertex
+    int vertexCount;
+    int normalOffset;           // floats from the start of a vertex, -1 when there are none
+    int uvOffset;               // likewise for texture coordinates
+
+    const unsigned int* indices;    // NULL for non-indexed draws
+    int firstIndex;             // first of the indexCount indices drawn, e.g. the level of detail of a mesh
+    int indexCount;
+
+    unsigned int mode;          // GL_TRIANGLES or GL_TRIANGLE_STRIP
+    int strips;                 // strips of stripLength indices, drawn one after the other (GL_TRIANGLE_STRIP only)
+    int stripLength;
+
+    DrawGeometry();
+
+    int triangles() const;
+};
+
+/**
+ * @brief Where draws go. One frame is beginFrame, setCamera and draws (setCamera again for another view), then endFrame
+ */
+class Renderer {
+    public:
+        virtual ~Renderer() {}
+
+        virtual RendererBackend backend() const = 0;
+
+        virtual void beginFrame(int width, int height) = 0;
+        virtual void setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position) = 0;
+
+        virtual void drawWater(const DrawGeometry& geometry, Shader* shader, const WaterEnvironment& env) = 0;
+        // faces are the cubemap's image files, which backends without GL load themselves; none draws a procedural sky toward sunDirection
+        virtual void drawSkybox(const DrawGeometry& geometry, Shader* shader, unsigned int cubemap, const vector<string>& faces, const glm::vec3& sunDirection) = 0;
+        // textures' paths are relative to directory
+        virtual void drawMesh(const DrawGeometry& geometry, Shader* shader, const vector<Texture>& textures, const string& directory, const glm::mat4& model) = 0;
+
+        virtual void endFrame() = 0;
+
+        // The last frame as RGB rows top to bottom. False when the backend keeps no image (GL reads its framebuffer instead)
+        virtual bool readPixels(int& width, int& height, vector<unsigned char>& rgb) const;
+        virtual void report(Profiler* profiler) const;
+
+        static const char* backendName(RendererBackend backend);
+};
+
+/**
+ * @brief Issues every draw to GL, as the objects did themselves
+ */
+class GLRenderer : public Renderer {
+    public:
+        GLRenderer();
+
+        RendererBackend backend() const override;
+
+        void beginFrame(int width, int height) override;
+        void setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position) override;
+
+        void drawWater(const DrawGeometry& geometry, Shader* shader, const WaterEnvironment& env) override;
+        void drawSkybox(const DrawGeometry& geometry, Shader* shader, unsigned int cubemap, const vector<string>& faces, const glm::vec3& sunDirection) override;
+        void drawMesh(const DrawGeometry& geometry, Shader* shader, const vector<Texture>& textures, const string& directory, const glm::mat4& model) override;
+
+        void endFrame() override;
+
+    private:
+        int width, height;
+        glm::mat4 view, projection;
+        glm::vec3 cameraPosition;
+};
+
+/**
+ * @brief One draw as the null backend recorded it
+ */
+struct RecordedDraw {
+    const char* kind;       // "water", "skybox" or "mesh"
+    int vertices, indices, triangles, textures;
+};
+
+/**
+ * @brief Keeps the draws of the last frame and counts them, without rendering anything, so everything above the driver can be timed on machines without a GPU
+ */
+class NullRenderer : public Renderer {
+    public:
+        NullRenderer();
+
+        RendererBackend backend() const override;
+
+        void beginFrame(int width, int height) override;
+        void setCamera(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& position) override;
+
+        void drawWater(const DrawGeometry& geometry, Shader* shader, const WaterEnvironment& env) override;
+        void drawSkybox(const DrawGeometry& geometry, Shader* shader, unsigned int cubemap, const vector<string>& faces, const glm::vec3& sunDirection) override;
+        void drawMesh(const DrawGeometry& geometry, Shader* shader, const vector<Texture>& textures, const string& directory, const glm::mat4& model) override;
+
+        void endFrame() override;
+
+        void report(Profiler* profiler) const override;
+        const vector<RecordedDraw>& getDraws() const;
+
+    private:
+        vector<RecordedDraw> draws;     // of the frame being recorded
+        int cameras;                    // setCamera calls this frame (passes)
+        int lastDraws, lastTriangles, lastVertices, lastPasses;
+
+        void record(const char* kind, const DrawGeometry& geometry, int textures);
+};
+
+Renderer* createRenderer(RendererBackend backend, ThreadPool* pool);
+
+#endif
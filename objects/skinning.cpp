@@ -0,0 +1,101 @@
+/**
+ * @file skinning.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Compute pre-skinning
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "skinning.h"
+
+/**
+ * @brief Construct a new Skinner object, pointing the model's skinned meshes at buffers holding their bind pose until skin() is called
+ *
+ * @param model Uploaded model with a skeleton (not owned)
+ * @param shader Compiled skin.cs program (not owned)
+ */
+Skinner::Skinner(Model* model, ComputeShader* shader) : model(model), shader(shader), skinnedVertices(0) {
+    paletteSSBO.create();
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, paletteSSBO);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max((size_t)1, model->skeleton.bones.size()) * sizeof(glm::mat4), NULL, GL_DYNAMIC_DRAW);
+    paletteSSBO.setSize(GLMEM_STORAGE, std::max((size_t)1, model->skeleton.bones.size()) * sizeof(glm::mat4));
+    labelObject(GL_BUFFER, paletteSSBO, model->directory + " bone palette");
+
+    for (unsigned int i = 0; i < model->meshes.size(); i ++) {
+        Mesh& mesh = model->meshes[i];
+        bool bound = false;
+        for (const Vertex& vertex : mesh.vertices) {
+            for (int k = 0; k < MAX_BONE_INFLUENCE && !bound; k ++)
+                bound = vertex.m_Weights[k] > 0;
+            if (bound)
+                break;
+        }
+        if (!bound)
+            continue;
+
+        GLBuffer buffer;
+        buffer.create();
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(Vertex), mesh.vertices.data(), GL_DYNAMIC_COPY);
+        buffer.setSize(GLMEM_VERTEX, mesh.vertices.size() * sizeof(Vertex));
+        countUpload(mesh.vertices.size() * sizeof(Vertex));
+        labelObject(GL_BUFFER, buffer, mesh.name + " skinned VBO");
+        mesh.setVertexSource(buffer);
+
+        meshes.push_back(i);
+        skinned.push_back(std::move(buffer));
+        skinnedVertices += mesh.vertices.size();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/**
+ * @brief Destroy the Skinner object, pointing the meshes back at their own vertices
+ */
+Skinner::~Skinner() {
+    for (int i : meshes)
+        model->meshes[i].setVertexSource(0);
+}
+
+/**
+ * @brief Deforms every skinned mesh by a pose. Call once per frame, before anything draws the model
+ *
+ * @param palette Bone palette of the pose (see Animator)
+ */
+void Skinner::skin(const vector<glm::mat4>& palette) {
+    if (meshes.empty() || palette.empty())
+        return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, paletteSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, std::min(palette.size(), model->skeleton.bones.size()) * sizeof(glm::mat4), palette.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    countUpload(palette.size() * sizeof(glm::mat4));
+
+    shader->use();
+    glUniform1ui(glGetUniformLocation(shader->ID, "stride"), sizeof(Vertex) / sizeof(float));
+    glUniform1ui(glGetUniformLocation(shader->ID, "normalOffset"), offsetof(Vertex, normal) / sizeof(float));
+    glUniform1ui(glGetUniformLocation(shader->ID, "tangentOffset"), offsetof(Vertex, tangent) / sizeof(float));
+    glUniform1ui(glGetUniformLocation(shader->ID, "bitangentOffset"), offsetof(Vertex, bitangent) / sizeof(float));
+    glUniform1ui(glGetUniformLocation(shader->ID, "boneOffset"), offsetof(Vertex, m_BoneIDs) / sizeof(float));
+    glUniform1ui(glGetUniformLocation(shader->ID, "weightOffset"), offsetof(Vertex, m_Weights) / sizeof(float));
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, paletteSSBO);
+    for (unsigned int i = 0; i < meshes.size(); i ++) {
+        const Mesh& mesh = model->meshes[meshes[i]];
+        glUniform1ui(glGetUniformLocation(shader->ID, "vertexCount"), mesh.vertices.size());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mesh.getVertexBuffer());
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, skinned[i]);
+        shader->dispatch(mesh.vertices.size(), 1, 1, 64);
+    }
+    glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+/**
+ * @brief Returns how many vertices skin() deforms
+ *
+ * @return int
+ */
+int Skinner::getSkinnedVertices() const {
+    return skinnedVertices;
+}
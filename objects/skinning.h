@@ -0,0 +1,37 @@
+/**
+ * @file skinning.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Compute pre-skinning. The bone palette of a pose is uploaded once per frame and a compute pass deforms the vertices of every skinned mesh into a buffer of its own, which the meshes then draw from; passes drawing the model several times (reflections, culling, many copies) never skin in their vertex shaders
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef SKINNING_H
+#define SKINNING_H
+
+#include "helper.h"
+
+/**
+ * @brief Skinned copies of the vertices of a model's meshes
+ */
+class Skinner {
+    public:
+        Skinner(Model* model, ComputeShader* shader);
+        ~Skinner();
+
+        void skin(const vector<glm::mat4>& palette);
+
+        int getSkinnedVertices() const;
+
+    private:
+        Model* model;
+        ComputeShader* shader;
+        GLBuffer paletteSSBO;
+        vector<int> meshes;         // meshes bound to bones
+        vector<GLBuffer> skinned;   // their skinned vertices, same layout as Vertex
+        int skinnedVertices;
+};
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file sky.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Procedural atmospheric sky. Transmittance and sky-view lookup tables are computed in a compute pass whenever the sun moves, and drawn with a single fullscreen triangle
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef SKY_H
+#define SKY_H
+
+#include "helper.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include <glm/trigonometric.hpp>
+
+// LUT resolutions (transmittance: cos zenith x height, sky-view: azimuth x elevation)
+#define TRANSMITTANCE_W 256
+#define TRANSMITTANCE_H 64
+#define SKYVIEW_W 192
+#define SKYVIEW_H 108
+
+/**
+ * @brief Manages the sky LUTs, the programs that build and draw them, and the sun parameters
+ */
+class Sky {
+    public:
+        GLTexture transmittanceLUT, skyViewLUT;
+        Shader* shader;
+        ComputeShader* lutShader;
+
+        float sunElevation, sunAzimuth;  // degrees
+        float sunIntensity, exposure;
+
+        Sky(const char* vertexPath, const char* fragmentPath, const char* computePath) : sunElevation(20.0f), sunAzimuth(45.0f), sunIntensity(20.0f), exposure(1.0f) {
+            shader = new Shader(vertexPath, fragmentPath);
+            lutShader = new ComputeShader(computePath);
+
+            createLUT(transmittanceLUT, TRANSMITTANCE_W, TRANSMITTANCE_H, "Sky transmittance LUT");
+            createLUT(skyViewLUT, SKYVIEW_W, SKYVIEW_H, "Sky view LUT");
+
+            // the fullscreen triangle is generated in the vertex shader, but core profile still needs a VAO bound
+            VAO.create();
+            glBindVertexArray(VAO);
+            labelObject(GL_VERTEX_ARRAY, VAO, "Sky VAO");
+            glBindVertexArray(0);
+
+            dirty = true;
+            lutUpdates = 0;
+        }
+
+        // GL objects are released by their handles
+        ~Sky() {
+            delete shader;
+            delete lutShader;
+        }
+
+        // Moves the sun. LUTs are rebuilt on the next update(), and only if the sun actually moved
+        void setSun(float elevation, float azimuth) {
+            elevation = std::max(-10.0f, std::min(90.0f, elevation));
+            azimuth = fmodf(fmodf(azimuth, 360.0f) + 360.0f, 360.0f);
+            if (elevation == sunElevation && azimuth == sunAzimuth)
+                return;
+            sunElevation = elevation;
+            sunAzimuth = azimuth;
+            dirty = true;
+        }
+
+        // World-space direction toward the sun
+        glm::vec3 sunDirection() {
+            float e = glm::radians(sunElevation), a = glm::radians(sunAzimuth);
+            return glm::vec3(cos(e) * cos(a), sin(e), cos(e) * sin(a));
+        }
+
+        // Rebuilds the LUTs if the sun changed since the last call. Returns whether any work was done
+        bool update() {
+            if (!dirty)
+                return false;
+
+            lutShader->use();
+            lutShader->setVec3("sunDir", sunDirection());
+            lutShader->setFloat("sunIntensity", sunIntensity);
+            glBindImageTexture(0, transmittanceLUT, 0, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+            glBindImageTexture(1, skyViewLUT, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+
+            lutShader->setInt("pass", 0);
+            lutShader->dispatch(TRANSMITTANCE_W, TRANSMITTANCE_H, 1, 8, 8);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+            lutShader->setInt("pass", 1);
+            lutShader->dispatch(SKYVIEW_W, SKYVIEW_H, 1, 8, 8);
+            glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+            dirty = false;
+            lutUpdates ++;
+            return true;
+        }
+
+        // Draws the sky on the far plane. Translation of view is discarded
+        void draw(const glm::mat4& view, const glm::mat4& projection) {
+            shader->use();
+            shader->setInt("skyView", 0);
+            shader->setInt("transmittance", 1);
+            shader->setMat3("invViewRot", glm::transpose(glm::mat3(view)));
+            shader->setVec4("projScale", projection[0][0], projection[1][1], projection[2][0], projection[2][1]);
+            shader->setVec3("sunDir", sunDirection());
+            shader->setFloat("sunIntensity", sunIntensity);
+            shader->setFloat("exposure", exposure);
+
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, skyViewLUT);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, transmittanceLUT);
+            glActiveTexture(GL_TEXTURE0);
+
+            glDepthFunc(GL_LEQUAL);
+            glBindVertexArray(VAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            countDrawCalls();
+            glBindVertexArray(0);
+            glDepthFunc(GL_LESS);
+        }
+
+        // Number of times the LUTs have been rebuilt
+        int getLutUpdates() {
+            return lutUpdates;
+        }
+
+    private:
+        GLVertexArray VAO;
+        bool dirty;
+        int lutUpdates;
+
+        void createLUT(GLTexture& textureID, int width, int height, const string& label) {
+            textureID.create();
+            glBindTexture(GL_TEXTURE_2D, textureID);
+            labelObject(GL_TEXTURE, textureID, label);
+            glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA16F, width, height);
+            textureID.setSize(GLMEM_TEXTURE, textureBytes(width, height, 8));
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            // azimuth wraps around, elevation does not
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+};
+
+#endif
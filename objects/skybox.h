@@ -65,43 +65,47 @@ static float skyboxVertices[] = {
  */
 class Skybox {
     public:
-        unsigned int skyboxVAO, skyboxVBO, cubeTexture;
+        GLVertexArray skyboxVAO;
+        GLBuffer skyboxVBO;
+        GLTexture cubeTexture;
         Shader* shader;
+        vector<std::string> faces;  // paths of the faces, loaded by renderers other than GL; none for a plain sky
 
         // Requires vertex path, fragment path, as well as paths to each face of the skybox in the order right, left, top, bottom, front, back or +x, -x, +y, -y, +z, -z
-        Skybox(const char* vertexPath, const char* fragmentPath, vector<std::string> faces) {
+        Skybox(const char* vertexPath, const char* fragmentPath, vector<std::string> faces) : shader(NULL), faces(faces) {
+            // renderers other than GL draw from skyboxVertices and the face files
+            if (!glContextCurrent())
+                return;
+
             shader = new Shader(vertexPath, fragmentPath);
             cubeTexture = loadCubemap(faces);
 
-            glGenVertexArrays(1, &skyboxVAO);
-            glGenBuffers(1, &skyboxVBO);
+            skyboxVAO.create();
+            skyboxVBO.create();
             glBindVertexArray(skyboxVAO);
             glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
             glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+            skyboxVBO.setSize(GLMEM_VERTEX, sizeof(skyboxVertices));
+            countUpload(sizeof(skyboxVertices));
+            labelObject(GL_VERTEX_ARRAY, skyboxVAO, "Skybox VAO");
+            labelObject(GL_BUFFER, skyboxVBO, "Skybox VBO");
             glEnableVertexAttribArray(0);
             glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
         }
 
-        // Draws the cube (with z-depth 1, so it should always be in the back of the scene)
-        void draw(Camera* camera, int rx, int ry) {
-            // compute matrices
-            glm::mat4 projection = glm::perspective(glm::radians(camera->zoom), (float)rx / (float)ry, 0.1f, 100.0f);
-            glm::mat4 view = camera->getViewMatrix();
-            
-            shader->use();
-            shader->setInt("skybox", 0);
-
-            glDepthFunc(GL_LEQUAL);
-            view = glm::mat4(glm::mat3(camera->getViewMatrix()));
-            shader->setMat4("view", view);
-            shader->setMat4("projection", projection);
-            
-            glBindVertexArray(skyboxVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubeTexture);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
-            glBindVertexArray(0);
-            glDepthFunc(GL_LESS);
+        // GL objects are released by their handles
+        ~Skybox() {
+            delete shader;
+        }
+
+        // Draws the cube (with z-depth 1, so it should always be in the back of the scene) with the renderer's current camera; translation of the view is discarded. sunDirection is used by renderers drawing a plain sky (no faces)
+        void draw(Renderer* renderer, const glm::vec3& sunDirection) {
+            DrawGeometry geometry;
+            geometry.vao = skyboxVAO;
+            geometry.vertices = skyboxVertices;
+            geometry.stride = 3;
+            geometry.vertexCount = sizeof(skyboxVertices) / (3 * sizeof(float));
+            renderer->drawSkybox(geometry, shader, cubeTexture, faces, sunDirection);
         }
 
 };
@@ -0,0 +1,114 @@
+/**
+ * @file threadpool.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Fixed set of worker threads that split index ranges between them (used to evaluate the water mesh in parallel)
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "threadpool.h"
+
+#include <algorithm>
+
+/**
+ * @brief Construct a new ThreadPool object
+ *
+ * @param threads Threads taking part in a parallelFor, including the caller; 0 uses every hardware thread
+ */
+ThreadPool::ThreadPool(int threads) : stopping(false), job(NULL), next(0), jobEnd(0), chunk(1), generation(0), active(0) {
+    if (threads <= 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+    for (int i = 1; i < threads; i ++)
+        workers.push_back(std::thread(&ThreadPool::work, this));
+}
+
+/**
+ * @brief Destroy the ThreadPool object, joining every worker
+ */
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+/**
+ * @brief Returns the number of threads taking part in a parallelFor
+ *
+ * @return int
+ */
+int ThreadPool::getThreads() const {
+    return (int)workers.size() + 1;
+}
+
+/**
+ * @brief Calls body on disjoint subranges covering [begin, end), in parallel, and returns once all have finished. One thread at a time may call it
+ *
+ * @param begin First index
+ * @param end One past the last index
+ * @param body Called with each subrange [from, to); must be safe to run concurrently
+ */
+void ThreadPool::parallelFor(int begin, int end, const std::function<void(int, int)>& body) {
+    if (end <= begin)
+        return;
+    if (workers.empty()) {
+        body(begin, end);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        next = begin;
+        jobEnd = end;
+        chunk = std::max(1, (end - begin) / (getThreads() * THREADPOOL_CHUNKS_PER_THREAD));
+        active = (int)workers.size();
+        generation ++;
+    }
+    wake.notify_all();
+
+    runChunks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return active == 0; });
+    job = NULL;
+}
+
+/**
+ * @brief Worker loop: waits for a job, helps with it, reports back
+ */
+void ThreadPool::work() {
+    unsigned int seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        runChunks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (-- active == 0)
+            done.notify_one();
+    }
+}
+
+/**
+ * @brief Claims and runs chunks of the current job until none are left
+ */
+void ThreadPool::runChunks() {
+    for (;;) {
+        int from = next.fetch_add(chunk);
+        if (from >= jobEnd)
+            return;
+        (*job)(from, std::min(from + chunk, jobEnd));
+    }
+}
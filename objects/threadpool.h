@@ -0,0 +1,53 @@
+/**
+ * @file threadpool.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief Fixed set of worker threads that split index ranges between them (used to evaluate the water mesh in parallel)
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::vector;
+
+// ranges are cut into this many chunks per thread, so uneven chunks still balance
+#define THREADPOOL_CHUNKS_PER_THREAD 4
+
+/**
+ * @brief Runs parallelFor bodies on the calling thread plus threads - 1 workers. Only one parallelFor runs at a time
+ */
+class ThreadPool {
+    public:
+        ThreadPool(int threads = 0);
+        ~ThreadPool();
+
+        int getThreads() const;
+        void parallelFor(int begin, int end, const std::function<void(int, int)>& body);
+
+    private:
+        vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake, done;
+        bool stopping;
+
+        // current job; generation changes whenever a new one is posted
+        const std::function<void(int, int)>* job;
+        std::atomic<int> next;
+        int jobEnd, chunk;
+        unsigned int generation;
+        int active;     // workers still running the current job
+
+        void work();
+        void runChunks();
+};
+
+#endif
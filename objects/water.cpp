@@ -41,19 +41,33 @@ Water::Water(int px, int pz, int pw, int pl, int pdimx, int pdimz, float maxA, i
     
     // define set of waves
     for (int i = 0; i < maxI; i ++) {
-        Ai.push_back(randFloat(maxA)); std::cout << "\n" << Ai.at(i);
-        wi.push_back(randFloat(MAXFREQ)*0.5+MAXFREQ*0.5); std::cout << "\n" << wi.at(i);
-        Di.push_back(glm::vec2(randFloat(1.0f)*2-1, randFloat(1.0f)*2-1)); std::cout << "\n" << Di.at(i).x << " " << Di.at(i).y;
-        Si.push_back(randFloat(MAXSPED)*0.5+MAXFREQ*0.5); std::cout << "\n" << Si.at(i);
+        Ai.push_back(randFloat(maxA));
+        wi.push_back(randFloat(MAXFREQ)*0.5+MAXFREQ*0.5);
+        Di.push_back(glm::vec2(randFloat(1.0f)*2-1, randFloat(1.0f)*2-1));
+        Si.push_back(randFloat(MAXSPED)*0.5+MAXFREQ*0.5);
+        LOG_DEBUG("water", "wave %d: A %f, w %f, D (%f, %f), S %f", i, Ai[i], wi[i], Di[i].x, Di[i].y, Si[i]);
+        waves.add(Ai[i], wi[i], Di[i].x, Di[i].y, Si[i]);
     }
+    for (int j = 0; j < pDimZ; j ++)
+        gridZ.push_back(pZ - pL / 2 + (float)j * pL / pDimZ);
 
     // initialize internal time
     internalTime = 0;
+    pool = NULL;
+    evaluator = WATER_EVAL_SCALAR;
+    evalShader = NULL;
 
     // setup wave mesh
     setupMesh();
 }
 
+/**
+ * @brief Destroy the Water object
+ */
+Water::~Water() {
+    delete evalShader;
+}
+
 /**
  * @brief Wave basis equation for some wave i. Follows W(x, y, t) = Ai sin (Di dot (x, y) * wi + Si * wi * t)
  * 
@@ -206,6 +220,25 @@ void Water::updateTime(float dT) {
     internalTime += dT;
 }
 
+/**
+ * @brief Returns where the points of the grid lie, and so which vertex is nearest a position
+ *
+ * @return WaterGrid
+ */
+WaterGrid Water::getGrid() const {
+    WaterGrid grid = { pX - pW / 2, pZ - pL / 2, pW, pL, pDimX, pDimZ };
+    return grid;
+}
+
+/**
+ * @brief Returns the vertex buffer, holding the surface as last evaluated (GPU) or uploaded (CPU evaluators)
+ *
+ * @return unsigned int, 0 without GL
+ */
+unsigned int Water::getVertexBuffer() const {
+    return VBO;
+}
+
 /**
  * @brief Setup the mesh after wave functions have been initialized
  */
@@ -240,13 +273,18 @@ void Water::setupMesh() {
         }
     }
 
-    // register/update buffers
-    glGenVertexArrays(1, &VAO);
+    // register/update buffers; renderers other than GL draw from the CPU copies alone
+    if (!glContextCurrent())
+        return;
+    VAO.create();
     glBindVertexArray(VAO);
 
-    glGenBuffers(1, &VBO);
+    VBO.create();
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_DYNAMIC_DRAW);
+    VBO.setSize(GLMEM_VERTEX, vertices.size() * sizeof(float));
+    labelObject(GL_VERTEX_ARRAY, VAO, "Water VAO");
+    labelObject(GL_BUFFER, VBO, "Water VBO");
 
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
@@ -254,61 +292,244 @@ void Water::setupMesh() {
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
     
-    glGenBuffers(1, &EBO);
+    EBO.create();
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_DYNAMIC_DRAW);
+    EBO.setSize(GLMEM_INDEX, indices.size() * sizeof(unsigned int));
+    countUpload(vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int));
+    labelObject(GL_BUFFER, EBO, "Water EBO");
 }
 
 /**
  * @brief Updates the mesh given current internal time and wave functions
  */
 void Water::updateMesh() {
-    // clear vertices/indices
-    vertices.clear();
-    indices.clear();
+    evaluate();
+    upload();
+}
 
-    // setup vertices
-    for (int i = 0; i < pDimX; i ++) {
-        for (int j = 0; j < pDimZ; j ++) {
+/**
+ * @brief Evaluates the vertices (positions and normals) at the current internal time with the selected evaluator. Only the GPU evaluator touches the GPU
+ */
+void Water::evaluate() {
+    if (evaluator == WATER_EVAL_GPU) {
+        evalShader->use();
+        evalShader->setFloat("time", internalTime);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, VBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, waveSSBO);
+        evalShader->dispatch(pDimX * pDimZ, 1, 1, 64);
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+        return;
+    }
+
+    // vertices are rewritten in place so rows can be filled in parallel; the indices never change
+    vertices.resize(pDimX * pDimZ * 6);
+    if (evaluator == WATER_EVAL_SSE2 || evaluator == WATER_EVAL_AVX2)
+        waves.setTime(internalTime);
+
+    auto rows = [this](int from, int to) {
+        for (int i = from; i < to; i ++) {
             // evaluate x and z (or just use i and j)
             float x = pX - pW / 2 + (float)i * pW / pDimX;
-            float z = pZ - pL / 2 + (float)j * pL / pDimZ;
-            
-            // compute H / update vertices
-            float y = H(x, z, internalTime);
-            vertices.push_back(x);
-            vertices.push_back(y);
-            vertices.push_back(z);
-
-            // compute N / update normals
-            glm::vec3 normal = N(x, z, internalTime);
-            vertices.push_back(normal.x);
-            vertices.push_back(normal.y);
-            vertices.push_back(normal.z);
+            float* row = &vertices[i * pDimZ * 6];
+            if (evaluator == WATER_EVAL_SSE2) {
+                evaluateRowSSE2(waves, x, &gridZ[0], pDimZ, row);
+                continue;
+            }
+            if (evaluator == WATER_EVAL_AVX2) {
+                evaluateRowAVX2(waves, x, &gridZ[0], pDimZ, row);
+                continue;
+            }
+            for (int j = 0; j < pDimZ; j ++) {
+                float z = gridZ[j];
+                float* v = row + j * 6;
+
+                // compute H / update vertices
+                v[0] = x;
+                v[1] = H(x, z, internalTime);
+                v[2] = z;
+
+                // compute N / update normals
+                glm::vec3 normal = N(x, z, internalTime);
+                v[3] = normal.x;
+                v[4] = normal.y;
+                v[5] = normal.z;
+            }
         }
-    }
+    };
+    if (pool != NULL)
+        pool->parallelFor(0, pDimX, rows);
+    else
+        rows(0, pDimX);
+}
+
+/**
+ * @brief Sends the last evaluated vertices to the vertex buffer. Nothing to send when they were evaluated on the GPU, or when there is no vertex buffer (renderers other than GL)
+ */
+void Water::upload() {
+    if (evaluator == WATER_EVAL_GPU || VBO == 0)
+        return;
 
-    // update buffers
     glBindVertexArray(VAO);
 
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), &vertices[0]);
+    countUpload(vertices.size() * sizeof(float));
 }
 
 /**
- * @brief Draws the mesh
+ * @brief Copies the vertex buffer back into vertices, so what the GPU evaluator wrote can be compared with the CPU evaluators. Stalls until the GPU is done
+ */
+void Water::readback() {
+    if (evaluator != WATER_EVAL_GPU)
+        return;
+
+    vertices.resize(pDimX * pDimZ * 6);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(float), &vertices[0]);
+}
+
+/**
+ * @brief Evaluates updateMesh on the pool's threads from now on
  * 
- * @param shader 
+ * @param pool Thread pool, or NULL to evaluate on the calling thread. Not owned
  */
-void Water::draw(Shader* shader, unsigned int cubeTexture) {
-    glBindVertexArray(VAO);
+void Water::setThreadPool(ThreadPool* pool) {
+    this->pool = pool;
+}
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, cubeTexture);
+/**
+ * @brief Returns the pool evaluating the water
+ *
+ * @return ThreadPool*, NULL when evaluated on the calling thread
+ */
+ThreadPool* Water::getThreadPool() const {
+    return pool;
+}
 
-    // render the mesh triangle strip by triangle strip - each row at a time
-    for(int i = 0; i < pDimZ-1; i ++) {
-        glDrawElements(GL_TRIANGLE_STRIP, pDimX, GL_UNSIGNED_INT, 
-            (void*)(sizeof(unsigned int) * pDimX * i));
+/**
+ * @brief Selects how evaluate computes the vertices from now on
+ *
+ * @param evaluator Evaluator to use
+ * @return bool false, keeping the current evaluator, when this machine cannot run it
+ */
+bool Water::setEvaluator(WaterEvaluator evaluator) {
+    if (!evaluatorSupported(evaluator))
+        return false;
+
+    if (evaluator == WATER_EVAL_GPU && evalShader == NULL) {
+        // two vec4 per wave: (A, w, D.x, D.y) and (S * w, w * D.x * A, w * D.y * A, 0)
+        vector<float> packed;
+        for (int i = 0; i < waves.count(); i ++) {
+            float wave[8] = { waves.A[i], waves.w[i], waves.Dx[i], waves.Dy[i], waves.Sw[i], waves.wDxA[i], waves.wDyA[i], 0 };
+            packed.insert(packed.end(), wave, wave + 8);
+        }
+        if (packed.empty())
+            packed.resize(8);
+        waveSSBO.create();
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, waveSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, packed.size() * sizeof(float), &packed[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        waveSSBO.setSize(GLMEM_STORAGE, packed.size() * sizeof(float));
+        countUpload(packed.size() * sizeof(float));
+        labelObject(GL_BUFFER, waveSSBO, "Water waves SSBO");
+
+        evalShader = new ComputeShader("shaders/water.cs");
+        evalShader->use();
+        evalShader->setInt("originX", pX - pW / 2);
+        evalShader->setInt("originZ", pZ - pL / 2);
+        evalShader->setInt("sizeX", pW);
+        evalShader->setInt("sizeZ", pL);
+        evalShader->setInt("dimX", pDimX);
+        evalShader->setInt("dimZ", pDimZ);
+        evalShader->setInt("waveCount", waves.count());
     }
-}
\ No newline at end of file
+    this->evaluator = evaluator;
+    return true;
+}
+
+/**
+ * @brief Returns the evaluator in use
+ *
+ * @return WaterEvaluator
+ */
+WaterEvaluator Water::getEvaluator() const {
+    return evaluator;
+}
+
+/**
+ * @brief Returns whether this machine can run an evaluator. The GPU evaluator needs a current GL context
+ *
+ * @param evaluator Evaluator to check
+ * @return bool
+ */
+bool Water::evaluatorSupported(WaterEvaluator evaluator) {
+    switch (evaluator) {
+        case WATER_EVAL_SCALAR: return true;
+        case WATER_EVAL_SSE2:   return cpuHasSSE2();
+        case WATER_EVAL_AVX2:   return cpuHasAVX2();
+        case WATER_EVAL_GPU:    return glContextCurrent() && (GLEW_VERSION_4_3 || GLEW_ARB_compute_shader);
+        default:                return false;
+    }
+}
+
+/**
+ * @brief Returns the name of an evaluator
+ *
+ * @param evaluator Evaluator
+ * @return const char*
+ */
+const char* Water::evaluatorName(WaterEvaluator evaluator) {
+    switch (evaluator) {
+        case WATER_EVAL_SCALAR: return "scalar";
+        case WATER_EVAL_SSE2:   return "sse2";
+        case WATER_EVAL_AVX2:   return "avx2";
+        default:                return "gpu";
+    }
+}
+
+/**
+ * @brief Draws the mesh
+ * 
+ * @param renderer Renderer to draw with
+ * @param shader Water shader (unused by renderers other than GL)
+ * @param env Sky and reflection textures the surface reflects
+ */
+void Water::draw(Renderer* renderer, Shader* shader, const WaterEnvironment& env) {
+    DrawGeometry geometry;
+    geometry.vao = VAO;
+    geometry.vertices = vertices.data();
+    geometry.stride = 6;
+    geometry.vertexCount = vertices.size() / 6;
+    geometry.normalOffset = 3;
+    geometry.indices = indices.data();
+    geometry.indexCount = indices.size();
+
+    // the mesh is drawn triangle strip by triangle strip - each row at a time
+    geometry.mode = GL_TRIANGLE_STRIP;
+    geometry.strips = pDimZ - 1;
+    geometry.stripLength = pDimX;
+    renderer->drawWater(geometry, shader, env);
+}
+
+/**
+ * @brief Writes the surface's parameters, e.g. for diagnostic dumps
+ * 
+ * @param params Map receiving "water.<parameter>" entries
+ */
+void Water::describe(std::map<std::string, double>& params) const {
+    params["water.time"] = internalTime;
+    params["water.center_x"] = pX;
+    params["water.center_z"] = pZ;
+    params["water.width"] = pW;
+    params["water.length"] = pL;
+    params["water.dim_x"] = pDimX;
+    params["water.dim_z"] = pDimZ;
+    params["water.vertices"] = vertices.size() / 6;
+    params["water.max_amplitude"] = maxA;
+    params["water.waves"] = (double)Ai.size();
+    params["water.directional"] = directional;
+    params["water.rounded"] = rounded;
+    params["water.animated"] = animated;
+    params["water.evaluator"] = evaluator;
+}
@@ -12,8 +12,13 @@
 #define WATER_H
 
 #include "helper.h"
+#include "renderer.h"
+#include "threadpool.h"
+#include "wavesimd.h"
 
 #include <vector>
+#include <map>
+#include <string>
 #include <stdlib.h>
 #include <time.h>
 #include <math.h>
@@ -21,6 +26,24 @@
 #define MAXFREQ 4.0f
 #define MAXSPED 0.005f
 
+// Ways of evaluating the sum of sines. They agree to within rounding; see kernel/validation.h for how closely
+enum WaterEvaluator {
+    WATER_EVAL_SCALAR,      // Water::H and Water::N, the reference
+    WATER_EVAL_SSE2,        // four points at a time
+    WATER_EVAL_AVX2,        // eight points at a time
+    WATER_EVAL_GPU,         // compute shader writing the vertex buffer, no upload
+    WATER_EVAL_COUNT
+};
+
+/**
+ * @brief Where the points of a water grid lie: point (i, j) is vertex i * dimZ + j, at x = originX + i * sizeX / dimX and z = originZ + j * sizeZ / dimZ
+ */
+struct WaterGrid {
+    int originX, originZ;
+    int sizeX, sizeZ;
+    int dimX, dimZ;
+};
+
 //TODO: reimplement Water class using tesselation shaders
 // generally calmer water. options for rounded/pointed peaks or directional/circular waves
 class Water {
@@ -29,16 +52,39 @@ class Water {
         vector<unsigned int> indices;
 
         Water(int px, int pz, int pw, int pl, int pdimx, int pdimz, float maxA, int maxI, bool dir, bool rnd, bool anim);
+        ~Water();
 
         void setupMesh();
         void updateMesh();
+        void evaluate();
+        void upload();
+        void readback();
+        void setThreadPool(ThreadPool* pool);
+        ThreadPool* getThreadPool() const;
+        bool setEvaluator(WaterEvaluator evaluator);
+        WaterEvaluator getEvaluator() const;
         void updateTime(float dT);
 
-        void draw(Shader* shader, unsigned int cubeTexture);
+        WaterGrid getGrid() const;
+        unsigned int getVertexBuffer() const;
+
+        void draw(Renderer* renderer, Shader* shader, const WaterEnvironment& env);
+
+        void describe(std::map<std::string, double>& params) const;
+
+        static bool evaluatorSupported(WaterEvaluator evaluator);
+        static const char* evaluatorName(WaterEvaluator evaluator);
 
     private:
         float internalTime;
-        unsigned int VAO, VBO, EBO;
+        ThreadPool* pool;   // splits updateMesh across threads (NULL runs it on the caller)
+        WaterEvaluator evaluator;
+        GLVertexArray VAO;
+        GLBuffer VBO, EBO;
+
+        // GPU evaluator, created when first selected: the waves in a storage buffer, and the shader writing VBO
+        ComputeShader* evalShader;
+        GLBuffer waveSSBO;
         
         // px - x position of center of water in world
         // pz - z position of center of water in world
@@ -75,6 +121,9 @@ class Water {
         vector<float> wi;       // frequency of wave
         vector<glm::vec2> Di;   // horizontal direction vector of wave
         vector<float> Si;       // phase-constant = S * 2/L = S * w
+
+        WaveSet waves;          // the same waves, as the SIMD evaluators read them
+        vector<float> gridZ;    // z of each column of the grid
 };
 
 // rougher seas. variations on intensity
@@ -0,0 +1,297 @@
+/**
+ * @file wavesimd.cpp
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief SSE2 and AVX2 evaluation of the sum of sines, a row of the water grid at a time. Selected at run time, so one binary runs on every x86 CPU
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#include "wavesimd.h"
+
+#include <math.h>
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define WAVESIMD_X86
+#include <immintrin.h>
+// each kernel is compiled for its own instruction set, whatever the rest of the program targets
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// Cody-Waite reduction by pi/4 in three parts and the minimax polynomials of Cephes' sinf/cosf; accurate to a few ulp while |x| < 8192
+#define FOUR_OVER_PI 1.27323954473516f
+#define DP1 0.78515625f
+#define DP2 2.4187564849853515625e-4f
+#define DP3 3.77489497744594108e-8f
+#define COS_C0 2.443315711809948e-5f
+#define COS_C1 -1.388731625493765e-3f
+#define COS_C2 4.166664568298827e-2f
+#define SIN_S0 -1.9515295891e-4f
+#define SIN_S1 8.3321608736e-3f
+#define SIN_S2 -1.6666654611e-1f
+#define TWO_PI 6.28318530717959
+
+/**
+ * @brief Appends a wave
+ *
+ * @param A Amplitude
+ * @param w Frequency
+ * @param Dx x of the direction
+ * @param Dy y of the direction
+ * @param S Speed
+ */
+void WaveSet::add(float A, float w, float Dx, float Dy, float S) {
+    this->A.push_back(A);
+    this->w.push_back(w);
+    this->Dx.push_back(Dx);
+    this->Dy.push_back(Dy);
+    Sw.push_back(S * w);
+    wDxA.push_back(w * Dx * A);
+    wDyA.push_back(w * Dy * A);
+    phase.push_back(0);
+}
+
+/**
+ * @brief Sets the time the evaluators read the waves at. The time terms grow without bound while the SIMD sincos is only accurate
+ * for small arguments, so each is wrapped by a period first; the spatial terms stay bounded by the grid
+ *
+ * @param t Time
+ */
+void WaveSet::setTime(float t) {
+    for (unsigned int i = 0; i < Sw.size(); i ++)
+        phase[i] = (float)fmod((double)Sw[i] * (double)t, TWO_PI);
+}
+
+/**
+ * @brief Returns the number of waves
+ *
+ * @return int
+ */
+int WaveSet::count() const {
+    return (int)A.size();
+}
+
+#ifdef WAVESIMD_X86
+
+/**
+ * @brief Returns whether the CPU runs SSE2
+ *
+ * @return bool
+ */
+bool cpuHasSSE2() {
+    return __builtin_cpu_supports("sse2");
+}
+
+/**
+ * @brief Returns whether the CPU (and the OS, which has to save the wider registers) runs AVX2
+ *
+ * @return bool
+ */
+bool cpuHasAVX2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+/**
+ * @brief Sine and cosine of four floats
+ *
+ * @param x Angles in radians
+ * @param s Receives the sines
+ * @param c Receives the cosines
+ */
+static inline TARGET_SSE2 void sincos4(__m128 x, __m128& s, __m128& c) {
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+    const __m128i two = _mm_set1_epi32(2), four = _mm_set1_epi32(4);
+
+    __m128 signSin = _mm_and_ps(x, signMask);
+    x = _mm_andnot_ps(signMask, x);
+
+    // octant, rounded up to even so the reduced angle is within [-pi/4, pi/4]
+    __m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+    j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+    __m128 y = _mm_cvtepi32_ps(j);
+
+    // the sine is negated in octants 4-7, the cosine in octants 2-5, and octants 2-3 and 6-7 swap the polynomials
+    signSin = _mm_xor_ps(signSin, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, four), 29)));
+    __m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, two), four), 29));
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, two), two));
+
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+    x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+    __m128 z = _mm_mul_ps(x, x);
+
+    __m128 cosPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_C0), z), _mm_set1_ps(COS_C1));
+    cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(COS_C2));
+    cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+    cosPoly = _mm_add_ps(_mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+    __m128 sinPoly = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_S0), z), _mm_set1_ps(SIN_S1));
+    sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(SIN_S2));
+    sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+    s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cosPoly), _mm_andnot_ps(swap, sinPoly)), signSin);
+    c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sinPoly), _mm_andnot_ps(swap, cosPoly)), signCos);
+}
+
+/**
+ * @brief Sine and cosine of eight floats
+ *
+ * @param x Angles in radians
+ * @param s Receives the sines
+ * @param c Receives the cosines
+ */
+static inline TARGET_AVX2 void sincos8(__m256 x, __m256& s, __m256& c) {
+    const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+    const __m256i two = _mm256_set1_epi32(2), four = _mm256_set1_epi32(4);
+
+    __m256 signSin = _mm256_and_ps(x, signMask);
+    x = _mm256_andnot_ps(signMask, x);
+
+    __m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(FOUR_OVER_PI)));
+    j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+    __m256 y = _mm256_cvtepi32_ps(j);
+
+    signSin = _mm256_xor_ps(signSin, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, four), 29)));
+    __m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, two), four), 29));
+    __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, two), two));
+
+    x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP1)));
+    x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP2)));
+    x = _mm256_sub_ps(x, _mm256_mul_ps(y, _mm256_set1_ps(DP3)));
+    __m256 z = _mm256_mul_ps(x, x);
+
+    __m256 cosPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(COS_C0), z), _mm256_set1_ps(COS_C1));
+    cosPoly = _mm256_add_ps(_mm256_mul_ps(cosPoly, z), _mm256_set1_ps(COS_C2));
+    cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+    cosPoly = _mm256_add_ps(_mm256_sub_ps(cosPoly, _mm256_mul_ps(z, _mm256_set1_ps(0.5f))), _mm256_set1_ps(1.0f));
+
+    __m256 sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(SIN_S0), z), _mm256_set1_ps(SIN_S1));
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(sinPoly, z), _mm256_set1_ps(SIN_S2));
+    sinPoly = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sinPoly, z), x), x);
+
+    s = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, swap), signSin);
+    c = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, swap), signCos);
+}
+
+/**
+ * @brief Evaluates a row of the grid four points at a time
+ *
+ * @param waves Waves to sum
+ * @param x x coordinate shared by the row
+ * @param z z coordinate of each point
+ * @param count Number of points
+ * @param out Receives 6 floats per point
+ */
+TARGET_SSE2 void evaluateRowSSE2(const WaveSet& waves, float x, const float* z, int count, float* out) {
+    const int n = waves.count();
+    for (int j = 0; j < count; j += 4) {
+        // the last points of a row that does not divide evenly are evaluated in lanes padded with its last z
+        float lanes[4];
+        for (int k = 0; k < 4; k ++)
+            lanes[k] = z[j + k < count ? j + k : count - 1];
+        __m128 vz = _mm_loadu_ps(lanes);
+
+        __m128 h = _mm_setzero_ps(), dx = _mm_setzero_ps(), dy = _mm_setzero_ps();
+        for (int i = 0; i < n; i ++) {
+            // (Di dot (x, z)) * wi + (Si * wi) * t, in Water::W's order but with the time term wrapped
+            __m128 arg = _mm_add_ps(_mm_set1_ps(waves.Dx[i] * x), _mm_mul_ps(_mm_set1_ps(waves.Dy[i]), vz));
+            arg = _mm_add_ps(_mm_mul_ps(arg, _mm_set1_ps(waves.w[i])), _mm_set1_ps(waves.phase[i]));
+            __m128 s, c;
+            sincos4(arg, s, c);
+            h = _mm_add_ps(h, _mm_mul_ps(_mm_set1_ps(waves.A[i]), s));
+            dx = _mm_add_ps(dx, _mm_mul_ps(_mm_set1_ps(waves.wDxA[i]), c));
+            dy = _mm_add_ps(dy, _mm_mul_ps(_mm_set1_ps(waves.wDyA[i]), c));
+        }
+
+        float hs[4], nx[4], ny[4];
+        _mm_storeu_ps(hs, h);
+        _mm_storeu_ps(nx, _mm_sub_ps(_mm_setzero_ps(), dx));
+        _mm_storeu_ps(ny, _mm_sub_ps(_mm_setzero_ps(), dy));
+        for (int k = 0; k < 4 && j + k < count; k ++) {
+            float* v = out + (j + k) * 6;
+            v[0] = x; v[1] = hs[k]; v[2] = lanes[k];
+            v[3] = nx[k]; v[4] = ny[k]; v[5] = 1;
+        }
+    }
+}
+
+/**
+ * @brief Evaluates a row of the grid eight points at a time
+ *
+ * @param waves Waves to sum
+ * @param x x coordinate shared by the row
+ * @param z z coordinate of each point
+ * @param count Number of points
+ * @param out Receives 6 floats per point
+ */
+TARGET_AVX2 void evaluateRowAVX2(const WaveSet& waves, float x, const float* z, int count, float* out) {
+    const int n = waves.count();
+    for (int j = 0; j < count; j += 8) {
+        float lanes[8];
+        for (int k = 0; k < 8; k ++)
+            lanes[k] = z[j + k < count ? j + k : count - 1];
+        __m256 vz = _mm256_loadu_ps(lanes);
+
+        __m256 h = _mm256_setzero_ps(), dx = _mm256_setzero_ps(), dy = _mm256_setzero_ps();
+        for (int i = 0; i < n; i ++) {
+            // separate multiplies and adds (no FMA), so rounding matches the other evaluators
+            __m256 arg = _mm256_add_ps(_mm256_set1_ps(waves.Dx[i] * x), _mm256_mul_ps(_mm256_set1_ps(waves.Dy[i]), vz));
+            arg = _mm256_add_ps(_mm256_mul_ps(arg, _mm256_set1_ps(waves.w[i])), _mm256_set1_ps(waves.phase[i]));
+            __m256 s, c;
+            sincos8(arg, s, c);
+            h = _mm256_add_ps(h, _mm256_mul_ps(_mm256_set1_ps(waves.A[i]), s));
+            dx = _mm256_add_ps(dx, _mm256_mul_ps(_mm256_set1_ps(waves.wDxA[i]), c));
+            dy = _mm256_add_ps(dy, _mm256_mul_ps(_mm256_set1_ps(waves.wDyA[i]), c));
+        }
+
+        float hs[8], nx[8], ny[8];
+        _mm256_storeu_ps(hs, h);
+        _mm256_storeu_ps(nx, _mm256_sub_ps(_mm256_setzero_ps(), dx));
+        _mm256_storeu_ps(ny, _mm256_sub_ps(_mm256_setzero_ps(), dy));
+        for (int k = 0; k < 8 && j + k < count; k ++) {
+            float* v = out + (j + k) * 6;
+            v[0] = x; v[1] = hs[k]; v[2] = lanes[k];
+            v[3] = nx[k]; v[4] = ny[k]; v[5] = 1;
+        }
+    }
+}
+
+#else
+
+bool cpuHasSSE2() {
+    return false;
+}
+
+bool cpuHasAVX2() {
+    return false;
+}
+
+/**
+ * @brief Stand-in for CPUs without SSE2 or AVX2; Water never selects it, as cpuHasSSE2 and cpuHasAVX2 return false
+ */
+static void evaluateRow(const WaveSet& waves, float x, const float* z, int count, float* out) {
+    for (int j = 0; j < count; j ++) {
+        float h = 0, dx = 0, dy = 0;
+        for (int i = 0; i < waves.count(); i ++) {
+            float arg = (waves.Dx[i] * x + waves.Dy[i] * z[j]) * waves.w[i] + waves.phase[i];
+            h += waves.A[i] * sinf(arg);
+            dx += waves.wDxA[i] * cosf(arg);
+            dy += waves.wDyA[i] * cosf(arg);
+        }
+        float* v = out + j * 6;
+        v[0] = x; v[1] = h; v[2] = z[j];
+        v[3] = 0 - dx; v[4] = 0 - dy; v[5] = 1;
+    }
+}
+
+void evaluateRowSSE2(const WaveSet& waves, float x, const float* z, int count, float* out) {
+    evaluateRow(waves, x, z, count, out);
+}
+
+void evaluateRowAVX2(const WaveSet& waves, float x, const float* z, int count, float* out) {
+    evaluateRow(waves, x, z, count, out);
+}
+
+#endif
@@ -0,0 +1,38 @@
+/**
+ * @file wavesimd.h
+ * @author Eron Ristich (eron@ristich.com)
+ * @brief SSE2 and AVX2 evaluation of the sum of sines, a row of the water grid at a time. Selected at run time, so one binary runs on every x86 CPU
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2022
+ */
+
+#ifndef WAVESIMD_H
+#define WAVESIMD_H
+
+#include <vector>
+using std::vector;
+
+/**
+ * @brief The waves of a Water in structure-of-arrays form, with the products the evaluators share precomputed in the order Water::W and its partials multiply them
+ */
+struct WaveSet {
+    vector<float> A, w, Dx, Dy;
+    vector<float> Sw;           // Si * wi
+    vector<float> wDxA, wDyA;   // wi * Di.x * Ai and wi * Di.y * Ai
+    vector<float> phase;        // (Si * wi) * t wrapped to [0, 2pi), as of the last setTime
+
+    void add(float A, float w, float Dx, float Dy, float S);
+    void setTime(float t);
+    int count() const;
+};
+
+bool cpuHasSSE2();
+bool cpuHasAVX2();
+
+// Both write count vertices (x, H, z, -ddxH, -ddyH, 1) to out, for the points (x, z[0 .. count - 1]) at the time of the last setTime
+void evaluateRowSSE2(const WaveSet& waves, float x, const float* z, int count, float* out);
+void evaluateRowAVX2(const WaveSet& waves, float x, const float* z, int count, float* out);
+
+#endif
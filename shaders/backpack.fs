@@ -1,16 +1,62 @@
 #version 430 core
+#extension GL_ARB_bindless_texture : enable
 out vec4 FragColor;
 
 in vec2 TexCoords;
 in vec3 Normal;
 in vec3 Position;
+in vec3 WorldPosition;
 in vec3 CPosition;
+flat in uint Material;
 
 uniform sampler2D texture_diffuse1;
 
+// with a material table the draw's material supplies the texture instead: a layer of one of the arrays, or a bindless handle
+struct MaterialEntry {
+    int diffuseArray;       // -1 for none
+    int diffuseLayer;
+    uvec2 diffuseHandle;
+};
+layout (std430, binding = 2) readonly buffer Materials { MaterialEntry materials[]; };
+uniform bool materialTable;
+uniform bool bindless;
+uniform sampler2DArray materialArrays[4];
+
+// caustics tiled over everything below the mean water surface (y = 0), fading in over the first unit of depth; off at strength 0
+uniform sampler2D caustics;
+uniform vec2 causticsOrigin;
+uniform float causticsTile;
+uniform float causticsStrength;
+
+vec4 diffuseColor() {
+    if (!materialTable)
+        return texture(texture_diffuse1, TexCoords);
+    MaterialEntry material = materials[Material];
+#ifdef GL_ARB_bindless_texture
+    if (bindless)
+        return material.diffuseHandle != uvec2(0) ? texture(sampler2D(material.diffuseHandle), TexCoords) : vec4(1.0);
+#endif
+    // gradients are taken outside the branch, the array need not be the same for every fragment of a multi-draw
+    vec2 dx = dFdx(TexCoords), dy = dFdy(TexCoords);
+    vec3 uvw = vec3(TexCoords, material.diffuseLayer);
+    switch (material.diffuseArray) {
+        case 0: return textureGrad(materialArrays[0], uvw, dx, dy);
+        case 1: return textureGrad(materialArrays[1], uvw, dx, dy);
+        case 2: return textureGrad(materialArrays[2], uvw, dx, dy);
+        case 3: return textureGrad(materialArrays[3], uvw, dx, dy);
+        default: return vec4(1.0);
+    }
+}
+
 void main() {
     // directional light
     vec3 lightDir = vec3(1, 5, 1);
     float diff = dot(lightDir, Normal);
-    FragColor = texture(texture_diffuse1, TexCoords) * diff;
-}
\ No newline at end of file
+    FragColor = diffuseColor() * diff;
+
+    // fetched outside any branch, submersion varies within a draw
+    if (causticsStrength > 0.0) {
+        float light = texture(caustics, (WorldPosition.xz - causticsOrigin) / causticsTile).r;
+        FragColor.rgb *= mix(1.0, light, causticsStrength * clamp(-WorldPosition.y, 0.0, 1.0));
+    }
+}
@@ -2,21 +2,34 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in uint aSlot;     // visible slot of a meshlet draw (its baseInstance)
+layout (location = 4) in uvec2 aDraw;    // material and visible offset of the draw: per command in batched multi-draws, else constant
 
 out vec2 TexCoords;
 out vec3 Normal;
 out vec3 Position;
+out vec3 WorldPosition;
 out vec3 CPosition;
+flat out uint Material;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 uniform vec3 cameraPos;
 
+// instanced draws read their transform through the list of visible instances compacted by cull.cs, from the section of the level drawn
+uniform bool instanced;
+uniform bool clustered;     // drawing compacted meshlets, one draw per slot, instead of instances
+layout (std430, binding = 0) readonly buffer Instances { mat4 transforms[]; };
+layout (std430, binding = 1) readonly buffer Visible { uint visible[]; };
+
 void main() {
+    mat4 world = instanced ? transforms[visible[aDraw.y + (clustered ? aSlot : uint(gl_InstanceID))]] : model;
     TexCoords = aTexCoords;
+    Material = aDraw.x;
     Normal = aNormal;
     CPosition = cameraPos;
     Position = aPos;
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    WorldPosition = vec3(world * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(WorldPosition, 1.0);
 }
\ No newline at end of file
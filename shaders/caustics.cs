@@ -0,0 +1,75 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// one update of CausticsMap (see caustics.h) in two stages, dispatched in order over the texels: 0 refracts the sun through the
+// surface above each texel and lands the ray depth below the surface, adding its light to the texels around where it lands
+// (wrapping around, so the texture tiles); 1 turns the sums into intensities and clears them for the next update. Texel (u, v)
+// lies under world (originX + u * tile, originZ + v * tile)
+layout (r32ui, binding = 0) uniform coherent uimage2D accumulation;
+layout (r16f, binding = 1) uniform writeonly image2D caustics;
+
+// the water's vertex buffer: x, H, z, -ddxH, -ddyH, 1 per point
+layout (std430, binding = 3) readonly buffer Water { float water[]; };
+
+// index of refraction from air into water
+#define ETA (1.0 / 1.33)
+
+uniform int stage;
+uniform int resolution;
+uniform float tile;
+uniform float depth;
+uniform float fixedScale;   // light of one ray, as an integer
+uniform vec3 sunDir;
+uniform int originX;
+uniform int originZ;
+uniform int sizeX;
+uniform int sizeZ;
+uniform int dimX;
+uniform int dimZ;
+
+// surface gradient (-ddxH, -ddyH) at grid point (i, j), clamped to the grid
+vec2 gradient(int i, int j) {
+    int point = clamp(i, 0, dimX - 1) * dimZ + clamp(j, 0, dimZ - 1);
+    return vec2(water[point * 6 + 3], water[point * 6 + 4]);
+}
+
+void splat(ivec2 p, float weight) {
+    p = ivec2(mod(vec2(p), float(resolution)));
+    imageAtomicAdd(accumulation, p, uint(weight * fixedScale + 0.5));
+}
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (p.x >= resolution || p.y >= resolution)
+        return;
+
+    if (stage == 1) {
+        imageStore(caustics, p, vec4(float(imageLoad(accumulation, p).r) / fixedScale));
+        imageStore(accumulation, p, uvec4(0u));
+        return;
+    }
+
+    // normal interpolated between the four grid points around the texel's world position
+    vec2 world = vec2(originX, originZ) + (vec2(p) + 0.5) / float(resolution) * tile;
+    vec2 g = (world - vec2(originX, originZ)) * vec2(dimX, dimZ) / vec2(sizeX, sizeZ);
+    ivec2 g0 = ivec2(floor(g));
+    vec2 f = g - vec2(g0);
+    vec2 slope = mix(mix(gradient(g0.x, g0.y), gradient(g0.x, g0.y + 1), f.y),
+                     mix(gradient(g0.x + 1, g0.y), gradient(g0.x + 1, g0.y + 1), f.y), f.x);
+    vec3 normal = normalize(vec3(slope.x, 1.0, slope.y));
+
+    // a sun at or below the horizon still lights the water from just above it
+    vec3 light = -normalize(vec3(sunDir.x, max(sunDir.y, 0.05), sunDir.z));
+    vec3 ray = refract(light, normal, ETA);
+    vec3 calm = refract(light, vec3(0.0, 1.0, 0.0), ETA);
+
+    // where the ray lands relative to where it would under a flat surface
+    vec2 offset = ray.xz * (depth / max(-ray.y, 0.05)) - calm.xz * (depth / -calm.y);
+    vec2 land = vec2(p) + offset * float(resolution) / tile;
+    ivec2 l0 = ivec2(floor(land));
+    vec2 w = land - vec2(l0);
+    splat(l0, (1.0 - w.x) * (1.0 - w.y));
+    splat(l0 + ivec2(1, 0), w.x * (1.0 - w.y));
+    splat(l0 + ivec2(0, 1), (1.0 - w.x) * w.y);
+    splat(l0 + ivec2(1, 1), w.x * w.y);
+}
@@ -0,0 +1,114 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// one invocation per meshlet (x) and meshlet slot (y), the first full-detail instances cull.cs kept; surviving meshlets append
+// their triangles to the slot's section of the mesh's compacted index list
+
+struct Command {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+struct Cluster {
+    vec4 sphere;        // object-space centre and radius
+    vec4 cone;          // mean normal and sine of its spread; a sine of 1 never culls
+    uint mesh;
+    uint sourceFirst;   // first index in Sources
+    uint count;
+    uint pad;
+};
+
+layout (std430, binding = 0) readonly buffer Instances { mat4 transforms[]; };
+layout (std430, binding = 1) readonly buffer Visible { uint visible[]; };
+layout (std430, binding = 3) readonly buffer Clusters { Cluster clusters[]; };
+layout (std430, binding = 4) readonly buffer Sources { uint sources[]; };
+layout (std430, binding = 5) writeonly buffer Outputs { uint outputs[]; };
+layout (std430, binding = 6) buffer ClusterCommands { Command clusterCommands[]; };
+layout (std430, binding = 7) buffer Stats { uint fullDetail; uint drawnClusters; uint drawnTriangles; };
+
+uniform uint clusterCount;
+uniform uint slotCount;      // commands per mesh
+uniform vec3 cameraPosition;
+uniform vec4 frustum[6];
+
+// hierarchical-Z pyramid of the previous frame, and the view-projection it was rendered with
+uniform bool useHiZ;
+uniform sampler2D hiz;
+uniform mat4 hizViewProjection;
+uniform vec2 hizSize;
+uniform int hizLevels;
+
+bool outsideFrustum(vec3 center, float radius) {
+    for (int i = 0; i < 6; i ++) {
+        if (dot(frustum[i].xyz, center) + frustum[i].w < -radius * length(frustum[i].xyz))
+            return true;
+    }
+    return false;
+}
+
+bool occluded(vec3 wmin, vec3 wmax) {
+    vec2 uvMin = vec2(1.0), uvMax = vec2(0.0);
+    float zMin = 1.0;
+    for (int i = 0; i < 8; i ++) {
+        vec3 corner = mix(wmin, wmax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = hizViewProjection * vec4(corner, 1.0);
+        // straddles the camera plane: cannot be tested against a screen-space pyramid
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+        uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+        zMin = min(zMin, ndc.z * 0.5 + 0.5);
+    }
+    uvMin = clamp(uvMin, 0.0, 1.0);
+    uvMax = clamp(uvMax, 0.0, 1.0);
+
+    // pick the level where the rectangle spans at most 2x2 texels
+    vec2 extent = (uvMax - uvMin) * hizSize;
+    float level = clamp(ceil(log2(max(max(extent.x, extent.y), 1.0))), 0.0, float(hizLevels - 1));
+
+    float zMax = textureLod(hiz, uvMin, level).r;
+    zMax = max(zMax, textureLod(hiz, vec2(uvMax.x, uvMin.y), level).r);
+    zMax = max(zMax, textureLod(hiz, vec2(uvMin.x, uvMax.y), level).r);
+    zMax = max(zMax, textureLod(hiz, uvMax, level).r);
+
+    return zMin > zMax;
+}
+
+void main() {
+    uint c = gl_GlobalInvocationID.x;
+    uint slot = gl_GlobalInvocationID.y;
+    // fullDetail counts every instance cull.cs kept at full detail, including those past the slots
+    if (c >= clusterCount || slot >= slotCount || slot >= fullDetail)
+        return;
+
+    Cluster cluster = clusters[c];
+    mat4 m = transforms[visible[slot]];
+    float scale = max(length(m[0].xyz), max(length(m[1].xyz), length(m[2].xyz)));
+    vec3 center = (m * vec4(cluster.sphere.xyz, 1.0)).xyz;
+    float radius = cluster.sphere.w * scale;
+
+    if (outsideFrustum(center, radius))
+        return;
+
+    // every triangle faces away when the camera lies inside the cone's back side
+    if (cluster.cone.w < 1.0) {
+        vec3 axis = normalize(mat3(m) * cluster.cone.xyz);
+        vec3 toCluster = center - cameraPosition;
+        if (dot(toCluster, axis) >= cluster.cone.w * length(toCluster) + radius)
+            return;
+    }
+
+    if (useHiZ && occluded(center - vec3(radius), center + vec3(radius)))
+        return;
+
+    uint command = cluster.mesh * slotCount + slot;
+    uint offset = clusterCommands[command].firstIndex + atomicAdd(clusterCommands[command].count, cluster.count);
+    for (uint i = 0u; i < cluster.count; i ++)
+        outputs[offset + i] = sources[cluster.sourceFirst + i];
+    atomicAdd(drawnClusters, 1u);
+    atomicAdd(drawnTriangles, cluster.count / 3u);
+}
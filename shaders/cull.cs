@@ -0,0 +1,139 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+struct Command {
+    uint count;
+    uint instanceCount;
+    uint firstIndex;
+    int baseVertex;
+    uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Instances { mat4 transforms[]; };
+layout (std430, binding = 1) writeonly buffer Visible { uint visible[]; };
+layout (std430, binding = 2) buffer Commands { Command commands[]; };
+layout (std430, binding = 3) buffer Levels { uint levels[]; };
+// full-detail instances seen so far, bound only when culling meshlets (the rest of cluster.cs's counters follow)
+layout (std430, binding = 4) buffer Stats { uint fullDetail; };
+
+uniform uint instanceCount;
+uniform uint meshCount;
+uniform uint clusterSlots;  // entries reserved for cluster.cs at the front of the visible list, 0 without meshlets
+uniform bool meshlets;      // whether this pass hands the first full-detail instances to cluster.cs
+uniform vec3 boundsMin;     // object-space bounds shared by every instance
+uniform vec3 boundsMax;
+uniform vec4 frustum[6];
+
+// level of detail: object-space error of each level, and how many pixels of it are allowed (see selectLod in lod.cpp)
+#define LOD_LEVELS 4
+#define LOD_HYSTERESIS 0.25
+uniform float lodErrors[LOD_LEVELS];
+uniform vec3 cameraPosition;
+uniform float pixelsPerUnit;
+uniform float lodThreshold;
+uniform bool lodUpdate;     // false reuses each instance's last level (mirrored passes)
+
+// hierarchical-Z pyramid of the previous frame, and the view-projection it was rendered with
+uniform bool useHiZ;
+uniform sampler2D hiz;
+uniform mat4 hizViewProjection;
+uniform vec2 hizSize;
+uniform int hizLevels;
+
+bool outsideFrustum(vec3 wmin, vec3 wmax) {
+    for (int i = 0; i < 6; i ++) {
+        vec3 p = mix(wmin, wmax, greaterThanEqual(frustum[i].xyz, vec3(0.0)));
+        if (dot(frustum[i].xyz, p) + frustum[i].w < 0.0)
+            return true;
+    }
+    return false;
+}
+
+bool occluded(vec3 wmin, vec3 wmax) {
+    vec2 uvMin = vec2(1.0), uvMax = vec2(0.0);
+    float zMin = 1.0;
+    for (int i = 0; i < 8; i ++) {
+        vec3 corner = mix(wmin, wmax, vec3(i & 1, (i >> 1) & 1, (i >> 2) & 1));
+        vec4 clip = hizViewProjection * vec4(corner, 1.0);
+        // straddles the camera plane: cannot be tested against a screen-space pyramid
+        if (clip.w <= 0.0)
+            return false;
+        vec3 ndc = clip.xyz / clip.w;
+        uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+        uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+        zMin = min(zMin, ndc.z * 0.5 + 0.5);
+    }
+    uvMin = clamp(uvMin, 0.0, 1.0);
+    uvMax = clamp(uvMax, 0.0, 1.0);
+
+    // pick the level where the rectangle spans at most 2x2 texels
+    vec2 extent = (uvMax - uvMin) * hizSize;
+    float level = clamp(ceil(log2(max(max(extent.x, extent.y), 1.0))), 0.0, float(hizLevels - 1));
+
+    float zMax = textureLod(hiz, uvMin, level).r;
+    zMax = max(zMax, textureLod(hiz, vec2(uvMax.x, uvMin.y), level).r);
+    zMax = max(zMax, textureLod(hiz, vec2(uvMin.x, uvMax.y), level).r);
+    zMax = max(zMax, textureLod(hiz, uvMax, level).r);
+
+    return zMin > zMax;
+}
+
+uint selectLod(float distance, uint current) {
+    if (lodThreshold <= 0.0)
+        return 0u;
+    int level = int(min(current, uint(LOD_LEVELS - 1)));
+    float scale = pixelsPerUnit / max(distance, 1e-3);
+    while (level > 0 && lodErrors[level] * scale > lodThreshold * (1.0 + LOD_HYSTERESIS))
+        level --;
+    while (level + 1 < LOD_LEVELS && lodErrors[level + 1] * scale < lodThreshold * (1.0 - LOD_HYSTERESIS))
+        level ++;
+    return uint(level);
+}
+
+void main() {
+    uint i = gl_GlobalInvocationID.x;
+    if (i >= instanceCount)
+        return;
+
+    // world-space bounds of the transformed object box
+    mat4 m = transforms[i];
+    vec3 wmin = vec3(1e30), wmax = vec3(-1e30);
+    for (int c = 0; c < 8; c ++) {
+        vec3 corner = mix(boundsMin, boundsMax, vec3(c & 1, (c >> 1) & 1, (c >> 2) & 1));
+        vec3 w = (m * vec4(corner, 1.0)).xyz;
+        wmin = min(wmin, w);
+        wmax = max(wmax, w);
+    }
+
+    if (outsideFrustum(wmin, wmax))
+        return;
+    if (useHiZ && occluded(wmin, wmax))
+        return;
+
+    // distance to the bounding sphere, in object units
+    float scale = max(length(m[0].xyz), max(length(m[1].xyz), length(m[2].xyz)));
+    vec3 center = (m * vec4((boundsMin + boundsMax) * 0.5, 1.0)).xyz;
+    float radius = length(boundsMax - boundsMin) * 0.5 * scale;
+    float distance = max(length(cameraPosition - center) - radius, 0.0) / max(scale, 1e-6);
+
+    uint level = levels[i];
+    if (lodUpdate) {
+        level = selectLod(distance, level);
+        levels[i] = level;
+    }
+
+    // the first full-detail instances take a meshlet slot at the front of the list; every other instance is drawn whole from its
+    // level's section after the slots
+    if (level == 0u && meshlets) {
+        uint slot = atomicAdd(fullDetail, 1u);
+        if (slot < clusterSlots) {
+            visible[slot] = i;
+            return;
+        }
+    }
+    uint first = clusterSlots + level * instanceCount;
+
+    // the first command of each level doubles as its compaction counter; the level's other meshes copy it afterwards
+    uint slot = atomicAdd(commands[level * meshCount].instanceCount, 1u);
+    visible[first + slot] = i;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// one update of FoamMap (see foam.h): the coverage of the last update, carried by the drift and decayed, plus foam where the
+// surface is steeper than the threshold. Texel (u, v) lies over world (originX + u * sizeX, originZ + v * sizeZ)
+uniform sampler2D previous;
+layout (r16f, binding = 0) uniform writeonly image2D current;
+
+// the water's vertex buffer: x, H, z, -ddxH, -ddyH, 1 per point
+layout (std430, binding = 3) readonly buffer Water { float water[]; };
+
+uniform int resolution;
+uniform float dt;
+uniform float keep;         // exp(-decay * dt)
+uniform vec2 offset;        // drift over dt, in texture coordinates
+uniform float threshold;
+uniform float gain;
+uniform int originX;
+uniform int originZ;
+uniform int sizeX;
+uniform int sizeZ;
+uniform int dimX;
+uniform int dimZ;
+
+// length of the surface gradient at grid point (i, j), clamped to the grid
+float steepness(int i, int j) {
+    int point = clamp(i, 0, dimX - 1) * dimZ + clamp(j, 0, dimZ - 1);
+    return length(vec2(water[point * 6 + 3], water[point * 6 + 4]));
+}
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (p.x >= resolution || p.y >= resolution)
+        return;
+    vec2 uv = (vec2(p) + 0.5) / float(resolution);
+
+    // steepness interpolated between the four grid points around the texel
+    vec2 g = uv * vec2(dimX, dimZ);
+    ivec2 g0 = ivec2(floor(g));
+    vec2 f = g - vec2(g0);
+    float s = mix(mix(steepness(g0.x, g0.y), steepness(g0.x, g0.y + 1), f.y),
+                  mix(steepness(g0.x + 1, g0.y), steepness(g0.x + 1, g0.y + 1), f.y), f.x);
+
+    float foam = texture(previous, uv - offset).r * keep + max(s - threshold, 0.0) * gain * dt;
+    imageStore(current, p, vec4(clamp(foam, 0.0, 1.0)));
+}
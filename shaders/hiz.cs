@@ -0,0 +1,37 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// level 0 copies the depth buffer, every other level keeps the farthest depth of the 2x2 (or 3x3 at odd edges) texels below it
+uniform int level;
+uniform sampler2D depth;
+
+layout (r32f, binding = 0) uniform readonly image2D src;
+layout (r32f, binding = 1) uniform writeonly image2D dst;
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    ivec2 size = imageSize(dst);
+    if (p.x >= size.x || p.y >= size.y)
+        return;
+
+    if (level == 0) {
+        imageStore(dst, p, vec4(texelFetch(depth, p, 0).r));
+        return;
+    }
+
+    ivec2 srcSize = imageSize(src);
+    ivec2 q = p * 2;
+
+    // odd source dimensions leave a row/column that only the last texel covers
+    int extentX = (p.x == size.x - 1 && (srcSize.x & 1) == 1) ? 3 : 2;
+    int extentY = (p.y == size.y - 1 && (srcSize.y & 1) == 1) ? 3 : 2;
+
+    float d = 0.0;
+    for (int y = 0; y < extentY; y ++) {
+        for (int x = 0; x < extentX; x ++) {
+            ivec2 t = min(q + ivec2(x, y), srcSize - 1);
+            d = max(d, imageLoad(src, t).r);
+        }
+    }
+    imageStore(dst, p, vec4(d));
+}
\ No newline at end of file
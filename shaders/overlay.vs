@@ -0,0 +1,19 @@
+#version 430 core
+// one instance per quad, corners generated from gl_VertexID (drawn as a 4-vertex triangle strip)
+layout (location = 0) in vec4 aRect;    // x, y, width, height in pixels, origin top left
+layout (location = 1) in vec4 aUV;      // u0, v0, u1, v1 in the glyph atlas
+layout (location = 2) in vec4 aColor;
+
+out vec2 TexCoords;
+out vec4 Color;
+
+uniform vec2 screen;
+
+void main() {
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec2 pos = aRect.xy + corner * aRect.zw;
+
+    TexCoords = mix(aUV.xy, aUV.zw, corner);
+    Color = aColor;
+    gl_Position = vec4(pos.x / screen.x * 2.0 - 1.0, 1.0 - pos.y / screen.y * 2.0, 0.0, 1.0);
+}
\ No newline at end of file
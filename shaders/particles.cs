@@ -0,0 +1,161 @@
+#version 430 core
+layout (local_size_x = 256) in;
+
+// one step of SprayParticles (see particles.h) in three stages, dispatched in order: 0 simulates the particles of source and appends
+// the survivors to target, 1 appends the particles the water's steep points emit, 2 turns the append count into the next step's
+// dispatch and this step's draw. Every formula has a twin in particles.cpp, used by the CPU reference
+struct Particle {
+    vec4 position;  // xyz, w: seconds left to live
+    vec4 velocity;  // xyz, w: 0 for spray, 1 for foam
+};
+layout (std430, binding = 0) readonly buffer Source { Particle source[]; };
+layout (std430, binding = 1) writeonly buffer Target { Particle target[]; };
+layout (std430, binding = 2) buffer State {
+    uint dispatchX, dispatchY, dispatchZ;   // DispatchIndirectCommand over the particles of source
+    uint drawCount, drawInstances, drawFirst, drawBaseInstance;     // DrawArraysIndirectCommand of target once finalized
+    uint appended;      // particles appended to target this step, possibly past the capacity
+    uint emitted;       // of them, emitted this step
+    uint lastEmitted;   // emitted by the last finalized step
+};
+// the water's vertex buffer: x, H, z, -ddxH, -ddyH, 1 per point
+layout (std430, binding = 3) readonly buffer Water { float water[]; };
+
+// mirror particles.h
+#define GRAVITY 9.81
+#define DRAG 0.8
+#define SPRAY_SPEED 1.5
+#define SPRAY_LIFE 2.0
+#define FOAM_LIFE 4.0
+#define FOAM_KEEP 0.3
+
+uniform int stage;
+uniform uint capacity;
+uniform float dt;
+uniform uint seed;
+uniform float threshold;
+uniform float rate;
+uniform int originX;
+uniform int originZ;
+uniform int sizeX;
+uniform int sizeZ;
+uniform int dimX;
+uniform int dimZ;
+
+shared uint groupCount;
+shared uint groupBase;
+
+// integer hash (lowbias32) and a float in [0, 1) from it
+uint hash(uint x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float random(uint x) {
+    return float(hash(x) >> 8) / 16777216.0;
+}
+
+// index of the grid point nearest a position, -1 off the grid
+int nearestPoint(vec3 p) {
+    int i = int(floor((p.x - float(originX)) * float(dimX) / float(sizeX) + 0.5));
+    int j = int(floor((p.z - float(originZ)) * float(dimZ) / float(sizeZ) + 0.5));
+    if (i < 0 || j < 0 || i >= dimX || j >= dimZ)
+        return -1;
+    return i * dimZ + j;
+}
+
+// advances a particle by dt, returning whether it is still alive. Spray reaching the surface becomes foam, which follows it
+bool simulate(inout Particle p) {
+    bool foam = p.velocity.w > 0.5;
+    p.position.w -= dt;
+    if (!foam)
+        p.velocity.y -= GRAVITY * dt;
+    p.velocity.xyz *= max(0.0, 1.0 - DRAG * dt);
+    p.position.xyz += p.velocity.xyz * dt;
+
+    int point = nearestPoint(p.position.xyz);
+    if (p.position.w <= 0.0 || point < 0)
+        return false;
+    float surface = water[point * 6 + 1];
+    if (foam) {
+        p.position.y = surface;
+    } else if (p.position.y <= surface) {
+        p.position = vec4(p.position.x, surface, p.position.z, FOAM_LIFE);
+        p.velocity = vec4(p.velocity.x * FOAM_KEEP, 0.0, p.velocity.z * FOAM_KEEP, 1.0);
+    }
+    return true;
+}
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+
+    // survivors are compacted by group, one global atomic per group
+    if (stage == 0) {
+        if (gl_LocalInvocationIndex == 0u)
+            groupCount = 0u;
+        barrier();
+        Particle p;
+        bool alive = false;
+        uint local = 0u;
+        if (id < drawCount) {
+            p = source[id];
+            alive = simulate(p);
+            if (alive)
+                local = atomicAdd(groupCount, 1u);
+        }
+        barrier();
+        if (gl_LocalInvocationIndex == 0u)
+            groupBase = atomicAdd(appended, groupCount);
+        barrier();
+        if (alive)
+            target[groupBase + local] = p;
+        return;
+    }
+
+    // each point emits in proportion to how far its slope exceeds the threshold, rounding at random
+    if (stage == 1) {
+        if (id >= uint(dimX * dimZ))
+            return;
+        vec2 slope = vec2(water[id * 6u + 3u], water[id * 6u + 4u]);
+        float steepness = length(slope);
+        if (steepness <= threshold)
+            return;
+        uint key = hash(id ^ hash(seed));
+        uint count = uint(floor((steepness - threshold) * rate * dt + random(key)));
+        if (count == 0u)
+            return;
+        uint base = atomicAdd(appended, count);
+        if (base >= capacity)
+            return;
+        count = min(count, capacity - base);
+        atomicAdd(emitted, count);
+
+        vec3 origin = vec3(water[id * 6u], water[id * 6u + 1u], water[id * 6u + 2u]);
+        vec3 normal = normalize(vec3(slope.x, 1.0, slope.y));
+        vec2 cell = vec2(float(sizeX) / float(dimX), float(sizeZ) / float(dimZ));
+        for (uint k = 0u; k < count; k ++) {
+            uint r = key + 4u * k;
+            Particle p;
+            p.position = vec4(origin + vec3((random(r + 1u) - 0.5) * cell.x, 0.0, (random(r + 2u) - 0.5) * cell.y), SPRAY_LIFE * (0.5 + 0.5 * random(r + 3u)));
+            p.velocity = vec4(normal * SPRAY_SPEED * (0.5 + random(r + 4u)), 0.0);
+            target[base + k] = p;
+        }
+        return;
+    }
+
+    if (id != 0u)
+        return;
+    drawCount = min(appended, capacity);
+    drawInstances = 1u;
+    drawFirst = 0u;
+    drawBaseInstance = 0u;
+    dispatchX = (drawCount + 255u) / 256u;
+    dispatchY = 1u;
+    dispatchZ = 1u;
+    lastEmitted = emitted;
+    appended = 0u;
+    emitted = 0u;
+}
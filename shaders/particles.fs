@@ -0,0 +1,14 @@
+#version 430 core
+out vec4 FragColor;
+
+in float Alpha;
+in float Foam;
+
+void main() {
+    // round, soft-edged points
+    vec2 d = gl_PointCoord * 2.0 - 1.0;
+    float r2 = dot(d, d);
+    if (r2 > 1.0)
+        discard;
+    FragColor = vec4(mix(vec3(0.85, 0.9, 0.95), vec3(1.0), Foam), Alpha * (1.0 - r2));
+}
@@ -0,0 +1,30 @@
+#version 430 core
+
+// one point per particle of the buffer particles.cs last wrote, drawn without vertex attributes
+struct Particle {
+    vec4 position;  // xyz, w: seconds left to live
+    vec4 velocity;  // xyz, w: 0 for spray, 1 for foam
+};
+layout (std430, binding = 0) readonly buffer Particles { Particle particles[]; };
+
+out float Alpha;
+out float Foam;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float pixelsPerUnit;    // at a distance of one unit
+uniform float spraySize;
+uniform float foamSize;
+uniform float foamLife;
+
+void main() {
+    Particle p = particles[gl_VertexID];
+    bool foam = p.velocity.w > 0.5;
+    vec4 eye = view * vec4(p.position.xyz, 1.0);
+    gl_Position = projection * eye;
+    gl_PointSize = max(1.0, (foam ? foamSize : spraySize) * pixelsPerUnit / max(-eye.z, 0.001));
+
+    // spray fades over its last half second, foam over its whole life
+    Alpha = foam ? 0.6 * clamp(p.position.w / foamLife, 0.0, 1.0) : 0.8 * clamp(p.position.w * 2.0, 0.0, 1.0);
+    Foam = foam ? 1.0 : 0.0;
+}
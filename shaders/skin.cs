@@ -0,0 +1,56 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// one invocation per vertex: the bind-pose Vertex is copied with its position, normal, tangent and bitangent deformed by its
+// weighted bones. Vertices are read as floats (bone ids as their bits), offsets in floats from the start of a Vertex
+layout (std430, binding = 0) readonly buffer Source { float source[]; };
+layout (std430, binding = 1) writeonly buffer Skinned { float skinned[]; };
+layout (std430, binding = 2) readonly buffer Palette { mat4 bones[]; };
+
+uniform uint vertexCount;
+uniform uint stride;
+uniform uint normalOffset;
+uniform uint tangentOffset;
+uniform uint bitangentOffset;
+uniform uint boneOffset;
+uniform uint weightOffset;
+
+vec3 load(uint at) {
+    return vec3(source[at], source[at + 1u], source[at + 2u]);
+}
+
+void store(uint at, vec3 v) {
+    skinned[at] = v.x;
+    skinned[at + 1u] = v.y;
+    skinned[at + 2u] = v.z;
+}
+
+void main() {
+    uint v = gl_GlobalInvocationID.x;
+    if (v >= vertexCount)
+        return;
+    uint base = v * stride;
+
+    mat4 skin = mat4(0.0);
+    float total = 0.0;
+    for (uint k = 0u; k < 4u; k ++) {
+        float weight = source[base + weightOffset + k];
+        if (weight > 0.0) {
+            skin += bones[floatBitsToInt(source[base + boneOffset + k])] * weight;
+            total += weight;
+        }
+    }
+    // vertices bound to no bone keep their bind pose
+    if (total <= 0.0)
+        skin = mat4(1.0);
+
+    for (uint i = 0u; i < stride; i ++)
+        skinned[base + i] = source[base + i];
+
+    mat3 linear = mat3(skin);
+    store(base, (skin * vec4(load(base), 1.0)).xyz);
+    vec3 normal = linear * load(base + normalOffset);
+    store(base + normalOffset, dot(normal, normal) > 0.0 ? normalize(normal) : normal);
+    store(base + tangentOffset, linear * load(base + tangentOffset));
+    store(base + bitangentOffset, linear * load(base + bitangentOffset));
+}
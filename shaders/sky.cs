@@ -0,0 +1,147 @@
+#version 430 core
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// pass 0 fills the transmittance LUT, pass 1 the sky-view LUT (which reads the transmittance LUT)
+uniform int pass;
+uniform vec3 sunDir;
+uniform float sunIntensity;
+
+layout (rgba16f, binding = 0) uniform image2D transmittanceLUT;
+layout (rgba16f, binding = 1) uniform writeonly image2D skyViewLUT;
+
+const float PI = 3.14159265;
+
+// planet and atmosphere, in kilometers
+const float groundRadius = 6360.0;
+const float atmosphereRadius = 6460.0;
+const float viewerHeight = 0.2;
+
+// scattering/absorption coefficients, per kilometer
+const vec3 rayleighScattering = vec3(5.802, 13.558, 33.1) * 1e-3;
+const float rayleighHeight = 8.0;
+const float mieScattering = 3.996e-3;
+const float mieExtinction = 4.40e-3;
+const float mieHeight = 1.2;
+const vec3 ozoneAbsorption = vec3(0.650, 1.881, 0.085) * 1e-3;
+
+// distance along a ray from inside a sphere to its surface, or -1 if the ray misses
+float raySphere(vec3 ro, vec3 rd, float radius) {
+    float b = dot(ro, rd);
+    float c = dot(ro, ro) - radius * radius;
+    float d = b * b - c;
+    if (d < 0.0)
+        return -1.0;
+    float s = sqrt(d);
+    if (-b - s > 0.0)
+        return -b - s;
+    if (-b + s > 0.0)
+        return -b + s;
+    return -1.0;
+}
+
+// scattering (rgb: rayleigh, a: mie) and extinction at an altitude above ground
+void medium(float altitude, out vec3 rayleigh, out float mie, out vec3 extinction) {
+    float rDensity = exp(-altitude / rayleighHeight);
+    float mDensity = exp(-altitude / mieHeight);
+    float oDensity = max(0.0, 1.0 - abs(altitude - 25.0) / 15.0);
+
+    rayleigh = rayleighScattering * rDensity;
+    mie = mieScattering * mDensity;
+    extinction = rayleigh + mieExtinction * mDensity + ozoneAbsorption * oDensity;
+}
+
+// transmittance LUT parameterization: u - cosine of the zenith angle, v - height through the atmosphere
+vec3 sampleTransmittance(float radius, float cosZenith) {
+    ivec2 size = imageSize(transmittanceLUT);
+    vec2 uv = vec2(cosZenith * 0.5 + 0.5, (radius - groundRadius) / (atmosphereRadius - groundRadius));
+    ivec2 p = clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1);
+    return imageLoad(transmittanceLUT, p).rgb;
+}
+
+void transmittancePass(ivec2 p, ivec2 size) {
+    vec2 uv = (vec2(p) + 0.5) / vec2(size);
+    float cosZenith = uv.x * 2.0 - 1.0;
+    float radius = mix(groundRadius, atmosphereRadius, uv.y);
+
+    vec3 ro = vec3(0.0, radius, 0.0);
+    vec3 rd = vec3(sqrt(max(0.0, 1.0 - cosZenith * cosZenith)), cosZenith, 0.0);
+
+    // blocked by the planet
+    float ground = raySphere(ro, rd, groundRadius);
+    if (ground > 0.0) {
+        imageStore(transmittanceLUT, p, vec4(0.0, 0.0, 0.0, 1.0));
+        return;
+    }
+
+    float len = raySphere(ro, rd, atmosphereRadius);
+    const int steps = 40;
+    float dt = len / float(steps);
+    vec3 depth = vec3(0.0);
+    for (int i = 0; i < steps; i ++) {
+        vec3 pos = ro + rd * (float(i) + 0.5) * dt;
+        vec3 rayleigh, extinction; float mie;
+        medium(length(pos) - groundRadius, rayleigh, mie, extinction);
+        depth += extinction * dt;
+    }
+    imageStore(transmittanceLUT, p, vec4(exp(-depth), 1.0));
+}
+
+// sky-view LUT parameterization: u - azimuth relative to the sun, v - elevation, squeezed toward the horizon
+vec3 skyViewDirection(vec2 uv) {
+    float azimuth = (uv.x * 2.0 - 1.0) * PI;
+    float v = uv.y * 2.0 - 1.0;
+    float elevation = sign(v) * v * v * PI * 0.5;
+    return vec3(cos(elevation) * cos(azimuth), sin(elevation), cos(elevation) * sin(azimuth));
+}
+
+void skyViewPass(ivec2 p, ivec2 size) {
+    vec2 uv = (vec2(p) + 0.5) / vec2(size);
+
+    // sun is placed at azimuth 0 of the LUT
+    vec3 rd = skyViewDirection(uv);
+    vec3 sun = normalize(vec3(length(sunDir.xz), sunDir.y, 0.0));
+    vec3 ro = vec3(0.0, groundRadius + viewerHeight, 0.0);
+
+    float len = raySphere(ro, rd, atmosphereRadius);
+    float ground = raySphere(ro, rd, groundRadius);
+    if (ground > 0.0)
+        len = ground;
+
+    float mu = dot(rd, sun);
+    float rayleighPhase = 3.0 / (16.0 * PI) * (1.0 + mu * mu);
+    const float g = 0.8;
+    float miePhase = 3.0 / (8.0 * PI) * ((1.0 - g * g) * (1.0 + mu * mu)) / ((2.0 + g * g) * pow(1.0 + g * g - 2.0 * g * mu, 1.5));
+
+    const int steps = 30;
+    float dt = len / float(steps);
+    vec3 luminance = vec3(0.0);
+    vec3 throughput = vec3(1.0);
+    for (int i = 0; i < steps; i ++) {
+        vec3 pos = ro + rd * (float(i) + 0.5) * dt;
+        float radius = length(pos);
+        vec3 rayleigh, extinction; float mie;
+        medium(radius - groundRadius, rayleigh, mie, extinction);
+
+        vec3 sunTransmittance = sampleTransmittance(radius, dot(pos / radius, sun));
+        vec3 scattered = (rayleigh * rayleighPhase + mie * miePhase) * sunTransmittance;
+
+        // analytic integration of scattering over the step
+        vec3 stepTransmittance = exp(-extinction * dt);
+        luminance += throughput * scattered * (1.0 - stepTransmittance) / max(extinction, vec3(1e-6));
+        throughput *= stepTransmittance;
+    }
+    imageStore(skyViewLUT, p, vec4(luminance * sunIntensity, 1.0));
+}
+
+void main() {
+    ivec2 p = ivec2(gl_GlobalInvocationID.xy);
+    if (pass == 0) {
+        ivec2 size = imageSize(transmittanceLUT);
+        if (p.x < size.x && p.y < size.y)
+            transmittancePass(p, size);
+    } else {
+        ivec2 size = imageSize(skyViewLUT);
+        if (p.x < size.x && p.y < size.y)
+            skyViewPass(p, size);
+    }
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#version 430 core
+out vec4 FragColor;
+
+in vec2 NDC;
+
+uniform sampler2D skyView;
+uniform sampler2D transmittance;
+
+uniform mat3 invViewRot;    // view-to-world rotation
+uniform vec4 projScale;     // projection[0][0], projection[1][1], projection[2][0], projection[2][1]
+uniform vec3 sunDir;
+uniform float sunIntensity;
+uniform float exposure;
+
+const float PI = 3.14159265;
+
+// inverse of the sky-view LUT parameterization in sky.cs
+vec2 skyViewUV(vec3 dir) {
+    float azimuth = atan(dir.z, dir.x) - atan(sunDir.z, sunDir.x);
+    azimuth = mod(azimuth + PI, 2.0 * PI) - PI;
+    float elevation = asin(clamp(dir.y, -1.0, 1.0));
+    float v = sign(elevation) * sqrt(abs(elevation) / (PI * 0.5));
+    return vec2(azimuth / (2.0 * PI) + 0.5, v * 0.5 + 0.5);
+}
+
+void main() {
+    // only the x/y rows of the projection are used, so oblique (reflection) projections work unchanged
+    vec3 viewDir = vec3((NDC.x + projScale.z) / projScale.x, (NDC.y + projScale.w) / projScale.y, -1.0);
+    vec3 dir = normalize(invViewRot * viewDir);
+
+    vec3 luminance = texture(skyView, skyViewUV(dir)).rgb;
+
+    // sun disk, attenuated by the atmosphere along the view ray
+    float cosSun = dot(dir, sunDir);
+    if (cosSun > 0.99996) {
+        vec3 sunTransmittance = texture(transmittance, vec2(sunDir.y * 0.5 + 0.5, 0.002)).rgb;
+        luminance += sunTransmittance * sunIntensity;
+    }
+
+    FragColor = vec4(1.0 - exp(-luminance * exposure), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#version 430 core
+
+// fullscreen triangle generated from gl_VertexID, no vertex buffer required
+out vec2 NDC;
+
+void main() {
+    vec2 pos = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2) * 2.0 - 1.0;
+    NDC = pos;
+    // z = w, so the sky sits on the far plane like the skybox cube did
+    gl_Position = vec4(pos, 1.0, 1.0);
+}
\ No newline at end of file
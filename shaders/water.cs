@@ -0,0 +1,46 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// the water's vertex buffer: x, H, z, -ddxH, -ddyH, 1 per point, laid out as Water::evaluate writes it
+layout (std430, binding = 0) writeonly buffer Vertices { float vertices[]; };
+// per wave: (A, w, D.x, D.y) and (S * w, w * D.x * A, w * D.y * A, 0)
+layout (std430, binding = 1) readonly buffer Waves { vec4 waves[]; };
+
+uniform int originX;    // pX - pW / 2
+uniform int originZ;    // pZ - pL / 2
+uniform int sizeX;      // pW
+uniform int sizeZ;      // pL
+uniform int dimX;
+uniform int dimZ;
+uniform int waveCount;
+uniform float time;
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(dimX * dimZ))
+        return;
+    int i = int(id) / dimZ;
+    int j = int(id) % dimZ;
+
+    // same operations, in the same order, as the CPU evaluators; precise keeps the compiler from fusing them
+    precise float x = float(originX) + float(i) * float(sizeX) / float(dimX);
+    precise float z = float(originZ) + float(j) * float(sizeZ) / float(dimZ);
+
+    precise float h = 0.0, ddx = 0.0, ddy = 0.0;
+    for (int k = 0; k < waveCount; k ++) {
+        vec4 wave = waves[2 * k];
+        vec4 partials = waves[2 * k + 1];
+        precise float phase = (wave.z * x + wave.w * z) * wave.y + partials.x * time;
+        h += wave.x * sin(phase);
+        ddx += partials.y * cos(phase);
+        ddy += partials.z * cos(phase);
+    }
+
+    uint v = id * 6u;
+    vertices[v + 0u] = x;
+    vertices[v + 1u] = h;
+    vertices[v + 2u] = z;
+    vertices[v + 3u] = 0.0 - ddx;
+    vertices[v + 4u] = 0.0 - ddy;
+    vertices[v + 5u] = 1.0;
+}
\ No newline at end of file
@@ -7,6 +7,40 @@ in vec3 CPosition;
 
 uniform samplerCube skybox;
 
+// planar reflection, rendered in screen space about the mean water plane
+uniform sampler2D reflection;
+uniform bool planarReflection;
+uniform vec2 viewport;
+uniform float distortion;
+
+// procedural sky, shared with sky.fs
+uniform sampler2D skyView;
+uniform bool proceduralSky;
+uniform vec3 sunDir;
+uniform float exposure;
+
+// accumulated foam coverage over the water (see foam.cs); with no texture bound it reads 0
+uniform sampler2D foamMap;
+uniform vec2 foamOrigin;
+uniform vec2 foamSize;
+
+const float PI = 3.14159265;
+
+// inverse of the sky-view LUT parameterization in sky.cs
+vec2 skyViewUV(vec3 dir) {
+    float azimuth = atan(dir.z, dir.x) - atan(sunDir.z, sunDir.x);
+    azimuth = mod(azimuth + PI, 2.0 * PI) - PI;
+    float elevation = asin(clamp(dir.y, -1.0, 1.0));
+    float v = sign(elevation) * sqrt(abs(elevation) / (PI * 0.5));
+    return vec2(azimuth / (2.0 * PI) + 0.5, v * 0.5 + 0.5);
+}
+
+vec3 sky(vec3 dir) {
+    if (proceduralSky)
+        return 1.0 - exp(-texture(skyView, skyViewUV(dir)).rgb * exposure);
+    return texture(skybox, dir).rgb;
+}
+
 void main() {
     // directional light
     /*vec3 lightDir = vec3(1, 5, 1);
@@ -14,5 +48,12 @@ void main() {
     FragColor = vec4(Normal, 1);*/
     vec3 I = normalize(Position - CPosition);
     vec3 R = reflect(I, normalize(Normal));
-    FragColor = vec4(texture(skybox, R).rgb, 1) * 0.7;
+    if (planarReflection) {
+        // water normals carry the surface gradient in xy; offset the lookup by it to fake ripples
+        vec2 uv = gl_FragCoord.xy / viewport + normalize(Normal).xy * distortion;
+        FragColor = vec4(texture(reflection, clamp(uv, 0.001, 0.999)).rgb, 1) * 0.7;
+    } else
+        FragColor = vec4(sky(R), 1) * 0.7;
+    float foam = texture(foamMap, (Position.xz - foamOrigin) / foamSize).r;
+    FragColor.rgb = mix(FragColor.rgb, vec3(0.9), foam);
 }
\ No newline at end of file